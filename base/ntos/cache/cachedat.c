@@ -29,6 +29,13 @@ LIST_ENTRY CcCleanSharedCacheMapList;
 SHARED_CACHE_MAP_LIST_CURSOR CcDirtySharedCacheMapList;
 SHARED_CACHE_MAP_LIST_CURSOR CcLazyWriterCursor;
 
+//
+//  Source of PrivateCacheMap read ahead generations, see CcPerformReadAhead.
+//  Synchronized by CcMasterSpinLock.
+//
+
+ULONG CcPrivateCacheMapGeneration;
+
 //
 //  Worker thread structures:
 //
@@ -39,6 +46,8 @@ SHARED_CACHE_MAP_LIST_CURSOR CcLazyWriterCursor;
 //      A listhead for an express queue of WORK_QUEUE_ENTRYs
 //      A listhead for a regular queue of WORK_QUEUE_ENTRYs
 //      A listhead for a post-tick queue of WORK_QUEUE_ENTRYs
+//      A listhead for the volumes with write behind WORK_QUEUE_ENTRYs
+//      The number of worker threads that may process one volume at once
 //
 //      A flag indicating if we are throttling the queue to a single thread
 //
@@ -50,6 +59,18 @@ LIST_ENTRY CcIdleWorkerThreadList;
 LIST_ENTRY CcExpressWorkQueue;
 LIST_ENTRY CcRegularWorkQueue;
 LIST_ENTRY CcPostTickWorkQueue;
+LIST_ENTRY CcVolumeWorkQueueList;
+ULONG CcVolumeWorkSequence;
+ULONG CcVolumeWorkerThreads;
+
+//
+//  The list of Volume Cache Maps, and the one used for SharedCacheMaps
+//  when a Volume Cache Map cannot be allocated.  Synchronized by
+//  CcMasterSpinLock.
+//
+
+LIST_ENTRY CcVolumeCacheMapList;
+VOLUME_CACHE_MAP CcDefaultVolumeCacheMap;
 
 BOOLEAN CcQueueThrottle = FALSE;
 
@@ -73,6 +94,13 @@ LARGE_INTEGER CcTargetCleanDelay = {(ULONG)-(LONG)(LAZY_WRITER_IDLE_DELAY * (LAZ
 // extern KSPIN_LOCK CcVacbSpinLock;
 ULONG_PTR CcNumberVacbs;
 
+//
+//  TRUE if the system cache has enough views to map view groups for big
+//  streams.
+//
+
+LOGICAL CcViewGroups;
+
 //
 //  Pointer to the global Vacb vector.
 //
@@ -177,6 +205,12 @@ ULONG CcCopyReadWait;
 ULONG CcCopyReadNoWaitMiss;
 ULONG CcCopyReadWaitMiss;
 
+//
+//  Pages handed over to user buffers by copy reads instead of copied.
+//
+
+ULONG CcCopyReadTransferPages;
+
 ULONG CcMdlReadNoWait;
 ULONG CcMdlReadWait;
 ULONG CcMdlReadNoWaitMiss;
@@ -184,6 +218,24 @@ ULONG CcMdlReadWaitMiss;
 
 ULONG CcReadAheadIos;
 
+//
+//  Reads that were already covered by stream read ahead, and pages read
+//  ahead for streams that were abandoned before reading them.
+//
+
+ULONG CcReadAheadHits;
+ULONG CcReadAheadWastedPages;
+
+//
+//  View misses taken by callers of CcGetVirtualAddress, views which had to
+//  be unmapped from another range to satisfy a miss, and the number of
+//  view groups mapped.
+//
+
+ULONG CcVacbMisses;
+ULONG CcVacbRemaps;
+ULONG CcViewGroupMaps;
+
 ULONG CcLazyWriteHotSpots;
 ULONG CcLazyWriteIos;
 ULONG CcLazyWritePages;
@@ -101,6 +101,14 @@ CcFindBitmapRangeToClean (
     IN LONGLONG Page
     );
 
+PREAD_AHEAD_STREAM
+CcFindReadAheadStream (
+    IN PPRIVATE_CACHE_MAP PrivateCacheMap,
+    IN PLARGE_INTEGER FileOffset,
+    IN PLARGE_INTEGER BeyondLastByte,
+    IN ULONG Window
+    );
+
 BOOLEAN
 CcLogError(
     IN PFILE_OBJECT FileObject,
@@ -1237,6 +1245,139 @@ Return Value:
 }
 
 
+//
+//  Internal support routine
+//
+
+PREAD_AHEAD_STREAM
+CcFindReadAheadStream (
+    IN PPRIVATE_CACHE_MAP PrivateCacheMap,
+    IN PLARGE_INTEGER FileOffset,
+    IN PLARGE_INTEGER BeyondLastByte,
+    IN ULONG Window
+    )
+
+/*++
+
+Routine Description:
+
+    This routine matches a read against the sequential streams tracked in
+    the PrivateCacheMap, and records the read in the stream it belongs to.
+
+    A read continues a stream if it starts anywhere from the end of the
+    last read of the stream (ignoring NOISE_BITS) up to the read ahead high
+    water mark of the stream, since reads satisfied from the cache while
+    read ahead was disabled do not update the stream.  The window of a
+    continued stream is doubled.
+
+    A read that continues no stream starts a new one in place of the least
+    recently read stream.  Any data read ahead for the replaced stream and
+    not read since is counted as wasted.
+
+    The caller must hold the ReadAheadSpinLock.
+
+Arguments:
+
+    PrivateCacheMap - Supplies the PrivateCacheMap the read was made through.
+
+    FileOffset - Supplies the offset of the read.
+
+    BeyondLastByte - Supplies the offset just beyond the read.
+
+    Window - Supplies the minimum read ahead window, which is the length
+             of the read rounded up to the read ahead granularity.
+
+Return Value:
+
+    The stream the read continues, or NULL if the read starts a new stream
+    anywhere other than at the start of the file.
+
+--*/
+
+{
+    PREAD_AHEAD_STREAM Stream;
+    PREAD_AHEAD_STREAM Victim = NULL;
+    LONGLONG Unread;
+    ULONG Clock;
+    ULONG i;
+
+    Clock = PrivateCacheMap->ReadAheadStreamClock += 1;
+
+    for (i = 0; i < CC_READ_AHEAD_STREAMS; i += 1) {
+
+        Stream = &PrivateCacheMap->ReadAheadStreams[i];
+
+        if (Stream->Window == 0) {
+
+            if ((Victim == NULL) || (Victim->Window != 0)) {
+                Victim = Stream;
+            }
+            continue;
+        }
+
+        if (((FileOffset->QuadPart & ~(LONGLONG)NOISE_BITS)
+               >= (Stream->BeyondLastByte.QuadPart & ~(LONGLONG)NOISE_BITS))
+
+                &&
+
+            (FileOffset->QuadPart <= Stream->ReadAheadHighWater.QuadPart)) {
+
+            Stream->BeyondLastByte = *BeyondLastByte;
+            Stream->LastUsed = Clock;
+
+            if (Stream->Window < CC_MAX_READ_AHEAD_WINDOW) {
+                Stream->Window <<= 1;
+            }
+
+            if (Stream->Window < Window) {
+                Stream->Window = Window;
+            }
+
+            return Stream;
+        }
+
+        if ((Victim == NULL) ||
+            ((Victim->Window != 0) &&
+             ((Clock - Stream->LastUsed) > (Clock - Victim->LastUsed)))) {
+
+            Victim = Stream;
+        }
+    }
+
+    //
+    //  Count what was read ahead for the stream being replaced, beyond its
+    //  last read, as wasted.  Pending read ahead was never issued.
+    //
+
+    if (Victim->Window != 0) {
+
+        Unread = Victim->ReadAheadHighWater.QuadPart -
+                 (LONGLONG)Victim->PendingLength -
+                 Victim->BeyondLastByte.QuadPart;
+
+        if (Unread > 0) {
+            CcReadAheadWastedPages += (ULONG)(Unread >> PAGE_SHIFT);
+        }
+    }
+
+    Victim->BeyondLastByte = *BeyondLastByte;
+    Victim->ReadAheadHighWater = *BeyondLastByte;
+    Victim->PendingLength = 0;
+    Victim->Window = Window;
+    Victim->LastUsed = Clock;
+
+    //
+    //  The first read of a file is treated as sequential.
+    //
+
+    if (FileOffset->QuadPart == 0) {
+        return Victim;
+    }
+
+    return NULL;
+}
+
+
 VOID
 CcScheduleReadAhead (
     __in PFILE_OBJECT FileObject,
@@ -1288,8 +1429,10 @@ Return Value:
     KIRQL OldIrql;
     PSHARED_CACHE_MAP SharedCacheMap;
     PPRIVATE_CACHE_MAP PrivateCacheMap;
+    PREAD_AHEAD_STREAM Stream;
     PWORK_QUEUE_ENTRY WorkQueueEntry;
     ULONG ReadAheadSize;
+    ULONG ReadAheadGeneration;
     LOGICAL Changed = FALSE;
 
     DebugTrace(+1, me, "CcScheduleReadAhead:\n", 0 );
@@ -1413,69 +1556,66 @@ Return Value:
     //
     //  Read Ahead Case 1.
     //
-    //  If this is the third of three sequential reads, then we will see if
-    //  we can read ahead.  Note that if the first read to a file is to
-    //  offset 0, it passes this test.
+    //  If this read continues one of the sequential streams tracked for
+    //  this file object, then we will see if we can read ahead.  Note that
+    //  the first read to a file at offset 0 starts a stream which passes
+    //  this test.  We try to keep the read ahead for the stream a full
+    //  window beyond the end of the current transfer, and the window grows
+    //  for as long as the stream keeps going.
     //
 
-    } else if ((NewOffset.HighPart == PrivateCacheMap->BeyondLastByte2.HighPart)
-
-            &&
-
-        ((NewOffset.LowPart & ~NOISE_BITS)
-           == (PrivateCacheMap->BeyondLastByte2.LowPart & ~NOISE_BITS))
-
-            &&
-
-        (PrivateCacheMap->FileOffset2.HighPart
-           == PrivateCacheMap->BeyondLastByte1.HighPart)
-
-            &&
-
-        ((PrivateCacheMap->FileOffset2.LowPart & ~NOISE_BITS)
-           == (PrivateCacheMap->BeyondLastByte1.LowPart & ~NOISE_BITS))) {
+    } else if ((Stream = CcFindReadAheadStream( PrivateCacheMap,
+                                                &NewOffset,
+                                                &NewBeyond,
+                                                ReadAheadSize )) != NULL) {
 
         //
-        //  On the first read if we are using a large read ahead granularity,
-        //  and the read did not get it all, we will just get the rest of the
-        //  first data we want.
+        //  Count the read as a hit if it was entirely read ahead already.
         //
 
-        if ((FileOffset->QuadPart == 0)
-
-                &&
-
-            (PrivateCacheMap->ReadAheadMask > (PAGE_SIZE - 1))
-
-                &&
-
-            ((Length + PAGE_SIZE - 1) <= PrivateCacheMap->ReadAheadMask)) {
-
-            FileOffset2.QuadPart = (LONGLONG)( ROUND_TO_PAGES(Length) );
+        if (NewBeyond.QuadPart <= Stream->ReadAheadHighWater.QuadPart) {
+            CcReadAheadHits += 1;
         }
 
         //
-        //  Round read offset to next read ahead boundary.
+        //  Read ahead from the high water mark of the stream, or from the
+        //  end of this read if it overtook the read ahead, up to one window
+        //  beyond the end of this read, rounded to read ahead granularity.
         //
 
-        else {
-            FileOffset2.QuadPart = NewBeyond.QuadPart + (LONGLONG)ReadAheadSize;
+        FileOffset1 = Stream->ReadAheadHighWater;
 
-            FileOffset2.LowPart &= ~PrivateCacheMap->ReadAheadMask;
+        if (FileOffset1.QuadPart < NewBeyond.QuadPart) {
+            FileOffset1 = NewBeyond;
         }
 
-        //
-        //  Set read ahead length to be the same as for the most recent read,
-        //  up to our max.
-        //
+        FileOffset1.LowPart &= ~(PAGE_SIZE - 1);
+
+        FileOffset2.QuadPart = NewBeyond.QuadPart +
+                               (LONGLONG)Stream->Window +
+                               (LONGLONG)PrivateCacheMap->ReadAheadMask;
 
-        if (FileOffset2.QuadPart != PrivateCacheMap->ReadAheadOffset[1].QuadPart) {
+        FileOffset2.LowPart &= ~PrivateCacheMap->ReadAheadMask;
+
+        if (FileOffset2.QuadPart > FileOffset1.QuadPart) {
 
             ASSERT( FileOffset2.HighPart >= 0 );
 
+            //
+            //  Extend the pending read ahead of the stream, unless none is
+            //  pending or this read has overtaken it.
+            //
+
+            if ((Stream->PendingLength == 0) ||
+                (NewBeyond.QuadPart > Stream->ReadAheadHighWater.QuadPart)) {
+
+                Stream->PendingOffset = FileOffset1;
+            }
+
+            Stream->PendingLength = (ULONG)(FileOffset2.QuadPart -
+                                            Stream->PendingOffset.QuadPart);
+            Stream->ReadAheadHighWater = FileOffset2;
             Changed = TRUE;
-            PrivateCacheMap->ReadAheadOffset[1] = FileOffset2;
-            PrivateCacheMap->ReadAheadLength[1] = ReadAheadSize;
         }
     }
 
@@ -1536,10 +1676,13 @@ Return Value:
     }
 
     //
-    //  Get out if the ReadAhead requirements did not change.
+    //  Get out if the ReadAhead requirements did not change, or if as many
+    //  read ahead requests as we allow are already queued.  The active
+    //  requests will pick up the new requirements.
     //
 
-    if (!Changed || PrivateCacheMap->Flags.ReadAheadActive) {
+    if (!Changed ||
+        (PrivateCacheMap->ReadAheadActiveCount >= CC_MAX_READ_AHEAD_ACTIVE)) {
 
         DebugTrace( 0, me, "Read ahead already in progress or no change\n", 0 );
 
@@ -1552,8 +1695,16 @@ Return Value:
     //  ourselves.
     //
 
+    PrivateCacheMap->ReadAheadActiveCount += 1;
     CC_SET_PRIVATE_CACHE_MAP (PrivateCacheMap, PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
 
+    //
+    //  Remember which PrivateCacheMap counted the request, as the FileObject
+    //  may be uninitialized and reinitialized before it completes.
+    //
+
+    ReadAheadGeneration = PrivateCacheMap->ReadAheadGeneration;
+
     //
     //  Release spin lock on way out
     //
@@ -1594,6 +1745,7 @@ Return Value:
 
         WorkQueueEntry->Function = (UCHAR)ReadAhead;
         WorkQueueEntry->Parameters.Read.FileObject = FileObject;
+        WorkQueueEntry->Parameters.Read.ReadAheadGeneration = ReadAheadGeneration;
 
         CcPostWorkQueue( WorkQueueEntry, &CcExpressWorkQueue );
     }
@@ -1606,7 +1758,12 @@ Return Value:
     else {
 
         ExAcquireFastLock( &PrivateCacheMap->ReadAheadSpinLock, &OldIrql );
-        CC_CLEAR_PRIVATE_CACHE_MAP (PrivateCacheMap, PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
+
+        PrivateCacheMap->ReadAheadActiveCount -= 1;
+        if (PrivateCacheMap->ReadAheadActiveCount == 0) {
+            CC_CLEAR_PRIVATE_CACHE_MAP (PrivateCacheMap, PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
+        }
+
         ExReleaseFastLock( &PrivateCacheMap->ReadAheadSpinLock, OldIrql );
     }
 
@@ -1619,7 +1776,8 @@ Return Value:
 VOID
 FASTCALL
 CcPerformReadAhead (
-    IN PFILE_OBJECT FileObject
+    IN PFILE_OBJECT FileObject,
+    IN ULONG ReadAheadGeneration
     )
 
 /*++
@@ -1634,6 +1792,10 @@ Arguments:
     FileObject - supplies pointer to FileObject on which readahead should be
                  considered.
 
+    ReadAheadGeneration - supplies the ReadAheadGeneration of the
+                          PrivateCacheMap whose ReadAheadActiveCount
+                          counted this request.
+
 Return Value:
 
     None
@@ -1643,9 +1805,10 @@ Return Value:
     KIRQL OldIrql;
     PSHARED_CACHE_MAP SharedCacheMap;
     PPRIVATE_CACHE_MAP PrivateCacheMap;
+    PREAD_AHEAD_STREAM Stream;
     ULONG i;
-    LARGE_INTEGER ReadAheadOffset[2];
-    ULONG ReadAheadLength[2];
+    LARGE_INTEGER ReadAheadOffset[CC_READ_AHEAD_REQUESTS];
+    ULONG ReadAheadLength[CC_READ_AHEAD_REQUESTS];
     PCACHE_MANAGER_CALLBACKS Callbacks;
     PVOID Context;
     ULONG SavedState;
@@ -1701,13 +1864,6 @@ Return Value:
 
                 ExAcquireSpinLockAtDpcLevel( &PrivateCacheMap->ReadAheadSpinLock );
 
-                //
-                //  We are done when the lengths are 0
-                //
-
-                Done = ((PrivateCacheMap->ReadAheadLength[0] |
-                         PrivateCacheMap->ReadAheadLength[1]) == 0);
-
                 ReadAheadOffset[0] = PrivateCacheMap->ReadAheadOffset[0];
                 ReadAheadOffset[1] = PrivateCacheMap->ReadAheadOffset[1];
                 ReadAheadLength[0] = PrivateCacheMap->ReadAheadLength[0];
@@ -1715,6 +1871,40 @@ Return Value:
                 PrivateCacheMap->ReadAheadLength[0] = 0;
                 PrivateCacheMap->ReadAheadLength[1] = 0;
 
+                //
+                //  Take the next chunk of the pending read ahead of each
+                //  stream, leaving the rest for another pass or for another
+                //  worker thread to issue in parallel.
+                //
+
+                for (i = 0; i < CC_READ_AHEAD_STREAMS; i += 1) {
+
+                    Stream = &PrivateCacheMap->ReadAheadStreams[i];
+
+                    ReadAheadOffset[2 + i] = Stream->PendingOffset;
+                    ReadAheadLength[2 + i] = Stream->PendingLength;
+
+                    if (ReadAheadLength[2 + i] > CC_READ_AHEAD_CHUNK) {
+                        ReadAheadLength[2 + i] = CC_READ_AHEAD_CHUNK;
+                    }
+
+                    Stream->PendingOffset.QuadPart += (LONGLONG)ReadAheadLength[2 + i];
+                    Stream->PendingLength -= ReadAheadLength[2 + i];
+                }
+
+                //
+                //  We are done when the lengths are 0
+                //
+
+                Done = TRUE;
+
+                for (i = 0; i < CC_READ_AHEAD_REQUESTS; i += 1) {
+                    if (ReadAheadLength[i] != 0) {
+                        Done = FALSE;
+                        break;
+                    }
+                }
+
                 ExReleaseSpinLockFromDpcLevel( &PrivateCacheMap->ReadAheadSpinLock );
             }
 
@@ -1856,7 +2046,7 @@ Return Value:
                     }
                 }
                 i += 1;
-            } while (i <= 1);
+            } while (i < CC_READ_AHEAD_REQUESTS);
 
             //
             //  Release the file
@@ -1907,7 +2097,22 @@ Return Value:
         if (PrivateCacheMap != NULL) {
 
             ExAcquireSpinLockAtDpcLevel( &PrivateCacheMap->ReadAheadSpinLock );
-            CC_CLEAR_PRIVATE_CACHE_MAP (PrivateCacheMap, PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
+
+            //
+            //  If the FileObject was uninitialized and reinitialized since
+            //  this request was scheduled, the request was counted in the
+            //  old PrivateCacheMap (now gone), not this one.
+            //
+
+            if (PrivateCacheMap->ReadAheadGeneration == ReadAheadGeneration) {
+
+                ASSERT( PrivateCacheMap->ReadAheadActiveCount != 0 );
+
+                PrivateCacheMap->ReadAheadActiveCount -= 1;
+                if (PrivateCacheMap->ReadAheadActiveCount == 0) {
+                    CC_CLEAR_PRIVATE_CACHE_MAP (PrivateCacheMap, PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
+                }
+            }
 
             //
             //  If he said sequential only and we smashed into Eof, then
@@ -87,6 +87,7 @@ extern PFN_NUMBER MmAvailablePages;
 #define CACHE_NTC_MBCB                   (0x2FB)
 #define CACHE_NTC_OBCB                   (0x2FA)
 #define CACHE_NTC_MBCB_GRANDE            (0x2F9)
+#define CACHE_NTC_VOLUME_CACHE_MAP       (0x2F8)
 
 //
 //  The following definitions are used to generate meaningful blue bugcheck
@@ -129,6 +130,49 @@ extern PFN_NUMBER MmAvailablePages;
 
 #define SEQUENTIAL_MAP_LIMIT        ((ULONG)(0x00080000))
 
+//
+//  View groups.  Once a big stream has taken CC_VIEW_GROUP_MISSES view
+//  misses, each miss maps every view in the CC_VIEW_GROUP_SIZE aligned
+//  range around it, so the stream takes one miss per view group rather
+//  than one per VACB_MAPPING_GRANULARITY.  View groups are only used if
+//  the system cache has at least CC_VIEW_GROUP_MIN_VACBS views, so that a
+//  few large streams cannot take all of them.
+//
+//  N.B. A view group is a run of ordinary views.  Each view is still mapped
+//       with small pages through MmMapViewInSystemCache, so a group saves
+//       view misses and remaps but not TB entries.
+//
+
+#define CC_VIEW_GROUP_SIZE          ((ULONG)(0x00200000))
+#define CC_VIEW_GROUP_MIN_FILE_SIZE ((LONGLONG)(0x04000000))
+#define CC_VIEW_GROUP_MISSES        (32)
+#define CC_VIEW_GROUP_MIN_VACBS     (64 * (CC_VIEW_GROUP_SIZE / VACB_MAPPING_GRANULARITY))
+
+#define CcUseViewGroups( S ) (                                      \
+    CcViewGroups &&                                                 \
+    !FlagOn((S)->Flags, MODIFIED_WRITE_DISABLED) &&                 \
+    ((S)->SectionSize.QuadPart >= CC_VIEW_GROUP_MIN_FILE_SIZE) &&   \
+    ((S)->VacbMisses >= CC_VIEW_GROUP_MISSES)                       \
+)
+
+//
+//  Minimum length of a copy read for which we try to hand clean cache
+//  pages over to the caller's buffer rather than copy them.  This is only
+//  done for sequential only file objects, whose callers do not expect the
+//  data to stay in the cache, and only for requests made from user mode,
+//  so that we are in the context of the process owning the buffer.  Mm
+//  makes the final decision for each page, see MmTransferCachedPage.
+//
+
+#define CC_ZERO_COPY_MIN_LENGTH          (0x10000)
+
+#define CcZeroCopyRead( FO, OFF, LEN, BUF ) (                           \
+    FlagOn((FO)->Flags, FO_SEQUENTIAL_ONLY) &&                          \
+    ((LEN) >= CC_ZERO_COPY_MIN_LENGTH) &&                               \
+    (KeGetPreviousMode() == UserMode) &&                                \
+    ((((ULONG_PTR)(BUF) ^ (ULONG_PTR)(OFF)) & (PAGE_SIZE - 1)) == 0)    \
+)
+
 //
 //  Define some constants to drive read ahead and write behind
 //
@@ -146,6 +190,29 @@ extern PFN_NUMBER MmAvailablePages;
 
 #define MAX_READ_AHEAD                   (8 * 1024 * 1024)
 
+//
+//  Define the limits for adaptive read ahead.  Each PrivateCacheMap tracks
+//  up to CC_READ_AHEAD_STREAMS interleaved sequential streams.  The read
+//  ahead window of a stream starts at the size of its first read and
+//  doubles with every read that continues the stream, up to
+//  CC_MAX_READ_AHEAD_WINDOW.  Worker threads pick up stream read ahead at
+//  most CC_READ_AHEAD_CHUNK bytes at a time, so that up to
+//  CC_MAX_READ_AHEAD_ACTIVE of them can have reads for the same
+//  PrivateCacheMap in flight.
+//
+
+#define CC_READ_AHEAD_STREAMS            (4)
+#define CC_MAX_READ_AHEAD_WINDOW         (4 * 1024 * 1024)
+#define CC_READ_AHEAD_CHUNK              (VACB_MAPPING_GRANULARITY)
+#define CC_MAX_READ_AHEAD_ACTIVE         (2)
+
+//
+//  Number of read ahead requests captured by each pass of
+//  CcPerformReadAhead:  the two in the PrivateCacheMap plus one per stream.
+//
+
+#define CC_READ_AHEAD_REQUESTS           (2 + CC_READ_AHEAD_STREAMS)
+
 //
 //  Set maximum write behind / lazy write (most drivers break up transfers >= 64kb)
 //
@@ -349,6 +416,14 @@ typedef struct _VACB_LEVEL_REFERENCE {
 #define LAZY_WRITER_IDLE_DELAY           ((LONG)(10000000))
 #define LAZY_WRITER_COLLISION_DELAY      ((LONG)(1000000))
 
+//
+//  The lazy writer scan is only a once a second sweep of dirty data, so
+//  its timer may fire up to a quarter of that period late (see
+//  KeSetCoalescableTimer).
+//
+
+#define LAZY_WRITER_TOLERABLE_DELAY      (250)
+
 //
 // the wait is in 100 nanosecond units to 10,000,000 = 1 second
 //
@@ -361,6 +436,17 @@ typedef struct _VACB_LEVEL_REFERENCE {
 
 #define LAZY_WRITER_MAX_AGE_TARGET       ((ULONG)(8))
 
+//
+//  Each volume gets a dirty page target of LAZY_WRITER_MAX_AGE_TARGET times
+//  the number of pages observed to be written per lazy writer scan, so that
+//  its dirty data can be flushed within the same age target as the system
+//  as a whole.  The target is never set below the following minimum, so a
+//  volume can always build up enough dirty data for a few write behind
+//  I/Os.
+//
+
+#define CC_MIN_VOLUME_DIRTY_TARGET       (16 * (MAX_WRITE_BEHIND / PAGE_SIZE))
+
 //
 //  Requeue information hint for the lazy writer.
 //
@@ -562,6 +648,50 @@ typedef struct _PRIVATE_CACHE_MAP_FLAGS {
 #define CC_CLEAR_PRIVATE_CACHE_MAP(PrivateCacheMap, Feature) \
     RtlInterlockedAndBitsDiscardReturn (&PrivateCacheMap->UlongFlags, (ULONG)~Feature);
 
+//
+//  A sequential read stream detected in the reads through a PrivateCacheMap.
+//  The PrivateCacheMap ReadAheadSpinLock controls access to these records.
+//
+
+typedef struct _READ_AHEAD_STREAM {
+
+    //
+    //  Byte beyond the last read of this stream, where its next read is
+    //  expected to start.
+    //
+
+    LARGE_INTEGER BeyondLastByte;
+
+    //
+    //  Byte beyond the last byte requested for read ahead on behalf of
+    //  this stream.
+    //
+
+    LARGE_INTEGER ReadAheadHighWater;
+
+    //
+    //  Read ahead requested for this stream but not yet picked up by a
+    //  worker thread.  This range always ends at ReadAheadHighWater.
+    //
+
+    LARGE_INTEGER PendingOffset;
+    ULONG PendingLength;
+
+    //
+    //  Current read ahead window, or 0 if this record is not in use.
+    //
+
+    ULONG Window;
+
+    //
+    //  Value of the PrivateCacheMap stream clock when this stream was last
+    //  read, for choosing the stream to replace.
+    //
+
+    ULONG LastUsed;
+
+} READ_AHEAD_STREAM, *PREAD_AHEAD_STREAM;
+
 //
 //  The Private Cache Map is a structure pointed to by the File Object, whenever
 //  a file is opened with caching enabled (default).
@@ -617,6 +747,29 @@ typedef struct _PRIVATE_CACHE_MAP {
     LARGE_INTEGER ReadAheadOffset[2];
     ULONG ReadAheadLength[2];
 
+    //
+    //  Sequential streams detected in the reads through this FileObject,
+    //  and the clock used to find the least recently read one.
+    //
+
+    READ_AHEAD_STREAM ReadAheadStreams[CC_READ_AHEAD_STREAMS];
+    ULONG ReadAheadStreamClock;
+
+    //
+    //  Number of read ahead requests queued to worker threads for this
+    //  PrivateCacheMap.  ReadAheadActive is set while it is nonzero.
+    //
+
+    ULONG ReadAheadActiveCount;
+
+    //
+    //  Distinguishes this PrivateCacheMap from any earlier one for the same
+    //  FileObject, so read ahead requests counted in an earlier one's
+    //  ReadAheadActiveCount do not uncount themselves from this one.
+    //
+
+    ULONG ReadAheadGeneration;
+
     //
     //  SpinLock controlling access to following fields
     //
@@ -635,6 +788,75 @@ typedef struct _PRIVATE_CACHE_MAP {
 typedef PRIVATE_CACHE_MAP *PPRIVATE_CACHE_MAP;
 
 
+//
+//  The Volume Cache Map partitions write behind by volume, so that a slow
+//  volume cannot consume the dirty page budget or the worker threads of
+//  the others.  There is one for each device object on which files are
+//  cached, shared by all of their SharedCacheMaps.
+//
+
+typedef struct _VOLUME_CACHE_MAP {
+
+    //
+    //  Type and size of this record
+    //
+
+    CSHORT NodeTypeCode;
+    CSHORT NodeByteSize;
+
+    //
+    //  Links for CcVolumeCacheMapList.  Synchronized by CcMasterSpinLock,
+    //  as are all of the counts and targets below.
+    //
+
+    LIST_ENTRY VolumeCacheMapLinks;
+
+    //
+    //  Device object identifying the volume.  It is only compared, never
+    //  referenced.
+    //
+
+    PDEVICE_OBJECT DeviceObject;
+
+    //
+    //  Number of SharedCacheMaps pointing to this Volume Cache Map.
+    //
+
+    ULONG SharedCacheMapCount;
+
+    //
+    //  Number of dirty pages in files on this volume, and number of pages
+    //  cleaned since the last lazy writer scan.
+    //
+
+    ULONG DirtyPages;
+    ULONG PagesCleaned;
+
+    //
+    //  Smoothed number of pages cleaned per lazy writer scan, and the dirty
+    //  page target and throttle threshold derived from it.
+    //
+
+    ULONG WriteRate;
+    ULONG DirtyPageTarget;
+    ULONG DirtyPageThreshold;
+
+    //
+    //  Write behind work queue for this volume, links for
+    //  CcVolumeWorkQueueList while the work queue is not empty, and the
+    //  number of worker threads processing this volume.  Synchronized by
+    //  the work queue lock.
+    //
+
+    LIST_ENTRY WorkQueue;
+    LIST_ENTRY WorkQueueLinks;
+    ULONG ActiveWorkerThreads;
+
+} VOLUME_CACHE_MAP;
+
+typedef VOLUME_CACHE_MAP *PVOLUME_CACHE_MAP;
+
+
 //
 //  The Shared Cache Map is a per-file structure pointed to indirectly by
 //  each File Object.  The File Object points to a pointer in a single
@@ -749,6 +971,13 @@ typedef struct _SHARED_CACHE_MAP {
     KSPIN_LOCK ActiveVacbSpinLock;
     ULONG VacbActiveCount;
 
+    //
+    //  Number of view misses taken on this stream, used to decide when to
+    //  switch it to view groups.  Synchronized by the VacbLock.
+    //
+
+    ULONG VacbMisses;
+
     //
     //  Number of dirty pages in this SharedCacheMap.  Used to trigger
     //  write behind.  Synchronized by CcMasterSpinLock.
@@ -854,6 +1083,12 @@ typedef struct _SHARED_CACHE_MAP {
 
     ULONG DirtyPageThreshold;
 
+    //
+    //  Volume Cache Map of the volume this stream is on.
+    //
+
+    PVOLUME_CACHE_MAP VolumeCacheMap;
+
     //
     //  Lazy Writer pass count.  Used by the Lazy Writer for
     //  no modified write streams, which are not serviced on
@@ -1606,6 +1841,7 @@ typedef struct _WORK_QUEUE_ENTRY {
 
         struct {
             PFILE_OBJECT FileObject;
+            ULONG ReadAheadGeneration;
         } Read;
 
         //
@@ -1614,6 +1850,7 @@ typedef struct _WORK_QUEUE_ENTRY {
 
         struct {
             PSHARED_CACHE_MAP SharedCacheMap;
+            ULONG VolumeWorkSequence;
         } Write;
 
         //
@@ -1622,6 +1859,7 @@ typedef struct _WORK_QUEUE_ENTRY {
 
         struct {
             PKEVENT Event;
+            ULONG VolumeWorkSequence;
         } Event;
 
     } Parameters;
@@ -1715,18 +1953,27 @@ CcSetActiveVacb (
 
 #define CcDeductDirtyPages( S, P )                                      \
         CcTotalDirtyPages -= (P);                                       \
+        (S)->VolumeCacheMap->DirtyPages -= (P);                         \
+        (S)->VolumeCacheMap->PagesCleaned += (P);                       \
         (S)->DirtyPages -= (P);
         
 #define CcChargeMaskDirtyPages( S, M, B, P )                            \
         CcTotalDirtyPages += (P);                                       \
+        (S)->VolumeCacheMap->DirtyPages += (P);                         \
         (M)->DirtyPages += (P);                                         \
         (B)->DirtyPages += (P);                                         \
         (S)->DirtyPages += (P);
 
 #define CcChargePinDirtyPages( S, P )                                   \
         CcTotalDirtyPages += (P);                                       \
+        (S)->VolumeCacheMap->DirtyPages += (P);                         \
         (S)->DirtyPages += (P);
 
+PVOLUME_CACHE_MAP
+CcReferenceVolumeCacheMap (
+    IN PDEVICE_OBJECT DeviceObject
+    );
+
 VOID
 CcPostDeferredWrites (
     );
@@ -1767,7 +2014,8 @@ CcDeallocateBcb (
 VOID
 FASTCALL
 CcPerformReadAhead (
-    IN PFILE_OBJECT FileObject
+    IN PFILE_OBJECT FileObject,
+    IN ULONG ReadAheadGeneration
     );
 
 VOID
@@ -1853,6 +2101,13 @@ CcPostWorkQueue (
     IN PLIST_ENTRY WorkQueue
     );
 
+VOID
+FASTCALL
+CcPostVolumeWorkQueue (
+    IN PWORK_QUEUE_ENTRY WorkQueueEntry,
+    IN PVOLUME_CACHE_MAP VolumeCacheMap
+    );
+
 VOID
 CcWorkerThread (
     PVOID ExWorkQueueItem
@@ -2000,6 +2255,7 @@ CcDrainVacbLevelZone (
 extern ALIGNED_SPINLOCK CcBcbSpinLock;
 extern LIST_ENTRY CcCleanSharedCacheMapList;
 extern SHARED_CACHE_MAP_LIST_CURSOR CcDirtySharedCacheMapList;
+extern ULONG CcPrivateCacheMapGeneration;
 extern SHARED_CACHE_MAP_LIST_CURSOR CcLazyWriterCursor;
 extern GENERAL_LOOKASIDE CcTwilightLookasideList;
 extern ULONG CcNumberWorkerThreads;
@@ -2008,6 +2264,11 @@ extern LIST_ENTRY CcIdleWorkerThreadList;
 extern LIST_ENTRY CcExpressWorkQueue;
 extern LIST_ENTRY CcRegularWorkQueue;
 extern LIST_ENTRY CcPostTickWorkQueue;
+extern LIST_ENTRY CcVolumeCacheMapList;
+extern LIST_ENTRY CcVolumeWorkQueueList;
+extern ULONG CcVolumeWorkSequence;
+extern VOLUME_CACHE_MAP CcDefaultVolumeCacheMap;
+extern ULONG CcVolumeWorkerThreads;
 extern BOOLEAN CcQueueThrottle;
 extern ULONG CcIdleDelayTick;
 extern LARGE_INTEGER CcNoDelay;
@@ -2017,6 +2278,7 @@ extern LARGE_INTEGER CcCollisionDelay;
 extern LARGE_INTEGER CcTargetCleanDelay;
 extern LAZY_WRITER LazyWriter;
 extern ULONG_PTR CcNumberVacbs;
+extern LOGICAL CcViewGroups;
 extern PVACB CcVacbs;
 extern PVACB CcBeyondVacbs;
 extern LIST_ENTRY CcVacbLru;
@@ -24,6 +24,17 @@ Abstract:
 
 #define me 0x00000004
 
+//
+//  Local support routines
+//
+
+BOOLEAN
+CcExceedsVolumeThreshold (
+    IN PFILE_OBJECT FileObject,
+    IN ULONG BytesToWrite,
+    IN UCHAR Retrying
+    );
+
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text(PAGE,CcCopyRead)
 #pragma alloc_text(PAGE,CcFastCopyRead)
@@ -118,6 +129,7 @@ Return Value:
     ULONG OriginalLength = Length;
     PETHREAD Thread = PsGetCurrentThread();
     ULONG GotAMiss = 0;
+    LOGICAL ZeroCopy;
 
     DebugTrace(+1, me, "CcCopyRead\n", 0 );
 
@@ -150,6 +162,15 @@ Return Value:
 
     FOffset = *FileOffset;
 
+    //
+    //  For large sequential only reads into a user buffer aligned like the
+    //  file data, try to hand whole clean pages over to the buffer instead
+    //  of copying them.  A sequential only caller has told us it will not
+    //  read the data again, so the cache loses little by giving them away.
+    //
+
+    ZeroCopy = CcZeroCopyRead( FileObject, FOffset.LowPart, Length, Buffer );
+
     //
     //  Increment performance counters
     //
@@ -438,15 +459,28 @@ Return Value:
                     }
 
                     //
-                    //  Here's hoping that it is cheaper to call Mm to see if
-                    //  the page is valid.  If not let Mm know how many pages
-                    //  we are after before doing the move.
+                    //  First see if Mm can just hand this page over.
                     //
 
-                    MmSetPageFaultReadAhead( Thread, PagesToGo );
-                    GotAMiss |= !MmCheckCachedPageState( CacheBuffer, FALSE );
+                    if (ZeroCopy &&
+                        (MoveLength == PAGE_SIZE) &&
+                        MmTransferCachedPage( CacheBuffer, Buffer )) {
+
+                        CcCopyReadTransferPages += 1;
 
-                    RtlCopyBytes( Buffer, CacheBuffer, MoveLength );
+                    } else {
+
+                        //
+                        //  Here's hoping that it is cheaper to call Mm to see if
+                        //  the page is valid.  If not let Mm know how many pages
+                        //  we are after before doing the move.
+                        //
+
+                        MmSetPageFaultReadAhead( Thread, PagesToGo );
+                        GotAMiss |= !MmCheckCachedPageState( CacheBuffer, FALSE );
+
+                        RtlCopyBytes( Buffer, CacheBuffer, MoveLength );
+                    }
 
                     PagesToGo -= 1;
 
@@ -657,6 +691,7 @@ Return Value:
     ULONG OriginalLength = Length;
     PETHREAD Thread = PsGetCurrentThread();
     ULONG GotAMiss = 0;
+    LOGICAL ZeroCopy;
 
     UNREFERENCED_PARAMETER (PageCount);
 
@@ -861,6 +896,13 @@ Return Value:
     FOffset.HighPart = 0;
     FOffset.LowPart = FileOffset;
 
+    //
+    //  See if we can hand pages over instead of copying them, as in
+    //  CcCopyRead.
+    //
+
+    ZeroCopy = CcZeroCopyRead( FileObject, FileOffset, Length, Buffer );
+
     while (Length != 0) {
 
         ULONG ReceivedLength;
@@ -940,15 +982,28 @@ Return Value:
                     }
 
                     //
-                    //  Here's hoping that it is cheaper to call Mm to see if
-                    //  the page is valid.  If not let Mm know how many pages
-                    //  we are after before doing the move.
+                    //  First see if Mm can just hand this page over.
                     //
 
-                    MmSetPageFaultReadAhead( Thread, PagesToGo );
-                    GotAMiss |= !MmCheckCachedPageState( CacheBuffer, FALSE );
+                    if (ZeroCopy &&
+                        (MoveLength == PAGE_SIZE) &&
+                        MmTransferCachedPage( CacheBuffer, Buffer )) {
+
+                        CcCopyReadTransferPages += 1;
+
+                    } else {
+
+                        //
+                        //  Here's hoping that it is cheaper to call Mm to see if
+                        //  the page is valid.  If not let Mm know how many pages
+                        //  we are after before doing the move.
+                        //
 
-                    RtlCopyBytes( Buffer, CacheBuffer, MoveLength );
+                        MmSetPageFaultReadAhead( Thread, PagesToGo );
+                        GotAMiss |= !MmCheckCachedPageState( CacheBuffer, FALSE );
+
+                        RtlCopyBytes( Buffer, CacheBuffer, MoveLength );
+                    }
 
                     PagesToGo -= 1;
 
@@ -1705,6 +1760,88 @@ Return Value:
     return EXCEPTION_EXECUTE_HANDLER;
 }
 
+
+//
+//  Internal support routine
+//
+
+BOOLEAN
+CcExceedsVolumeThreshold (
+    IN PFILE_OBJECT FileObject,
+    IN ULONG BytesToWrite,
+    IN UCHAR Retrying
+    )
+
+/*++
+
+Routine Description:
+
+    This routine checks whether writing the specified number of bytes to
+    a file would take its volume over the dirty page threshold calculated
+    for it by the Lazy Writer.
+
+    The SharedCacheMap and its VolumeCacheMap are examined under the
+    master lock, unless the caller already holds it.
+
+Arguments:
+
+    FileObject - for the file to be written
+
+    BytesToWrite - Number of bytes to be written, already capped at
+                   WRITE_CHARGE_THRESHOLD by the caller.
+
+    Retrying - As for CcCanIWrite: MAXUCHAR if the caller already holds the
+               master lock.
+
+Return Value:
+
+    TRUE if the write should be throttled for the volume, else FALSE.
+
+--*/
+
+{
+    KIRQL OldIrql;
+    PSHARED_CACHE_MAP SharedCacheMap;
+    PVOLUME_CACHE_MAP VolumeCacheMap;
+    ULONG PagesToWrite;
+    BOOLEAN Exceeded = FALSE;
+
+    if ((FileObject->PrivateCacheMap == NULL) ||
+        (FileObject->SectionObjectPointer == NULL)) {
+
+        return FALSE;
+    }
+
+    PagesToWrite = (BytesToWrite + (PAGE_SIZE - 1)) / PAGE_SIZE;
+
+    if (Retrying != MAXUCHAR) {
+        CcAcquireMasterLock( &OldIrql );
+    }
+
+    //
+    //  Always let a volume with no dirty pages write, so a stale target
+    //  can never block it entirely.
+    //
+
+    if ((SharedCacheMap = FileObject->SectionObjectPointer->SharedCacheMap) != NULL) {
+
+        VolumeCacheMap = SharedCacheMap->VolumeCacheMap;
+
+        if ((VolumeCacheMap->DirtyPages != 0) &&
+            ((VolumeCacheMap->DirtyPages + PagesToWrite) >
+             VolumeCacheMap->DirtyPageThreshold)) {
+
+            Exceeded = TRUE;
+        }
+    }
+
+    if (Retrying != MAXUCHAR) {
+        CcReleaseMasterLock( OldIrql );
+    }
+
+    return Exceeded;
+}
+
 
 BOOLEAN
 CcCanIWrite (
@@ -1761,6 +1898,7 @@ Return Value:
     KIRQL OldIrql;
     ULONG PagesToWrite;
     BOOLEAN ExceededPerFileThreshold;
+    BOOLEAN ExceededVolumeThreshold;
     DEFERRED_WRITE DeferredWrite;
     PSECTION_OBJECT_POINTERS SectionObjectPointers;
 
@@ -1818,6 +1956,16 @@ Return Value:
         }
     }
 
+    //
+    //  A volume which is slow to write back its dirty pages gets throttled
+    //  at its own threshold, before it can fill the global dirty page budget
+    //  and stall writers on every other volume.
+    //
+
+    ExceededVolumeThreshold = CcExceedsVolumeThreshold( FileObject,
+                                                        PagesToWrite * PAGE_SIZE,
+                                                        Retrying );
+
     //
     //  See if it is ok to do the write right now
     //
@@ -1834,7 +1982,11 @@ Return Value:
 
                 &&
 
-        !ExceededPerFileThreshold) {
+        !ExceededPerFileThreshold
+
+                &&
+
+        !ExceededVolumeThreshold) {
 
         return TRUE;
     }
@@ -2125,11 +2277,14 @@ Return Value:
                 } else {
 
                     //
-                    //  If this was a private throttle, skip over it and
-                    //  remove its byte count from the running total.
+                    //  If this was a private or volume throttle, skip over
+                    //  it and remove its byte count from the running total.
                     //
 
-                    if (DeferredWrite->LimitModifiedPages) {
+                    if (DeferredWrite->LimitModifiedPages ||
+                        CcExceedsVolumeThreshold( DeferredWrite->FileObject,
+                                                  DeferredWrite->BytesToWrite,
+                                                  MAXUCHAR - 1 )) {
 
                         Entry = Entry->Flink;
                         TotalBytesLetLoose -= DeferredWrite->BytesToWrite;
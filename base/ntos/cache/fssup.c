@@ -63,6 +63,12 @@ CcPurgeAndClearCacheSection (
     IN PLARGE_INTEGER FileOffset
     );
 
+VOID
+CcInitializeVolumeCacheMap (
+    IN PVOLUME_CACHE_MAP VolumeCacheMap,
+    IN PDEVICE_OBJECT DeviceObject
+    );
+
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text(INIT,CcInitializeCacheManager)
 #pragma alloc_text(PAGE,CcZeroData)
@@ -130,6 +136,8 @@ Return Value:
     InitializeListHead( &CcExpressWorkQueue );
     InitializeListHead( &CcRegularWorkQueue );
     InitializeListHead( &CcPostTickWorkQueue );
+    InitializeListHead( &CcVolumeWorkQueueList );
+    InitializeListHead( &CcVolumeCacheMapList );
 
     //
     //  Set the number of worker threads based on the system size.
@@ -190,6 +198,24 @@ Return Value:
                             CcDirtyPageThreshold / 4;
     }
 
+    //
+    //  Let no single volume occupy more than half of the worker threads
+    //  with write behind.
+    //
+
+    CcVolumeWorkerThreads = CcNumberWorkerThreads / 2;
+
+    if (CcVolumeWorkerThreads == 0) {
+        CcVolumeWorkerThreads = 1;
+    }
+
+    //
+    //  Initialize the Volume Cache Map used when we cannot allocate one.
+    //  It is never freed.
+    //
+
+    CcInitializeVolumeCacheMap( &CcDefaultVolumeCacheMap, NULL );
+
     CcAggressiveZeroCount = 0;
 
     //
@@ -545,6 +571,12 @@ restart:
         SharedCacheMap = CacheMapToFree;
         CacheMapToFree = NULL;
 
+        //
+        //  Attach the new Shared Cache Map to its volume for write behind.
+        //
+
+        SharedCacheMap->VolumeCacheMap = CcReferenceVolumeCacheMap( FileObject->DeviceObject );
+
         //
         //  Insert the new Shared Cache Map in the global list
         //
@@ -941,6 +973,9 @@ restart2:
         PrivateCacheMap->FileObject = FileObject;
         PrivateCacheMap->ReadAheadMask = PAGE_SIZE - 1;
 
+        CcPrivateCacheMapGeneration += 1;
+        PrivateCacheMap->ReadAheadGeneration = CcPrivateCacheMapGeneration;
+
         //
         //  Initialize the spin lock.
         //
@@ -1811,6 +1846,128 @@ Return Value:
 //  Internal support routine.
 //
 
+VOID
+CcInitializeVolumeCacheMap (
+    IN PVOLUME_CACHE_MAP VolumeCacheMap,
+    IN PDEVICE_OBJECT DeviceObject
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes a Volume Cache Map and inserts it in the
+    global list.  The dirty page target of a new volume starts at a quarter
+    of the global target, until its write rate has been observed.
+
+    NOTE:   The CcMasterSpinLock must be acquired on entry, except during
+            cache manager initialization.
+
+Arguments:
+
+    VolumeCacheMap - Supplies the Volume Cache Map to initialize.
+
+    DeviceObject - Supplies the device object of the volume.
+
+ReturnValue:
+
+    None.
+
+--*/
+
+{
+    RtlZeroMemory( VolumeCacheMap, sizeof(VOLUME_CACHE_MAP) );
+
+    VolumeCacheMap->NodeTypeCode = CACHE_NTC_VOLUME_CACHE_MAP;
+    VolumeCacheMap->NodeByteSize = sizeof(VOLUME_CACHE_MAP);
+    VolumeCacheMap->DeviceObject = DeviceObject;
+
+    VolumeCacheMap->WriteRate = CcDirtyPageTarget / (4 * LAZY_WRITER_MAX_AGE_TARGET);
+    VolumeCacheMap->DirtyPageTarget = CcDirtyPageTarget / 4;
+    VolumeCacheMap->DirtyPageThreshold = CcDirtyPageThreshold / 4;
+
+    if (VolumeCacheMap->DirtyPageTarget < CC_MIN_VOLUME_DIRTY_TARGET) {
+        VolumeCacheMap->DirtyPageTarget = CC_MIN_VOLUME_DIRTY_TARGET;
+        VolumeCacheMap->DirtyPageThreshold = CC_MIN_VOLUME_DIRTY_TARGET +
+                                             CC_MIN_VOLUME_DIRTY_TARGET / 3;
+    }
+
+    InitializeListHead( &VolumeCacheMap->WorkQueue );
+    InsertTailList( &CcVolumeCacheMapList, &VolumeCacheMap->VolumeCacheMapLinks );
+}
+
+
+//
+//  Internal support routine.
+//
+
+PVOLUME_CACHE_MAP
+CcReferenceVolumeCacheMap (
+    IN PDEVICE_OBJECT DeviceObject
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the Volume Cache Map for the specified device
+    object, creating it if it does not exist yet, and references it for a
+    new SharedCacheMap.  If a Volume Cache Map cannot be allocated the
+    default one is used, which only costs the volume its isolation.
+
+    Unused Volume Cache Maps are freed by the Lazy Writer.
+
+    NOTE:   The CcMasterSpinLock must already be acquired on entry.
+
+Arguments:
+
+    DeviceObject - Supplies the device object of the volume.
+
+ReturnValue:
+
+    The referenced Volume Cache Map.
+
+--*/
+
+{
+    PLIST_ENTRY Entry;
+    PVOLUME_CACHE_MAP VolumeCacheMap;
+
+    for (Entry = CcVolumeCacheMapList.Flink;
+         Entry != &CcVolumeCacheMapList;
+         Entry = Entry->Flink) {
+
+        VolumeCacheMap = CONTAINING_RECORD( Entry, VOLUME_CACHE_MAP, VolumeCacheMapLinks );
+
+        if (VolumeCacheMap->DeviceObject == DeviceObject) {
+
+            VolumeCacheMap->SharedCacheMapCount += 1;
+            return VolumeCacheMap;
+        }
+    }
+
+    //
+    //  Volumes come and go rarely enough that it is fine to allocate the
+    //  new one while holding the spinlock.
+    //
+
+    VolumeCacheMap = ExAllocatePoolWithTag( NonPagedPool, sizeof(VOLUME_CACHE_MAP), 'cVcC' );
+
+    if (VolumeCacheMap == NULL) {
+        VolumeCacheMap = &CcDefaultVolumeCacheMap;
+    } else {
+        CcInitializeVolumeCacheMap( VolumeCacheMap, DeviceObject );
+    }
+
+    VolumeCacheMap->SharedCacheMapCount += 1;
+    return VolumeCacheMap;
+}
+
+
+//
+//  Internal support routine.
+//
+
 VOID
 FASTCALL
 CcDeleteSharedCacheMap (
@@ -2021,6 +2178,15 @@ ReturnValue:
         ExFreePool( SharedCacheMap->WaitOnActiveCount );
     }
 
+    //
+    //  Drop our reference to the Volume Cache Map.  The Lazy Writer frees
+    //  it once it is no longer in use.
+    //
+
+    CcAcquireMasterLock( &ListIrql );
+    SharedCacheMap->VolumeCacheMap->SharedCacheMapCount -= 1;
+    CcReleaseMasterLock( ListIrql );
+
     //
     //  Deallocate the storeage for the SharedCacheMap.
     //
@@ -42,6 +42,19 @@ VOID
 CcLazyWriteScan (
     );
 
+VOID
+CcUpdateVolumeCacheMaps (
+    );
+
+PVOLUME_CACHE_MAP
+CcFindVolumeWorkQueue (
+    );
+
+BOOLEAN
+CcVolumeWorkDrained (
+    IN ULONG VolumeWorkSequence
+    );
+
 
 VOID
 CcScheduleLazyWriteScan (
@@ -89,12 +102,20 @@ Return Value:
 
     } else if (LazyWriter.ScanActive) {
 
-        KeSetTimer( &LazyWriter.ScanTimer, CcIdleDelay, &LazyWriter.ScanDpc );
+        KeSetCoalescableTimer( &LazyWriter.ScanTimer,
+                               CcIdleDelay,
+                               0,
+                               LAZY_WRITER_TOLERABLE_DELAY,
+                               &LazyWriter.ScanDpc );
     
     } else {
 
         LazyWriter.ScanActive = TRUE;
-        KeSetTimer( &LazyWriter.ScanTimer, CcFirstDelay, &LazyWriter.ScanDpc );
+        KeSetCoalescableTimer( &LazyWriter.ScanTimer,
+                               CcFirstDelay,
+                               0,
+                               LAZY_WRITER_TOLERABLE_DELAY,
+                               &LazyWriter.ScanDpc );
     }
 }
 
@@ -396,6 +417,13 @@ Return Value:
         CcDirtyPagesLastScan = CcTotalDirtyPages;
         CcPagesYetToWrite = CcPagesWrittenLastTime = PagesToWrite;
 
+        //
+        //  Recalculate the dirty page targets of the volumes from the rate
+        //  at which they have actually been written.
+        //
+
+        CcUpdateVolumeCacheMaps();
+
         //
         //  Loop to flush enough Shared Cache Maps to write the number of pages
         //  we just calculated.
@@ -454,7 +482,8 @@ Return Value:
                            &&
                    (FlagOn(SharedCacheMap->Flags, WAITING_FOR_TEARDOWN)
                                 ||
-                    ((PagesToWrite != 0)
+                    (((PagesToWrite != 0) ||
+                      (SharedCacheMap->VolumeCacheMap->DirtyPages > SharedCacheMap->VolumeCacheMap->DirtyPageTarget))
                                         && 
                      (((++SharedCacheMap->LazyWritePassCount & 0xF) == 0) ||
                       !FlagOn(SharedCacheMap->Flags, MODIFIED_WRITE_DISABLED) ||
@@ -613,10 +642,10 @@ Return Value:
                     //
                     //  We aren't anxiously awaiting for this shared cached map
                     //  to go away, so just process this work item via the 
-                    //  regular work queue.
+                    //  work queue of its volume.
                     //
 
-                    CcPostWorkQueue( WorkQueueEntry, &CcRegularWorkQueue );
+                    CcPostVolumeWorkQueue( WorkQueueEntry, SharedCacheMap->VolumeCacheMap );
                 }
 
                 LoopsWithLockHeld = 0;
@@ -717,6 +746,109 @@ Return Value:
 //  Internal support routine
 //
 
+VOID
+CcUpdateVolumeCacheMaps (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called once per lazy writer scan to recalculate the
+    dirty page target and throttle threshold of each volume.  The write
+    rate of a volume is a running average of the pages cleaned on it per
+    scan, and its target is the number of dirty pages it can write within
+    LAZY_WRITER_MAX_AGE_TARGET scans at that rate.  A volume which is slow
+    to write therefore gets throttled long before it can fill the global
+    dirty page budget at the expense of the others.
+
+    Volume Cache Maps which are no longer in use are freed here.
+
+    NOTE:   The CcMasterSpinLock must already be acquired on entry.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+    PLIST_ENTRY Entry;
+    PVOLUME_CACHE_MAP VolumeCacheMap;
+    ULONG Target;
+
+    Entry = CcVolumeCacheMapList.Flink;
+
+    while (Entry != &CcVolumeCacheMapList) {
+
+        VolumeCacheMap = CONTAINING_RECORD( Entry, VOLUME_CACHE_MAP, VolumeCacheMapLinks );
+        Entry = Entry->Flink;
+
+        //
+        //  Free the Volume Cache Map if no files on the volume are cached
+        //  and no worker thread can still be looking at it.
+        //
+
+        if ((VolumeCacheMap->SharedCacheMapCount == 0) &&
+            (VolumeCacheMap->DirtyPages == 0) &&
+            (VolumeCacheMap != &CcDefaultVolumeCacheMap)) {
+
+            BOOLEAN Unused;
+
+            CcAcquireWorkQueueLockAtDpcLevel();
+            Unused = (BOOLEAN)(IsListEmpty( &VolumeCacheMap->WorkQueue ) &&
+                               (VolumeCacheMap->ActiveWorkerThreads == 0));
+            CcReleaseWorkQueueLockFromDpcLevel();
+
+            if (Unused) {
+
+                RemoveEntryList( &VolumeCacheMap->VolumeCacheMapLinks );
+                ExFreePool( VolumeCacheMap );
+                continue;
+            }
+        }
+
+        //
+        //  Leave the rate alone on an idle volume, so that it does not decay
+        //  just because nobody was writing.
+        //
+
+        if ((VolumeCacheMap->DirtyPages == 0) && (VolumeCacheMap->PagesCleaned == 0)) {
+            continue;
+        }
+
+        VolumeCacheMap->WriteRate = (3 * VolumeCacheMap->WriteRate +
+                                     VolumeCacheMap->PagesCleaned) / 4;
+        VolumeCacheMap->PagesCleaned = 0;
+
+        Target = VolumeCacheMap->WriteRate * LAZY_WRITER_MAX_AGE_TARGET;
+
+        if (Target > CcDirtyPageTarget) {
+            Target = CcDirtyPageTarget;
+        }
+
+        if (Target < CC_MIN_VOLUME_DIRTY_TARGET) {
+            Target = CC_MIN_VOLUME_DIRTY_TARGET;
+        }
+
+        VolumeCacheMap->DirtyPageTarget = Target;
+        VolumeCacheMap->DirtyPageThreshold = Target + Target / 3;
+
+        if (VolumeCacheMap->DirtyPageThreshold > CcDirtyPageThreshold) {
+            VolumeCacheMap->DirtyPageThreshold = CcDirtyPageThreshold;
+        }
+    }
+}
+
+
+//
+//  Internal support routine
+//
+
 LONG
 CcExceptionFilter (
     IN NTSTATUS ExceptionCode
@@ -798,6 +930,16 @@ Return Value:
     //
 
     CcAcquireWorkQueueLock( &OldIrql );
+
+    //
+    //  An EventSet waits for the write behind queued to the volumes ahead
+    //  of it, so remember how far the volume work had got.
+    //
+
+    if (WorkQueueEntry->Function == EventSet) {
+        WorkQueueEntry->Parameters.Event.VolumeWorkSequence = CcVolumeWorkSequence;
+    }
+
     InsertTailList( WorkQueue, &WorkQueueEntry->WorkQueueLinks );
 
     //
@@ -835,6 +977,196 @@ Return Value:
 //  Internal support routine
 //
 
+VOID
+FASTCALL
+CcPostVolumeWorkQueue (
+    IN PWORK_QUEUE_ENTRY WorkQueueEntry,
+    IN PVOLUME_CACHE_MAP VolumeCacheMap
+    )
+
+/*++
+
+Routine Description:
+
+    This routine queues a write behind WorkQueueEntry to the work queue of
+    a volume, and makes the volume visible to the worker threads if its
+    work queue was empty.
+
+Arguments:
+
+    WorkQueueEntry - supplies a pointer to the entry to queue
+
+    VolumeCacheMap - supplies the volume to queue it to
+
+Return Value:
+
+    None
+
+--*/
+
+{
+    KIRQL OldIrql;
+    PLIST_ENTRY WorkerThreadEntry = NULL;
+
+    DebugTrace(+1, me, "CcPostVolumeWorkQueue:\n", 0 );
+    DebugTrace( 0, me, "    WorkQueueEntry = %08lx\n", WorkQueueEntry );
+    DebugTrace( 0, me, "    VolumeCacheMap = %08lx\n", VolumeCacheMap );
+
+    CcAcquireWorkQueueLock( &OldIrql );
+
+    if (IsListEmpty( &VolumeCacheMap->WorkQueue )) {
+        InsertTailList( &CcVolumeWorkQueueList, &VolumeCacheMap->WorkQueueLinks );
+    }
+
+    CcVolumeWorkSequence += 1;
+    WorkQueueEntry->Parameters.Write.VolumeWorkSequence = CcVolumeWorkSequence;
+    InsertTailList( &VolumeCacheMap->WorkQueue, &WorkQueueEntry->WorkQueueLinks );
+
+    //
+    //  Now, if we aren't throttled and have any more idle threads we can
+    //  use, activate one.
+    //
+
+    if (!CcQueueThrottle && !IsListEmpty(&CcIdleWorkerThreadList)) {
+        WorkerThreadEntry = RemoveHeadList( &CcIdleWorkerThreadList );
+        CcNumberActiveWorkerThreads += 1;
+    }
+    CcReleaseWorkQueueLock( OldIrql );
+
+    if (WorkerThreadEntry != NULL) {
+
+        //
+        //  This routine is a noop if the Flink is not NULL.
+        //
+
+        ((PWORK_QUEUE_ITEM)WorkerThreadEntry)->List.Flink = NULL;
+        ExQueueWorkItem( (PWORK_QUEUE_ITEM)WorkerThreadEntry, CriticalWorkQueue );
+    }
+
+    DebugTrace(-1, me, "CcPostVolumeWorkQueue -> VOID\n", 0 );
+
+    return;
+}
+
+
+//
+//  Internal support routine
+//
+
+PVOLUME_CACHE_MAP
+CcFindVolumeWorkQueue (
+    )
+
+/*++
+
+Routine Description:
+
+    This routine picks the next volume with write behind work for a worker
+    thread.  Volumes are serviced round robin, skipping those which already
+    have CcVolumeWorkerThreads threads working on them, so that a volume
+    with slow I/O cannot tie up the whole worker pool.
+
+    NOTE:   The work queue lock must already be acquired on entry.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    The Volume Cache Map to service, or NULL if there is none.
+
+--*/
+
+{
+    PLIST_ENTRY Entry;
+    PVOLUME_CACHE_MAP VolumeCacheMap;
+
+    for (Entry = CcVolumeWorkQueueList.Flink;
+         Entry != &CcVolumeWorkQueueList;
+         Entry = Entry->Flink) {
+
+        VolumeCacheMap = CONTAINING_RECORD( Entry, VOLUME_CACHE_MAP, WorkQueueLinks );
+
+        if (VolumeCacheMap->ActiveWorkerThreads < CcVolumeWorkerThreads) {
+
+            //
+            //  Move it to the end, so the next thread starts on another
+            //  volume.
+            //
+
+            RemoveEntryList( Entry );
+            InsertTailList( &CcVolumeWorkQueueList, Entry );
+            return VolumeCacheMap;
+        }
+    }
+
+    return NULL;
+}
+
+
+//
+//  Internal support routine
+//
+
+BOOLEAN
+CcVolumeWorkDrained (
+    IN ULONG VolumeWorkSequence
+    )
+
+/*++
+
+Routine Description:
+
+    This routine checks whether all of the write behind which had been
+    queued to the volumes by the time an EventSet was queued has been
+    picked up by worker threads.  Each volume work queue is in order of
+    sequence number, so only the head of each queue need be examined.
+
+    Write behind queued after the EventSet does not hold it up, so that
+    a steady stream of new volume work cannot starve the EventSet and the
+    regular work queued behind it.
+
+    NOTE:   The work queue lock must already be acquired on entry.
+
+Arguments:
+
+    VolumeWorkSequence - Supplies the volume work sequence number captured
+                         when the EventSet was queued.
+
+Return Value:
+
+    TRUE if no earlier write behind remains queued, else FALSE.
+
+--*/
+
+{
+    PLIST_ENTRY Entry;
+    PVOLUME_CACHE_MAP VolumeCacheMap;
+    PWORK_QUEUE_ENTRY WorkQueueEntry;
+
+    for (Entry = CcVolumeWorkQueueList.Flink;
+         Entry != &CcVolumeWorkQueueList;
+         Entry = Entry->Flink) {
+
+        VolumeCacheMap = CONTAINING_RECORD( Entry, VOLUME_CACHE_MAP, WorkQueueLinks );
+        WorkQueueEntry = CONTAINING_RECORD( VolumeCacheMap->WorkQueue.Flink,
+                                            WORK_QUEUE_ENTRY,
+                                            WorkQueueLinks );
+
+        if ((LONG)(VolumeWorkSequence - WorkQueueEntry->Parameters.Write.VolumeWorkSequence) >= 0) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+//
+//  Internal support routine
+//
+
 VOID
 CcWorkerThread (
     PVOID ExWorkQueueItem
@@ -861,6 +1193,7 @@ Return Value:
     KIRQL OldIrql;
     PLIST_ENTRY WorkQueue;
     PWORK_QUEUE_ENTRY WorkQueueEntry;
+    PVOLUME_CACHE_MAP VolumeCacheMap = NULL;
     BOOLEAN RescanOk = FALSE;
     BOOLEAN DropThrottle = FALSE;
     IO_STATUS_BLOCK IoStatus;
@@ -885,14 +1218,35 @@ Return Value:
 
         //
         //  On requeue, push at end of the source queue and clear hint.
+        //  Write behind requeued to a volume counts as new volume work.
         //
 
         if (IoStatus.Information == CC_REQUEUE) {
 
+            if (VolumeCacheMap != NULL) {
+
+                if (IsListEmpty( WorkQueue )) {
+                    InsertTailList( &CcVolumeWorkQueueList, &VolumeCacheMap->WorkQueueLinks );
+                }
+
+                CcVolumeWorkSequence += 1;
+                WorkQueueEntry->Parameters.Write.VolumeWorkSequence = CcVolumeWorkSequence;
+            }
+
             InsertTailList( WorkQueue, &WorkQueueEntry->WorkQueueLinks );
             IoStatus.Information = 0;
         }
 
+        //
+        //  We are done with the volume of the last workitem, if any.
+        //
+
+        if (VolumeCacheMap != NULL) {
+
+            VolumeCacheMap->ActiveWorkerThreads -= 1;
+            VolumeCacheMap = NULL;
+        }
+
         //
         //  First see if there is something in the express queue.
         //
@@ -901,12 +1255,25 @@ Return Value:
             WorkQueue = &CcExpressWorkQueue;
 
         //
-        //  If there was nothing there, then try the regular queue.
+        //  If there was nothing there, then try the regular queue.  An
+        //  EventSet must wait for the write behind which was queued to the
+        //  volumes ahead of it, so leave it until that work has drained.
         //
 
-        } else if (!IsListEmpty(&CcRegularWorkQueue)) {
+        } else if (!IsListEmpty(&CcRegularWorkQueue) &&
+                   ((CONTAINING_RECORD( CcRegularWorkQueue.Flink, WORK_QUEUE_ENTRY, WorkQueueLinks )->Function != EventSet) ||
+                    CcVolumeWorkDrained( CONTAINING_RECORD( CcRegularWorkQueue.Flink,
+                                                            WORK_QUEUE_ENTRY,
+                                                            WorkQueueLinks )->Parameters.Event.VolumeWorkSequence ))) {
             WorkQueue = &CcRegularWorkQueue;
 
+        //
+        //  Then look for a volume with write behind to do.
+        //
+
+        } else if ((VolumeCacheMap = CcFindVolumeWorkQueue()) != NULL) {
+            WorkQueue = &VolumeCacheMap->WorkQueue;
+
         //
         //  Else we can break and go idle.
         //
@@ -935,6 +1302,20 @@ Return Value:
 
         RemoveHeadList( WorkQueue );
 
+        //
+        //  Account for this thread against the volume, and take the volume
+        //  out of the ready list if we emptied its queue.
+        //
+
+        if (VolumeCacheMap != NULL) {
+
+            VolumeCacheMap->ActiveWorkerThreads += 1;
+
+            if (IsListEmpty( WorkQueue )) {
+                RemoveEntryList( &VolumeCacheMap->WorkQueueLinks );
+            }
+        }
+
         CcReleaseWorkQueueLock( OldIrql );
 
         //
@@ -955,7 +1336,8 @@ Return Value:
                 DebugTrace( 0, me, "CcWorkerThread Read Ahead FileObject = %08lx\n",
                             WorkQueueEntry->Parameters.Read.FileObject );
 
-                CcPerformReadAhead( WorkQueueEntry->Parameters.Read.FileObject );
+                CcPerformReadAhead( WorkQueueEntry->Parameters.Read.FileObject,
+                                    WorkQueueEntry->Parameters.Read.ReadAheadGeneration );
 
                 break;
 
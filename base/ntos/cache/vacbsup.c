@@ -67,6 +67,12 @@ CcSetVacbLargeOffset (
     IN PVACB Vacb
     );
 
+VOID
+CcMapViewGroup (
+    IN PSHARED_CACHE_MAP SharedCacheMap,
+    IN LARGE_INTEGER FileOffset
+    );
+
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text(INIT, CcInitializeVacbs)
 #endif
@@ -213,6 +219,12 @@ Return Value:
             InsertTailList( &CcVacbFreeList, &NextVacb->LruList );
         }
     }
+
+    //
+    //  Only map view groups if the system cache is big enough.
+    //
+
+    CcViewGroups = (CcNumberVacbs >= CC_VIEW_GROUP_MIN_VACBS);
 }
 
 
@@ -388,6 +400,7 @@ Return Value:
     PVACB TempVacb;
     ULONG VacbOffset = FileOffset.LowPart & (VACB_MAPPING_GRANULARITY - 1);
     LOGICAL HasBcbListHeads = FALSE;
+    LOGICAL ViewGroup = FALSE;
 
     ASSERT(KeGetCurrentIrql() < DISPATCH_LEVEL);
 
@@ -420,6 +433,10 @@ Return Value:
 
     if ((TempVacb = GetVacb( SharedCacheMap, FileOffset )) == NULL) {
 
+        CcVacbMisses += 1;
+        SharedCacheMap->VacbMisses += 1;
+        ViewGroup = CcUseViewGroups( SharedCacheMap );
+
         TempVacb = CcGetVacbMiss( SharedCacheMap, FileOffset, &LockHandle, HasBcbListHeads );
 
     } else {
@@ -441,6 +458,16 @@ Return Value:
     CcReleaseBcbSpinLockAndVacbLock( HasBcbListHeads, &LockHandle );
 
     ExReleasePushLockShared( &SharedCacheMap->VacbPushLock );
+
+    //
+    //  If this stream uses view groups, map the rest of the view group
+    //  now, so that we do not miss again until we leave it.
+    //
+
+    if (ViewGroup) {
+
+        CcMapViewGroup( SharedCacheMap, FileOffset );
+    }
     
     //
     //  Now form all outputs.
@@ -512,6 +539,7 @@ Return Value:
     ULONG PageIsDirty;
     PVACB ActiveVacb = NULL;
     ULONG VacbOffset = FileOffset.LowPart & (VACB_MAPPING_GRANULARITY - 1);
+    ULONG MapLimit = SEQUENTIAL_MAP_LIMIT;
 
     NormalOffset = FileOffset;
     NormalOffset.LowPart -= VacbOffset;
@@ -540,10 +568,18 @@ Return Value:
     //  pages should come from.  We can't let the filecache size make large
     //  excursions, or we'll kick out a lot of valuable pages in the process.
     //
+    //  Streams using view groups unmap a whole view group at a time, since
+    //  mapping a view group would otherwise trip the unmap behind within
+    //  the view itself.
+    //
+
+    if (CcUseViewGroups( SharedCacheMap )) {
+        MapLimit = CC_VIEW_GROUP_SIZE;
+    }
 
     if (!FlagOn(SharedCacheMap->Flags, RANDOM_ACCESS_SEEN) &&
-        ((NormalOffset.LowPart & (SEQUENTIAL_MAP_LIMIT - 1)) == 0) &&
-        (NormalOffset.QuadPart >= (SEQUENTIAL_MAP_LIMIT * 2))) {
+        ((NormalOffset.LowPart & (MapLimit - 1)) == 0) &&
+        (NormalOffset.QuadPart >= (MapLimit * 2))) {
 
         //
         //  Use MappedLength as a scratch variable to form the offset
@@ -562,8 +598,8 @@ Return Value:
         CcReleaseBcbSpinLockAndVacbLock( HasBcbListHeads, LockHandle );
         ExReleasePushLockShared( &SharedCacheMap->VacbPushLock );
         
-        MappedLength.QuadPart = NormalOffset.QuadPart - (SEQUENTIAL_MAP_LIMIT * 2);
-        CcUnmapVacbArray( SharedCacheMap, &MappedLength, (SEQUENTIAL_MAP_LIMIT * 2), TRUE );
+        MappedLength.QuadPart = NormalOffset.QuadPart - (MapLimit * 2);
+        CcUnmapVacbArray( SharedCacheMap, &MappedLength, (MapLimit * 2), TRUE );
 
         ExAcquirePushLockShared( &SharedCacheMap->VacbPushLock );
         CcAcquireBcbSpinLockAndVacbLock( HasBcbListHeads, SharedCacheMap, LockHandle );
@@ -723,6 +759,8 @@ Return Value:
 
     if (Vacb->BaseAddress != NULL) {
 
+        CcVacbRemaps += 1;
+
         //
         //  Check to see if we need to drain the zone.
         //
@@ -974,6 +1012,90 @@ Return Value:
 }
 
 
+VOID
+CcMapViewGroup (
+    IN PSHARED_CACHE_MAP SharedCacheMap,
+    IN LARGE_INTEGER FileOffset
+    )
+
+/*++
+
+Routine Description:
+
+    This routine maps every view of the CC_VIEW_GROUP_SIZE aligned range
+    containing the specified file offset which is not already mapped, and
+    leaves them at the back of the LRU for the caller to find.
+
+    Mapping the rest of the view group is only an optimization, so we just
+    stop if we run out of views or cannot map one.
+
+Arguments:
+
+    SharedCacheMap - Supplies a pointer to the Shared Cache Map for the file.
+
+    FileOffset - Supplies the file offset which just missed.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+    KLOCK_QUEUE_HANDLE LockHandle;
+    LARGE_INTEGER Offset;
+    LONGLONG EndOffset;
+    PVACB Vacb;
+
+    Offset.QuadPart = FileOffset.QuadPart & ~((LONGLONG)CC_VIEW_GROUP_SIZE - 1);
+    EndOffset = Offset.QuadPart + CC_VIEW_GROUP_SIZE;
+
+    if (EndOffset > SharedCacheMap->SectionSize.QuadPart) {
+        EndOffset = SharedCacheMap->SectionSize.QuadPart;
+    }
+
+    CcViewGroupMaps += 1;
+
+    try {
+
+        for (; Offset.QuadPart < EndOffset; Offset.QuadPart += VACB_MAPPING_GRANULARITY) {
+
+            ExAcquirePushLockShared( &SharedCacheMap->VacbPushLock );
+            CcAcquireBcbSpinLockAndVacbLock( FALSE, SharedCacheMap, &LockHandle );
+
+            //
+            //  Skip views which are already mapped, including the one which
+            //  our caller just missed on.
+            //
+
+            if (GetVacb( SharedCacheMap, Offset ) != NULL) {
+
+                CcReleaseBcbSpinLockAndVacbLock( FALSE, &LockHandle );
+                ExReleasePushLockShared( &SharedCacheMap->VacbPushLock );
+                continue;
+            }
+
+            //
+            //  CcGetVacbMiss releases our locks if it raises.
+            //
+
+            Vacb = CcGetVacbMiss( SharedCacheMap, Offset, &LockHandle, FALSE );
+            CcMoveVacbToReuseTail( Vacb );
+
+            CcReleaseBcbSpinLockAndVacbLock( FALSE, &LockHandle );
+            ExReleasePushLockShared( &SharedCacheMap->VacbPushLock );
+
+            CcFreeVirtualAddress( Vacb );
+        }
+
+    } except( FsRtlIsNtstatusExpected( GetExceptionCode() ) ?
+              EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH ) {
+
+        NOTHING;
+    }
+}
+
+
 VOID
 FASTCALL
 CcFreeVirtualAddress (
@@ -3371,6 +3493,7 @@ Environment:
                     SetFlag(SharedCacheMap->Flags, ACTIVE_PAGE_IS_DIRTY);
                     CcTotalDirtyPages += 1;
                     SharedCacheMap->DirtyPages += 1;
+                    SharedCacheMap->VolumeCacheMap->DirtyPages += 1;
                     if (SharedCacheMap->DirtyPages == 1) {
                         PLIST_ENTRY Blink;
                         PLIST_ENTRY Entry;
@@ -3395,9 +3518,11 @@ Environment:
 #else
                             ExReleaseFastLock(&SharedCacheMap->ActiveVacbSpinLock, Irql);
 #endif
-                            KeSetTimer( &LazyWriter.ScanTimer,
-                                        CcFirstDelay,
-                                        &LazyWriter.ScanDpc );
+                            KeSetCoalescableTimer( &LazyWriter.ScanTimer,
+                                                   CcFirstDelay,
+                                                   0,
+                                                   LAZY_WRITER_TOLERABLE_DELAY,
+                                                   &LazyWriter.ScanDpc );
                             break;
                         }
                     }
@@ -53,6 +53,13 @@ ULONG CmpLazyFlushHiveCount = 7;
 //
 #define ENABLE_LAZY_FLUSH_INTERVAL_IN_SECONDS   600
 
+//
+// LAZY_FLUSH_TOLERABLE_DELAY_IN_MS is how late the lazy flush timers may
+// fire (see KeSetCoalescableTimer).  Dirty hive data already waits several
+// seconds for the flush, so another second is of no consequence.
+//
+#define LAZY_FLUSH_TOLERABLE_DELAY_IN_MS        1000
+
 PKPROCESS   CmpSystemProcess;
 KTIMER      CmpLazyFlushTimer;
 KDPC        CmpLazyFlushDpc;
@@ -265,9 +272,11 @@ Return Value:
     DueTime.QuadPart = Int32x32To64(ENABLE_LAZY_FLUSH_INTERVAL_IN_SECONDS,
                                     - SECOND_MULT);
 
-    KeSetTimer(&CmpEnableLazyFlushTimer,
-               DueTime,
-               &CmpEnableLazyFlushDpc);
+    KeSetCoalescableTimer(&CmpEnableLazyFlushTimer,
+                          DueTime,
+                          0,
+                          LAZY_FLUSH_TOLERABLE_DELAY_IN_MS,
+                          &CmpEnableLazyFlushDpc);
 
     CmpNoWrite = CmpMiniNTBoot;
 
@@ -478,9 +487,11 @@ Return Value:
         // Indicate relative time
         //
 
-        KeSetTimer(&CmpLazyFlushTimer,
-                   DueTime,
-                   &CmpLazyFlushDpc);
+        KeSetCoalescableTimer(&CmpLazyFlushTimer,
+                              DueTime,
+                              0,
+                              LAZY_FLUSH_TOLERABLE_DELAY_IN_MS,
+                              &CmpLazyFlushDpc);
 
     }
 
@@ -610,6 +610,7 @@ Return Value:
     Lookaside->Size = Size;
     Lookaside->LastTotalAllocates = 0;
     Lookaside->LastAllocateHits = 0;
+    LOOKASIDE_SET_STATE(Lookaside, 0, 0, LOOKASIDE_DEPTH_HOLD);
     InsertTailList(ListHead, &Lookaside->ListEntry);
     return;
 }
@@ -287,6 +287,8 @@ extern BOOLEAN ExpTooLateForErrors;
 extern FAST_MUTEX ExpEnvironmentLock;
 extern ERESOURCE ExpKeyManipLock;
 
+extern PEX_WORK_QUEUE ExpNodeWorkerQueue[];
+
 extern GENERAL_LOOKASIDE ExpSmallPagedPoolLookasideLists[POOL_SMALL_LISTS];
 extern GENERAL_LOOKASIDE ExpSmallNPagedPoolLookasideLists[POOL_SMALL_LISTS];
 
@@ -295,6 +297,22 @@ extern KSPIN_LOCK ExNPagedLookasideLock;
 extern LIST_ENTRY ExPagedLookasideListHead;
 extern KSPIN_LOCK ExPagedLookasideLock;
 extern LIST_ENTRY ExPoolLookasideListHead;
+
+//
+// The lookaside depth controller keeps its state in the reserved fields of
+// the general lookaside structure: the smoothed miss ratio and the last
+// decision in the first and the allocate misses per second in the second.
+//
+
+#define LOOKASIDE_MISS_RATIO(L) ((USHORT)((L)->Future[0] & 0xFFFF))
+
+#define LOOKASIDE_DECISION(L) ((UCHAR)((L)->Future[0] >> 16))
+
+#define LOOKASIDE_MISS_RATE(L) ((L)->Future[1])
+
+#define LOOKASIDE_SET_STATE(L, Ratio, Rate, Decision)                    \
+    ((L)->Future[0] = ((ULONG)(Decision) << 16) | ((Ratio) & 0xFFFF),    \
+     (L)->Future[1] = (Rate))
 extern PEPROCESS ExpDefaultErrorPortProcess;
 extern HANDLE ExpDefaultErrorPort;
 extern HANDLE ExpProductTypeKey;
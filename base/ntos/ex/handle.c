@@ -148,6 +148,21 @@ ULONG CurrentSeq = 0;
 
 #define LEVEL_CODE_MASK 3
 
+//
+//  Define the per processor free handle caches.  Each cache is a cache line
+//  of free handle values (zero means an empty slot) which are claimed and
+//  released with interlocked operations so a thread that migrates to another
+//  processor in the middle of an operation is harmless.  Empty caches are
+//  refilled and full caches drained a batch at a time.
+//
+
+#define HANDLE_CACHE_ENTRIES 16
+#define HANDLE_CACHE_BATCH 8
+
+typedef struct _HANDLE_TABLE_CACHE {
+    ULONG Index[HANDLE_CACHE_ENTRIES];
+} HANDLE_TABLE_CACHE, *PHANDLE_TABLE_CACHE;
+
 //
 //  Local support routines
 //
@@ -175,6 +190,29 @@ ExpAllocateHandleTableEntry (
     OUT PEXHANDLE Handle
     );
 
+PHANDLE_TABLE_ENTRY
+ExpPopFreeHandleTableEntry (
+    IN PHANDLE_TABLE HandleTable,
+    OUT PEXHANDLE pHandle,
+    IN BOOLEAN Expand
+    );
+
+VOID
+ExpAllocateHandleCache (
+    IN PHANDLE_TABLE HandleTable
+    );
+
+VOID
+ExpRefillHandleCache (
+    IN PHANDLE_TABLE HandleTable
+    );
+
+BOOLEAN
+ExpFreeHandleToCache (
+    IN PHANDLE_TABLE HandleTable,
+    IN ULONG NewFree
+    );
+
 VOID
 ExpFreeHandleTableEntry (
     IN PHANDLE_TABLE HandleTable,
@@ -264,6 +302,10 @@ ExpAllocateTablePagedPoolNoZero (
 #pragma alloc_text(PAGE, ExpAllocateHandleTable)
 #pragma alloc_text(PAGE, ExpFreeHandleTable)
 #pragma alloc_text(PAGE, ExpAllocateHandleTableEntry)
+#pragma alloc_text(PAGE, ExpPopFreeHandleTableEntry)
+#pragma alloc_text(PAGE, ExpAllocateHandleCache)
+#pragma alloc_text(PAGE, ExpRefillHandleCache)
+#pragma alloc_text(PAGE, ExpFreeHandleToCache)
 #pragma alloc_text(PAGE, ExpAllocateHandleTableEntrySlow)
 #pragma alloc_text(PAGE, ExpFreeHandleTableEntry)
 #pragma alloc_text(PAGE, ExpLookupHandleTableEntry)
@@ -485,8 +527,352 @@ ExpAllocateHandleTableEntry (
 
 Routine Description:
 
-    This routine does a fast allocate of a free handle. It's lock free if
-    possible.
+    This routine does a fast allocate of a free handle. The per processor
+    free handle cache is tried first, then the shared free list. If the
+    cache was empty it is refilled with a batch from the shared list.
+
+Arguments:
+
+    HandleTable - Supplies the handle table being allocated from.
+
+    pHandle - Handle returned
+
+Return Value:
+
+    PHANDLE_TABLE_ENTRY - The allocated handle table entry pointer or NULL
+                          on failure.
+
+--*/
+{
+    PHANDLE_TABLE_CACHE HandleCache;
+    PHANDLE_TABLE_ENTRY Entry;
+    EXHANDLE Handle;
+    ULONG Value;
+    ULONG i;
+
+    HandleCache = HandleTable->HandleCache;
+
+    if (HandleCache != NULL) {
+
+        HandleCache += KeGetCurrentProcessorNumber () % HandleTable->HandleCacheCount;
+
+        for (i = 0; i < HANDLE_CACHE_ENTRIES; i += 1) {
+
+            if (HandleCache->Index[i] == 0) {
+                continue;
+            }
+
+            Value = InterlockedExchange ((PLONG)&HandleCache->Index[i], 0);
+
+            if (Value != 0) {
+
+                Handle.Value = Value;
+
+                Entry = ExpLookupHandleTableEntry (HandleTable, Handle);
+
+                EXASSERT (Entry->Object == NULL);
+
+                InterlockedIncrement (&HandleTable->HandleCount);
+
+                *pHandle = Handle;
+
+                return Entry;
+            }
+        }
+    }
+
+    Entry = ExpPopFreeHandleTableEntry (HandleTable, pHandle, TRUE);
+
+    if (Entry == NULL) {
+        return NULL;
+    }
+
+    if (HandleCache != NULL) {
+        ExpRefillHandleCache (HandleTable);
+    }
+
+    InterlockedIncrement (&HandleTable->HandleCount);
+
+    return Entry;
+}
+
+VOID
+ExpAllocateHandleCache (
+    IN PHANDLE_TABLE HandleTable
+    )
+/*++
+
+Routine Description:
+
+    This routine allocates the per processor free handle caches for a
+    handle table.  Tables which are strict FIFO or traced are left alone
+    since the caches recycle handle values quickly.
+
+    Note: The caller must have the handle table locked exclusive.
+
+Arguments:
+
+    HandleTable - Supplies the handle table to allocate caches for.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    PHANDLE_TABLE_CACHE HandleCache;
+    ULONG Count;
+
+    PAGED_CODE();
+
+    Count = (ULONG) KeNumberProcessors;
+
+    if ((Count == 1) ||
+        (HandleTable->StrictFIFO) ||
+        (HandleTable->DebugInfo != NULL)) {
+        return;
+    }
+
+    HandleCache = ExpAllocateTablePagedPool (HandleTable->QuotaProcess,
+                                             Count * sizeof (HANDLE_TABLE_CACHE));
+
+    if (HandleCache == NULL) {
+        return;
+    }
+
+    //
+    // Publish the count before the caches as lock free readers use it once
+    // they see the caches.
+    //
+
+    HandleTable->HandleCacheCount = Count;
+
+    InterlockedExchangePointer ((PVOID *)&HandleTable->HandleCache, HandleCache);
+
+    return;
+}
+
+FORCEINLINE
+VOID
+ExpPushFreeHandleChain (
+    IN PHANDLE_TABLE HandleTable,
+    IN ULONG FirstIndex,
+    IN PHANDLE_TABLE_ENTRY LastEntry
+    )
+/*++
+
+Routine Description:
+
+    This routine pushes a chain of free entries linked through their
+    NextFreeTableEntry fields onto the alternate free list of the table.
+    Like any free of a potentially old entry it uses the alternate list to
+    avoid the A-B-A problem; ExpMoveFreeHandles moves the entries over.
+
+Arguments:
+
+    HandleTable - Supplies the handle table the chain belongs to.
+
+    FirstIndex - Supplies the handle value of the first entry in the chain.
+
+    LastEntry - Supplies the last entry in the chain.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    ULONG OldFree;
+
+    while (1) {
+
+        OldFree = ReadForWriteAccess (&HandleTable->LastFree);
+        LastEntry->NextFreeTableEntry = OldFree;
+
+        if ((ULONG)InterlockedCompareExchange ((PLONG)&HandleTable->LastFree,
+                                               FirstIndex,
+                                               OldFree) == OldFree) {
+            break;
+        }
+    }
+}
+
+VOID
+ExpRefillHandleCache (
+    IN PHANDLE_TABLE HandleTable
+    )
+/*++
+
+Routine Description:
+
+    This routine moves a batch of free handles from the shared free list of
+    the table into the cache of the current processor.  The table is never
+    expanded just to fill the cache.
+
+Arguments:
+
+    HandleTable - Supplies the handle table whose cache is refilled.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    PHANDLE_TABLE_CACHE HandleCache;
+    PHANDLE_TABLE_ENTRY Entry;
+    EXHANDLE Handle;
+    ULONG Count;
+    ULONG i;
+
+    PAGED_CODE();
+
+    HandleCache = HandleTable->HandleCache;
+    HandleCache += KeGetCurrentProcessorNumber () % HandleTable->HandleCacheCount;
+
+    i = 0;
+
+    for (Count = 0; Count < HANDLE_CACHE_BATCH; Count += 1) {
+
+        Entry = ExpPopFreeHandleTableEntry (HandleTable, &Handle, FALSE);
+
+        if (Entry == NULL) {
+            break;
+        }
+
+        //
+        // Find an empty slot for the handle.  Other threads may be filling
+        // this cache too, so if none is left give the handle back.
+        //
+
+        for ( ; i < HANDLE_CACHE_ENTRIES; i += 1) {
+
+            if ((HandleCache->Index[i] == 0) &&
+                (InterlockedCompareExchange ((PLONG)&HandleCache->Index[i],
+                                             (LONG) Handle.Value,
+                                             0) == 0)) {
+                break;
+            }
+        }
+
+        if (i == HANDLE_CACHE_ENTRIES) {
+            ExpPushFreeHandleChain (HandleTable, (ULONG) Handle.Value, Entry);
+            break;
+        }
+    }
+
+    return;
+}
+
+BOOLEAN
+ExpFreeHandleToCache (
+    IN PHANDLE_TABLE HandleTable,
+    IN ULONG NewFree
+    )
+/*++
+
+Routine Description:
+
+    This routine places a free handle in the cache of the current processor.
+    If the cache is full a batch of its handles is first chained together
+    and pushed onto the alternate free list of the table with a single
+    interlocked operation.
+
+Arguments:
+
+    HandleTable - Supplies the handle table the handle belongs to.
+
+    NewFree - Supplies the free handle value.
+
+Return Value:
+
+    BOOLEAN - TRUE if the handle was cached, FALSE if the caller must free
+              it to the shared free list.
+
+--*/
+{
+    PHANDLE_TABLE_CACHE HandleCache;
+    PHANDLE_TABLE_ENTRY Entry;
+    PHANDLE_TABLE_ENTRY LastEntry;
+    EXHANDLE Handle;
+    ULONG FirstIndex;
+    ULONG Value;
+    ULONG i;
+
+    PAGED_CODE();
+
+    HandleCache = HandleTable->HandleCache;
+    HandleCache += KeGetCurrentProcessorNumber () % HandleTable->HandleCacheCount;
+
+    for (i = 0; i < HANDLE_CACHE_ENTRIES; i += 1) {
+
+        if ((HandleCache->Index[i] == 0) &&
+            (InterlockedCompareExchange ((PLONG)&HandleCache->Index[i],
+                                         (LONG) NewFree,
+                                         0) == 0)) {
+            return TRUE;
+        }
+    }
+
+    //
+    // The cache is full.  Drain a batch of handles from it, link them
+    // through their entries and push the whole chain at once.
+    //
+
+    FirstIndex = 0;
+    LastEntry = NULL;
+
+    for (i = 0; i < HANDLE_CACHE_BATCH; i += 1) {
+
+        Value = InterlockedExchange ((PLONG)&HandleCache->Index[i], 0);
+
+        if (Value == 0) {
+            continue;
+        }
+
+        Handle.Value = Value;
+
+        Entry = ExpLookupHandleTableEntry (HandleTable, Handle);
+
+        EXASSERT (Entry->Object == NULL);
+
+        Entry->NextFreeTableEntry = FirstIndex;
+        FirstIndex = Value;
+
+        if (LastEntry == NULL) {
+            LastEntry = Entry;
+        }
+    }
+
+    if (LastEntry != NULL) {
+        ExpPushFreeHandleChain (HandleTable, FirstIndex, LastEntry);
+    }
+
+    for (i = 0; i < HANDLE_CACHE_ENTRIES; i += 1) {
+
+        if ((HandleCache->Index[i] == 0) &&
+            (InterlockedCompareExchange ((PLONG)&HandleCache->Index[i],
+                                         (LONG) NewFree,
+                                         0) == 0)) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+PHANDLE_TABLE_ENTRY
+ExpPopFreeHandleTableEntry (
+    IN PHANDLE_TABLE HandleTable,
+    OUT PEXHANDLE pHandle,
+    IN BOOLEAN Expand
+    )
+/*++
+
+Routine Description:
+
+    This routine pops a free handle from the shared free list of the table.
+    It's lock free if possible.
 
     Only the rare case of handle table expansion is covered by the handle
     table lock.
@@ -497,11 +883,16 @@ Arguments:
 
     pHandle - Handle returned
 
+    Expand - Supplies FALSE if the caller only wants an entry which is
+             already on the free list, i.e., the table must not be expanded.
+
 Return Value:
 
     PHANDLE_TABLE_ENTRY - The allocated handle table entry pointer or NULL
                           on failure.
 
+    N.B. The handle count of the table is not updated.
+
 --*/
 {
     PKTHREAD CurrentThread;
@@ -519,6 +910,12 @@ Return Value:
 
 
         while (OldValue == 0) {
+
+            if (!Expand) {
+                pHandle->GenericHandleOverlay = NULL;
+                return NULL;
+            }
+
             //
             //  Lock the handle table for exclusive access as we will be
             //  allocating a new table level.
@@ -556,6 +953,15 @@ Return Value:
 
             RetVal = ExpAllocateHandleTableEntrySlow (HandleTable, TRUE);
 
+            //
+            // Once a table has grown beyond its first page give it per
+            // processor free handle caches.
+            //
+
+            if (RetVal && (HandleTable->HandleCache == NULL)) {
+                ExpAllocateHandleCache (HandleTable);
+            }
+
             ExpUnlockHandleTableExclusive (HandleTable, CurrentThread);
 
 
@@ -610,8 +1016,6 @@ Return Value:
             EXASSERT ((NewValue1 & FREE_HANDLE_MASK) != (OldValue & FREE_HANDLE_MASK));
         }
     }
-    InterlockedIncrement (&HandleTable->HandleCount);
-
     *pHandle = Handle;
     
     return Entry;
@@ -2917,6 +3321,16 @@ Return Value:
                              );
     }
 
+    //
+    // Free the per processor handle caches if we have any.
+    //
+
+    if (HandleTable->HandleCache != NULL) {
+        ExpFreeTablePagedPool (Process,
+                               HandleTable->HandleCache,
+                               HandleTable->HandleCacheCount * sizeof (HANDLE_TABLE_CACHE));
+    }
+
     //
     // Free any debug info if we have any.
     //
@@ -3489,6 +3903,16 @@ Return Value:
 
         if (!HandleTable->StrictFIFO) {
 
+            //
+            // Tables with per processor caches free to the cache first unless
+            // handle tracing was enabled since the caches were created.
+            //
+
+            if ((HandleTable->HandleCache != NULL) &&
+                (HandleTable->DebugInfo == NULL) &&
+                ExpFreeHandleToCache (HandleTable, NewFree)) {
+                return;
+            }
 
             //
             // We are pushing potentially old entries onto the free list.
@@ -32,6 +32,23 @@ Abstract:
 
 #define MINIMUM_ALLOCATION_THRESHOLD 25
 
+//
+// Define the smoothed miss ratios (in tenths of a percent) above which the
+// depth of a lookaside list is raised and below which it is lowered, and the
+// minimum depth increase.
+//
+
+#define GROW_MISS_RATIO 10
+#define SHRINK_MISS_RATIO 5
+#define MINIMUM_LOOKASIDE_GROWTH 4
+
+//
+// Define the number of available pages below which memory is considered low
+// and surplus lookaside entries are returned to pool.
+//
+
+#define LOOKASIDE_LOW_MEMORY_PAGES ((8 * 1024 * 1024) / PAGE_SIZE)
+
 //
 // Define forward referenced function prototypes.
 //
@@ -71,6 +88,7 @@ LIST_ENTRY ExSystemLookasideListHead;
 
 ULONG ExpPoolScanCount = 0;
 ULONG ExpScanCount = 0;
+LOGICAL ExpLookasideMemoryLow = FALSE;
 
 //
 // Lookasides are disabled (via the variable below) when the verifier is on.
@@ -98,10 +116,21 @@ Return Value:
 
     None.
 
+Environment:
+
+    Kernel mode, PASSIVE_LEVEL.
+
 --*/
 
 {
 
+    //
+    // Sample the memory state once per scan so all the lookaside lists
+    // scanned this period make the same decision.
+    //
+
+    ExpLookasideMemoryLow = !MmIsMemoryAvailable(LOOKASIDE_LOW_MEMORY_PAGES);
+
     //
     // Switch on the current scan count.
     //
@@ -137,6 +166,21 @@ Return Value:
 
     case 2:
         ExpScanSystemLookasideList();
+
+#if !defined (NT_UP)
+
+        //
+        // Return the full magazines which were not needed during the last
+        // period from the pool magazine depots to the pools, and free the
+        // magazine pages if every magazine is idle.
+        //
+
+        ExpFlushPoolMagazineDepot(NonPagedPool, TRUE);
+        ExpFlushPoolMagazineDepot(PagedPool, TRUE);
+        ExpReleasePoolMagazinePages();
+
+#endif
+
         break;
     }
 
@@ -170,6 +214,12 @@ Routine Description:
     total allocations and misses during the last scan period and the current
     depth.
 
+    The direction of the adjustment is taken from a smoothed miss ratio so
+    a single bursty period does not whipsaw the depth, and the size of an
+    increase is taken from the number of allocations per second which fell
+    through to pool, since that is the number of additional entries which
+    would have been hits.
+
 Arguments:
 
     Lookaside - Supplies a pointer to a lookaside list descriptor.
@@ -187,8 +237,11 @@ Return Value:
 {
 
     ULONG Allocates;
+    ULONG Decision;
     ULONG Delta;
     USHORT MaximumDepth;
+    ULONG MissRate;
+    ULONG MissRatio;
     ULONG Ratio;
     LONG Target;
 
@@ -200,60 +253,180 @@ Return Value:
     Allocates = Lookaside->TotalAllocates - Lookaside->LastTotalAllocates;
     Lookaside->LastTotalAllocates = Lookaside->TotalAllocates;
 
+    MissRate = Misses / ScanPeriod;
+
+    //
+    // Fold the miss ratio (in tenths of a percent) of this scan period into
+    // the smoothed miss ratio with a weight of one quarter.
+    //
+    // N.B. It is possible that the number of misses are greater than the
+    //      number of allocates, so the ratio is clamped.
+    //
+
+    MissRatio = LOOKASIDE_MISS_RATIO(Lookaside);
+    if (Allocates != 0) {
+        Ratio = (ULONG)(((ULONGLONG)Misses * 1000) / Allocates);
+        if (Ratio > 1000) {
+            Ratio = 1000;
+        }
+
+        MissRatio = ((MissRatio * 3) + Ratio) / 4;
+
+    } else {
+        MissRatio = (MissRatio * 3) / 4;
+    }
+
     //
     // If the verifier is enabled, disable lookasides so driver problems can
     // be isolated. Otherwise, compute the target lookaside list depth.
     //
 
+    MaximumDepth = Lookaside->MaximumDepth;
+    Target = Lookaside->Depth;
     if (ExMinimumLookasideDepth == 0) {
         Target = 0;
+        Decision = LOOKASIDE_DEPTH_DISABLED;
 
     } else {
-    
+
         //
-        // If the allocate rate is less than the minimum threshold, then lower
-        // the maximum depth of the lookaside list. Otherwise, if the miss rate
-        // is less than .5%, then lower the maximum depth. Otherwise, raise the
-        // maximum depth based on the miss rate.
+        // If the allocate rate is less than the minimum threshold, then halve
+        // the depth of the lookaside list. Otherwise, if memory is low, then
+        // lower the depth by a quarter. Otherwise, raise the depth when the
+        // smoothed miss ratio is high and lower it slowly when the ratio is
+        // very low.
         //
-    
-        MaximumDepth = Lookaside->MaximumDepth;
-        Target = Lookaside->Depth;
+
         if (Allocates < (ScanPeriod * MINIMUM_ALLOCATION_THRESHOLD)) {
-            if ((Target -= 10) < MINIMUM_LOOKASIDE_DEPTH) {
-                Target = MINIMUM_LOOKASIDE_DEPTH;
+            Target -= Target / 2;
+            Decision = LOOKASIDE_DEPTH_IDLE;
+
+        } else if (ExpLookasideMemoryLow != FALSE) {
+            Target -= Target / 4;
+            Decision = LOOKASIDE_DEPTH_PRESSURE;
+
+        } else if (MissRatio >= GROW_MISS_RATIO) {
+            Delta = MissRate;
+            if (Delta < MINIMUM_LOOKASIDE_GROWTH) {
+                Delta = MINIMUM_LOOKASIDE_GROWTH;
             }
-    
-        } else {
-    
-            //
-            // N.B. The number of allocates is guaranteed to be greater than
-            //      zero because of the above test. 
-            //
-            // N.B. It is possible that the number of misses are greater than the
-            //      number of allocates, but this won't cause the an incorrect
-            //      computation of the depth adjustment.
-            //      
-    
-            Ratio = (Misses * 1000) / Allocates;
-            if (Ratio < 5) {
-                if ((Target -= 1) < MINIMUM_LOOKASIDE_DEPTH) {
-                    Target = MINIMUM_LOOKASIDE_DEPTH;
-                }
-        
-            } else {
-                if ((Delta = ((Ratio * (MaximumDepth - Target)) / (1000 * 2)) + 5) > 30) {
-                    Delta = 30;
-                }
-        
-                if ((Target += Delta) > MaximumDepth) {
-                    Target = MaximumDepth;
-                }
+
+            if (Delta > (ULONG)(MaximumDepth - Target)) {
+                Delta = MaximumDepth - Target;
+            }
+
+            Target += Delta;
+            Decision = LOOKASIDE_DEPTH_GROW;
+
+        } else if (MissRatio < SHRINK_MISS_RATIO) {
+            if ((Delta = Target / 8) == 0) {
+                Delta = 1;
             }
+
+            Target -= Delta;
+            Decision = LOOKASIDE_DEPTH_SHRINK;
+
+        } else {
+            Decision = LOOKASIDE_DEPTH_HOLD;
+        }
+
+        if (Target < MINIMUM_LOOKASIDE_DEPTH) {
+            Target = MINIMUM_LOOKASIDE_DEPTH;
+        }
+
+        if (Target > MaximumDepth) {
+            Target = MaximumDepth;
         }
     }
 
     Lookaside->Depth = (USHORT)Target;
+    LOOKASIDE_SET_STATE(Lookaside, MissRatio, MissRate, Decision);
+    return;
+}
+
+FORCEINLINE
+PSLIST_ENTRY
+ExpTrimLookasideList (
+    IN PGENERAL_LOOKASIDE Lookaside,
+    IN PSLIST_ENTRY TrimList
+    )
+
+/*++
+
+Routine Description:
+
+    This function removes the entries above the current depth of a
+    lookaside list and chains them onto the specified trim list. The
+    caller frees the entries once it no longer holds any locks.
+
+Arguments:
+
+    Lookaside - Supplies a pointer to a lookaside list descriptor.
+
+    TrimList - Supplies the current head of the trim list.
+
+Return Value:
+
+    The new head of the trim list.
+
+--*/
+
+{
+
+    PSLIST_ENTRY Entry;
+
+    while (ExQueryDepthSList(&Lookaside->ListHead) > Lookaside->Depth) {
+        Entry = InterlockedPopEntrySList(&Lookaside->ListHead);
+        if (Entry == NULL) {
+            break;
+        }
+
+        Entry->Next = TrimList;
+        TrimList = Entry;
+    }
+
+    return TrimList;
+}
+
+FORCEINLINE
+VOID
+ExpFreeLookasideSurplus (
+    IN PGENERAL_LOOKASIDE Lookaside
+    )
+
+/*++
+
+Routine Description:
+
+    This function frees the entries above the current depth of a lookaside
+    list with the free routine of the list.
+
+Arguments:
+
+    Lookaside - Supplies a pointer to a lookaside list descriptor.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, PASSIVE_LEVEL, no locks held.
+
+--*/
+
+{
+
+    PSLIST_ENTRY Entry;
+    PSLIST_ENTRY NextEntry;
+
+    Entry = ExpTrimLookasideList(Lookaside, NULL);
+    while (Entry != NULL) {
+        NextEntry = Entry->Next;
+        (Lookaside->Free)(Entry);
+        Entry = NextEntry;
+    }
+
     return;
 }
 
@@ -290,6 +463,8 @@ Return Value:
     PPAGED_LOOKASIDE_LIST Lookaside;
     ULONG Misses;
     KIRQL OldIrql;
+    PSLIST_ENTRY NextEntry;
+    PSLIST_ENTRY TrimList;
 
 #ifdef NT_UP
 
@@ -301,6 +476,7 @@ Return Value:
     // Raise IRQL and acquire the specified spinlock.
     //
 
+    TrimList = NULL;
     ExAcquireSpinLock(SpinLock, &OldIrql);
 
     //
@@ -322,18 +498,35 @@ Return Value:
         //
         // Compute target depth of lookaside list.
         //
+        // N.B. When memory is low, the surplus entries of lists which free
+        //      to pool are removed now and freed after the spinlock is
+        //      released. Lists with a driver supplied free routine are only
+        //      lowered in depth since the driver may delete the list (and
+        //      unload) as soon as the spinlock is released.
+        //
 
         Misses = Lookaside->L.AllocateMisses - Lookaside->L.LastAllocateMisses;
         Lookaside->L.LastAllocateMisses = Lookaside->L.AllocateMisses;
         ExpComputeLookasideDepth(&Lookaside->L, Misses, 3);
+        if ((ExpLookasideMemoryLow != FALSE) &&
+            (Lookaside->L.Free == ExFreePool)) {
+            TrimList = ExpTrimLookasideList(&Lookaside->L, TrimList);
+        }
+
         Entry = Entry->Flink;
     }
 
     //
-    // Release spinlock, lower IRQL, and return function value.
+    // Release spinlock, lower IRQL, and free any surplus entries.
     //
 
     ExReleaseSpinLock(SpinLock, OldIrql);
+    while (TrimList != NULL) {
+        NextEntry = TrimList->Next;
+        ExFreePool(TrimList);
+        TrimList = NextEntry;
+    }
+
     return;
 }
 
@@ -396,6 +589,9 @@ Return Value:
                 Misses = Lookaside->AllocateMisses - Lookaside->LastAllocateMisses;
                 Lookaside->LastAllocateMisses = Lookaside->AllocateMisses;
                 ExpComputeLookasideDepth(Lookaside, Misses, ScanPeriod);
+                if (ExpLookasideMemoryLow != FALSE) {
+                    ExpFreeLookasideSurplus(Lookaside);
+                }
             }
         }
 
@@ -445,6 +641,9 @@ Return Value:
                 Misses = Lookaside->AllocateMisses - Lookaside->LastAllocateMisses;
                 Lookaside->LastAllocateMisses = Lookaside->AllocateMisses;
                 ExpComputeLookasideDepth(Lookaside, Misses, ScanPeriod);
+                if (ExpLookasideMemoryLow != FALSE) {
+                    ExpFreeLookasideSurplus(Lookaside);
+                }
             }
         }
 
@@ -569,6 +768,7 @@ Return Value:
 
     Lookaside->L.LastTotalAllocates = 0;
     Lookaside->L.LastAllocateMisses = 0;
+    LOOKASIDE_SET_STATE(&Lookaside->L, 0, 0, LOOKASIDE_DEPTH_HOLD);
     
     //
     // Insert the lookaside list structure in the system nonpaged lookaside
@@ -706,6 +906,7 @@ Return Value:
 
     Lookaside->L.LastTotalAllocates = 0;
     Lookaside->L.LastAllocateMisses = 0;
+    LOOKASIDE_SET_STATE(&Lookaside->L, 0, 0, LOOKASIDE_DEPTH_HOLD);
 
     //
     // Insert the lookaside list structure in the system paged lookaside
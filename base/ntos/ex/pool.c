@@ -66,8 +66,30 @@ NTSTATUS
 ExGetPoolTagInfo (
     IN PVOID SystemInformation,
     IN ULONG SystemInformationLength,
-    IN OUT PULONG ReturnLength OPTIONAL
+    IN OUT PULONG ReturnLength OPTIONAL,
+    IN LOGICAL NodeInformation
+    );
+
+#if !defined (NT_UP)
+PPOOL_MAGAZINE_CACHE
+ExpCreatePoolMagazineCache (
+    IN ULONG ProcessorNumber,
+    IN ULONG NodeNumber
+    );
+
+VOID
+ExpFlushPoolMagazineCache (
+    IN PPOOL_MAGAZINE_CACHE Cache
+    );
+
+VOID
+ExpPoolMagazineFlushDpc (
+    IN PKDPC Dpc,
+    IN PVOID DeferredContext,
+    IN PVOID SystemArgument1,
+    IN PVOID SystemArgument2
     );
+#endif
 
 #pragma alloc_text(PAGE, ExpAllocateStringRoutine)
 #pragma alloc_text(INIT, InitializePool)
@@ -77,12 +99,21 @@ ExGetPoolTagInfo (
 #pragma alloc_text(PAGE, ExCreatePoolTagTable)
 #pragma alloc_text(PAGE, ExGetSessionPoolTagInfo)
 #pragma alloc_text(PAGE, ExGetPoolTagInfo)
+#pragma alloc_text(PAGE, ExQueryPoolMagazineUsage)
 #pragma alloc_text(PAGEVRFY, ExAllocatePoolSanityChecks)
 #pragma alloc_text(PAGEVRFY, ExFreePoolSanityChecks)
 #pragma alloc_text(POOLCODE, ExAllocatePoolWithTag)
 #pragma alloc_text(POOLCODE, ExFreePool)
 #pragma alloc_text(POOLCODE, ExFreePoolWithTag)
 #pragma alloc_text(POOLCODE, ExDeferredFreePool)
+#if !defined (NT_UP)
+#pragma alloc_text(PAGE, ExpCreatePoolMagazineCache)
+#pragma alloc_text(POOLCODE, ExpFlushPoolMagazineDepot)
+#pragma alloc_text(POOLCODE, ExpFlushPoolMagazineCache)
+#pragma alloc_text(POOLCODE, ExpFlushPoolMagazines)
+#pragma alloc_text(POOLCODE, ExpPoolMagazineFlushDpc)
+#pragma alloc_text(POOLCODE, ExpReleasePoolMagazinePages)
+#endif
 #endif
 
 #if defined (NT_UP)
@@ -230,6 +261,13 @@ ExpRemovePoolTrackerExpansion (
     IN POOL_TYPE PoolType
     );
 
+#if !defined (NT_UP)
+VOID
+ExpCountRemotePoolAllocation (
+    IN ULONG Key
+    );
+#endif
+
 LOGICAL
 ExpAddTagForBigPages (
     IN PVOID Va,
@@ -368,6 +406,31 @@ GENERAL_LOOKASIDE ExpSmallNPagedPoolLookasideLists[POOL_SMALL_LISTS];
 
 GENERAL_LOOKASIDE ExpSmallPagedPoolLookasideLists[POOL_SMALL_LISTS];
 
+#if !defined (NT_UP)
+
+//
+// Define the per processor pool magazine caches, the per node magazine
+// depots and the list of empty magazines shared by all processors.
+//
+
+PPOOL_MAGAZINE_CACHE ExpPoolMagazineCaches[MAXIMUM_PROCESSOR_TAG_TABLES];
+
+PPOOL_MAGAZINE_DEPOT ExpPoolMagazineDepot;
+
+SLIST_HEADER ExpPoolEmptyMagazines;
+
+LONG ExpPoolMagazinePages;
+
+LONG ExpPoolMagazinePageLimit;
+
+#define POOL_MAGAZINE_PAGES_PER_PROCESSOR 8
+
+C_ASSERT ((sizeof(POOL_MAGAZINE) & (MEMORY_ALLOCATION_ALIGNMENT - 1)) == 0);
+
+C_ASSERT (POOL_MAGAZINE_LISTS < POOL_LIST_HEADS);
+
+#endif
+
 
 
 #define LOCK_POOL(PoolDesc, LockHandle) {                                   \
@@ -876,19 +939,876 @@ Routine Description:
 
     This procedure enables the specified pool flag(s).
 
-Arguments:
+Arguments:
+
+    PoolFlag - Supplies the pool flag(s) to enable.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    RtlInterlockedSetBits (&ExpPoolFlags, PoolFlag);
+}
+
+#if !defined (NT_UP)
+
+PPOOL_MAGAZINE_CACHE
+ExpCreatePoolMagazineCache (
+    IN ULONG ProcessorNumber,
+    IN ULONG NodeNumber
+    )
+
+/*++
+
+Routine Description:
+
+    This function allocates and initializes a pool magazine cache for a
+    processor on the specified node.
+
+Arguments:
+
+    ProcessorNumber - Supplies the number of the processor which owns the
+                      cache.
+
+    NodeNumber - Supplies the node number of the processor.
+
+Return Value:
+
+    A pointer to the new magazine cache, NULL if one could not be allocated.
+
+Environment:
+
+    Kernel mode, PASSIVE_LEVEL.
+
+--*/
+
+{
+    PPOOL_MAGAZINE_CACHE Cache;
+
+    PAGED_CODE ();
+
+    if ((ExpPoolFlags & EX_POOL_MAGAZINES) == 0) {
+        return NULL;
+    }
+
+    Cache = MmAllocateIndependentPages (sizeof(POOL_MAGAZINE_CACHE),
+                                        NodeNumber);
+
+    if (Cache != NULL) {
+
+        RtlZeroMemory (Cache, sizeof(POOL_MAGAZINE_CACHE));
+
+        Cache->NodeNumber = NodeNumber;
+
+        //
+        // The loaded and previous magazines may only be manipulated by
+        // the owning processor, so flushes are targeted at it.
+        //
+
+        KeInitializeDpc (&Cache->FlushDpc, ExpPoolMagazineFlushDpc, Cache);
+        KeSetTargetProcessorDpc (&Cache->FlushDpc, (CCHAR) ProcessorNumber);
+
+        InterlockedExchangeAdd (&ExpPoolMagazinePageLimit,
+                                POOL_MAGAZINE_PAGES_PER_PROCESSOR);
+    }
+
+    return Cache;
+}
+
+LOGICAL
+ExpAllocatePoolMagazines (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This function carves a nonpaged pool page into empty magazines and
+    inserts them in the empty magazine list.
+
+    The page is obtained directly from memory management so this never
+    recurses into the small block allocator.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    TRUE if empty magazines were added, FALSE if not.
+
+Environment:
+
+    Kernel mode, DISPATCH_LEVEL or below.
+
+--*/
+
+{
+    ULONG i;
+    PPOOL_MAGAZINE Magazine;
+
+    if (InterlockedIncrement (&ExpPoolMagazinePages) > ExpPoolMagazinePageLimit) {
+        InterlockedDecrement (&ExpPoolMagazinePages);
+        return FALSE;
+    }
+
+    Magazine = (PPOOL_MAGAZINE) MiAllocatePoolPages (NonPagedPool, PAGE_SIZE);
+
+    if (Magazine == NULL) {
+        InterlockedDecrement (&ExpPoolMagazinePages);
+        return FALSE;
+    }
+
+    ExpInsertPoolTracker ('gaMP', PAGE_SIZE, NonPagedPool);
+
+    for (i = 0; i < PAGE_SIZE / sizeof(POOL_MAGAZINE); i += 1) {
+        Magazine->Rounds = 0;
+        InterlockedPushEntrySList (&ExpPoolEmptyMagazines,
+                                   &Magazine->ListEntry);
+        Magazine += 1;
+    }
+
+    return TRUE;
+}
+
+FORCEINLINE
+PPOOL_HEADER
+ExpAllocateFromPoolMagazine (
+    IN POOL_TYPE CheckType,
+    IN ULONG BlockSize
+    )
+
+/*++
+
+Routine Description:
+
+    This function attempts to allocate a free pool block of the specified
+    size from the current processor's magazine cache, exchanging an empty
+    magazine for a full one from the node depot if necessary.
+
+    The returned block is still marked free and untracked.  Note the block
+    itself is never touched here since paged pool blocks may not be
+    referenced at DISPATCH_LEVEL.
+
+Arguments:
+
+    CheckType - Supplies the base pool type.
+
+    BlockSize - Supplies the block size in pool block units.
+
+Return Value:
+
+    A pointer to the pool header of the block, NULL if the magazines and the
+    depot are empty.
+
+Environment:
+
+    Kernel mode, IRQL appropriate for the pool type.
+
+--*/
+
+{
+    KIRQL OldIrql;
+    ULONG Depth;
+    PPOOL_HEADER Entry;
+    PPOOL_MAGAZINE Magazine;
+    PPOOL_MAGAZINE_CACHE Cache;
+    PPOOL_MAGAZINE_CLASS Class;
+    PPOOL_MAGAZINE_DEPOT Depot;
+    PSLIST_HEADER ListHead;
+
+    ASSERT ((BlockSize != 0) && (BlockSize <= POOL_MAGAZINE_LISTS));
+
+    KeRaiseIrql (DISPATCH_LEVEL, &OldIrql);
+
+    Cache = ExpPoolMagazineCaches[KeGetCurrentProcessorNumber ()];
+
+    if (Cache == NULL) {
+        KeLowerIrql (OldIrql);
+        return NULL;
+    }
+
+    Cache->Allocates += 1;
+
+    Class = &Cache->Class[CheckType][BlockSize - 1];
+
+    Magazine = Class->Loaded;
+
+    if ((Magazine == NULL) || (Magazine->Rounds == 0)) {
+
+        Magazine = Class->Previous;
+
+        if ((Magazine != NULL) && (Magazine->Rounds != 0)) {
+
+            //
+            // The previous magazine still has rounds, swap it in.
+            //
+
+            Class->Previous = Class->Loaded;
+            Class->Loaded = Magazine;
+        }
+        else {
+
+            //
+            // Both magazines are empty.  Exchange the previous (empty)
+            // magazine for a full one from the depot.
+            //
+
+            Depot = &ExpPoolMagazineDepot[Cache->NodeNumber];
+            ListHead = &Depot->FullMagazines[CheckType][BlockSize - 1];
+
+            Magazine = (PPOOL_MAGAZINE) InterlockedPopEntrySList (ListHead);
+
+            if (Magazine == NULL) {
+                KeLowerIrql (OldIrql);
+                return NULL;
+            }
+
+            //
+            // Track the depot low water mark so the periodic trim knows
+            // how many full magazines sat unused during the last interval.
+            // This is not interlocked as it is only a hint.
+            //
+
+            Depth = ExQueryDepthSList (ListHead);
+
+            if (Depth < Depot->MinimumDepth[CheckType][BlockSize - 1]) {
+                Depot->MinimumDepth[CheckType][BlockSize - 1] = (USHORT) Depth;
+            }
+
+            Cache->DepotAllocates += 1;
+
+            if (Class->Previous != NULL) {
+                ASSERT (Class->Previous->Rounds == 0);
+                InterlockedPushEntrySList (&ExpPoolEmptyMagazines,
+                                           &Class->Previous->ListEntry);
+            }
+
+            Class->Previous = Class->Loaded;
+            Class->Loaded = Magazine;
+        }
+    }
+
+    ASSERT (Magazine->Rounds != 0);
+
+    Magazine->Rounds -= 1;
+    Entry = Magazine->Round[Magazine->Rounds];
+
+    Cache->AllocateHits += 1;
+
+    KeLowerIrql (OldIrql);
+
+    return Entry;
+}
+
+FORCEINLINE
+LOGICAL
+ExpFreeToPoolMagazine (
+    IN PPOOL_DESCRIPTOR PoolDesc,
+    IN PPOOL_HEADER Entry,
+    IN ULONG BlockSize
+    )
+
+/*++
+
+Routine Description:
+
+    This function attempts to free a pool block to the current processor's
+    magazine cache, exchanging a full magazine for an empty one with the
+    node depot if necessary.
+
+    Only blocks which belong to a pool local to the current processor's node
+    are cached so that the depots never hand out remote memory.
+
+Arguments:
+
+    PoolDesc - Supplies the pool descriptor which owns the block.
+
+    Entry - Supplies the pool header of the block, already marked free and
+            debited from the tag tracker.
+
+    BlockSize - Supplies the block size in pool block units.
+
+Return Value:
+
+    TRUE if the block was cached, FALSE if it must be freed to the pool
+    descriptor.
+
+Environment:
+
+    Kernel mode, IRQL appropriate for the pool type.
+
+--*/
+
+{
+    KIRQL OldIrql;
+    ULONG PoolIndex;
+    POOL_TYPE CheckType;
+    PPOOL_MAGAZINE Magazine;
+    PPOOL_MAGAZINE_CACHE Cache;
+    PPOOL_MAGAZINE_CLASS Class;
+
+    ASSERT ((BlockSize != 0) && (BlockSize <= POOL_MAGAZINE_LISTS));
+
+    CheckType = PoolDesc->PoolType & BASE_POOL_TYPE_MASK;
+    PoolIndex = PoolDesc->PoolIndex;
+
+    if (CheckType == PagedPool) {
+
+        //
+        // Prototype pool is never cached for the same reason it is never
+        // put on the lookaside lists.
+        //
+
+        if (PoolIndex == 0) {
+            return FALSE;
+        }
+
+        PoolIndex -= 1;
+    }
+
+    KeRaiseIrql (DISPATCH_LEVEL, &OldIrql);
+
+    Cache = ExpPoolMagazineCaches[KeGetCurrentProcessorNumber ()];
+
+    if ((Cache == NULL) ||
+        ((KeNumberNodes > 1) && (Cache->NodeNumber != PoolIndex))) {
+
+        KeLowerIrql (OldIrql);
+        return FALSE;
+    }
+
+    Cache->Frees += 1;
+
+    Class = &Cache->Class[CheckType][BlockSize - 1];
+
+    Magazine = Class->Loaded;
+
+    if ((Magazine == NULL) ||
+        (Magazine->Rounds == POOL_MAGAZINE_CAPACITY (BlockSize))) {
+
+        Magazine = Class->Previous;
+
+        if ((Magazine != NULL) &&
+            (Magazine->Rounds < POOL_MAGAZINE_CAPACITY (BlockSize))) {
+
+            //
+            // The previous magazine has room, swap it in.
+            //
+
+            Class->Previous = Class->Loaded;
+            Class->Loaded = Magazine;
+        }
+        else {
+
+            //
+            // Both magazines are full (or absent).  Exchange the previous
+            // (full) magazine for an empty one, growing the empty list
+            // if it is exhausted.
+            //
+
+            Magazine = (PPOOL_MAGAZINE) InterlockedPopEntrySList (&ExpPoolEmptyMagazines);
+
+            if (Magazine == NULL) {
+
+                if (ExpAllocatePoolMagazines () == TRUE) {
+                    Magazine = (PPOOL_MAGAZINE) InterlockedPopEntrySList (&ExpPoolEmptyMagazines);
+                }
+
+                if (Magazine == NULL) {
+                    KeLowerIrql (OldIrql);
+                    return FALSE;
+                }
+            }
+
+            ASSERT (Magazine->Rounds == 0);
+
+            if (Class->Previous != NULL) {
+                InterlockedPushEntrySList (
+                    &ExpPoolMagazineDepot[Cache->NodeNumber].FullMagazines[CheckType][BlockSize - 1],
+                    &Class->Previous->ListEntry);
+
+                Cache->DepotFrees += 1;
+            }
+
+            Class->Previous = Class->Loaded;
+            Class->Loaded = Magazine;
+        }
+    }
+
+    Magazine->Round[Magazine->Rounds] = Entry;
+    Magazine->Rounds += 1;
+
+    Cache->FreeHits += 1;
+
+    KeLowerIrql (OldIrql);
+
+    return TRUE;
+}
+
+ULONG
+ExpFlushPoolMagazineDepot (
+    IN POOL_TYPE PoolType,
+    IN LOGICAL TrimOnly
+    )
+
+/*++
+
+Routine Description:
+
+    This function returns the blocks held in full depot magazines back to
+    their pool descriptors.  The blocks are queued as pending frees on the
+    owning descriptor and then released with a single lock acquisition per
+    descriptor.
+
+    When trimming, only the magazines which were not needed during the last
+    interval (the depot low water mark) are flushed.  Otherwise every full
+    magazine is flushed.
+
+Arguments:
+
+    PoolType - Supplies the base pool type to flush.
+
+    TrimOnly - Supplies TRUE to flush only the unused working set of the
+               depot, FALSE to flush the whole depot.
+
+Return Value:
+
+    The number of blocks returned to the pool descriptors.
+
+Environment:
+
+    Kernel mode, APC_LEVEL or below for paged pool, DISPATCH_LEVEL or below
+    for nonpaged pool.
+
+--*/
+
+{
+    ULONG i;
+    ULONG Node;
+    ULONG Index;
+    ULONG Count;
+    ULONG Flushed;
+    POOL_TYPE CheckType;
+    PVOID OldValue;
+    PPOOL_HEADER Entry;
+    PPOOL_DESCRIPTOR PoolDesc;
+    PPOOL_MAGAZINE Magazine;
+    PPOOL_MAGAZINE_DEPOT Depot;
+    PSLIST_HEADER ListHead;
+
+    CheckType = PoolType & BASE_POOL_TYPE_MASK;
+
+    if ((ExpPoolFlags & EX_POOL_MAGAZINES) == 0) {
+        return 0;
+    }
+
+    Flushed = 0;
+
+    for (Node = 0; Node < KeNumberNodes; Node += 1) {
+
+        Depot = &ExpPoolMagazineDepot[Node];
+
+        for (Index = 0; Index < POOL_MAGAZINE_LISTS; Index += 1) {
+
+            ListHead = &Depot->FullMagazines[CheckType][Index];
+
+            Count = ExQueryDepthSList (ListHead);
+
+            if ((TrimOnly == TRUE) &&
+                (Count > Depot->MinimumDepth[CheckType][Index])) {
+
+                Count = Depot->MinimumDepth[CheckType][Index];
+            }
+
+            while (Count != 0) {
+
+                Count -= 1;
+
+                Magazine = (PPOOL_MAGAZINE) InterlockedPopEntrySList (ListHead);
+
+                if (Magazine == NULL) {
+                    break;
+                }
+
+                for (i = 0; i < Magazine->Rounds; i += 1) {
+
+                    Entry = Magazine->Round[i];
+
+                    ASSERT (Entry->BlockSize == Index + 1);
+                    ASSERT (IS_POOL_HEADER_MARKED_ALLOCATED (Entry) == 0);
+
+                    if (CheckType == PagedPool) {
+                        PoolDesc = ExpPagedPoolDescriptor[DECODE_POOL_INDEX(Entry)];
+                    }
+                    else if (ExpNumberOfNonPagedPools > 1) {
+                        PoolDesc = ExpNonPagedPoolDescriptor[DECODE_POOL_INDEX(Entry)];
+                    }
+                    else {
+                        PoolDesc = &NonPagedPoolDescriptor;
+                    }
+
+                    //
+                    // Queue the block as a pending free on its descriptor.
+                    //
+
+                    do {
+
+                        OldValue = ReadForWriteAccess (&PoolDesc->PendingFrees);
+                        ((PSINGLE_LIST_ENTRY)(Entry + 1))->Next = OldValue;
+
+                    } while (InterlockedCompareExchangePointer (
+                                    &PoolDesc->PendingFrees,
+                                    (PVOID)(Entry + 1),
+                                    OldValue) != OldValue);
+
+                    InterlockedIncrement (&PoolDesc->PendingFreeDepth);
+                }
+
+                Flushed += Magazine->Rounds;
+
+                Magazine->Rounds = 0;
+                InterlockedPushEntrySList (&ExpPoolEmptyMagazines,
+                                           &Magazine->ListEntry);
+            }
+
+            Depot->MinimumDepth[CheckType][Index] =
+                ExQueryDepthSList (ListHead);
+        }
+    }
+
+    if (Flushed != 0) {
+
+        if (CheckType == PagedPool) {
+            for (i = 1; i <= ExpNumberOfPagedPools; i += 1) {
+                ExDeferredFreePool (ExpPagedPoolDescriptor[i]);
+            }
+        }
+        else if (ExpNumberOfNonPagedPools > 1) {
+            for (i = 0; i < ExpNumberOfNonPagedPools; i += 1) {
+                ExDeferredFreePool (ExpNonPagedPoolDescriptor[i]);
+            }
+        }
+        else {
+            ExDeferredFreePool (&NonPagedPoolDescriptor);
+        }
+    }
+
+    return Flushed;
+}
+
+VOID
+ExpFlushPoolMagazineCache (
+    IN PPOOL_MAGAZINE_CACHE Cache
+    )
+
+/*++
+
+Routine Description:
+
+    This function returns the loaded and previous magazines of the
+    specified processor magazine cache to the node depot (magazines which
+    still hold blocks) or to the empty magazine list.
+
+Arguments:
+
+    Cache - Supplies the magazine cache of the current processor.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, DISPATCH_LEVEL on the processor which owns the cache.
+
+--*/
+
+{
+    ULONG Index;
+    ULONG PoolIndex;
+    PPOOL_MAGAZINE Magazine;
+    PPOOL_MAGAZINE_CLASS Class;
+    PPOOL_MAGAZINE_DEPOT Depot;
+
+    ASSERT (KeGetCurrentIrql () == DISPATCH_LEVEL);
+    ASSERT (Cache == ExpPoolMagazineCaches[KeGetCurrentProcessorNumber ()]);
+
+    Depot = &ExpPoolMagazineDepot[Cache->NodeNumber];
+
+    Cache->Flushes += 1;
+
+    for (PoolIndex = 0; PoolIndex < NUMBER_OF_POOLS; PoolIndex += 1) {
+
+        for (Index = 0; Index < POOL_MAGAZINE_LISTS; Index += 1) {
+
+            Class = &Cache->Class[PoolIndex][Index];
+
+            do {
+
+                Magazine = Class->Loaded;
+                Class->Loaded = Class->Previous;
+                Class->Previous = NULL;
+
+                if (Magazine == NULL) {
+                    NOTHING;
+                }
+                else if (Magazine->Rounds != 0) {
+                    InterlockedPushEntrySList (&Depot->FullMagazines[PoolIndex][Index],
+                                               &Magazine->ListEntry);
+
+                    Cache->DepotFrees += 1;
+                }
+                else {
+                    InterlockedPushEntrySList (&ExpPoolEmptyMagazines,
+                                               &Magazine->ListEntry);
+                }
+
+            } while (Class->Loaded != NULL);
+        }
+    }
+
+    return;
+}
+
+VOID
+ExpPoolMagazineFlushDpc (
+    IN PKDPC Dpc,
+    IN PVOID DeferredContext,
+    IN PVOID SystemArgument1,
+    IN PVOID SystemArgument2
+    )
+
+/*++
+
+Routine Description:
+
+    This deferred routine executes on the processor which owns a pool
+    magazine cache and returns its magazines to the depot.
+
+Arguments:
+
+    Dpc - Supplies a pointer to the flush DPC in the magazine cache.
+
+    DeferredContext - Supplies the magazine cache.
+
+    SystemArgument1 - Not used.
+
+    SystemArgument2 - Not used.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, DISPATCH_LEVEL.
+
+--*/
+
+{
+    UNREFERENCED_PARAMETER (Dpc);
+    UNREFERENCED_PARAMETER (SystemArgument1);
+    UNREFERENCED_PARAMETER (SystemArgument2);
+
+    ExpFlushPoolMagazineCache ((PPOOL_MAGAZINE_CACHE) DeferredContext);
+
+    return;
+}
+
+ULONG
+ExpFlushPoolMagazines (
+    IN POOL_TYPE PoolType
+    )
+
+/*++
+
+Routine Description:
+
+    This function is called when a pool expansion fails.  It returns the
+    magazines of every processor to the depots, then flushes the depots
+    and the empty magazine pages back to the pools.
+
+    The current processor's magazines are flushed synchronously.  The
+    magazines of the other processors are flushed by a DPC targeted at
+    each of them, so their blocks reach the depot shortly afterwards and
+    are returned by the next flush or depot trim.
+
+Arguments:
+
+    PoolType - Supplies the base pool type whose expansion failed.
+
+Return Value:
+
+    The number of blocks returned to the pool descriptors.
+
+Environment:
+
+    Kernel mode, APC_LEVEL or below for paged pool, DISPATCH_LEVEL or below
+    for nonpaged pool.
+
+--*/
+
+{
+    ULONG i;
+    ULONG Flushed;
+    KIRQL OldIrql;
+    PPOOL_MAGAZINE_CACHE Cache;
+
+    if ((ExpPoolFlags & EX_POOL_MAGAZINES) == 0) {
+        return 0;
+    }
+
+    KeRaiseIrql (DISPATCH_LEVEL, &OldIrql);
+
+    for (i = 0; i < (ULONG) KeNumberProcessors; i += 1) {
+
+        Cache = ExpPoolMagazineCaches[i];
+
+        if (Cache == NULL) {
+            continue;
+        }
+
+        if (i == KeGetCurrentProcessorNumber ()) {
+            ExpFlushPoolMagazineCache (Cache);
+        }
+        else if (KeActiveProcessors & AFFINITY_MASK (i)) {
+            KeInsertQueueDpc (&Cache->FlushDpc, NULL, NULL);
+        }
+    }
+
+    KeLowerIrql (OldIrql);
+
+    Flushed = ExpFlushPoolMagazineDepot (PoolType, FALSE);
+
+    ExpReleasePoolMagazinePages ();
+
+    return Flushed;
+}
+
+VOID
+ExpReleasePoolMagazinePages (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This function frees the pages backing the pool magazines when every
+    magazine is empty and on the empty magazine list.
+
+    Magazines from different pages are interleaved on the list, so the
+    pages can only be released when all of them are idle.  The whole list
+    is captured and counted - if any magazine is loaded by a processor or
+    held in a depot the list is put back untouched.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, DISPATCH_LEVEL or below.
+
+--*/
+
+{
+    LONG Pages;
+    ULONG Count;
+    PSLIST_ENTRY Entry;
+    PSLIST_ENTRY FirstEntry;
+    PSLIST_ENTRY LastEntry;
+    PSLIST_ENTRY NextEntry;
+    PSLIST_ENTRY PageList;
+
+    Pages = ExpPoolMagazinePages;
+
+    if ((Pages == 0) ||
+        (ExQueryDepthSList (&ExpPoolEmptyMagazines) !=
+            (ULONG) Pages * (PAGE_SIZE / sizeof(POOL_MAGAZINE)))) {
+
+        return;
+    }
+
+    FirstEntry = InterlockedFlushSList (&ExpPoolEmptyMagazines);
+
+    if (FirstEntry == NULL) {
+        return;
+    }
+
+    Count = 0;
+    Entry = FirstEntry;
+
+    do {
+        Count += 1;
+        LastEntry = Entry;
+        Entry = Entry->Next;
+    } while (Entry != NULL);
+
+    //
+    // The page count must be read after the list was captured.  A page
+    // added concurrently is either counted here (and then its magazines
+    // are missing from the captured list) or not counted at all (and then
+    // none of its magazines are in the captured list).
+    //
+
+    Pages = ExpPoolMagazinePages;
+
+    if (Count != (ULONG) Pages * (PAGE_SIZE / sizeof(POOL_MAGAZINE))) {
+        InterlockedPushListSList (&ExpPoolEmptyMagazines,
+                                  FirstEntry,
+                                  LastEntry,
+                                  Count);
+        return;
+    }
+
+    InterlockedExchangeAdd (&ExpPoolMagazinePages, -Pages);
+
+    //
+    // Every magazine of every page is in the captured list.  Pick out the
+    // first magazine of each page, then free the pages once the walk no
+    // longer touches any of the magazines.
+    //
+
+    PageList = NULL;
+    Entry = FirstEntry;
+
+    do {
+        NextEntry = Entry->Next;
+
+        if (PAGE_ALIGN (Entry) == (PVOID) Entry) {
+            Entry->Next = PageList;
+            PageList = Entry;
+        }
+
+        Entry = NextEntry;
+
+    } while (Entry != NULL);
+
+    while (PageList != NULL) {
+
+        NextEntry = PageList->Next;
 
-    PoolFlag - Supplies the pool flag(s) to enable.
+        MiFreePoolPages (PageList);
 
-Return Value:
+        ExpRemovePoolTracker ('gaMP', PAGE_SIZE, NonPagedPool);
 
-    None.
+        PageList = NextEntry;
+    }
 
---*/
-{
-    RtlInterlockedSetBits (&ExpPoolFlags, PoolFlag);
+    return;
 }
 
+#endif
+
 
 VOID
 InitializePool (
@@ -1312,6 +2232,42 @@ Return Value:
             (!NT_SUCCESS (MmIsVerifierEnabled (&i)))) {
 
             ExSetPoolFlags (EX_DELAY_POOL_FREES);
+
+#if !defined (NT_UP)
+
+            //
+            // Enable the per processor pool magazines.  The depots are
+            // allocated here along with the cache for the boot processor,
+            // the caches for the other processors are created as they are
+            // started.
+            //
+
+            NumberOfBytes = KeNumberNodes * sizeof(POOL_MAGAZINE_DEPOT);
+
+            ExpPoolMagazineDepot = ExAllocatePoolWithTag (NonPagedPool,
+                                                          NumberOfBytes,
+                                                          'gaMP');
+
+            if (ExpPoolMagazineDepot != NULL) {
+
+                RtlZeroMemory (ExpPoolMagazineDepot, NumberOfBytes);
+
+                for (Index = 0; Index < KeNumberNodes; Index += 1) {
+                    for (i = 0; i < NUMBER_OF_POOLS * POOL_MAGAZINE_LISTS; i += 1) {
+                        ExInitializeSListHead (&ExpPoolMagazineDepot[Index].FullMagazines[i / POOL_MAGAZINE_LISTS][i % POOL_MAGAZINE_LISTS]);
+                    }
+                }
+
+                ExInitializeSListHead (&ExpPoolEmptyMagazines);
+
+                ExSetPoolFlags (EX_POOL_MAGAZINES);
+
+                ExpPoolMagazineCaches[0] =
+                    ExpCreatePoolMagazineCache (0, KeGetCurrentPrcb ()->ParentNode->Color);
+            }
+
+#endif
+
         }
 
         if ((ExpPoolFlags & EX_SPECIAL_POOL_ENABLED) ||
@@ -1577,6 +2533,95 @@ Environment:
     ExpInsertPoolTrackerExpansion (Key, NumberOfBytes, PoolType);
 }
 
+#if !defined (NT_UP)
+
+VOID
+ExpCountRemotePoolAllocation (
+    IN ULONG Key
+    )
+
+/*++
+
+Routine Description:
+
+    This function charges a nonpaged pool allocation that had to be
+    satisfied with pages from a remote node to the argument pool tag.
+
+Arguments:
+
+    Key - Supplies the key value used to locate a matching entry in the
+          tag table.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, IRQL <= DISPATCH_LEVEL, no pool locks held.  The tag has
+    already been inserted by the caller.
+
+--*/
+
+{
+    ULONG Hash;
+    ULONG Index;
+    KIRQL OldIrql;
+
+    Key &= ~PROTECTED_POOL;
+
+    //
+    // Search the global builtin table.  A key is always entered there
+    // first and occupies the same index in every processor's table, but
+    // a processor's private table only picks the key up lazily.  The
+    // snapshot in ExGetPoolTagInfo sums every table by index, so the
+    // count is charged to the global table.
+    //
+
+    Hash = POOLTAG_HASH (Key, PoolTrackTableMask);
+
+    Index = Hash;
+
+    do {
+
+        if (PoolTrackTable[Hash].Key == Key) {
+            InterlockedIncrement ((PLONG) &PoolTrackTable[Hash].NonPagedRemoteAllocs);
+            return;
+        }
+
+        if (PoolTrackTable[Hash].Key == 0) {
+            break;
+        }
+
+        Hash = (Hash + 1) & (ULONG)PoolTrackTableMask;
+
+    } while (Hash != Index);
+
+    //
+    // The tag spilled into the expansion table.
+    //
+
+    ExAcquireSpinLock (&ExpTaggedPoolLock, &OldIrql);
+
+    for (Hash = 0; Hash < PoolTrackTableExpansionSize; Hash += 1) {
+
+        if (PoolTrackTableExpansion[Hash].Key == Key) {
+            PoolTrackTableExpansion[Hash].NonPagedRemoteAllocs += 1;
+            break;
+        }
+
+        if (PoolTrackTableExpansion[Hash].Key == 0) {
+            break;
+        }
+    }
+
+    ExReleaseSpinLock (&ExpTaggedPoolLock, OldIrql);
+
+    return;
+}
+
+#endif
+
 FORCEINLINE
 VOID
 ExpRemovePoolTrackerInline (
@@ -2021,6 +3066,22 @@ Return Value:
                               ROUND_TO_PAGES(NumberOfBytes),
                               PoolType);
 
+#if !defined (NT_UP)
+
+        //
+        // Charge the tag if the pages came from a remote node.  Nonpaged
+        // session allocations are tracked in the global tables too.
+        //
+
+        if ((CheckType == NonPagedPool) &&
+            (KeNumberNodes > 1) &&
+            (MiIsPoolPageLocal (Entry) == FALSE)) {
+
+            ExpCountRemotePoolAllocation (Tag);
+        }
+
+#endif
+
         PERFINFO_BIGPOOLALLOC (PoolType, Tag, NumberOfBytes, Entry);
 
         return Entry;
@@ -2188,6 +3249,8 @@ Return Value:
             else 
             {
 
+                PoolIndex = 0;
+
                 if (KeNumberNodes > 1) {
 
                     //
@@ -2198,44 +3261,45 @@ Return Value:
                     // have been paged out, on large memory
                     // NUMA machines this should be less common.
                     //
+                    // N.B. This falls through to the pool magazines below
+                    //      so that paged blocks freed into the magazines
+                    //      are also allocated from them on NUMA machines.
+                    //
 
                     Prcb = KeGetCurrentPrcb ();
 
-                    PoolIndex = Prcb->ParentNode->Color;
-
-                    if (PoolIndex < ExpNumberOfPagedPools) {
-                        PoolIndex += 1;
-                        PoolDesc = ExpPagedPoolDescriptor[PoolIndex];
-                        RequestType = PoolType & (BASE_POOL_TYPE_MASK | SESSION_POOL_MASK);
-                        RetryCount = 0;
-                        goto restart2;
+                    if (Prcb->ParentNode->Color < ExpNumberOfPagedPools) {
+                        PoolIndex = Prcb->ParentNode->Color + 1;
                     }
                 }
 
-                PoolIndex = 1;
-                if (ExpNumberOfPagedPools != PoolIndex) 
-                {
-                    ExpPoolIndex += 1;
-                    PoolIndex = ExpPoolIndex;
-                    if (PoolIndex > ExpNumberOfPagedPools) {
-                        PoolIndex = 1;
-                        ExpPoolIndex = 1;
-                    }
-
-                    Index = PoolIndex;
-                    do {
-                        Lock = (PKGUARDED_MUTEX) ExpPagedPoolDescriptor[PoolIndex]->LockAddress;
-
-                        if (KeGetOwnerGuardedMutex (Lock) == NULL) {
-                            break;
-                        }
+                if (PoolIndex == 0) {
 
-                        PoolIndex += 1;
+                    PoolIndex = 1;
+                    if (ExpNumberOfPagedPools != PoolIndex) 
+                    {
+                        ExpPoolIndex += 1;
+                        PoolIndex = ExpPoolIndex;
                         if (PoolIndex > ExpNumberOfPagedPools) {
                             PoolIndex = 1;
+                            ExpPoolIndex = 1;
                         }
 
-                    } while (PoolIndex != Index);
+                        Index = PoolIndex;
+                        do {
+                            Lock = (PKGUARDED_MUTEX) ExpPagedPoolDescriptor[PoolIndex]->LockAddress;
+
+                            if (KeGetOwnerGuardedMutex (Lock) == NULL) {
+                                break;
+                            }
+
+                            PoolIndex += 1;
+                            if (PoolIndex > ExpNumberOfPagedPools) {
+                                PoolIndex = 1;
+                            }
+
+                        } while (PoolIndex != Index);
+                    }
                 }
             }
 
@@ -2377,6 +3441,51 @@ Return Value:
         ASSERT(PoolIndex == PoolDesc->PoolIndex);
     }
 
+#if !defined (NT_UP)
+
+    //
+    // The lookaside lists missed, so try the per processor pool magazines
+    // before acquiring the pool descriptor lock.  Paged session pool has its
+    // own lookasides and prototype pool never gets here.
+    //
+
+    if ((NeededSize <= POOL_MAGAZINE_LISTS) &&
+        (ExpPoolFlags & EX_POOL_MAGAZINES) &&
+        (((PoolType & SESSION_POOL_MASK) == 0) || (CheckType == NonPagedPool))) {
+
+        Entry = ExpAllocateFromPoolMagazine (CheckType, NeededSize);
+
+        if (Entry != NULL) {
+
+            ASSERT (Entry->BlockSize == NeededSize);
+
+            NewPoolType = (PoolType & (BASE_POOL_TYPE_MASK | POOL_QUOTA_MASK | SESSION_POOL_MASK | POOL_VERIFIER_MASK)) + 1;
+            NewPoolType |= POOL_IN_USE_MASK;
+
+            Entry->PoolType = (UCHAR)NewPoolType;
+
+            Entry->PoolTag = Tag;
+
+            ExpInsertPoolTrackerInline (Tag,
+                                        Entry->BlockSize << POOL_BLOCK_SHIFT,
+                                        PoolType);
+
+            //
+            // Zero out any back pointer to our internal structures
+            // to stop someone from corrupting us via an
+            // uninitialized pointer.
+            //
+
+            ((PULONG_PTR)((PCHAR)Entry + CacheOverhead))[0] = 0;
+
+            PERFINFO_POOLALLOC_ADDR((PUCHAR)Entry + CacheOverhead);
+
+            return (PUCHAR)Entry + CacheOverhead;
+        }
+    }
+
+#endif
+
 restart1:
 
     RequestType = PoolType & (BASE_POOL_TYPE_MASK | SESSION_POOL_MASK);
@@ -2570,6 +3679,20 @@ restart2:
             goto restart2;
         }
 
+#if !defined (NT_UP)
+
+        //
+        // If blocks are cached in the magazine depot, return them to their
+        // pools and retry.
+        //
+
+        if ((RetryCount <= 2) &&
+            (ExpFlushPoolMagazines (CheckType) != 0)) {
+            goto restart2;
+        }
+
+#endif
+
         if ((PoolType & MUST_SUCCEED_POOL_TYPE_MASK) != 0) {
 
             //
@@ -2697,6 +3820,23 @@ restart2:
 
     ExpInsertPoolTrackerInline (Tag, NeededSize, PoolType);
 
+#if !defined (NT_UP)
+
+    //
+    // The rest of this page now sits in the local node's descriptor, so
+    // charge the tag that brought a remote page into it.
+    //
+
+    if ((CheckType == NonPagedPool) &&
+        ((PoolType & SESSION_POOL_MASK) == 0) &&
+        (KeNumberNodes > 1) &&
+        (MiIsPoolPageLocal (Entry) == FALSE)) {
+
+        ExpCountRemotePoolAllocation (Tag);
+    }
+
+#endif
+
     PERFINFO_POOLALLOC_ADDR (Block);
 
     return Block;
@@ -4877,6 +6017,25 @@ Return Value:
                 }
             }
         }
+
+#if !defined (NT_UP)
+
+        //
+        // The lookaside lists are full (or the block is too large for them),
+        // try to free the block to the per processor pool magazines.
+        //
+
+        if ((BlockSize <= POOL_MAGAZINE_LISTS) &&
+            (USING_HOT_COLD_METRICS == 0) &&
+            (ExpPoolFlags & EX_POOL_MAGAZINES)) {
+
+            if (ExpFreeToPoolMagazine (PoolDesc, Entry, BlockSize) == TRUE) {
+                return;
+            }
+        }
+
+#endif
+
     }
     else 
     {
@@ -5424,6 +6583,70 @@ ExQueryPoolUsage (
     return;
 }
 
+VOID
+ExQueryPoolMagazineUsage (
+    OUT PSYSTEM_POOL_MAGAZINE_INFORMATION MagazineInformation
+    )
+
+/*++
+
+Routine Description:
+
+    This function sums the pool magazine counters of all processors.
+
+    N.B. The counters are updated by their owning processors without
+         synchronization, so the sums are approximate.
+
+Arguments:
+
+    MagazineInformation - Supplies a pointer to the structure that receives
+                          the summed counters.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+#if !defined (NT_UP)
+    ULONG i;
+    PPOOL_MAGAZINE_CACHE Cache;
+#endif
+
+    PAGED_CODE ();
+
+    RtlZeroMemory (MagazineInformation,
+                   sizeof (SYSTEM_POOL_MAGAZINE_INFORMATION));
+
+#if !defined (NT_UP)
+
+    if ((ExpPoolFlags & EX_POOL_MAGAZINES) == 0) {
+        return;
+    }
+
+    for (i = 0; i < (ULONG) KeNumberProcessors; i += 1) {
+
+        Cache = ExpPoolMagazineCaches[i];
+
+        if (Cache == NULL) {
+            continue;
+        }
+
+        MagazineInformation->Allocates += Cache->Allocates;
+        MagazineInformation->AllocateHits += Cache->AllocateHits;
+        MagazineInformation->Frees += Cache->Frees;
+        MagazineInformation->FreeHits += Cache->FreeHits;
+        MagazineInformation->DepotAllocates += Cache->DepotAllocates;
+        MagazineInformation->DepotFrees += Cache->DepotFrees;
+        MagazineInformation->Flushes += Cache->Flushes;
+    }
+
+#endif
+
+    return;
+}
+
 
 VOID
 ExReturnPoolQuota (
@@ -5549,6 +6772,14 @@ ExCreatePoolTagTable (
                        PoolTrackTableSize * sizeof(POOL_TRACKER_TABLE));
 
         ExPoolTagTables[NewProcessorNumber] = NewTagTable;
+
+        //
+        // Create the pool magazine cache for the new processor.  Failure
+        // is not fatal, the processor just bypasses the magazine layer.
+        //
+
+        ExpPoolMagazineCaches[NewProcessorNumber] =
+            ExpCreatePoolMagazineCache (NewProcessorNumber, NodeNumber);
     }
 
     return (PVOID) NewTagTable;
@@ -5580,6 +6811,7 @@ Return Value:
     KIRQL OldIrql;
     PVOID VirtualAddress;
     SIZE_T NumberOfBytes;
+    PPOOL_MAGAZINE_CACHE Cache;
 
     ASSERT (KeGetCurrentIrql () == PASSIVE_LEVEL);
     ASSERT (NewProcessorNumber < MAXIMUM_PROCESSOR_TAG_TABLES);
@@ -5598,10 +6830,22 @@ Return Value:
 
     ExPoolTagTables[NewProcessorNumber] = NULL;
 
+    Cache = ExpPoolMagazineCaches[NewProcessorNumber];
+
+    ExpPoolMagazineCaches[NewProcessorNumber] = NULL;
+
     KeLowerIrql (OldIrql);
 
     MmFreeIndependentPages (VirtualAddress, NumberOfBytes);
 
+    //
+    // The processor never ran so its magazine cache is still empty.
+    //
+
+    if (Cache != NULL) {
+        MmFreeIndependentPages (Cache, sizeof(POOL_MAGAZINE_CACHE));
+    }
+
     return;
 }
 #endif
@@ -5713,6 +6957,7 @@ Environment:
                     TrackerEntry->PagedAllocs += TargetTrackerEntry->PagedAllocs;
                     TrackerEntry->PagedFrees += TargetTrackerEntry->PagedFrees;
                     TrackerEntry->PagedBytes += TargetTrackerEntry->PagedBytes;
+                    TrackerEntry->NonPagedRemoteAllocs += TargetTrackerEntry->NonPagedRemoteAllocs;
                 }
                 TrackerEntry += 1;
                 TargetTrackerEntry += 1;
@@ -5747,7 +6992,8 @@ NTSTATUS
 ExGetPoolTagInfo (
     IN PVOID SystemInformation,
     IN ULONG SystemInformationLength,
-    IN OUT PULONG ReturnLength OPTIONAL
+    IN OUT PULONG ReturnLength OPTIONAL,
+    IN LOGICAL NodeInformation
     )
 
 /*++
@@ -5766,6 +7012,10 @@ Arguments:
 
     ReturnLength - Receives the actual length of the data returned.
 
+    NodeInformation - Supplies TRUE if SYSTEM_POOLTAG_NODE entries (which
+                      include the remote node allocation counts) should be
+                      returned instead of SYSTEM_POOLTAG entries.
+
 Return Value:
 
     Various NTSTATUS codes.
@@ -5776,9 +7026,11 @@ Return Value:
     SIZE_T NumberOfBytes;
     SIZE_T NumberOfExpansionTableBytes;
     ULONG totalBytes;
+    ULONG EntrySize;
     NTSTATUS status;
     PSYSTEM_POOLTAG_INFORMATION taginfo;
     PSYSTEM_POOLTAG poolTag;
+    PSYSTEM_POOLTAG_NODE poolTagNode;
     PPOOL_TRACKER_TABLE PoolTrackInfo;
     PPOOL_TRACKER_TABLE TrackerEntry;
     PPOOL_TRACKER_TABLE LastTrackerEntry;
@@ -5791,9 +7043,27 @@ Return Value:
     totalBytes = 0;
     status = STATUS_SUCCESS;
 
+    //
+    // The node information format shares the leading Count field and
+    // differs only in the size and layout of each tag entry.
+    //
+
+    C_ASSERT (FIELD_OFFSET(SYSTEM_POOLTAG_INFORMATION, Count) ==
+              FIELD_OFFSET(SYSTEM_POOLTAG_NODE_INFORMATION, Count));
+
     taginfo = (PSYSTEM_POOLTAG_INFORMATION)SystemInformation;
     poolTag = &taginfo->TagInfo[0];
-    totalBytes = FIELD_OFFSET(SYSTEM_POOLTAG_INFORMATION, TagInfo);
+    poolTagNode = &((PSYSTEM_POOLTAG_NODE_INFORMATION)SystemInformation)->TagInfo[0];
+
+    if (NodeInformation == FALSE) {
+        totalBytes = FIELD_OFFSET(SYSTEM_POOLTAG_INFORMATION, TagInfo);
+        EntrySize = sizeof (SYSTEM_POOLTAG);
+    }
+    else {
+        totalBytes = FIELD_OFFSET(SYSTEM_POOLTAG_NODE_INFORMATION, TagInfo);
+        EntrySize = sizeof (SYSTEM_POOLTAG_NODE);
+    }
+
     taginfo->Count = 0;
 
     LocalTrackTableSize = PoolTrackTableSize;
@@ -5831,10 +7101,16 @@ Return Value:
         while (TrackerEntry < LastTrackerEntry) {
             if (TrackerEntry->Key != 0) {
                 taginfo->Count += 1;
-                totalBytes += sizeof (SYSTEM_POOLTAG);
+                totalBytes += EntrySize;
                 if (SystemInformationLength < totalBytes) {
                     status = STATUS_INFO_LENGTH_MISMATCH;
                 }
+                else if (NodeInformation == TRUE) {
+                    poolTagNode->TagUlong = TrackerEntry->Key;
+                    poolTagNode->NonPagedAllocs = TrackerEntry->NonPagedAllocs;
+                    poolTagNode->NonPagedRemoteAllocs = TrackerEntry->NonPagedRemoteAllocs;
+                    poolTagNode += 1;
+                }
                 else {
                     ASSERT (TrackerEntry->PagedAllocs >= TrackerEntry->PagedFrees);
                     ASSERT (TrackerEntry->NonPagedAllocs >= TrackerEntry->NonPagedFrees);
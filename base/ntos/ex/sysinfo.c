@@ -216,7 +216,8 @@ NTSTATUS
 ExpGetLookasideInformation (
     OUT PVOID Buffer,
     IN ULONG BufferLength,
-    OUT PULONG Length
+    OUT PULONG Length,
+    IN LOGICAL Extended
     );
 
 NTSTATUS
@@ -249,7 +250,8 @@ NTSTATUS
 ExGetPoolTagInfo (
     IN PVOID SystemInformation,
     IN ULONG SystemInformationLength,
-    IN OUT PULONG ReturnLength OPTIONAL
+    IN OUT PULONG ReturnLength OPTIONAL,
+    IN LOGICAL NodeInformation
     );
 
 NTSTATUS
@@ -1701,6 +1703,12 @@ Return Value:
     PSYSTEM_QUERY_TIME_ADJUST_INFORMATION TimeAdjustmentInformation;
     PSYSTEM_KERNEL_DEBUGGER_INFORMATION KernelDebuggerInformation;
     PSYSTEM_CONTEXT_SWITCH_INFORMATION ContextSwitchInformation;
+    PSYSTEM_TIMER_EXPIRATION_INFORMATION TimerExpirationInformation;
+    PSYSTEM_DISPATCHER_LOCK_INFORMATION DispatcherLockInformation;
+    PSYSTEM_SCHEDULER_STEAL_INFORMATION StealInformation;
+    PSYSTEM_WORK_QUEUE_DELAY_INFORMATION WorkQueueDelayInformation;
+    PEX_WORK_QUEUE Queue;
+    PSYSTEM_TB_FLUSH_INFORMATION TbFlushInformation;
     PSYSTEM_INTERRUPT_INFORMATION InterruptInformation;
     PSYSTEM_SESSION_PROCESS_INFORMATION SessionProcessInformation;
     PVOID ProcessInformation;
@@ -2575,7 +2583,21 @@ Return Value:
 
             Status = ExGetPoolTagInfo (SystemInformation,
                                        SystemInformationLength,
-                                       ReturnLength);
+                                       ReturnLength,
+                                       FALSE);
+
+            break;
+
+        case SystemPoolTagNodeInformation:
+
+            if (SystemInformationLength < sizeof( SYSTEM_POOLTAG_NODE_INFORMATION )) {
+                return STATUS_INFO_LENGTH_MISMATCH;
+            }
+
+            Status = ExGetPoolTagInfo (SystemInformation,
+                                       SystemInformationLength,
+                                       ReturnLength,
+                                       TRUE);
 
             break;
 
@@ -2749,6 +2771,274 @@ Return Value:
 
             break;
 
+        case SystemTimerExpirationInformation:
+
+            if (SystemInformationLength < sizeof( SYSTEM_TIMER_EXPIRATION_INFORMATION)) {
+                return STATUS_INFO_LENGTH_MISMATCH;
+            }
+
+            TimerExpirationInformation =
+                (PSYSTEM_TIMER_EXPIRATION_INFORMATION)SystemInformation;
+
+            //
+            // Capture the timer expiration counters. The number of timer
+            // induced wakeups per second is the rate of expiration scans.
+            //
+
+            TimerExpirationInformation->ExpirationScans = KeTimerExpirationCounters.ExpirationScans;
+            TimerExpirationInformation->TimersExpired = KeTimerExpirationCounters.TimersExpired;
+            TimerExpirationInformation->TimersCoalesced = KeTimerExpirationCounters.TimersCoalesced;
+
+            if (ARGUMENT_PRESENT( ReturnLength )) {
+                *ReturnLength = sizeof(SYSTEM_TIMER_EXPIRATION_INFORMATION);
+            }
+
+            break;
+
+        case SystemDispatcherLockInformation:
+
+            if (SystemInformationLength < sizeof( SYSTEM_DISPATCHER_LOCK_INFORMATION)) {
+                return STATUS_INFO_LENGTH_MISMATCH;
+            }
+
+            DispatcherLockInformation =
+                (PSYSTEM_DISPATCHER_LOCK_INFORMATION)SystemInformation;
+
+            //
+            // Capture the dispatcher lock counters and histograms.
+            //
+
+            DispatcherLockInformation->Acquisitions = KeDispatcherLockCounters.Acquisitions;
+            DispatcherLockInformation->Contentions = KeDispatcherLockCounters.Contentions;
+            RtlCopyMemory(DispatcherLockInformation->SpinHistogram,
+                          KeDispatcherLockCounters.SpinHistogram,
+                          sizeof(DispatcherLockInformation->SpinHistogram));
+
+            RtlCopyMemory(DispatcherLockInformation->HoldHistogram,
+                          KeDispatcherLockCounters.HoldHistogram,
+                          sizeof(DispatcherLockInformation->HoldHistogram));
+
+            //
+            // Sum the event and semaphore operations that were completed
+            // under an object lock without the dispatcher lock.
+            //
+
+            DispatcherLockInformation->ObjectLockBypasses = 0;
+            for (i = 0; i < OBJECT_LOCK_TABLE_SIZE; i += 1) {
+                DispatcherLockInformation->ObjectLockBypasses +=
+                                            KeObjectLockTable[i].Bypasses;
+            }
+
+            if (ARGUMENT_PRESENT( ReturnLength )) {
+                *ReturnLength = sizeof(SYSTEM_DISPATCHER_LOCK_INFORMATION);
+            }
+
+            break;
+
+        case SystemSchedulerStealInformation:
+
+            if (SystemInformationLength < sizeof( SYSTEM_SCHEDULER_STEAL_INFORMATION)) {
+                return STATUS_INFO_LENGTH_MISMATCH;
+            }
+
+            StealInformation =
+                (PSYSTEM_SCHEDULER_STEAL_INFORMATION)SystemInformation;
+
+            //
+            // Sum the per-processor work stealing counters.
+            //
+
+            StealInformation->LocalHits = 0;
+            StealInformation->SmtSteals = 0;
+            StealInformation->NodeSteals = 0;
+            StealInformation->RemoteNodeSteals = 0;
+
+#if !defined(NT_UP)
+
+            for (i = 0; i < (ULONG)KeNumberProcessors; i += 1) {
+                StealInformation->LocalHits += KiStealCounters[i].LocalHits;
+                StealInformation->SmtSteals += KiStealCounters[i].SmtSteals;
+                StealInformation->NodeSteals += KiStealCounters[i].NodeSteals;
+                StealInformation->RemoteNodeSteals += KiStealCounters[i].RemoteNodeSteals;
+            }
+
+#endif
+
+            if (ARGUMENT_PRESENT( ReturnLength )) {
+                *ReturnLength = sizeof(SYSTEM_SCHEDULER_STEAL_INFORMATION);
+            }
+
+            break;
+
+        case SystemWorkQueueDelayInformation:
+
+            if (SystemInformationLength <
+                KeNumberNodes * MaximumWorkQueue * sizeof( SYSTEM_WORK_QUEUE_DELAY_INFORMATION)) {
+                return STATUS_INFO_LENGTH_MISMATCH;
+            }
+
+            WorkQueueDelayInformation =
+                (PSYSTEM_WORK_QUEUE_DELAY_INFORMATION)SystemInformation;
+
+            //
+            // Copy the delay statistics of each system work queue of each
+            // node.  A node without work queues of its own returns zeroes.
+            //
+
+            for (i = 0; i < (ULONG)(KeNumberNodes * MaximumWorkQueue); i += 1) {
+                if (ExpNodeWorkerQueue[i / MaximumWorkQueue] == NULL) {
+                    RtlZeroMemory(WorkQueueDelayInformation,
+                                  sizeof(SYSTEM_WORK_QUEUE_DELAY_INFORMATION));
+
+                } else {
+                    Queue = &ExpNodeWorkerQueue[i / MaximumWorkQueue][i % MaximumWorkQueue];
+                    WorkQueueDelayInformation->WorkItemsProcessed =
+                        Queue->WorkItemsProcessed;
+                    WorkQueueDelayInformation->DynamicThreadCount =
+                        Queue->DynamicThreadCount;
+                    WorkQueueDelayInformation->DelayThreadsCreated =
+                        Queue->DelayThreadsCreated;
+
+                    RtlCopyMemory(WorkQueueDelayInformation->DelayHistogram,
+                                  Queue->DelayHistogram,
+                                  sizeof(WorkQueueDelayInformation->DelayHistogram));
+                }
+
+                WorkQueueDelayInformation += 1;
+            }
+
+            if (ARGUMENT_PRESENT( ReturnLength )) {
+                *ReturnLength =
+                    KeNumberNodes * MaximumWorkQueue * sizeof(SYSTEM_WORK_QUEUE_DELAY_INFORMATION);
+            }
+
+            break;
+
+        case SystemTbFlushInformation:
+
+            if (SystemInformationLength < sizeof( SYSTEM_TB_FLUSH_INFORMATION)) {
+                return STATUS_INFO_LENGTH_MISMATCH;
+            }
+
+            TbFlushInformation =
+                (PSYSTEM_TB_FLUSH_INFORMATION)SystemInformation;
+
+            //
+            // Sum the per-processor TB flush counters.
+            //
+
+            TbFlushInformation->EntireFlushes = 0;
+            TbFlushInformation->ProcessFlushes = 0;
+            TbFlushInformation->MultipleFlushes = 0;
+            TbFlushInformation->MultipleFlushEntries = 0;
+            TbFlushInformation->SingleFlushes = 0;
+            TbFlushInformation->IpiRequests = 0;
+
+#if !defined(NT_UP)
+
+            for (i = 0; i < (ULONG)KeNumberProcessors; i += 1) {
+                TbFlushInformation->EntireFlushes += KiTbFlushCounters[i].EntireFlushes;
+                TbFlushInformation->ProcessFlushes += KiTbFlushCounters[i].ProcessFlushes;
+                TbFlushInformation->MultipleFlushes += KiTbFlushCounters[i].MultipleFlushes;
+                TbFlushInformation->MultipleFlushEntries += KiTbFlushCounters[i].MultipleFlushEntries;
+                TbFlushInformation->SingleFlushes += KiTbFlushCounters[i].SingleFlushes;
+                TbFlushInformation->IpiRequests += KiTbFlushCounters[i].IpiRequests;
+            }
+
+#endif
+
+            if (ARGUMENT_PRESENT( ReturnLength )) {
+                *ReturnLength = sizeof(SYSTEM_TB_FLUSH_INFORMATION);
+            }
+
+            break;
+
+        case SystemZeroPageInformation:
+
+            Status = MmGetZeroPageInformation( SystemInformation,
+                                               SystemInformationLength,
+                                               &Length
+                                              );
+
+            if (ARGUMENT_PRESENT( ReturnLength )) {
+                *ReturnLength = Length;
+            }
+            break;
+
+        case SystemStandbyListInformation:
+
+            Status = MmGetStandbyListInformation( SystemInformation,
+                                                  SystemInformationLength,
+                                                  &Length
+                                                 );
+
+            if (ARGUMENT_PRESENT( ReturnLength )) {
+                *ReturnLength = Length;
+            }
+            break;
+
+        case SystemPageFileWriteInformation:
+
+            Status = MmGetPageFileWriteInformation( SystemInformation,
+                                                    SystemInformationLength,
+                                                    &Length
+                                                   );
+
+            if (ARGUMENT_PRESENT( ReturnLength )) {
+                *ReturnLength = Length;
+            }
+            break;
+
+        case SystemPageFileReadInformation:
+
+            Status = MmGetPageFileReadInformation( SystemInformation,
+                                                   SystemInformationLength,
+                                                   &Length
+                                                  );
+
+            if (ARGUMENT_PRESENT( ReturnLength )) {
+                *ReturnLength = Length;
+            }
+            break;
+
+        case SystemWorkingSetTrimInformation:
+
+            Status = MmGetWorkingSetTrimInformation( SystemInformation,
+                                                     SystemInformationLength,
+                                                     &Length
+                                                    );
+
+            if (ARGUMENT_PRESENT( ReturnLength )) {
+                *ReturnLength = Length;
+            }
+            break;
+
+        case SystemMemoryCompactionInformation:
+
+            Status = MmGetMemoryCompactionInformation( SystemInformation,
+                                                       SystemInformationLength,
+                                                       &Length
+                                                      );
+
+            if (ARGUMENT_PRESENT( ReturnLength )) {
+                *ReturnLength = Length;
+            }
+            break;
+
+        case SystemPoolMagazineInformation:
+
+            if (SystemInformationLength < sizeof( SYSTEM_POOL_MAGAZINE_INFORMATION)) {
+                return STATUS_INFO_LENGTH_MISMATCH;
+            }
+
+            ExQueryPoolMagazineUsage( (PSYSTEM_POOL_MAGAZINE_INFORMATION)SystemInformation );
+
+            if (ARGUMENT_PRESENT( ReturnLength )) {
+                *ReturnLength = sizeof(SYSTEM_POOL_MAGAZINE_INFORMATION);
+            }
+
+            break;
+
         case SystemRegistryQuotaInformation:
 
             if (SystemInformationLength < sizeof( SYSTEM_REGISTRY_QUOTA_INFORMATION)) {
@@ -2830,7 +3120,25 @@ Return Value:
         case SystemLookasideInformation:
             Status = ExpGetLookasideInformation(SystemInformation,
                                                 SystemInformationLength,
-                                                &Length);
+                                                &Length,
+                                                FALSE);
+
+            if (ARGUMENT_PRESENT(ReturnLength)) {
+                *ReturnLength = Length;
+            }
+
+            break;
+
+            //
+            // Query pool lookaside list and general lookaside list
+            // information including the depth controller state.
+            //
+
+        case SystemLookasideInformationEx:
+            Status = ExpGetLookasideInformation(SystemInformation,
+                                                SystemInformationLength,
+                                                &Length,
+                                                TRUE);
 
             if (ARGUMENT_PRESENT(ReturnLength)) {
                 *ReturnLength = Length;
@@ -5426,11 +5734,54 @@ Return Value:
     return Status;
 }
 
+FORCEINLINE
+VOID
+ExpCopyLookasideState (
+    OUT PSYSTEM_LOOKASIDE_INFORMATION Information,
+    IN PGENERAL_LOOKASIDE Lookaside
+    )
+
+/*++
+
+Routine Description:
+
+    This function copies the depth controller state of a lookaside list to
+    an extended lookaside information entry.
+
+Arguments:
+
+    Information - Supplies a pointer to the base of an extended lookaside
+        information entry.
+
+    Lookaside - Supplies a pointer to a lookaside list descriptor.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PSYSTEM_LOOKASIDE_INFORMATION_EX InformationEx;
+
+    InformationEx = CONTAINING_RECORD(Information,
+                                      SYSTEM_LOOKASIDE_INFORMATION_EX,
+                                      Information);
+
+    InformationEx->MissRatio = LOOKASIDE_MISS_RATIO(Lookaside);
+    InformationEx->Decision = LOOKASIDE_DECISION(Lookaside);
+    InformationEx->Spare = 0;
+    InformationEx->MissRate = LOOKASIDE_MISS_RATE(Lookaside);
+    return;
+}
+
 NTSTATUS
 ExpGetLookasideInformation (
     OUT PVOID Buffer,
     IN ULONG BufferLength,
-    OUT PULONG Length
+    OUT PULONG Length,
+    IN LOGICAL Extended
     )
 
 /*++
@@ -5450,6 +5801,9 @@ Arguments:
     Length - Supplies a pointer to a variable that receives the length of
         lookaside information returned.
 
+    Extended - Supplies TRUE if SYSTEM_LOOKASIDE_INFORMATION_EX entries,
+        which include the depth controller state, should be returned.
+
 Environment:
 
     Kernel mode.
@@ -5472,6 +5826,7 @@ Return Value:
 
     PVOID BufferLock;
     PLIST_ENTRY Entry;
+    ULONG EntrySize;
     KIRQL OldIrql;
     ULONG Limit;
     PSYSTEM_LOOKASIDE_INFORMATION Lookaside;
@@ -5488,7 +5843,14 @@ Return Value:
     // success.
     //
 
-    Limit = BufferLength / sizeof(SYSTEM_LOOKASIDE_INFORMATION);
+    if (Extended == FALSE) {
+        EntrySize = sizeof(SYSTEM_LOOKASIDE_INFORMATION);
+
+    } else {
+        EntrySize = sizeof(SYSTEM_LOOKASIDE_INFORMATION_EX);
+    }
+
+    Limit = BufferLength / EntrySize;
     Number = 0;
     Status = STATUS_SUCCESS;
 
@@ -5532,13 +5894,17 @@ Return Value:
                 Lookaside->Type = PoolLookaside->Type;
                 Lookaside->Tag = PoolLookaside->Tag;
                 Lookaside->Size = PoolLookaside->Size;
+                if (Extended != FALSE) {
+                    ExpCopyLookasideState(Lookaside, PoolLookaside);
+                }
+
                 Number += 1;
                 if (Number == Limit) {
                     goto Finish2;
                 }
 
                 Entry = Entry->Flink;
-                Lookaside += 1;
+                Lookaside = (PSYSTEM_LOOKASIDE_INFORMATION)((PCHAR)Lookaside + EntrySize);
             }
 
             //
@@ -5561,13 +5927,17 @@ Return Value:
                 Lookaside->Type = SystemLookaside->Type;
                 Lookaside->Tag = SystemLookaside->Tag;
                 Lookaside->Size = SystemLookaside->Size;
+                if (Extended != FALSE) {
+                    ExpCopyLookasideState(Lookaside, SystemLookaside);
+                }
+
                 Number += 1;
                 if (Number == Limit) {
                     goto Finish2;
                 }
 
                 Entry = Entry->Flink;
-                Lookaside += 1;
+                Lookaside = (PSYSTEM_LOOKASIDE_INFORMATION)((PCHAR)Lookaside + EntrySize);
             }
 
             //
@@ -5591,13 +5961,17 @@ Return Value:
                 Lookaside->Type = 0;
                 Lookaside->Tag = NPagedLookaside->L.Tag;
                 Lookaside->Size = NPagedLookaside->L.Size;
+                if (Extended != FALSE) {
+                    ExpCopyLookasideState(Lookaside, &NPagedLookaside->L);
+                }
+
                 Number += 1;
                 if (Number == Limit) {
                     goto Finish1;
                 }
 
                 Entry = Entry->Flink;
-                Lookaside += 1;
+                Lookaside = (PSYSTEM_LOOKASIDE_INFORMATION)((PCHAR)Lookaside + EntrySize);
             }
 
             ExReleaseSpinLock(SpinLock, OldIrql);
@@ -5623,13 +5997,17 @@ Return Value:
                 Lookaside->Type = 1;
                 Lookaside->Tag = PagedLookaside->L.Tag;
                 Lookaside->Size = PagedLookaside->L.Size;
+                if (Extended != FALSE) {
+                    ExpCopyLookasideState(Lookaside, &PagedLookaside->L);
+                }
+
                 Number += 1;
                 if (Number == Limit) {
                     goto Finish1;
                 }
 
                 Entry = Entry->Flink;
-                Lookaside += 1;
+                Lookaside = (PSYSTEM_LOOKASIDE_INFORMATION)((PCHAR)Lookaside + EntrySize);
             }
 
 Finish1:
@@ -5644,7 +6022,7 @@ Finish2:
         }
     }
 
-    *Length = Number * sizeof(SYSTEM_LOOKASIDE_INFORMATION);
+    *Length = Number * EntrySize;
     return Status;
 }
 
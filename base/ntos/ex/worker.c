@@ -43,6 +43,7 @@ C_ASSERT(MaximumBalanceObject <= THREAD_WAIT_OBJECTS);
 typedef struct {
     WORK_QUEUE_ITEM WorkItem;
     WORK_QUEUE_TYPE QueueType;
+    ULONG           Node;
     PETHREAD        PrevThread;
 } SHUTDOWN_WORK_ITEM, *PSHUTDOWN_WORK_ITEM;
 
@@ -80,10 +81,12 @@ typedef struct _EXP_WORKER_LINK {
 #define LARGE_NUMBER_OF_THREADS 5
 
 //
-// 10-minute timeout used for terminating dynamic work item worker threads.
+// 1-minute timeout used for terminating idle dynamic work item worker
+// threads.  Dynamic threads are created whenever the queue delay exceeds
+// its target, so they are retired quickly once the load subsides.
 //
 
-#define DYNAMIC_THREAD_TIMEOUT ((LONGLONG)10 * 60 * 1000 * 1000 * 10)
+#define DYNAMIC_THREAD_TIMEOUT ((LONGLONG)1 * 60 * 1000 * 1000 * 10)
 
 //
 // 1-second timeout used for waking up the worker thread set manager.
@@ -91,19 +94,49 @@ typedef struct _EXP_WORKER_LINK {
 
 #define THREAD_SET_INTERVAL (1 * 1000 * 1000 * 10)
 
+//
+// 10-millisecond target for the 99th percentile time a work item spends in
+// the critical and delayed work queues before a worker picks it up.
+//
+
+#define WORK_QUEUE_DELAY_TARGET (10 * 1000 * 10)
+#define WORK_QUEUE_DELAY_PERCENTILE 99
+
 //
 // Flag to pass in to the worker thread, indicating whether it is dynamic
-// or not.
+// or not.  The node of the worker queue is passed in the upper half of the
+// start context and the queue type in the lower half.
 //
 
 #define DYNAMIC_WORKER_THREAD 0x80000000
 
+#define WORKER_THREAD_NODE_SHIFT 16
+#define WORKER_THREAD_QUEUE_MASK 0xffff
+
 //
 // Per-queue dynamic thread state.
 //
 
 EX_WORK_QUEUE ExWorkerQueue[MaximumWorkQueue];
 
+//
+// Per-node work queues.  Critical and delayed work items are inserted in
+// the work queue of the node of the processor that queues them, and are
+// processed by worker threads that are affine to that node.  The work
+// queues of node zero are ExWorkerQueue, which also holds the only
+// hypercritical work queue.  A node whose work queues could not be
+// created has a NULL entry and uses the work queues of node zero.
+//
+
+PEX_WORK_QUEUE ExpNodeWorkerQueue[MAXIMUM_CCNUMA_NODES] = { ExWorkerQueue };
+
+//
+// The work queue of the worker thread that shuts down the worker threads.
+// It keeps one worker until the shutdown is complete.
+//
+
+PEX_WORK_QUEUE ExpShutdownQueue;
+
 //
 // Additional worker threads... Controlled using registry settings
 //
@@ -162,12 +195,24 @@ ExpCheckDynamicThreadCount (
     VOID
     );
 
+VOID
+ExpCheckWorkQueueDelay (
+    VOID
+    );
+
 NTSTATUS
 ExpCreateWorkerThread (
     WORK_QUEUE_TYPE QueueType,
+    ULONG Node,
     BOOLEAN Dynamic
     );
 
+VOID
+ExpInitializeWorkerQueues (
+    IN PEX_WORK_QUEUE Queue,
+    IN BOOLEAN NtAs
+    );
+
 VOID
 ExpDetectWorkerThreadDeadlock (
     VOID
@@ -198,6 +243,7 @@ ExpWorkerThread (
 
 LOGICAL
 ExpCheckQueueShutdown (
+    IN ULONG Node,
     IN WORK_QUEUE_TYPE QueueType,
     IN PSHUTDOWN_WORK_ITEM ShutdownItem
     );
@@ -214,7 +260,9 @@ ExpDebuggerWorker(
 
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text(INIT, ExpWorkerInitialization)
+#pragma alloc_text(INIT, ExpInitializeWorkerQueues)
 #pragma alloc_text(PAGE, ExpCheckDynamicThreadCount)
+#pragma alloc_text(PAGE, ExpCheckWorkQueueDelay)
 #pragma alloc_text(PAGE, ExpCreateWorkerThread)
 #pragma alloc_text(PAGE, ExpDetectWorkerThreadDeadlock)
 #pragma alloc_text(PAGE, ExpWorkerThreadBalanceManager)
@@ -282,20 +330,259 @@ Return Value:
     return FALSE;
 }
 
+PEX_WORK_QUEUE
+__forceinline
+ExpSelectWorkerQueue (
+    IN WORK_QUEUE_TYPE QueueType
+    )
+
+/*++
+
+Routine Description:
+
+    This function selects the worker queue a work item of the supplied type
+    is inserted in.  Critical and delayed work items are inserted in the
+    work queue of the current node, so they are processed by a worker
+    thread that runs near the processor that queued them.
+
+Arguments:
+
+    QueueType - Supplies the type of the work queue.
+
+Return Value:
+
+    The worker queue to insert the work item in.
+
+--*/
+
+{
+    PEX_WORK_QUEUE Queue;
+
+    if (QueueType != HyperCriticalWorkQueue) {
+        Queue = ExpNodeWorkerQueue[KeGetCurrentNode()->NodeNumber];
+        if (Queue != NULL) {
+            return &Queue[QueueType];
+        }
+    }
+
+    return &ExWorkerQueue[QueueType];
+}
+
+ULONG
+__forceinline
+ExpComputeDelayBucket (
+    IN ULONG Delay
+    )
+
+/*++
+
+Routine Description:
+
+    This function computes the queue delay histogram bucket for the
+    supplied delay.
+
+Arguments:
+
+    Delay - Supplies the delay in interrupt time units.
+
+Return Value:
+
+    The histogram bucket index.
+
+--*/
+
+{
+    ULONG Index;
+
+    Delay >>= EX_WORK_QUEUE_DELAY_SHIFT;
+    if (Delay == 0) {
+        return 0;
+    }
+
+    BitScanReverse (&Index, Delay);
+    Index += 1;
+    if (Index >= EX_WORK_QUEUE_DELAY_HISTOGRAM_SIZE) {
+        Index = EX_WORK_QUEUE_DELAY_HISTOGRAM_SIZE - 1;
+    }
+
+    return Index;
+}
+
+VOID
+__forceinline
+ExpInsertWorkItem (
+    IN PEX_WORK_QUEUE Queue,
+    IN PWORK_QUEUE_ITEM WorkItem
+    )
+
+/*++
+
+Routine Description:
+
+    This function records the insertion time of a work item and inserts
+    it in the supplied worker queue.
+
+Arguments:
+
+    Queue - Supplies the queue the work item is inserted in.
+
+    WorkItem - Supplies the work item to insert.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+    ExRecordWorkItemInsertion (Queue, WorkItem);
+    KeInsertQueue (&Queue->WorkerQueue, &WorkItem->List);
+    return;
+}
+
+VOID
+__forceinline
+ExpRecordWorkItemDelay (
+    IN PEX_WORK_QUEUE Queue,
+    IN PWORK_QUEUE_ITEM WorkItem
+    )
+
+/*++
+
+Routine Description:
+
+    This function computes the time the work item just removed from the
+    supplied queue spent in the queue and records it in the queue delay
+    histogram.  The insertion time stamp of the work item is released.
+
+    Work items that were inserted without a time stamp (because no stamp
+    slot was free) are not recorded.
+
+Arguments:
+
+    Queue - Supplies the queue the work item was removed from.
+
+    WorkItem - Supplies the work item that was removed.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+    ULONG Delay;
+    ULONG Index;
+    ULONG Probe;
+    PEX_WORK_ITEM_STAMP Stamp;
+
+    Index = EX_WORK_QUEUE_STAMP_INDEX (WorkItem);
+
+    for (Probe = 0; Probe < EX_WORK_QUEUE_STAMP_PROBES; Probe += 1) {
+
+        Stamp = &Queue->InsertStamp[(Index + Probe) % EX_WORK_QUEUE_STAMP_TABLE_SIZE];
+
+        if (Stamp->WorkItem == (PVOID)WorkItem) {
+
+            Delay = (ULONG)KeQueryInterruptTime () - Stamp->InsertTime;
+
+            //
+            // The work item may be queued again as soon as its routine
+            // runs, so release the slot only after the time is read.
+            //
+
+            InterlockedExchangePointer (&Stamp->WorkItem, NULL);
+
+            Index = ExpComputeDelayBucket (Delay);
+            InterlockedIncrement ((PLONG)&Queue->DelayHistogram[Index]);
+            return;
+        }
+    }
+
+    return;
+}
+
+VOID
+ExpInitializeWorkerQueues (
+    IN PEX_WORK_QUEUE Queue,
+    IN BOOLEAN NtAs
+    )
+
+/*++
+
+Routine Description:
+
+    This function initializes the work queues of a node.
+
+Arguments:
+
+    Queue - Supplies the array of MaximumWorkQueue work queues of the node.
+
+    NtAs - Supplies TRUE if this is a server system.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+    WORK_QUEUE_TYPE WorkQueueType;
+
+    RtlZeroMemory (Queue, MaximumWorkQueue * sizeof(EX_WORK_QUEUE));
+
+    for (WorkQueueType = 0; WorkQueueType < MaximumWorkQueue; WorkQueueType += 1) {
+
+        KeInitializeQueue (&Queue[WorkQueueType].WorkerQueue, 0);
+        Queue[WorkQueueType].Info.WaitMode = UserMode;
+    }
+
+    //
+    // Always make stack for this thread resident
+    // so that worker pool deadlock magic can run
+    // even when what we are trying to do is inpage
+    // the hyper critical worker thread's stack.
+    // Without this fix, we hold the process lock
+    // but this thread's stack can't come in, and
+    // the deadlock detection cannot create new threads
+    // to break the system deadlock.
+    //
+
+    Queue[HyperCriticalWorkQueue].Info.WaitMode = KernelMode;
+
+    if (NtAs) {
+        Queue[CriticalWorkQueue].Info.WaitMode = KernelMode;
+    }
+
+    //
+    // We only create dynamic threads for the critical work queue (note
+    // this doesn't apply to dynamic threads created to break deadlocks.)
+    //
+    // The rationale is this: folks who use the delayed work queue are
+    // not time critical, and the hypercritical queue is used rarely
+    // by folks who are non-blocking.
+    //
+
+    Queue[CriticalWorkQueue].Info.MakeThreadsAsNecessary = 1;
+
+    return;
+}
+
 NTSTATUS
 ExpWorkerInitialization (
     VOID
     )
 {
     ULONG Index;
+    ULONG Node;
     OBJECT_ATTRIBUTES ObjectAttributes;
     ULONG NumberOfDelayedThreads;
     ULONG NumberOfCriticalThreads;
     ULONG NumberOfThreads;
+    PEX_WORK_QUEUE Queue;
     NTSTATUS Status;
     HANDLE Thread;
     BOOLEAN NtAs;
-    WORK_QUEUE_TYPE WorkQueueType;
 
     ExInitializeFastMutex (&ExpWorkerSwapinMutex);
     InitializeListHead (&ExpWorkerListHead);
@@ -356,44 +643,11 @@ ExpWorkerInitialization (
     }
 
     //
-    // Initialize the ExWorkerQueue[] array.
-    //
-
-    RtlZeroMemory (&ExWorkerQueue[0], MaximumWorkQueue * sizeof(EX_WORK_QUEUE));
-
-    for (WorkQueueType = 0; WorkQueueType < MaximumWorkQueue; WorkQueueType += 1) {
-
-        KeInitializeQueue (&ExWorkerQueue[WorkQueueType].WorkerQueue, 0);
-        ExWorkerQueue[WorkQueueType].Info.WaitMode = UserMode;
-    }
-
-    //
-    // Always make stack for this thread resident
-    // so that worker pool deadlock magic can run
-    // even when what we are trying to do is inpage
-    // the hyper critical worker thread's stack.
-    // Without this fix, we hold the process lock
-    // but this thread's stack can't come in, and
-    // the deadlock detection cannot create new threads
-    // to break the system deadlock.
-    //
-
-    ExWorkerQueue[HyperCriticalWorkQueue].Info.WaitMode = KernelMode;
-
-    if (NtAs) {
-        ExWorkerQueue[CriticalWorkQueue].Info.WaitMode = KernelMode;
-    }
-
-    //
-    // We only create dynamic threads for the critical work queue (note
-    // this doesn't apply to dynamic threads created to break deadlocks.)
-    //
-    // The rationale is this: folks who use the delayed work queue are
-    // not time critical, and the hypercritical queue is used rarely
-    // by folks who are non-blocking.
+    // Initialize the ExWorkerQueue[] array, which holds the work queues of
+    // node zero.
     //
 
-    ExWorkerQueue[CriticalWorkQueue].Info.MakeThreadsAsNecessary = 1;
+    ExpInitializeWorkerQueues (&ExWorkerQueue[0], NtAs);
 
     //
     // Initialize the global thread set manager events
@@ -423,7 +677,7 @@ ExpWorkerInitialization (
         // Create a worker thread to service the critical work queue.
         //
 
-        Status = ExpCreateWorkerThread (CriticalWorkQueue, FALSE);
+        Status = ExpCreateWorkerThread (CriticalWorkQueue, 0, FALSE);
 
         if (!NT_SUCCESS(Status)) {
             break;
@@ -443,7 +697,7 @@ ExpWorkerInitialization (
         // Create a worker thread to service the delayed work queue.
         //
 
-        Status = ExpCreateWorkerThread (DelayedWorkQueue, FALSE);
+        Status = ExpCreateWorkerThread (DelayedWorkQueue, 0, FALSE);
 
         if (!NT_SUCCESS(Status)) {
             break;
@@ -456,7 +710,48 @@ ExpWorkerInitialization (
     // Create the hypercritical worker thread.
     //
 
-    Status = ExpCreateWorkerThread (HyperCriticalWorkQueue, FALSE);
+    Status = ExpCreateWorkerThread (HyperCriticalWorkQueue, 0, FALSE);
+
+    //
+    // Create the critical and delayed work queues of the other nodes in
+    // memory local to the node, and the same number of critical and delayed
+    // worker threads for each node as for node zero.  ExCriticalWorkerThreads
+    // and ExDelayedWorkerThreads remain the number of threads per node.
+    //
+    // If the work queues of a node cannot be created, then work items queued
+    // on that node are inserted in the work queues of node zero.
+    //
+
+    for (Node = 1; Node < KeNumberNodes; Node += 1) {
+
+        if ((KeNodeBlock[Node]->ProcessorMask & KeActiveProcessors) == 0) {
+            continue;
+        }
+
+        Queue = MmAllocateIndependentPages (MaximumWorkQueue * sizeof(EX_WORK_QUEUE),
+                                            Node);
+
+        if (Queue == NULL) {
+            continue;
+        }
+
+        ExpInitializeWorkerQueues (Queue, NtAs);
+        ExpNodeWorkerQueue[Node] = Queue;
+
+        for (Index = 0; Index < ExCriticalWorkerThreads; Index += 1) {
+            Status = ExpCreateWorkerThread (CriticalWorkQueue, Node, FALSE);
+            if (!NT_SUCCESS(Status)) {
+                break;
+            }
+        }
+
+        for (Index = 0; Index < ExDelayedWorkerThreads; Index += 1) {
+            Status = ExpCreateWorkerThread (DelayedWorkQueue, Node, FALSE);
+            if (!NT_SUCCESS(Status)) {
+                break;
+            }
+        }
+    }
 
     //
     // Create the worker thread set manager thread.
@@ -496,7 +791,8 @@ ExQueueWorkItem (
 Routine Description:
 
     This function inserts a work item into a work queue that is processed
-    by a worker thread of the corresponding type.
+    by a worker thread of the corresponding type.  Critical and delayed
+    work items are processed by a worker thread of the current node.
 
 Arguments:
 
@@ -533,13 +829,14 @@ Return Value:
                       0);
     }
 
-    Queue = &ExWorkerQueue[QueueType];
+    Queue = ExpSelectWorkerQueue (QueueType);
 
     //
-    // Insert the work item in the appropriate queue object.
+    // Insert the work item in the appropriate queue object of the current
+    // node.
     //
 
-    KeInsertQueue (&Queue->WorkerQueue, &WorkItem->List);
+    ExpInsertWorkItem (Queue, WorkItem);
 
     //
     // We check the queue's shutdown state after we insert the work
@@ -662,6 +959,13 @@ Return Value:
                 //
 
                 ExpDetectWorkerThreadDeadlock ();
+
+                //
+                // Also check whether any work queue has been making work
+                // items wait longer than the target delay.
+                //
+
+                ExpCheckWorkQueueDelay ();
                 break;
 
             case ThreadSetManagerEvent:
@@ -729,9 +1033,9 @@ Routine Description:
     This routine is called when there is reason to believe that a work queue
     might benefit from the creation of an additional worker thread.
 
-    This routine checks each queue to determine whether it would benefit from
-    an additional worker thread (see ExpNewThreadNecessary()), and creates
-    one if so.
+    This routine checks each queue of each node to determine whether it
+    would benefit from an additional worker thread (see
+    ExpNewThreadNecessary()), and creates one if so.
 
 Arguments:
 
@@ -744,28 +1048,36 @@ Return Value:
 --*/
 
 {
+    ULONG Node;
     PEX_WORK_QUEUE Queue;
     WORK_QUEUE_TYPE QueueType;
 
     PAGED_CODE();
 
     //
-    // Check each worker queue.
+    // Check each worker queue of each node.
     //
 
-    Queue = &ExWorkerQueue[0];
+    for (Node = 0; Node < KeNumberNodes; Node += 1) {
 
-    for (QueueType = 0; QueueType < MaximumWorkQueue; Queue += 1, QueueType += 1) {
+        Queue = ExpNodeWorkerQueue[Node];
 
-        if (ExpNewThreadNecessary (Queue)) {
+        if (Queue == NULL) {
+            continue;
+        }
 
-            //
-            // Create a new thread for this queue.  We explicitly ignore
-            // an error from ExpCreateDynamicThread(): there's nothing
-            // we can or should do in the event of a failure.
-            //
+        for (QueueType = 0; QueueType < MaximumWorkQueue; Queue += 1, QueueType += 1) {
 
-            ExpCreateWorkerThread (QueueType, TRUE);
+            if (ExpNewThreadNecessary (Queue)) {
+
+                //
+                // Create a new thread for this queue.  We explicitly ignore
+                // an error from ExpCreateDynamicThread(): there's nothing
+                // we can or should do in the event of a failure.
+                //
+
+                ExpCreateWorkerThread (QueueType, Node, TRUE);
+            }
         }
     }
 }
@@ -794,17 +1106,24 @@ Return Value:
 
 {
     ULONG Index;
+    ULONG Node;
     PEX_WORK_QUEUE Queue;
 
     PAGED_CODE();
 
     //
-    // Process each queue type.
+    // Process each queue type of each node.
     //
 
-    for (Index = 0; Index < MaximumWorkQueue; Index += 1) {
+    for (Index = 0; Index < KeNumberNodes * MaximumWorkQueue; Index += 1) {
 
-        Queue = &ExWorkerQueue[Index];
+        Node = Index / MaximumWorkQueue;
+
+        if (ExpNodeWorkerQueue[Node] == NULL) {
+            continue;
+        }
+
+        Queue = &ExpNodeWorkerQueue[Node][Index % MaximumWorkQueue];
 
         ASSERT( Queue->DynamicThreadCount <= MAX_ADDITIONAL_DYNAMIC_THREADS );
 
@@ -827,7 +1146,7 @@ Return Value:
             // like it's still stuck.
             //
 
-            ExpCreateWorkerThread (Index, TRUE);
+            ExpCreateWorkerThread (Index % MaximumWorkQueue, Node, TRUE);
         }
 
         //
@@ -842,9 +1161,114 @@ Return Value:
     }
 }
 
+VOID
+ExpCheckWorkQueueDelay (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This function computes the 99th percentile time work items spent in
+    each work queue of each node since the last balance period, and
+    creates a dynamic
+    worker thread for any queue that exceeds the target delay while it
+    still has a backlog that another thread could help clear.
+
+    The hypercritical queue is excluded for the same reason it is not
+    eligible for dynamic threads in ExpNewThreadNecessary.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+    ULONG Count;
+    ULONG Index;
+    ULONG Node;
+    ULONG Percentile;
+    ULONG QueueIndex;
+    ULONG Total;
+    ULONG Samples[EX_WORK_QUEUE_DELAY_HISTOGRAM_SIZE];
+    PEX_WORK_QUEUE Queue;
+    WORK_QUEUE_TYPE QueueType;
+
+    PAGED_CODE();
+
+    for (QueueIndex = 0; QueueIndex < KeNumberNodes * MaximumWorkQueue; QueueIndex += 1) {
+
+        Node = QueueIndex / MaximumWorkQueue;
+        QueueType = QueueIndex % MaximumWorkQueue;
+
+        if (ExpNodeWorkerQueue[Node] == NULL) {
+            continue;
+        }
+
+        Queue = &ExpNodeWorkerQueue[Node][QueueType];
+
+        //
+        // Compute the histogram of the delays recorded since the last
+        // pass and take a new snapshot.
+        //
+
+        Total = 0;
+        for (Index = 0; Index < EX_WORK_QUEUE_DELAY_HISTOGRAM_SIZE; Index += 1) {
+            Count = Queue->DelayHistogram[Index];
+            Samples[Index] = Count - Queue->DelayHistogramLastPass[Index];
+            Queue->DelayHistogramLastPass[Index] = Count;
+            Total += Samples[Index];
+        }
+
+        if ((QueueType == HyperCriticalWorkQueue) || (Total == 0)) {
+            continue;
+        }
+
+        //
+        // Find the bucket that contains the 99th percentile delay.
+        //
+
+        Count = 0;
+        for (Percentile = 0;
+             Percentile < EX_WORK_QUEUE_DELAY_HISTOGRAM_SIZE - 1;
+             Percentile += 1) {
+
+            Count += Samples[Percentile];
+            if ((ULONG64)Count * 100 >=
+                (ULONG64)Total * WORK_QUEUE_DELAY_PERCENTILE) {
+                break;
+            }
+        }
+
+        if ((Percentile > ExpComputeDelayBucket (WORK_QUEUE_DELAY_TARGET)) &&
+            (IsListEmpty (&Queue->WorkerQueue.EntryListHead) == FALSE) &&
+            (Queue->WorkerQueue.CurrentCount < Queue->WorkerQueue.MaximumCount) &&
+            (Queue->DynamicThreadCount < MAX_ADDITIONAL_DYNAMIC_THREADS)) {
+
+            //
+            // Work items are waiting too long, there is still a backlog,
+            // and fewer workers are runnable than there are processors,
+            // so the existing workers are blocked.  Add a dynamic thread,
+            // which will terminate once it has been idle for a while.
+            //
+
+            if (NT_SUCCESS (ExpCreateWorkerThread (QueueType, Node, TRUE))) {
+                Queue->DelayThreadsCreated += 1;
+            }
+        }
+    }
+}
+
 NTSTATUS
 ExpCreateWorkerThread (
     IN WORK_QUEUE_TYPE QueueType,
+    IN ULONG Node,
     IN BOOLEAN Dynamic
     )
 
@@ -853,13 +1277,16 @@ ExpCreateWorkerThread (
 Routine Description:
 
     This function creates a single new static or dynamic worker thread for
-    the given queue type.
+    the given queue type of the given node.  On a multinode system the
+    worker thread is affine to the processors of the node.
 
 Arguments:
 
     QueueType - Supplies the type of the queue for which the worker thread
                 should be created.
 
+    Node - Supplies the node of the queue.
+
     Dynamic - If TRUE, the worker thread is created as a dynamic thread that
               will terminate after a sufficient period of inactivity.  If FALSE,
               the worker thread will never terminate.
@@ -877,6 +1304,7 @@ Notes:
 --*/
 
 {
+    KAFFINITY Affinity;
     OBJECT_ATTRIBUTES ObjectAttributes;
     NTSTATUS Status;
     HANDLE ThreadHandle;
@@ -884,9 +1312,11 @@ Notes:
     ULONG BasePriority;
     PETHREAD Thread;
 
+    ASSERT (ExpNodeWorkerQueue[Node] != NULL);
+
     InitializeObjectAttributes (&ObjectAttributes, NULL, 0, NULL, NULL);
 
-    Context = QueueType;
+    Context = QueueType | (Node << WORKER_THREAD_NODE_SHIFT);
     if (Dynamic != FALSE) 
     {
         Context |= DYNAMIC_WORKER_THREAD;
@@ -906,7 +1336,7 @@ Notes:
 
     if (Dynamic != FALSE) 
     {
-        InterlockedIncrement ((PLONG)&ExWorkerQueue[QueueType].DynamicThreadCount);
+        InterlockedIncrement ((PLONG)&ExpNodeWorkerQueue[Node][QueueType].DynamicThreadCount);
     }
 
     //
@@ -945,6 +1375,20 @@ Notes:
     if (NT_SUCCESS(Status))
     {
         KeSetBasePriorityThread (&Thread->Tcb, BasePriority);
+
+        //
+        // On a multinode system, restrict the thread to the processors of
+        // the node so the work items queued on the node are processed on
+        // the node.
+        //
+
+        if (KeNumberNodes > 1) {
+            Affinity = KeNodeBlock[Node]->ProcessorMask & KeActiveProcessors;
+            if (Affinity != 0) {
+                KeSetAffinityThread (&Thread->Tcb, Affinity);
+            }
+        }
+
         ObDereferenceObject (Thread);
     }
 
@@ -964,6 +1408,8 @@ ExpCheckForWorker (
     PLIST_ENTRY Entry;
     PCHAR BeginBlock;
     PCHAR EndBlock;
+    ULONG Node;
+    PEX_WORK_QUEUE Queue;
     WORK_QUEUE_TYPE wqt;
 
     BeginBlock = (PCHAR)p;
@@ -971,9 +1417,14 @@ ExpCheckForWorker (
 
     KiLockDispatcherDatabase (&OldIrql);
 
-    for (wqt = CriticalWorkQueue; wqt < MaximumWorkQueue; wqt += 1) {
-        for (Entry = (PLIST_ENTRY) ExWorkerQueue[wqt].WorkerQueue.EntryListHead.Flink;
-             Entry && (Entry != (PLIST_ENTRY) &ExWorkerQueue[wqt].WorkerQueue.EntryListHead);
+    for (Node = 0; Node < KeNumberNodes; Node += 1) {
+      Queue = ExpNodeWorkerQueue[Node];
+      if (Queue == NULL) {
+        continue;
+      }
+      for (wqt = CriticalWorkQueue; wqt < MaximumWorkQueue; wqt += 1) {
+        for (Entry = (PLIST_ENTRY) Queue[wqt].WorkerQueue.EntryListHead.Flink;
+             Entry && (Entry != (PLIST_ENTRY) &Queue[wqt].WorkerQueue.EntryListHead);
              Entry = Entry->Flink) {
            if (((PCHAR) Entry >= BeginBlock) && ((PCHAR) Entry < EndBlock)) {
               KeBugCheckEx(WORKER_INVALID,
@@ -984,6 +1435,7 @@ ExpCheckForWorker (
 
            }
         }
+      }
     }
     KiUnlockDispatcherDatabase (OldIrql);
 }
@@ -1003,6 +1455,7 @@ ExpWorkerThread (
     )
 {
     PLIST_ENTRY Entry;
+    ULONG Node;
     WORK_QUEUE_TYPE QueueType;
     PWORK_QUEUE_ITEM WorkItem;
     KPROCESSOR_MODE WaitMode;
@@ -1053,9 +1506,11 @@ ExpWorkerThread (
 
     /* ȡ */
     QueueType = (WORK_QUEUE_TYPE)
-                ((ULONG_PTR)StartContext & ~DYNAMIC_WORKER_THREAD);
+                ((ULONG_PTR)StartContext & WORKER_THREAD_QUEUE_MASK);
+
+    Node = (ULONG)(((ULONG_PTR)StartContext & ~DYNAMIC_WORKER_THREAD) >> WORKER_THREAD_NODE_SHIFT);
 
-    WorkerQueue = &ExWorkerQueue[QueueType];
+    WorkerQueue = &ExpNodeWorkerQueue[Node][QueueType];
 
     WaitMode = (KPROCESSOR_MODE) WorkerQueue->Info.WaitMode;
 
@@ -1086,7 +1541,7 @@ ExpWorkerThread (
     // we should be helping to process).
     //
 
-    if (PO_SHUTDOWN_QUEUE == Queu   eType) 
+    if (WorkerQueue == ExpShutdownQueue) 
     {
         CountForQueueEmpty = 1;
     }
@@ -1166,6 +1621,9 @@ ExpWorkerThread (
             InterlockedIncrement ((PLONG)&WorkerQueue->WorkItemsProcessed);
 
             WorkItem = CONTAINING_RECORD(Entry, WORK_QUEUE_ITEM, List);
+
+            ExpRecordWorkItemDelay (WorkerQueue, WorkItem);
+
             WorkerRoutine = WorkItem->WorkerRoutine;
             Parameter = WorkItem->Parameter;
 
@@ -1465,13 +1923,17 @@ Return Value:
 
 LOGICAL
 ExpCheckQueueShutdown (
+    IN ULONG Node,
     IN WORK_QUEUE_TYPE QueueType,
     IN PSHUTDOWN_WORK_ITEM ShutdownItem
     )
 {
     ULONG CountForQueueEmpty;
+    PEX_WORK_QUEUE Queue;
 
-    if (PO_SHUTDOWN_QUEUE == QueueType) {
+    Queue = &ExpNodeWorkerQueue[Node][QueueType];
+
+    if (Queue == ExpShutdownQueue) {
         CountForQueueEmpty = 1;
     }
     else {
@@ -1488,18 +1950,19 @@ ExpCheckQueueShutdown (
     // See ExpWorkerThread, ExpShutdownWorker, and ExpShutdownWorkerThreads.
     //
 
-    if (ExWorkerQueue[QueueType].Info.WorkerCount > CountForQueueEmpty) {
+    if (Queue->Info.WorkerCount > CountForQueueEmpty) {
 
         //
         // There're still worker threads; send one of them the axe.
         //
 
         ShutdownItem->QueueType = QueueType;
+        ShutdownItem->Node = Node;
         ShutdownItem->PrevThread = PsGetCurrentThread();
         ObReferenceObject (ShutdownItem->PrevThread);
 
-        KeInsertQueue (&ExWorkerQueue[QueueType].WorkerQueue,
-                       &ShutdownItem->WorkItem.List);
+        ExpInsertWorkItem (Queue,
+                           &ShutdownItem->WorkItem);
         return TRUE;
     }
 
@@ -1512,6 +1975,7 @@ ExpShutdownWorker (
     )
 {
     PETHREAD CurrentThread;
+    ULONG Node;
     PSHUTDOWN_WORK_ITEM  ShutdownItem;
 
     ShutdownItem = (PSHUTDOWN_WORK_ITEM) Parameter;
@@ -1541,12 +2005,28 @@ ExpShutdownWorker (
     // Decrement the worker count.
     //
 
-    InterlockedDecrement (&ExWorkerQueue[ShutdownItem->QueueType].Info.QueueWorkerInfo);
+    InterlockedDecrement (&ExpNodeWorkerQueue[ShutdownItem->Node][ShutdownItem->QueueType].Info.QueueWorkerInfo);
 
     CurrentThread = PsGetCurrentThread();
 
-    if ((!ExpCheckQueueShutdown(DelayedWorkQueue, ShutdownItem)) &&
-        (!ExpCheckQueueShutdown(CriticalWorkQueue, ShutdownItem))) {
+    //
+    // Pass the shutdown work item on to the delayed and then the critical
+    // work queue of each node until no worker threads remain.
+    //
+
+    for (Node = 0; Node < KeNumberNodes; Node += 1) {
+
+        if (ExpNodeWorkerQueue[Node] == NULL) {
+            continue;
+        }
+
+        if ((ExpCheckQueueShutdown(Node, DelayedWorkQueue, ShutdownItem)) ||
+            (ExpCheckQueueShutdown(Node, CriticalWorkQueue, ShutdownItem))) {
+            break;
+        }
+    }
+
+    if (Node == KeNumberNodes) {
 
         //
         // We're the last worker to exit
@@ -1569,6 +2049,7 @@ ExpShutdownWorkerThreads (
     VOID
     )
 {
+    ULONG Node;
     PULONG QueueEnable;
     SHUTDOWN_WORK_ITEM ShutdownItem;
 
@@ -1576,19 +2057,34 @@ ExpShutdownWorkerThreads (
         return;
     }
 
+    //
+    // The current thread is a worker of the shutdown queue of the node it
+    // runs on.  Record that queue so it keeps the current thread until the
+    // shutdown is complete.
+    //
+
+    ExpShutdownQueue = ExpSelectWorkerQueue (PO_SHUTDOWN_QUEUE);
+
     ASSERT (KeGetCurrentThread()->Queue
-           == &ExWorkerQueue[PO_SHUTDOWN_QUEUE].WorkerQueue);
+           == &ExpShutdownQueue->WorkerQueue);
 
     //
-    // Mark the queues as terminating.
+    // Mark the queues of each node as terminating.
     //
 
-    QueueEnable = (PULONG)&ExWorkerQueue[DelayedWorkQueue].Info.QueueWorkerInfo;
+    for (Node = 0; Node < KeNumberNodes; Node += 1) {
 
-    RtlInterlockedSetBitsDiscardReturn (QueueEnable, EX_WORKER_QUEUE_DISABLED);
+        if (ExpNodeWorkerQueue[Node] == NULL) {
+            continue;
+        }
+
+        QueueEnable = (PULONG)&ExpNodeWorkerQueue[Node][DelayedWorkQueue].Info.QueueWorkerInfo;
 
-    QueueEnable = (PULONG)&ExWorkerQueue[CriticalWorkQueue].Info.QueueWorkerInfo;
-    RtlInterlockedSetBitsDiscardReturn (QueueEnable, EX_WORKER_QUEUE_DISABLED);
+        RtlInterlockedSetBitsDiscardReturn (QueueEnable, EX_WORKER_QUEUE_DISABLED);
+
+        QueueEnable = (PULONG)&ExpNodeWorkerQueue[Node][CriticalWorkQueue].Info.QueueWorkerInfo;
+        RtlInterlockedSetBitsDiscardReturn (QueueEnable, EX_WORKER_QUEUE_DISABLED);
+    }
 
     //
     // Queue the shutdown work item to the delayed work queue.  After
@@ -1602,10 +2098,11 @@ ExpShutdownWorkerThreads (
                           &ShutdownItem);
 
     ShutdownItem.QueueType = DelayedWorkQueue;
+    ShutdownItem.Node = 0;
     ShutdownItem.PrevThread = NULL;
 
-    KeInsertQueue (&ExWorkerQueue[DelayedWorkQueue].WorkerQueue,
-                   &ShutdownItem.WorkItem.List);
+    ExpInsertWorkItem (&ExWorkerQueue[DelayedWorkQueue],
+                       &ShutdownItem.WorkItem);
 
     //
     // Wait for all of the workers and the balancer to exit.
@@ -1500,7 +1500,9 @@ typedef struct _KPRCB {
     PVOID DpcThread;
     KEVENT DpcEvent;
     KDPC CallDpc;
-    ULONG64 PrcbPad7[4];
+    ULONG64 DispatcherLockAcquireTime;
+    struct _KTIMER_TABLE *TimerTable;
+    ULONG64 PrcbPad7[2];
 
 //
 // Per-processor ready summary and ready queues - 128-byte aligned.
@@ -211,6 +211,7 @@ extern ULONG CcCopyReadNoWait;
 extern ULONG CcCopyReadWait;
 extern ULONG CcCopyReadNoWaitMiss;
 extern ULONG CcCopyReadWaitMiss;
+extern ULONG CcCopyReadTransferPages;
 
 extern ULONG CcMdlReadNoWait;
 extern ULONG CcMdlReadWait;
@@ -218,6 +219,12 @@ extern ULONG CcMdlReadNoWaitMiss;
 extern ULONG CcMdlReadWaitMiss;
 
 extern ULONG CcReadAheadIos;
+extern ULONG CcReadAheadHits;
+extern ULONG CcReadAheadWastedPages;
+
+extern ULONG CcVacbMisses;
+extern ULONG CcVacbRemaps;
+extern ULONG CcViewGroupMaps;
 
 extern ULONG CcLazyWriteIos;
 extern ULONG CcLazyWritePages;
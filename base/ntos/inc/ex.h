@@ -4243,6 +4243,30 @@ typedef union {
     LONG QueueWorkerInfo;
 } EX_QUEUE_WORKER_INFO;
 
+//
+// Work queue delay tracking.  WORK_QUEUE_ITEM has no room for a time stamp,
+// so the insertion time of each work item is recorded in a small table in
+// the queue keyed by the address of the work item, and looked up by the
+// worker that removes the item.  An item that finds no free slot within
+// EX_WORK_QUEUE_STAMP_PROBES slots is simply not sampled.  The time in
+// queue is accumulated into a log2 histogram whose first bucket covers
+// delays of less than 2^EX_WORK_QUEUE_DELAY_SHIFT interrupt time units
+// (~100us).
+//
+
+#define EX_WORK_QUEUE_STAMP_TABLE_SIZE      256
+#define EX_WORK_QUEUE_STAMP_PROBES          4
+#define EX_WORK_QUEUE_DELAY_HISTOGRAM_SIZE  16
+#define EX_WORK_QUEUE_DELAY_SHIFT           10
+
+typedef struct _EX_WORK_ITEM_STAMP {
+    PVOID WorkItem;
+    ULONG InsertTime;
+} EX_WORK_ITEM_STAMP, *PEX_WORK_ITEM_STAMP;
+
+#define EX_WORK_QUEUE_STAMP_INDEX(WorkItem)                                 \
+    ((ULONG)((ULONG_PTR)(WorkItem) >> 4) % EX_WORK_QUEUE_STAMP_TABLE_SIZE)
+
 typedef struct _EX_WORK_QUEUE {
 
     //
@@ -4282,10 +4306,84 @@ typedef struct _EX_WORK_QUEUE {
 
     EX_QUEUE_WORKER_INFO Info;
 
+    //
+    // Low part of the interrupt time at which each queued work item was
+    // inserted, keyed by the address of the work item.
+    //
+
+    EX_WORK_ITEM_STAMP InsertStamp[EX_WORK_QUEUE_STAMP_TABLE_SIZE];
+
+    //
+    // Histogram of the time work items spent in the queue, and a snapshot
+    // of it taken by the balance manager at its last pass.
+    //
+
+    ULONG DelayHistogram[EX_WORK_QUEUE_DELAY_HISTOGRAM_SIZE];
+    ULONG DelayHistogramLastPass[EX_WORK_QUEUE_DELAY_HISTOGRAM_SIZE];
+
+    //
+    // Number of dynamic threads created because the queue delay exceeded
+    // its target.
+    //
+
+    ULONG DelayThreadsCreated;
+
 } EX_WORK_QUEUE, *PEX_WORK_QUEUE;
 
 extern EX_WORK_QUEUE ExWorkerQueue[];
 
+FORCEINLINE
+VOID
+ExRecordWorkItemInsertion (
+    IN PEX_WORK_QUEUE Queue,
+    IN PVOID WorkItem
+    )
+
+/*++
+
+Routine Description:
+
+    This function records the current interrupt time as the insertion time
+    of the specified work item in the stamp table of the supplied worker
+    queue.
+
+    N.B. The caller must call this function before inserting the work item
+         so the stamp is visible to the worker which removes it.
+
+Arguments:
+
+    Queue - Supplies the queue the work item is about to be inserted in.
+
+    WorkItem - Supplies the work item.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+    ULONG Probe;
+    PEX_WORK_ITEM_STAMP Stamp;
+
+    Index = EX_WORK_QUEUE_STAMP_INDEX(WorkItem);
+    for (Probe = 0; Probe < EX_WORK_QUEUE_STAMP_PROBES; Probe += 1) {
+        Stamp = &Queue->InsertStamp[(Index + Probe) % EX_WORK_QUEUE_STAMP_TABLE_SIZE];
+        if ((Stamp->WorkItem == NULL) &&
+            (InterlockedCompareExchangePointer(&Stamp->WorkItem,
+                                               WorkItem,
+                                               NULL) == NULL)) {
+
+            Stamp->InsertTime = (ULONG)KeQueryInterruptTime();
+            break;
+        }
+    }
+
+    return;
+}
+
 
 // begin_ntddk begin_nthal begin_ntifs begin_ntosp
 //
@@ -5260,6 +5358,16 @@ typedef struct _HANDLE_TABLE {
 
     LONG HandleCount;                       // ʹõľ
 
+    //
+    //  Per processor caches of free handle values.  These are allocated once
+    //  a table grows beyond its first page so that busy multithreaded
+    //  processes can create and close handles without touching the shared
+    //  free lists.  Cached entries are free (i.e., have no object).
+    //
+
+    struct _HANDLE_TABLE_CACHE *HandleCache;
+    ULONG HandleCacheCount;
+
     //
     // Define a flags field
     //
@@ -1249,7 +1249,8 @@ typedef struct _KPRCB {
     UCHAR PrcbPad50;
     volatile BOOLEAN IdleSchedule;              // ôǷ
     LONG DpcSetEventRequest;
-    UCHAR PrcbPad5[18];
+    struct _KTIMER_TABLE *TimerTable;
+    UCHAR PrcbPad5[14];
 
 //
 // Number of 100ns units remaining before a tick completes on this processor.
@@ -1330,7 +1331,12 @@ typedef struct _KPRCB {
 //
 
     volatile ULONGLONG IsrTime;
-    ULONGLONG SpareField1;
+
+//
+// Dispatcher lock acquisition time stamp.
+//
+
+    ULONGLONG DispatcherLockAcquireTime;
 
 //
 // Npx save area - 16-byte aligned.
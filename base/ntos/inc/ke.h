@@ -58,6 +58,92 @@ typedef struct _KTHREAD_SWITCH_COUNTERS {
     ULONG SwitchToIdle;
 } KTHREAD_SWITCH_COUNTERS, *PKTHREAD_SWITCH_COUNTERS;
 
+//
+// Define timer expiration performance data structure.
+//
+
+typedef struct _KTIMER_EXPIRATION_COUNTERS {
+    ULONG ExpirationScans;
+    ULONG TimersExpired;
+    ULONG TimersCoalesced;
+} KTIMER_EXPIRATION_COUNTERS, *PKTIMER_EXPIRATION_COUNTERS;
+
+//
+// Define dispatcher lock performance data structure.
+//
+// N.B. Entry N of the spin histogram counts contended acquisitions that
+//      spun fewer than 2^(N+1) times. Entry N of the hold histogram counts
+//      hold times of fewer than 2^(N+7) processor cycles. The last entry
+//      of each histogram counts everything larger.
+//
+// N.B. The spin histogram is only maintained where the kernel implements
+//      the queued spin lock spin loop (AMD64). On x86 the HAL spins.
+//
+// N.B. These counters only measure the dispatcher database lock. Signals,
+//      resets and releases of events and semaphores that complete under
+//      an object lock without the dispatcher database lock are counted
+//      in the object lock table.
+//
+
+#define DISPATCHER_LOCK_HISTOGRAM_SIZE 16
+
+typedef struct _KDISPATCHER_LOCK_COUNTERS {
+    ULONG Acquisitions;
+    ULONG Contentions;
+    ULONG SpinHistogram[DISPATCHER_LOCK_HISTOGRAM_SIZE];
+    ULONG HoldHistogram[DISPATCHER_LOCK_HISTOGRAM_SIZE];
+} KDISPATCHER_LOCK_COUNTERS, *PKDISPATCHER_LOCK_COUNTERS;
+
+//
+// Define dispatcher object lock table structure.
+//
+// Event and semaphore state is protected by a hashed object lock in
+// addition to the dispatcher database lock. An event or semaphore with an
+// empty wait list is signaled, reset or released under its object lock
+// alone. The dispatcher database lock is only acquired when there are
+// waiters.
+//
+// N.B. The object lock is always acquired after the dispatcher database
+//      lock. When more than one object lock is required, the locks are
+//      acquired in ascending table index order and an index that is
+//      shared by several objects is only acquired once.
+//
+// N.B. Bypasses counts the operations completed under the object lock
+//      without the dispatcher database lock. It is updated with the object
+//      lock held.
+//
+
+#define OBJECT_LOCK_TABLE_SIZE 32
+
+typedef struct DECLSPEC_CACHEALIGN _KOBJECT_LOCK_ENTRY {
+    KSPIN_LOCK Lock;
+    ULONG Bypasses;
+} KOBJECT_LOCK_ENTRY, *PKOBJECT_LOCK_ENTRY;
+
+//
+// Define per-processor scheduler work stealing performance data structure.
+//
+
+typedef struct DECLSPEC_CACHEALIGN _KSCHEDULER_STEAL_COUNTERS {
+    ULONG LocalHits;
+    ULONG SmtSteals;
+    ULONG NodeSteals;
+    ULONG RemoteNodeSteals;
+} KSCHEDULER_STEAL_COUNTERS, *PKSCHEDULER_STEAL_COUNTERS;
+
+//
+// Define per-processor translation buffer flush performance data structure.
+//
+
+typedef struct DECLSPEC_CACHEALIGN _KTB_FLUSH_COUNTERS {
+    ULONG EntireFlushes;
+    ULONG ProcessFlushes;
+    ULONG MultipleFlushes;
+    ULONG MultipleFlushEntries;
+    ULONG SingleFlushes;
+    ULONG IpiRequests;
+} KTB_FLUSH_COUNTERS, *PKTB_FLUSH_COUNTERS;
+
 //
 // Public (external) constant definitions.
 //
@@ -2682,6 +2768,16 @@ KeSetTimerEx (
     __in_opt PKDPC Dpc
     );
 
+NTKERNELAPI
+BOOLEAN
+KeSetCoalescableTimer (
+    __inout PKTIMER Timer,
+    __in LARGE_INTEGER DueTime,
+    __in LONG Period,
+    __in ULONG TolerableDelay,
+    __in_opt PKDPC Dpc
+    );
+
 // end_ntddk end_nthal end_ntifs end_wdm end_ntosp
 
 extern volatile KAFFINITY KiIdleSummary;
@@ -3096,7 +3192,10 @@ KeTryToAcquireQueuedSpinLockRaiseToSynch (
 
 #else   // NT_UP
 
-#if defined(_AMD64_)
+//
+// N.B. The dispatcher lock routines are implemented for each architecture
+//      so that the dispatcher lock counters are maintained on all of them.
+//
 
 KIRQL
 KiAcquireDispatcherLockRaiseToSynch (
@@ -3114,16 +3213,6 @@ KiTryToAcquireDispatcherLockRaiseToSynch (
 #define KiTryToLockDispatcherDatabase(OldIrql)                               \
     KiTryToAcquireDispatcherLockRaiseToSynch(OldIrql)
 
-#else
-
-#define KiLockDispatcherDatabase(OldIrql)                                    \
-    *(OldIrql) = KeAcquireQueuedSpinLockRaiseToSynch(LockQueueDispatcherLock)
-
-#define KiTryToLockDispatcherDatabase(OldIrql)                               \
-    KeTryToAcquireQueuedSpinLockRaiseToSynch(LockQueueDispatcherLock,OldIrql)
-
-#endif
-
 #endif  // NT_UP
 
 #if defined(NT_UP)
@@ -3133,8 +3222,6 @@ KiTryToAcquireDispatcherLockRaiseToSynch (
 
 #else
 
-#if defined(_AMD64_)
-
 VOID
 KiAcquireDispatcherLockAtSynchLevel (
     VOID
@@ -3151,16 +3238,6 @@ KiReleaseDispatcherLockFromSynchLevel (
 #define KiUnlockDispatcherDatabaseFromSynchLevel()                           \
     KiReleaseDispatcherLockFromSynchLevel()
 
-#else
-
-#define KiLockDispatcherDatabaseAtSynchLevel()                               \
-    KeAcquireQueuedSpinLockAtDpcLevel(&KeGetCurrentPrcb()->LockQueue[LockQueueDispatcherLock])
-
-#define KiUnlockDispatcherDatabaseFromSynchLevel()                           \
-    KeReleaseQueuedSpinLockFromDpcLevel(&KeGetCurrentPrcb()->LockQueue[LockQueueDispatcherLock])
-
-#endif
-
 #endif
 
 VOID
@@ -4596,6 +4673,17 @@ extern PKPRCB KiProcessorBlock[];
 extern ULONG KiSpinlockTimeout;
 extern ULONG KiStackProtectTime;
 extern KTHREAD_SWITCH_COUNTERS KeThreadSwitchCounters;
+extern KTIMER_EXPIRATION_COUNTERS KeTimerExpirationCounters;
+extern KDISPATCHER_LOCK_COUNTERS KeDispatcherLockCounters;
+extern KOBJECT_LOCK_ENTRY KeObjectLockTable[OBJECT_LOCK_TABLE_SIZE];
+
+#if !defined(NT_UP)
+
+extern KSCHEDULER_STEAL_COUNTERS KiStealCounters[MAXIMUM_PROCESSORS];
+extern KTB_FLUSH_COUNTERS KiTbFlushCounters[MAXIMUM_PROCESSORS];
+
+#endif
+
 extern ULONG KeTimerCheckFlags;
 extern ULONG KeLargestCacheLine;
 
@@ -713,6 +713,11 @@ MiIsPoolLargeSession (
     IN PVOID VirtualAddress
     );
 
+LOGICAL
+MiIsPoolPageLocal (
+    IN PVOID VirtualAddress
+    );
+
 PVOID
 MiAllocatePoolPages (
     IN POOL_TYPE PoolType,
@@ -1503,6 +1508,48 @@ MmGetPageFileInformation (
     OUT PULONG Length
     );
 
+NTSTATUS
+MmGetZeroPageInformation (
+    OUT PVOID SystemInformation,
+    IN ULONG SystemInformationLength,
+    OUT PULONG Length
+    );
+
+NTSTATUS
+MmGetStandbyListInformation (
+    OUT PVOID SystemInformation,
+    IN ULONG SystemInformationLength,
+    OUT PULONG Length
+    );
+
+NTSTATUS
+MmGetPageFileWriteInformation (
+    OUT PVOID SystemInformation,
+    IN ULONG SystemInformationLength,
+    OUT PULONG Length
+    );
+
+NTSTATUS
+MmGetPageFileReadInformation (
+    OUT PVOID SystemInformation,
+    IN ULONG SystemInformationLength,
+    OUT PULONG Length
+    );
+
+NTSTATUS
+MmGetWorkingSetTrimInformation (
+    OUT PVOID SystemInformation,
+    IN ULONG SystemInformationLength,
+    OUT PULONG Length
+    );
+
+NTSTATUS
+MmGetMemoryCompactionInformation (
+    OUT PVOID SystemInformation,
+    IN ULONG SystemInformationLength,
+    OUT PULONG Length
+    );
+
 HANDLE
 MmGetSystemPageFile (
     VOID
@@ -1624,6 +1671,12 @@ MmCheckCachedPageState (
     IN BOOLEAN SetToZero
     );
 
+LOGICAL
+MmTransferCachedPage (
+    IN PVOID SystemCacheAddress,
+    IN PVOID UserAddress
+    );
+
 NTSTATUS
 MmCopyToCachedPage (
     IN PVOID Address,
@@ -569,7 +569,11 @@ typedef struct _DISPATCHER_HEADER {
         struct {
             UCHAR Type;
             union {
-                UCHAR Absolute;
+                struct {
+                    UCHAR Absolute : 1;
+                    UCHAR Processor : 7;
+                };
+
                 UCHAR NpxIrql;
             };
 
@@ -620,9 +624,13 @@ typedef struct _KGATE {
 //
 // N.B. The size of the timer table must be less than or equal to 256 and a
 //      power of 2 in size.
+//
+// N.B. There is a timer table for each processor and a timer is inserted
+//      in the timer table of the processor on which it is set. The timer
+//      header records the processor number and the timer table hand value.
 
-#define TIMER_TABLE_SIZE 512
-#define TIMER_TABLE_SHIFT 9
+#define TIMER_TABLE_SIZE 256
+#define TIMER_TABLE_SHIFT 8
 
 C_ASSERT((1 << TIMER_TABLE_SHIFT) == TIMER_TABLE_SIZE);
 C_ASSERT((TIMER_TABLE_SIZE & (TIMER_TABLE_SIZE - 1)) == 0);
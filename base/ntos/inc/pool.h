@@ -280,6 +280,7 @@ ExDeletePoolTagTable (
 #define EX_STOP_ON_POOL_FAILURES                     0x80
 #define EX_SEPARATE_HOT_PAGES_DURING_BOOT           0x100
 #define EX_DELAY_POOL_FREES                         0x200
+#define EX_POOL_MAGAZINES                           0x400
 
 VOID
 ExSetPoolFlags (
@@ -319,6 +320,7 @@ typedef struct _POOL_TRACKER_TABLE {
     ULONG PagedAllocs;
     ULONG PagedFrees;
     SIZE_T PagedBytes;
+    ULONG NonPagedRemoteAllocs;
 } POOL_TRACKER_TABLE, *PPOOL_TRACKER_TABLE;
 
 //
@@ -335,4 +337,85 @@ typedef struct _POOL_TRACKER_BIG_PAGES {
     PVOID QuotaObject;
 } POOL_TRACKER_BIG_PAGES, *PPOOL_TRACKER_BIG_PAGES;
 
+//
+// Define per processor pool magazine structures.
+//
+// Small pool blocks which miss the per processor lookaside lists are cached
+// in per processor magazines (fixed size stacks of freed blocks) before
+// falling through to the pool descriptor list heads.  Each processor keeps
+// a loaded and a previous magazine for every block size.  Full and empty
+// magazines are exchanged with a per node depot using interlocked singly
+// linked lists so the pool descriptor locks are only acquired when the
+// depot has no full magazine (allocation) or no empty one (free).
+//
+// Blocks held in magazines are in exactly the same state as blocks held in
+// the pool lookaside lists - the header is marked free and the tag tracker
+// has already been debited.
+//
+
+#define POOL_MAGAZINE_LISTS 64
+
+#define POOL_MAGAZINE_ROUNDS 15
+
+//
+// Larger block sizes use fewer rounds so a magazine never caches more than
+// about a page worth of blocks.
+//
+
+#define POOL_MAGAZINE_CAPACITY(BlockSize)                                   \
+    ((((POOL_PAGE_SIZE / POOL_SMALLEST_BLOCK) / (BlockSize)) < POOL_MAGAZINE_ROUNDS) ? \
+        ((POOL_PAGE_SIZE / POOL_SMALLEST_BLOCK) / (BlockSize)) :            \
+        POOL_MAGAZINE_ROUNDS)
+
+typedef struct _POOL_MAGAZINE {
+    SLIST_ENTRY ListEntry;
+    ULONG Rounds;
+    ULONG Spare;
+    PPOOL_HEADER Round[POOL_MAGAZINE_ROUNDS];
+} POOL_MAGAZINE, *PPOOL_MAGAZINE;
+
+typedef struct _POOL_MAGAZINE_CLASS {
+    PPOOL_MAGAZINE Loaded;
+    PPOOL_MAGAZINE Previous;
+} POOL_MAGAZINE_CLASS, *PPOOL_MAGAZINE_CLASS;
+
+typedef struct _POOL_MAGAZINE_CACHE {
+    ULONG NodeNumber;
+    ULONG Allocates;
+    ULONG AllocateHits;
+    ULONG Frees;
+    ULONG FreeHits;
+    ULONG DepotAllocates;
+    ULONG DepotFrees;
+    ULONG Flushes;
+    KDPC FlushDpc;
+    POOL_MAGAZINE_CLASS Class[NUMBER_OF_POOLS][POOL_MAGAZINE_LISTS];
+} POOL_MAGAZINE_CACHE, *PPOOL_MAGAZINE_CACHE;
+
+typedef struct _POOL_MAGAZINE_DEPOT {
+    SLIST_HEADER FullMagazines[NUMBER_OF_POOLS][POOL_MAGAZINE_LISTS];
+    USHORT MinimumDepth[NUMBER_OF_POOLS][POOL_MAGAZINE_LISTS];
+} POOL_MAGAZINE_DEPOT, *PPOOL_MAGAZINE_DEPOT;
+
+ULONG
+ExpFlushPoolMagazineDepot (
+    IN POOL_TYPE PoolType,
+    IN LOGICAL TrimOnly
+    );
+
+ULONG
+ExpFlushPoolMagazines (
+    IN POOL_TYPE PoolType
+    );
+
+VOID
+ExpReleasePoolMagazinePages (
+    VOID
+    );
+
+VOID
+ExQueryPoolMagazineUsage (
+    OUT PSYSTEM_POOL_MAGAZINE_INFORMATION MagazineInformation
+    );
+
 #endif
@@ -82,6 +82,15 @@ typedef struct _MMSUPPORT {
     WSLE_NUMBER EstimatedAvailable;
     WSLE_NUMBER WorkingSetSize;
 
+    //
+    // Pages recently trimmed from this working set and how many of those
+    // were faulted back in before being repurposed.  Protected by the
+    // working set mutex.
+    //
+
+    WSLE_NUMBER TrimmedPages;
+    WSLE_NUMBER RefaultedPages;
+
     EX_PUSH_LOCK WorkingSetMutex;
 
 } MMSUPPORT, *PMMSUPPORT;
@@ -194,6 +203,13 @@ typedef struct _PAGEFAULT_HISTORY {
 #define PS_WS_TRIM_FROM_EXE_HEADER        1
 #define PS_WS_TRIM_BACKGROUND_ONLY_APP    2
 
+//
+// Number of VAD range locks in each process (must be a power of 2).
+// VADs are hashed onto these, see MiLockVadRange.
+//
+
+#define PS_VAD_RANGE_LOCKS                8
+
 //
 // Wow64 process structure.
 //
@@ -511,6 +527,33 @@ typedef struct _EPROCESS {
 
     ULONG Cookie;										/* ý̵ֵһͨNtQueryInformationProcessȡCookiesֵʱϵͳһֵԺøֵ˽ *[BAI]*/
 
+    //
+    // Incremented whenever a VAD is removed from VadRoot, so threads can
+    // tell if their cached VAD (see ETHREAD VadCache) may have been freed.
+    // This is 64 bits wide so it never wraps back to a value a thread may
+    // still have cached.
+    //
+
+    ULONG64 VadSequence;
+
+    //
+    // Protection changes, commits and decommits within a single private
+    // VAD hold AddressSpaceRangeLock shared and the range lock their VAD
+    // hashes to instead of holding the address creation mutex throughout.
+    // Everything else holds AddressSpaceRangeLock exclusive along with the
+    // mutex, see LOCK_ADDRESS_SPACE.
+    //
+
+    EX_PUSH_LOCK AddressSpaceRangeLock;
+    EX_PUSH_LOCK VadRangeLocks[PS_VAD_RANGE_LOCKS];
+
+    //
+    // Number of image pages made valid by fault-around instead of each
+    // taking its own soft fault.  See MiFaultAround.
+    //
+
+    ULONG FaultAroundCount;
+
 } EPROCESS, *PEPROCESS; 
 
 C_ASSERT( FIELD_OFFSET(EPROCESS, Pcb) == 0 );
@@ -807,6 +850,22 @@ typedef struct _ETHREAD {
     BOOLEAN DisablePageFaultClustering;				/* ҳ潻ľۼ *[BAI]*/
     UCHAR ActiveFaultCount;							/* ڽеҳ *[BAI]*/ /* ҳй *[BAI]*/
 
+    //
+    // Last VAD located in this thread's own process and the process
+    // VadSequence it was located at.  See MiLocateAddress.
+    //
+
+    ULONG64 VadCacheSequence;
+    PVOID VadCache;
+
+    //
+    // Adaptive page file read cluster size and the address following the
+    // last page file cluster this thread read.  See MiResolvePageFileFault.
+    //
+
+    ULONG PageFileReadCluster;
+    PVOID PageFileReadNext;
+
 #if defined (PERF_DATA)
     ULONG PerformanceCountLow;
     LONG PerformanceCountHigh;
@@ -183,6 +183,7 @@ Return Value:
     //   Machine Check Stack
     //   NMI Stack
     //   Multinode structure
+    //   Timer table
     //   GDT
     //   IDT
     //
@@ -195,7 +196,8 @@ Return Value:
                      ROUNDUP64(DOUBLE_FAULT_STACK_SIZE) +
                      ROUNDUP64(KERNEL_MCA_EXCEPTION_STACK_SIZE) +
                      ROUNDUP64(NMI_STACK_SIZE) +
-                     ROUNDUP64(sizeof(KNODE));
+                     ROUNDUP64(sizeof(KNODE)) +
+                     ROUNDUP64(sizeof(KTIMER_TABLE));
 
     //
     // Save the offset of the GDT in the allocation structure and add in
@@ -468,6 +470,15 @@ Return Value:
 
         PcrBase->Prcb.ParentNode = Node;
 
+        //
+        // Use the space allocated for the timer table of the next processor
+        // and initialize the timer table.
+        //
+
+        PcrBase->Prcb.TimerTable = (PKTIMER_TABLE)Base;
+        KiInitializeTimerTable(PcrBase->Prcb.TimerTable);
+        Base += ROUNDUP64(sizeof(KTIMER_TABLE));
+
         //
         // Adjust the loader block so it has the next processor state. Ensure
         // that the kernel stack has space for home registers for up to four
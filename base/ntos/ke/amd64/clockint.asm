@@ -32,7 +32,6 @@ include ksamd64.inc
         extern  KiRestoreDebugRegisterState:proc
         extern  KiSaveDebugRegisterState:proc
         extern  KiTimeIncrement:qword
-        extern  KiTimerTableListHead:qword
         extern  __imp_HalRequestSoftwareInterrupt:qword
 
         subttl  "Update System Time"
@@ -105,7 +104,8 @@ endif
 ;
 
         mov     rcx, USER_SHARED_DATA   ; get user shared data address
-        lea     r11, KiTimerTableListHead ; get timer table address
+        mov     r11, gs:[PcCurrentPrcb] ; get current processor block address
+        mov     r11, PbTimerTable[r11]  ; get timer table address
         mov     r8, UsInterruptTime[rcx] ; get interrupt time
         add     r8, rdx                 ; compute updated interrupt time
         ror     r8, 32                  ; swap upper and lower halves
@@ -67,7 +67,9 @@ Return Value:
     Prcb = KeGetCurrentPrcb();
     TargetProcessors = KeActiveProcessors & ~Prcb->SetMember;
     KiSetTbFlushTimeStampBusy();
+    KiRecordTbFlush(Prcb, EntireFlushes);
     if (TargetProcessors != 0) {
+        KiRecordTbFlush(Prcb, IpiRequests);
         Barrier = KiIpiSendRequest(TargetProcessors, 0, 0, IPI_FLUSH_ALL);
         KeFlushCurrentTb();
         KiIpiWaitForRequestBarrier(Barrier);
@@ -134,6 +136,7 @@ Return Value:
     Process = Prcb->CurrentThread->ApcState.Process;
     TargetProcessors = Process->ActiveProcessors;
     TargetProcessors &= ~Prcb->SetMember;
+    KiRecordTbFlush(Prcb, ProcessFlushes);
 
     //
     // Send request to target processors, if any, flush the current process
@@ -141,6 +144,7 @@ Return Value:
     //
 
     if (TargetProcessors != 0) {
+        KiRecordTbFlush(Prcb, IpiRequests);
         Barrier = KiIpiSendRequest(TargetProcessors, 0, 0, IPI_FLUSH_PROCESS);
         KiFlushProcessTb();
         KiIpiWaitForRequestBarrier(Barrier);
@@ -223,7 +227,10 @@ Return Value:
 
     End = Virtual + Number;
     TargetProcessors &= ~Prcb->SetMember;
+    KiRecordTbFlush(Prcb, MultipleFlushes);
+    KiTbFlushCounters[Prcb->Number].MultipleFlushEntries += Number;
     if (TargetProcessors != 0) {
+        KiRecordTbFlush(Prcb, IpiRequests);
         Barrier = KiIpiSendRequest(TargetProcessors,
                                    (LONG64)Virtual,
                                    Number,
@@ -310,7 +317,9 @@ Return Value:
     //
 
     TargetProcessors &= ~Prcb->SetMember;
+    KiRecordTbFlush(Prcb, SingleFlushes);
     if (TargetProcessors != 0) {
+        KiRecordTbFlush(Prcb, IpiRequests);
         Barrier = KiIpiSendRequest(TargetProcessors, (LONG64)Virtual, 0, IPI_FLUSH_SINGLE);
         KiFlushSingleTb(Virtual);
         KiIpiWaitForRequestBarrier(Barrier);
@@ -102,6 +102,7 @@ Return Value:
 
     SpinCount = 0;
     do {
+        SpinCount += 1;
         KeYieldProcessor();
     } while ((*((ULONG64 volatile *)&LockQueue->Lock) & LOCK_QUEUE_WAIT) != 0);
 
@@ -812,6 +813,69 @@ Return Value:
     return;
 }
 
+__forceinline
+VOID
+KxAcquireDispatcherLock (
+    __inout PKSPIN_LOCK_QUEUE LockQueue,
+    __inout PKSPIN_LOCK SpinLock
+    )
+
+/*++
+
+Routine Description:
+
+    This function acquires the dispatcher database queued spin lock at the
+    current IRQL and records the acquisition in the dispatcher lock counters.
+
+    N.B. The counters are updated while the dispatcher lock is held.
+
+Arguments:
+
+    LockQueue - Supplies a pointer to the dispatcher lock queue.
+
+    SpinLock - Supplies a pointer to the dispatcher spin lock.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+#if !defined(NT_UP)
+
+    ULONG64 SpinCount;
+    PKSPIN_LOCK_QUEUE TailQueue;
+
+    //
+    // Insert the lock queue entry at the end of the lock queue and wait for
+    // ownership if the lock is owned. Record a contended acquisition in the
+    // spin histogram and capture the acquisition time.
+    //
+
+    SpinCount = 0;
+    TailQueue = InterlockedExchangePointer((PVOID *)SpinLock, LockQueue);
+    if (TailQueue != NULL) {
+        SpinCount = KxWaitForLockOwnerShip(LockQueue, TailQueue);
+    }
+
+    if (TailQueue != NULL) {
+        KeDispatcherLockCounters.SpinHistogram[KiComputeLockHistogramIndex(SpinCount >> 1)] += 1;
+    }
+
+    KiRecordDispatcherLockAcquire(TailQueue != NULL);
+
+#else
+
+    UNREFERENCED_PARAMETER(LockQueue);
+    UNREFERENCED_PARAMETER(SpinLock);
+
+#endif
+
+    return;
+}
+
 KIRQL
 KiAcquireDispatcherLockRaiseToSynch (
     VOID
@@ -848,7 +912,7 @@ Return Value:
     OldIrql = KfRaiseIrql(SYNCH_LEVEL);
     LockQueue = &KiGetLockQueue()[LockQueueDispatcherLock];
     SpinLock = LockQueue->Lock;
-    KxAcquireQueuedSpinLock(LockQueue, SpinLock);
+    KxAcquireDispatcherLock(LockQueue, SpinLock);
     return OldIrql;
 }
 
@@ -885,7 +949,7 @@ Return Value:
 
     LockQueue = &KiGetLockQueue()[LockQueueDispatcherLock];
     SpinLock = LockQueue->Lock;
-    KxAcquireQueuedSpinLock(LockQueue, SpinLock);
+    KxAcquireDispatcherLock(LockQueue, SpinLock);
     return;
 }
 
@@ -913,6 +977,16 @@ Return Value:
 
 {
 
+#if !defined(NT_UP)
+
+    //
+    // Record the lock hold time in the hold histogram.
+    //
+
+    KiRecordDispatcherLockRelease();
+
+#endif
+
     //
     // Release the dispatcher databsse queued spin lock at the current IRQL.
     //
@@ -965,6 +1039,12 @@ Return Value:
 
     }
 
+#if !defined(NT_UP)
+
+    KiRecordDispatcherLockAcquire(FALSE);
+
+#endif
+
     return TRUE;
 }
 
@@ -34,7 +34,9 @@ Routine Description:
     tick count, update the runtime of the current thread, update the runtime
     of the current thread's process, perform DPC moderation, and decrement
     the current thread quantum if a full tick has expired. This routine also
-    performs real time scheduling quantum end and next interval processing.
+    performs real time scheduling quantum end and next interval processing,
+    and requests a timer expiration scan if a timer in the timer table of
+    the current processor has expired.
  
     N.B. This routine is executed on all processors in a multiprocessor
          system.
@@ -53,8 +55,12 @@ Return Value:
 
 {
 
+    ULONG Hand;
+    ULONG Index;
+    ULARGE_INTEGER InterruptTime;
     PKPRCB Prcb;
     PKTHREAD Thread;
+    PKTIMER_TABLE TimerTable;
 
     //
     // If the clock tick should be skipped, then clear the skip flag and
@@ -84,6 +90,35 @@ Return Value:
         //
 
         Prcb->TickOffset += KeMaximumIncrement;
+
+        //
+        // If a timer in the timer table of the current processor has expired,
+        // then request a timer expiration scan on the current processor. The
+        // previous and the current hand values are checked since the clock
+        // interrupt of the current processor is not synchronized with the
+        // update of the tick count.
+        //
+        // N.B. On the processor that keeps the system time the check
+        //      duplicates the check in KeUpdateSystemTime and finds the
+        //      expiration already active.
+        //
+
+        if (Prcb->TimerRequest == 0) {
+            KiQueryInterruptTime((PLARGE_INTEGER)&InterruptTime);
+            TimerTable = Prcb->TimerTable;
+            Hand = (ULONG)KiQueryLowTickCount() - 1;
+            Index = Hand & (TIMER_TABLE_SIZE - 1);
+            if (TimerTable->TimerEntries[Index].Time.QuadPart > InterruptTime.QuadPart) {
+                Hand += 1;
+                Index = Hand & (TIMER_TABLE_SIZE - 1);
+            }
+
+            if (TimerTable->TimerEntries[Index].Time.QuadPart <= InterruptTime.QuadPart) {
+                Prcb->TimerHand = 0x100000000I64 + Hand;
+                KiRequestSoftwareInterrupt(DISPATCH_LEVEL);
+            }
+        }
+
         Thread = KeGetCurrentThread();
         if ((TrapFrame->SegCs & MODE_MASK) == 0) {
 
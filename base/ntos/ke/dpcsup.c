@@ -354,40 +354,74 @@ KiCheckTimerTable (
 
 {
 
+    PKTIMER_TABLE_ENTRY FarEntry;
     ULONG Index;
     PLIST_ENTRY ListHead;
     PLIST_ENTRY NextEntry;
     KIRQL OldIrql;
+    PKPRCB Prcb;
     PKTIMER Timer;
+    PKTIMER_TABLE TimerTable;
 
     //
-    // Raise IRQL to highest level and scan timer table for timers that
-    // have expired.
+    // Raise IRQL to highest level and scan the near and far lists of the
+    // timer table of the current processor for timers that have expired.
     //
 
     KeRaiseIrql(HIGH_LEVEL, &OldIrql);
+    Prcb = KeGetCurrentPrcb();
+    TimerTable = Prcb->TimerTable;
     Index = 0;
     do {
-        ListHead = &KiTimerTableListHead[Index].Entry;
+        FarEntry = &TimerTable->FarEntries[Index];
+        ListHead = &TimerTable->TimerEntries[Index].Entry;
+
+ScanList:
         NextEntry = ListHead->Flink;
         while (NextEntry != ListHead) {
             Timer = CONTAINING_RECORD(NextEntry, KTIMER, TimerListEntry);
             NextEntry = NextEntry->Flink;
+
+            //
+            // Every timer must be in a list of the entry selected by its
+            // hand value in the timer table of the processor on which it
+            // was set. The far due time must be a lower bound on the due
+            // time of each timer in the far list, and the entry due time
+            // must not be later than the cascade time of the far list.
+            //
+
+            if ((Timer->Header.Hand != Index) ||
+                (Timer->Header.Processor != Prcb->Number)) {
+                DbgBreakPoint();
+            }
+
+            if ((ListHead == &FarEntry->Entry) &&
+                ((Timer->DueTime.QuadPart < FarEntry->Time.QuadPart) ||
+                 (TimerTable->TimerEntries[Index].Time.QuadPart > KiComputeCascadeTime(TimerTable, Index)))) {
+
+                DbgBreakPoint();
+            }
+
             if (Timer->DueTime.QuadPart <= CurrentTime.QuadPart) {
 
                 //
-                // If the timer expiration DPC is queued, then the time has
-                // been change and the DPC has not yet had the chance to run
-                // and clear out the expired timers.
+                // If a timer expiration request is pending, then either the
+                // time has been changed or the timer has expired and the
+                // expiration scan has not yet had the chance to run and
+                // clear out the expired timers.
                 //
 
-                if ((KeGetCurrentPrcb()->TimerRequest == 0) &&
-                    *((volatile PKSPIN_LOCK *)(&KiTimerExpireDpc.DpcData)) == NULL) {
+                if (Prcb->TimerRequest == 0) {
                     DbgBreakPoint();
                 }
             }
         }
 
+        if (ListHead != &FarEntry->Entry) {
+            ListHead = &FarEntry->Entry;
+            goto ScanList;
+        }
+
         Index += 1;
     } while(Index < TIMER_TABLE_SIZE);
 
@@ -515,8 +549,9 @@ Routine Description:
     This function is called when the clock interupt routine discovers that
     a timer has expired.
 
-    N.B. This function executes on the same processor that receives clock
-         interrupts.
+    N.B. This function executes on the processor whose timer table is
+         scanned, which is the processor on which the expired timers were
+         set.
 
 Arguments:
 
@@ -537,6 +572,7 @@ Return Value:
 
 {
 
+    ULONG64 CascadeTime;
     ULARGE_INTEGER CurrentTime;
     ULONG DpcCount;
     PKDPC Dpc;
@@ -551,16 +587,12 @@ Return Value:
     KIRQL OldIrql;
     LONG Period;
 
-#if !defined(NT_UP) || defined(_WIN64)
-
     PKPRCB Prcb = KeGetCurrentPrcb();
-
-#endif
-
     ULARGE_INTEGER SystemTime;
     PKTIMER Timer;
     ULONG TimersExamined;
     ULONG TimersProcessed;
+    PKTIMER_TABLE TimerTable;
 
     UNREFERENCED_PARAMETER(TimerDpc);
     UNREFERENCED_PARAMETER(DeferredContext);
@@ -603,6 +635,7 @@ Return Value:
 
     Index -= 1;
     HandLimit &= (TIMER_TABLE_SIZE - 1);
+    TimerTable = Prcb->TimerTable;
 
     //
     // Acquire the dispatcher database lock and read the current interrupt
@@ -613,11 +646,25 @@ Return Value:
     TimersExamined = MAXIMUM_TIMERS_EXAMINED;
     TimersProcessed = MAXIMUM_TIMERS_PROCESSED;
     KiLockDispatcherDatabase(&OldIrql);
+    KeTimerExpirationCounters.ExpirationScans += 1;
     do {
         Index = (Index + 1) & (TIMER_TABLE_SIZE - 1);
-        ListHead = &KiTimerTableListHead[Index].Entry;
+
+        //
+        // If the far list of the current timer table entry contains timers
+        // that are due within one revolution, then cascade them into the
+        // near list before it is scanned.
+        //
+
+        if (KiComputeCascadeTime(TimerTable, Index) <= CurrentTime.QuadPart) {
+            LockQueue = KiAcquireTimerTableLock(Prcb->Number, Index);
+            KiCascadeTimerTable(TimerTable, Index, CurrentTime.QuadPart);
+            KiReleaseTimerTableLock(LockQueue);
+        }
+
+        ListHead = &TimerTable->TimerEntries[Index].Entry;
         while (ListHead != ListHead->Flink) {
-            LockQueue = KiAcquireTimerTableLock(Index);
+            LockQueue = KiAcquireTimerTableLock(Prcb->Number, Index);
             NextEntry = ListHead->Flink;
             Timer = CONTAINING_RECORD(NextEntry, KTIMER, TimerListEntry);
             TimersExamined -= 1;
@@ -631,6 +678,7 @@ Return Value:
                 //
 
                 TimersProcessed -= 1;
+                KeTimerExpirationCounters.TimersExpired += 1;
                 KiRemoveEntryTimer(Timer);
                 Timer->Header.Inserted = FALSE;
                 KiReleaseTimerTableLock(LockQueue);
@@ -751,7 +799,8 @@ Return Value:
 
                 //
                 // If the timer table list is not empty, then set the due time
-                // to the first entry in the respective timer table entry.
+                // to the earlier of the first entry in the respective timer
+                // table entry and the cascade time of the far list.
                 //
                 // N.B. On the x86 the write of the due time is not atomic.
                 //      Therefore, interrupts must be disabled to synchronize
@@ -763,17 +812,22 @@ Return Value:
 
                 if (NextEntry != ListHead) {
 
-                    ASSERT(KiTimerTableListHead[Index].Time.QuadPart <= Timer->DueTime.QuadPart);
+                    ASSERT(TimerTable->TimerEntries[Index].Time.QuadPart <= Timer->DueTime.QuadPart);
+
+                    CascadeTime = KiComputeCascadeTime(TimerTable, Index);
+                    if ((ULONG64)Timer->DueTime.QuadPart < CascadeTime) {
+                        CascadeTime = Timer->DueTime.QuadPart;
+                    }
 
 #if defined(_X86_)
 
                     _disable();
-                    KiTimerTableListHead[Index].Time.QuadPart = Timer->DueTime.QuadPart;
+                    TimerTable->TimerEntries[Index].Time.QuadPart = CascadeTime;
                     _enable();
 
 #else
 
-                    KiTimerTableListHead[Index].Time.QuadPart = Timer->DueTime.QuadPart;
+                    TimerTable->TimerEntries[Index].Time.QuadPart = CascadeTime;
 
 #endif
 
@@ -194,6 +194,7 @@ Return Value:
 
 {
 
+    PKOBJECT_LOCK_ENTRY LockEntry;
     KIRQL OldIrql;
     LONG OldState;
     PRKTHREAD Thread;
@@ -202,10 +203,12 @@ Return Value:
     ASSERT(KeGetCurrentIrql() <= DISPATCH_LEVEL);
 
     //
-    // Raise IRQL to dispatcher level and lock dispatcher database.
+    // Raise IRQL to dispatcher level, lock dispatcher database, and lock
+    // the event object.
     //
 
     KiLockDispatcherDatabase(&OldIrql);
+    LockEntry = KiAcquireObjectLock(Event);
 
     //
     // If the current state of the event object is Not-Signaled and
@@ -223,6 +226,7 @@ Return Value:
     }
 
     Event->Header.SignalState = 0;
+    KiReleaseObjectLock(LockEntry);
 
     //
     // If the value of the Wait argument is TRUE, then return to the
@@ -304,6 +308,7 @@ Return Value:
 
 {
 
+    PKOBJECT_LOCK_ENTRY LockEntry;
     KIRQL OldIrql;
     LONG OldState;
 
@@ -311,10 +316,30 @@ Return Value:
     ASSERT(KeGetCurrentIrql() <= DISPATCH_LEVEL);
 
     //
-    // Raise IRQL to dispatcher level and lock dispatcher database.
+    // Raise IRQL to SYNCH level and lock the event object.
+    //
+    // If the wait list is empty, then no wait can observe the signal state
+    // and the event is reset without locking the dispatcher database.
     //
 
-    KiLockDispatcherDatabase(&OldIrql);
+    OldIrql = KeRaiseIrqlToSynchLevel();
+    LockEntry = KiAcquireObjectLock(Event);
+    if (IsListEmpty(&Event->Header.WaitListHead) != FALSE) {
+        OldState = ReadForWriteAccess(&Event->Header.SignalState);
+        Event->Header.SignalState = 0;
+        LockEntry->Bypasses += 1;
+        KiReleaseObjectLock(LockEntry);
+        KeLowerIrql(OldIrql);
+        return OldState;
+    }
+
+    //
+    // Lock the dispatcher database and relock the event object.
+    //
+
+    KiReleaseObjectLock(LockEntry);
+    KiLockDispatcherDatabaseAtSynchLevel();
+    LockEntry = KiAcquireObjectLock(Event);
 
     //
     // Capture the current signal state of event object and then reset
@@ -325,9 +350,10 @@ Return Value:
     Event->Header.SignalState = 0;
 
     //
-    // Unlock the dispatcher database and lower IRQL to its previous
-    // value.
+    // Unlock the event object and the dispatcher database and lower IRQL to
+    // its previous value.
 
+    KiReleaseObjectLock(LockEntry);
     KiUnlockDispatcherDatabase(OldIrql);
 
     //
@@ -371,6 +397,7 @@ Return Value:
 
 {
 
+    PKOBJECT_LOCK_ENTRY LockEntry;
     KIRQL OldIrql;
     LONG OldState;
     PRKTHREAD Thread;
@@ -392,10 +419,34 @@ Return Value:
     }
 
     //
-    // Raise IRQL to dispatcher level and lock dispatcher database.
+    // If wait is false, then raise IRQL to SYNCH level and lock the event
+    // object. If the wait list is empty, then there is no wait to satisfy
+    // and the event is set without locking the dispatcher database.
+    //
+    // Otherwise, raise IRQL to dispatcher level, lock the dispatcher
+    // database, and lock the event object.
     //
 
-    KiLockDispatcherDatabase(&OldIrql);
+    if (Wait == FALSE) {
+        OldIrql = KeRaiseIrqlToSynchLevel();
+        LockEntry = KiAcquireObjectLock(Event);
+        if (IsListEmpty(&Event->Header.WaitListHead) != FALSE) {
+            OldState = ReadForWriteAccess(&Event->Header.SignalState);
+            Event->Header.SignalState = 1;
+            LockEntry->Bypasses += 1;
+            KiReleaseObjectLock(LockEntry);
+            KeLowerIrql(OldIrql);
+            return OldState;
+        }
+
+        KiReleaseObjectLock(LockEntry);
+        KiLockDispatcherDatabaseAtSynchLevel();
+
+    } else {
+        KiLockDispatcherDatabase(&OldIrql);
+    }
+
+    LockEntry = KiAcquireObjectLock(Event);
 
     //
     // Capture the old state and set the new state to signaled.
@@ -420,6 +471,8 @@ Return Value:
         }
     }
 
+    KiReleaseObjectLock(LockEntry);
+
     //
     // If the value of the Wait argument is TRUE, then return to the
     // caller with IRQL raised and the dispatcher database locked. Else
@@ -478,6 +531,7 @@ Return Value:
 {
 
     PKTHREAD CurrentThread;
+    PKOBJECT_LOCK_ENTRY LockEntry;
     KIRQL OldIrql;
     PKWAIT_BLOCK WaitBlock;
     PRKTHREAD WaitThread;
@@ -486,11 +540,13 @@ Return Value:
     ASSERT(KeGetCurrentIrql() <= DISPATCH_LEVEL);
 
     //
-    // Raise IRQL to dispatcher level and lock dispatcher database.
+    // Raise IRQL to dispatcher level, lock dispatcher database, and lock
+    // the event object.
     //
 
     CurrentThread = KeGetCurrentThread();
     KiLockDispatcherDatabase(&OldIrql);
+    LockEntry = KiAcquireObjectLock(Event);
 
     //
     // If the the wait list is not empty, then satisfy the wait of the
@@ -566,10 +622,11 @@ Return Value:
     }
 
     //
-    // Unlock dispatcher database lock and lower IRQL to its previous
-    // value.
+    // Unlock the event object and the dispatcher database lock and lower
+    // IRQL to its previous value.
     //
 
+    KiReleaseObjectLock(LockEntry);
     KiUnlockDispatcherDatabase(OldIrql);
     return;
 }
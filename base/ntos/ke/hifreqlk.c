@@ -72,6 +72,7 @@ ALIGNED_SPINLOCK KiProcessListLock = 0;
 ALIGNED_SPINLOCK KiProfileLock = 0;
 ALIGNED_SPINLOCK KiReverseStallIpiLock = 0;
 ALIGNED_SPINLOCK_STRUCT KiTimerTableLock[LOCK_QUEUE_TIMER_TABLE_LOCKS] = {0};
+KOBJECT_LOCK_ENTRY KeObjectLockTable[OBJECT_LOCK_TABLE_SIZE] = {0};
 
 #if defined(_AMD64_)
 
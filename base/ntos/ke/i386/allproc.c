@@ -393,6 +393,15 @@ Return value:
 
 #endif
 
+    //
+    // Use the space allocated for the timer table of the new processor and
+    // initialize the timer table.
+    //
+
+    NewPrcb->TimerTable = (PKTIMER_TABLE)Base;
+    KiInitializeTimerTable(NewPrcb->TimerTable);
+    Base += ROUNDUP16(sizeof(KTIMER_TABLE));
+
     ASSERT(((PUCHAR)PerProcessorAllocation + GdtOffset) == Base);
 
     //
@@ -515,6 +524,7 @@ Return Value:
     //   NMI TSS
     //   Double Fault TSS
     //   Double Fault Stack
+    //   Timer table
     //   GDT
     //   IDT
     //
@@ -539,6 +549,12 @@ Return Value:
 
 #endif
 
+    //
+    // Add the size of the timer table of the new processor.
+    //
+
+    ProcessorDataSize += ROUNDUP16(sizeof(KTIMER_TABLE));
+
     //
     // Add sizeof GDT
     //
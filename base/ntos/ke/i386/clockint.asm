@@ -41,7 +41,6 @@ include mac386.inc
         extrn   _KiIdealDpcRate:DWORD
         extrn   _KiMaximumDpcQueueDepth:DWORD
         extrn   _KiTickOffset:DWORD
-        extrn   _KiTimerTableListHead:DWORD
         extrn   _KiProfileListHead:DWORD
         extrn   _KiProfileLock:DWORD
         extrn   _KiProfileInterval:DWORD
@@ -189,7 +188,8 @@ endif
         mov     USERDATA[UsTickCount]+4, edx ; store USD high 1 tick count
 
 ;
-; Check to determine if a timer has expired.
+; Check to determine if a timer in the timer table of the current processor
+; has expired.
 ; (edi:esi) = KiInterruptTime
 ; (eax) = KeTickCount.LowPart
 ; (ebx) = KeTickCount.LowPart
@@ -199,10 +199,11 @@ endif
 
         and     eax,TIMER_TABLE_SIZE-1  ; isolate current hand value
         shl     eax, 4                  ; compute timer entry offset
-        cmp     esi,[eax]+_KiTimerTableListHead+TtTime+4 ; compare high due time 
+        add     eax,PCR[PcPrcbData+PbTimerTable] ; compute timer entry address
+        cmp     esi,[eax]+TtTime+4      ; compare high due time 
         jb      short kust5             ; if below, timer has not expired
         ja      short kust15            ; if above, timer has expired
-        cmp     edi,[eax]+_KiTimerTableListHead+TtTime ; compare low due time
+        cmp     edi,[eax]+TtTime        ; compare low due time
         jae     short kust15            ; if above or equal, timer has expired
 kust5:  inc     ebx                     ; advance hand value to next entry
         mov     eax, ebx                ;
@@ -216,10 +217,11 @@ kust5:  inc     ebx                     ; advance hand value to next entry
 
 kust10: and     eax,TIMER_TABLE_SIZE-1  ; isolate current hand value
         shl     eax, 4                  ; compute timer entry offset
-        cmp     esi,[eax]+_KiTimerTableListHead+TtTime+4 ; compare high due time 
+        add     eax,PCR[PcPrcbData+PbTimerTable] ; compute timer entry address
+        cmp     esi,[eax]+TtTime+4      ; compare high due time 
         jb      kustxx                  ; if below, timer has not expired
         ja      short kust15            ; if above, timer has expired
-        cmp     edi,[eax]+_KiTimerTableListHead+TtTime ; compare low due time
+        cmp     edi,[eax]+TtTime        ; compare low due time
         jb      kustxx                  ; if below, timer has not expired
 kust15:                                 ;
 
@@ -301,6 +303,9 @@ stdENDP _KeUpdateSystemTime
 ;    It increments InterruptCount so that clock ticks get counted as
 ;    interrupts.
 ;
+;    It checks the timer table of the current processor for expired timers
+;    and requests a timer expiration scan on the current processor.
+;
 ; Arguments:
 ;
 ;    esp+4 constant PreviousIrql
@@ -323,7 +328,56 @@ if DBG
 endif
         push    ebx                     ; we will destroy ebx
         inc     dword ptr [eax]+PcPrcbData+PbInterruptCount
-        mov     ebx, [eax]+PcPrcbData+PbCurrentThread ; (ebx)->current thread
+
+;
+; Check to determine if a timer in the timer table of the current processor
+; has expired. The previous and the current hand values are checked since
+; the clock interrupt of the current processor is not synchronized with the
+; update of the tick count.
+;
+; N.B. On the processor that keeps the system time the check duplicates the
+;      check in KeUpdateSystemTime and finds the expiration already active.
+;
+; (eax) = address of PCR
+;
+
+        cmp     dword ptr [eax]+PcPrcbData+PbTimerRequest, 0 ; check if expiration active
+        jne     Kutp14                  ; if ne, expiration already active
+        push    esi                     ; save nonvolatile registers
+        push    edi                     ;
+Kutp10: mov     esi,USERDATA[UsInterruptTime]+4 ; get high 1 interrupt time
+        mov     edi,USERDATA[UsInterruptTime]+0 ; get low interrupt time
+        cmp     esi,USERDATA[UsInterruptTime]+8 ; compare high 2 interrupt time
+        jne     short Kutp10            ; if ne, interrupt time changing
+        mov     ebx,_KeTickCount+0      ; get low tick count
+        dec     ebx                     ; compute previous hand value
+        mov     ecx,ebx                 ; copy hand value
+        and     ecx,TIMER_TABLE_SIZE-1  ; isolate hand value
+        shl     ecx, 4                  ; compute timer entry offset
+        add     ecx,[eax]+PcPrcbData+PbTimerTable ; compute timer entry address
+        cmp     esi,[ecx]+TtTime+4      ; compare high due time
+        jb      short Kutp11            ; if below, timer has not expired
+        ja      short Kutp12            ; if above, timer has expired
+        cmp     edi,[ecx]+TtTime        ; compare low due time
+        jae     short Kutp12            ; if above or equal, timer has expired
+Kutp11: inc     ebx                     ; advance hand value to next entry
+        mov     ecx,ebx                 ; copy hand value
+        and     ecx,TIMER_TABLE_SIZE-1  ; isolate hand value
+        shl     ecx, 4                  ; compute timer entry offset
+        add     ecx,[eax]+PcPrcbData+PbTimerTable ; compute timer entry address
+        cmp     esi,[ecx]+TtTime+4      ; compare high due time
+        jb      short Kutp13            ; if below, timer has not expired
+        ja      short Kutp12            ; if above, timer has expired
+        cmp     edi,[ecx]+TtTime        ; compare low due time
+        jb      short Kutp13            ; if below, timer has not expired
+Kutp12: mov     [eax]+PcPrcbData+PbTimerRequest, esp ; set timer request
+        mov     [eax]+PcPrcbData+PbTimerHand, ebx ; set timer hand value
+        mov     ecx, DISPATCH_LEVEL     ; request dispatch interrupt
+        fstCall HalRequestSoftwareInterrupt ;
+        mov     eax, PCR[PcSelfPcr]     ; restore PCR address
+Kutp13: pop     edi                     ; restore nonvolatile registers
+        pop     esi                     ;
+Kutp14: mov     ebx, [eax]+PcPrcbData+PbCurrentThread ; (ebx)->current thread
         mov     ecx, ThApcState+AsProcess[ebx]
                                         ; (ecx)->current thread's process
 
@@ -0,0 +1,184 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+You may only use this code if you agree to the terms of the Windows Research Kernel Source Code License agreement (see License.txt).
+If you do not agree to the terms, do not use the code.
+
+
+Module Name:
+
+    displock.c
+
+Abstract:
+
+    This module implements the platform specific functions for acquiring
+    and releasing the dispatcher database lock.
+
+    The queued spin lock itself is implemented by the HAL on this platform.
+    These functions wrap the HAL queued spin lock functions so that the
+    dispatcher lock counters are maintained as they are on other platforms.
+
+    N.B. The HAL owns the spin loop, so contended acquisitions are counted
+         but the spin histogram is not maintained on this platform.
+
+--*/
+
+#include "ki.h"
+
+#if !defined(NT_UP)
+
+KIRQL
+KiAcquireDispatcherLockRaiseToSynch (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This function raises IRQL to SYNCH_LEVEL and acquires the dispatcher
+    database queued spin lock.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    The previous IRQL is returned as the function value.
+
+--*/
+
+{
+
+    KIRQL OldIrql;
+
+    //
+    // Try to acquire the dispatcher lock without waiting so a contended
+    // acquisition can be counted, then wait for the lock if necessary.
+    //
+
+    if (KeTryToAcquireQueuedSpinLockRaiseToSynch(LockQueueDispatcherLock,
+                                                 &OldIrql) != FALSE) {
+
+        KiRecordDispatcherLockAcquire(FALSE);
+
+    } else {
+        OldIrql = KeAcquireQueuedSpinLockRaiseToSynch(LockQueueDispatcherLock);
+        KiRecordDispatcherLockAcquire(TRUE);
+    }
+
+    return OldIrql;
+}
+
+VOID
+KiAcquireDispatcherLockAtSynchLevel (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This function acquires the dispatcher database queued spin lock at the
+    current IRQL.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PKSPIN_LOCK_QUEUE LockQueue;
+
+    LockQueue = &KeGetCurrentPrcb()->LockQueue[LockQueueDispatcherLock];
+    if (KeTryToAcquireQueuedSpinLockAtRaisedIrql(LockQueue) != FALSE) {
+        KiRecordDispatcherLockAcquire(FALSE);
+
+    } else {
+        KeAcquireQueuedSpinLockAtDpcLevel(LockQueue);
+        KiRecordDispatcherLockAcquire(TRUE);
+    }
+
+    return;
+}
+
+VOID
+KiReleaseDispatcherLockFromSynchLevel (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This function releases the dispatcher database queued spin lock at the
+    current IRQL.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    //
+    // Record the lock hold time in the hold histogram.
+    //
+
+    KiRecordDispatcherLockRelease();
+    KeReleaseQueuedSpinLockFromDpcLevel(&KeGetCurrentPrcb()->LockQueue[LockQueueDispatcherLock]);
+    return;
+}
+
+LOGICAL
+KiTryToAcquireDispatcherLockRaiseToSynch (
+    __out PKIRQL OldIrql
+    )
+
+/*++
+
+Routine Description:
+
+    This function raises IRQL to SYNCH_LEVEL and attempts to acquire the
+    dispatcher database spin lock. If the dispatcher database lock is
+    already owned, then IRQL is restored to its previous value and FALSE
+    is returned. Otherwise, the dispatcher database lock is acquired and
+    TRUE is returned.
+
+Arguments:
+
+    OldIrql - Supplies a pointer to the variable to receive the old IRQL.
+
+Return Value:
+
+    If the dispatcher database lock is acquired a value TRUE is returned.
+    Otherwise, FALSE is returned as the function value.
+
+--*/
+
+{
+
+    if (KeTryToAcquireQueuedSpinLockRaiseToSynch(LockQueueDispatcherLock,
+                                                 OldIrql) == FALSE) {
+
+        return FALSE;
+    }
+
+    KiRecordDispatcherLockAcquire(FALSE);
+    return TRUE;
+}
+
+#endif
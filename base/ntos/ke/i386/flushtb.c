@@ -95,6 +95,7 @@ Return Value:
 
     Prcb = KeGetCurrentPrcb();
     TargetProcessors = KeActiveProcessors & ~Prcb->SetMember;
+    KiRecordTbFlush(Prcb, EntireFlushes);
 
     //
     // Send packet to target processors.
@@ -108,6 +109,7 @@ Return Value:
                         NULL);
 
         IPI_INSTRUMENT_COUNT (Prcb->Number, FlushEntireTb);
+        KiRecordTbFlush(Prcb, IpiRequests);
     }
 
 #endif
@@ -228,6 +230,7 @@ Return Value:
     Process = Prcb->CurrentThread->ApcState.Process;
     TargetProcessors = Process->ActiveProcessors;
     TargetProcessors &= ~Prcb->SetMember;
+    KiRecordTbFlush(Prcb, ProcessFlushes);
 
     //
     // Send packet to target processors.
@@ -241,6 +244,7 @@ Return Value:
                         NULL);
 
         IPI_INSTRUMENT_COUNT (Prcb->Number, FlushEntireTb);
+        KiRecordTbFlush(Prcb, IpiRequests);
     }
 
     //
@@ -368,6 +372,8 @@ Return Value:
     }
 
     TargetProcessors &= ~Prcb->SetMember;
+    KiRecordTbFlush(Prcb, MultipleFlushes);
+    KiTbFlushCounters[Prcb->Number].MultipleFlushEntries += Number;
 
     //
     // If any target processors are specified, then send a flush multiple
@@ -382,6 +388,7 @@ Return Value:
                         (PVOID)Virtual);
 
         IPI_INSTRUMENT_COUNT (Prcb->Number, FlushMultipleTb);
+        KiRecordTbFlush(Prcb, IpiRequests);
     }
 
     //
@@ -519,6 +526,7 @@ Return Value:
     }
 
     TargetProcessors &= ~Prcb->SetMember;
+    KiRecordTbFlush(Prcb, SingleFlushes);
 
     //
     // If any target processors are specified, then send a flush single
@@ -533,6 +541,7 @@ Return Value:
                         NULL);
 
         IPI_INSTRUMENT_COUNT(Prcb->Number, FlushSingleTb);
+        KiRecordTbFlush(Prcb, IpiRequests);
     }
 
     //
@@ -57,11 +57,9 @@ Return Value:
 
 {
 
-    LONG Index;
-    LONG Limit;
-    LONG Number;
     PKTHREAD NewThread;
     ULONG Processor;
+    KAFFINITY Scanned;
     PKPRCB TargetPrcb;
 
     ASSERT (CurrentPrcb == KeGetCurrentPrcb());
@@ -119,6 +117,7 @@ Return Value:
         NewThread = KiSelectReadyThread(0, CurrentPrcb);            // ȡһ߳
         if (NewThread != NULL) 
         {
+            KiRecordLocalReadyThread(CurrentPrcb);
             CurrentPrcb->NextThread = NULL;
             CurrentPrcb->CurrentThread = NewThread;
             NewThread->State = Running;
@@ -131,118 +130,102 @@ Return Value:
             // Release the current PRCB lock and attempt to select a thread
             // from any processor dispatcher ready queues.
             //
-            // If this is a multinode system, then start with the processors
-            // on the same node. Otherwise, start with the current processor.
+            // Processors are searched in order of locality: the other logical
+            // processors of the current physical processor, then the processors
+            // on the same node, then all other processors. Within each set the
+            // processor with the highest priority ready thread is searched
+            // first.
             //
 
             KiReleasePrcbLock(CurrentPrcb);
             Processor = CurrentPrcb->Number;
-            Index = Processor;
-            if (KeNumberNodes > 1)
-            {
-                KeFindFirstSetLeftAffinity(CurrentPrcb->ParentNode->ProcessorMask,
-                                           (PULONG)&Index);
-            }
-        
-            Limit = KeNumberProcessors - 1;
-            Number = Limit;
-            do 
+            Scanned = CurrentPrcb->SetMember;
+            while ((TargetPrcb = KiFindStealTarget(CurrentPrcb, &Scanned)) != NULL) 
             {                                                                                       // Ҫϵ
-                TargetPrcb = KiProcessorBlock[Index];
-                if (CurrentPrcb != TargetPrcb) 
+                if (TargetPrcb->ReadySummary != 0) 
                 {
-                    if (TargetPrcb->ReadySummary != 0) 
-                    {
 
-                        //
-                        // Acquire the current and target PRCB locks.
-                        //
+                    //
+                    // Acquire the current and target PRCB locks.
+                    //
 
-                        KiAcquireTwoPrcbLocks(CurrentPrcb, TargetPrcb);
+                    KiAcquireTwoPrcbLocks(CurrentPrcb, TargetPrcb);
 
-                        //
-                        // If a new thread has not been selected to run on
-                        // the current processor, then attempt to select a
-                        // thread to run on the current processor.
-                        //
+                    //
+                    // If a new thread has not been selected to run on
+                    // the current processor, then attempt to select a
+                    // thread to run on the current processor.
+                    //
 
-                        if ((NewThread = CurrentPrcb->NextThread) == NULL) 
+                    if ((NewThread = CurrentPrcb->NextThread) == NULL) 
+                    {
+                        if ((TargetPrcb->ReadySummary != 0) &&
+                            (NewThread = KiFindReadyThread(Processor,
+                                                           TargetPrcb)) != NULL) 
                         {
-                            if ((TargetPrcb->ReadySummary != 0) &&
-                                (NewThread = KiFindReadyThread(Processor,
-                                                               TargetPrcb)) != NULL) 
-                            {
     
-                                //
-                                // A new thread has been found to run on the
-                                // current processor.
-                                //
+                            //
+                            // A new thread has been found to run on the
+                            // current processor.
+                            //
     
-                                NewThread->State = Running;
-                                KiReleasePrcbLock(TargetPrcb);
-                                CurrentPrcb->NextThread = NULL;
-                                CurrentPrcb->CurrentThread = NewThread;
-
-                                //
-                                // Clear idle on the current processor
-                                // and update the idle SMT summary set to
-                                // indicate the set is not idle.
-                                //
-
-                                KiClearIdleSummary(AFFINITY_MASK(Processor));
-                                KiClearSMTSummary(CurrentPrcb->MultiThreadProcessorSet);
-                                goto ThreadFound;
-
-                            } else {
-                                KiReleasePrcbLock(CurrentPrcb);
-                                KiReleasePrcbLock(TargetPrcb);
-                            }
+                            NewThread->State = Running;
+                            KiReleasePrcbLock(TargetPrcb);
+                            CurrentPrcb->NextThread = NULL;
+                            CurrentPrcb->CurrentThread = NewThread;
 
-                        } 
-                        else
-                        {
-                            // һѾѡ񵽸ִ
                             //
-                            // A thread has already been selected to run on
-                            // the current processor. It is possible that
-                            // the thread is the idle thread due to a state
-                            // change that made a scheduled runable thread
-                            // unrunable.
-                            //
-                            // N.B. If the idle thread is selected, then the
-                            //      current processor is idle. Otherwise,
-                            //      the current processor is not idle.
+                            // Clear idle on the current processor
+                            // and update the idle SMT summary set to
+                            // indicate the set is not idle.
                             //
 
-                            if (NewThread == CurrentPrcb->IdleThread)
-                            {
-                                CurrentPrcb->NextThread = NULL;
-                                CurrentPrcb->IdleSchedule = FALSE;
-                                KiReleasePrcbLock(CurrentPrcb);
-                                KiReleasePrcbLock(TargetPrcb);
-                                continue;
-
-                            } 
-                            else 
-                            {
-                                NewThread->State = Running;
-                                KiReleasePrcbLock(TargetPrcb);
-                                CurrentPrcb->NextThread = NULL;
-                                CurrentPrcb->CurrentThread = NewThread;
-                                goto ThreadFound;
-                            }
+                            KiClearIdleSummary(AFFINITY_MASK(Processor));
+                            KiClearSMTSummary(CurrentPrcb->MultiThreadProcessorSet);
+                            KiRecordStealThread(CurrentPrcb, TargetPrcb);
+                            goto ThreadFound;
+
+                        } else {
+                            KiReleasePrcbLock(CurrentPrcb);
+                            KiReleasePrcbLock(TargetPrcb);
+                        }
+
+                    } 
+                    else
+                    {
+                        // һѾѡ񵽸ִ
+                        //
+                        // A thread has already been selected to run on
+                        // the current processor. It is possible that
+                        // the thread is the idle thread due to a state
+                        // change that made a scheduled runable thread
+                        // unrunable.
+                        //
+                        // N.B. If the idle thread is selected, then the
+                        //      current processor is idle. Otherwise,
+                        //      the current processor is not idle.
+                        //
+
+                        if (NewThread == CurrentPrcb->IdleThread)
+                        {
+                            CurrentPrcb->NextThread = NULL;
+                            CurrentPrcb->IdleSchedule = FALSE;
+                            KiReleasePrcbLock(CurrentPrcb);
+                            KiReleasePrcbLock(TargetPrcb);
+                            continue;
+
+                        } 
+                        else 
+                        {
+                            NewThread->State = Running;
+                            KiReleasePrcbLock(TargetPrcb);
+                            CurrentPrcb->NextThread = NULL;
+                            CurrentPrcb->CurrentThread = NewThread;
+                            goto ThreadFound;
                         }
                     }
                 }
-        
-                Index -= 1;
-                if (Index < 0) 
-                {
-                    Index = Limit;
-                }
-        
-                Number -= 1;
-            } while (Number >= 0);
+            }
         }
     }
 
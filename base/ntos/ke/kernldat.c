@@ -20,11 +20,14 @@ Abstract:
 #include "ki.h"
 
 //
-// KiTimerTableListHead - This is an array of tiemr table entries that anchor
-//      the individual timer lists.
+// KiInitialTimerTable - This is the timer table of processor zero. The near
+//      and far lists of each entry anchor the timers set on processor zero
+//      and are guarded by the lock of the respective timer table entry. The
+//      timer tables of the other processors are allocated with their
+//      processor blocks.
 //
 
-DECLSPEC_CACHEALIGN KTIMER_TABLE_ENTRY KiTimerTableListHead[TIMER_TABLE_SIZE];
+DECLSPEC_CACHEALIGN KTIMER_TABLE KiInitialTimerTable;
 
 //
 // KiQueuedLockTableSize - This is the size of the PRCB based numbered queued
@@ -203,6 +206,50 @@ DECLSPEC_CACHEALIGN KSERVICE_TABLE_DESCRIPTOR KeServiceDescriptorTableShadow[NUM
 
 KTHREAD_SWITCH_COUNTERS KeThreadSwitchCounters;
 
+//
+// KeTimerExpirationCounters - These counters record the number of timer
+//      expiration scans requested by the clock interrupt, the number of
+//      timers expired by the scans, and the number of timers whose due
+//      time was delayed to a coalescing boundary.
+//
+
+KTIMER_EXPIRATION_COUNTERS KeTimerExpirationCounters;
+
+//
+// KeDispatcherLockCounters - These counters record the number of times the
+//      dispatcher database lock is acquired and contended, and histograms
+//      of the contended spin counts and the lock hold times.
+//
+
+KDISPATCHER_LOCK_COUNTERS KeDispatcherLockCounters;
+
+//
+// KiStealCounters - These per-processor counters record the number of
+//      threads selected from the current processor ready queues and the
+//      number of threads taken from the ready queues of a logical processor
+//      of the same physical processor, of a processor on the same node, and
+//      of a processor on another node.
+//
+
+#if !defined(NT_UP)
+
+KSCHEDULER_STEAL_COUNTERS KiStealCounters[MAXIMUM_PROCESSORS];
+
+#endif
+
+//
+// KiTbFlushCounters - These per-processor counters record the number of
+//      entire, process, multiple and single entry TB flushes requested, the
+//      number of entries flushed by multiple entry requests, and the number
+//      of flush requests which had to be sent to other processors.
+//
+
+#if !defined(NT_UP)
+
+KTB_FLUSH_COUNTERS KiTbFlushCounters[MAXIMUM_PROCESSORS];
+
+#endif
+
 //
 // KeTimeIncrement - This is the nominal number of 100ns units that are to
 //      be added to the system time at each interval timer interupt. This
@@ -484,13 +531,6 @@ ULONG KiProfileInterval = DEFAULT_PROFILE_INTERVAL;
 
 LIST_ENTRY KiProfileListHead;
 
-//
-// KiTimerExpireDpc - This is the Deferred Procedure Call (DPC) object that
-//      is used to process the timer queue when a timer has expired.
-//
-
-KDPC KiTimerExpireDpc;
-
 //
 // KiEnableTimerWatchdog at one point controlled a HAL clock interrupt
 // watchdog that is now obsolete.  This symbol was present in Server 2003,
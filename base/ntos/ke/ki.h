@@ -987,6 +987,7 @@ extern ALIGNED_SPINLOCK_STRUCT KiTimerTableLock[LOCK_QUEUE_TIMER_TABLE_LOCKS];
 FORCEINLINE
 PKSPIN_LOCK_QUEUE
 KiAcquireTimerTableLock (
+    __in ULONG Processor,
     __in ULONG Hand
     )
 
@@ -999,8 +1000,16 @@ Routine Description:
     N.B. This routine must be called from an IRQL greater than or equal to
          dispatch level.
 
+    N.B. The timer table locks are shared by the timer tables of all
+         processors. The processor number skews the lock selection so
+         timers that are due at the same time on different processors
+         are protected by different locks.
+
 Arguments:
 
+    Processor - Supplies the number of the processor that owns the timer
+        table.
+
     Hand - Supplies the timer table hand value.
 
 Return Value:
@@ -1015,6 +1024,7 @@ Return Value:
 
     ASSERT(KeGetCurrentIrql() >= DISPATCH_LEVEL);
 
+    UNREFERENCED_PARAMETER(Processor);
     UNREFERENCED_PARAMETER(Hand);
 
     return NULL;
@@ -1026,7 +1036,7 @@ Return Value:
 
     ASSERT(KeGetCurrentIrql() >= DISPATCH_LEVEL);
 
-    Number = (Hand >> LOCK_QUEUE_TIMER_LOCK_SHIFT) & (LOCK_QUEUE_TIMER_TABLE_LOCKS - 1);
+    Number = ((Hand >> LOCK_QUEUE_TIMER_LOCK_SHIFT) + Processor) & (LOCK_QUEUE_TIMER_TABLE_LOCKS - 1);
     Number += LockQueueTimerTableLock;
     LockQueue = KeQueuedSpinLockContext(Number);
     KeAcquireQueuedSpinLockAtDpcLevel(LockQueue);
@@ -1079,6 +1089,197 @@ Return Value:
     return;
 }
 
+FORCEINLINE
+ULONG
+KiObjectLockIndex (
+    __in PVOID Object
+    )
+
+/*++
+
+Routine Description:
+
+    This function computes the object lock table index of a dispatcher
+    object.
+
+Arguments:
+
+    Object - Supplies a pointer to a dispatcher object.
+
+Return Value:
+
+    The object lock table index of the dispatcher object.
+
+--*/
+
+{
+
+    ULONG_PTR Address = (ULONG_PTR)Object;
+
+    return (ULONG)((Address >> 4) ^ (Address >> 9)) & (OBJECT_LOCK_TABLE_SIZE - 1);
+}
+
+FORCEINLINE
+PKOBJECT_LOCK_ENTRY
+KiAcquireObjectLock (
+    __in PVOID Object
+    )
+
+/*++
+
+Routine Description:
+
+    This function acquires the object lock of a dispatcher object.
+
+    N.B. This function must be called at SYNCH_LEVEL. If the dispatcher
+         database lock is also required, then it must be acquired first.
+
+Arguments:
+
+    Object - Supplies a pointer to a dispatcher object.
+
+Return Value:
+
+    The address of the object lock table entry.
+
+--*/
+
+{
+
+    PKOBJECT_LOCK_ENTRY LockEntry;
+
+    ASSERT(KeGetCurrentIrql() >= DISPATCH_LEVEL);
+
+    LockEntry = &KeObjectLockTable[KiObjectLockIndex(Object)];
+    KiAcquireSpinLock(&LockEntry->Lock);
+    return LockEntry;
+}
+
+FORCEINLINE
+VOID
+KiReleaseObjectLock (
+    __in PKOBJECT_LOCK_ENTRY LockEntry
+    )
+
+/*++
+
+Routine Description:
+
+    This function releases an object lock.
+
+Arguments:
+
+    LockEntry - Supplies the address of the object lock table entry.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ASSERT(KeGetCurrentIrql() >= DISPATCH_LEVEL);
+
+    KiReleaseSpinLock(&LockEntry->Lock);
+    return;
+}
+
+FORCEINLINE
+ULONG
+KiAcquireObjectLocks (
+    __in ULONG Count,
+    __in_ecount(Count) PVOID Object[]
+    )
+
+/*++
+
+Routine Description:
+
+    This function acquires the object locks of a set of dispatcher objects
+    in ascending table index order. Objects that hash to the same lock
+    share a single acquisition.
+
+    N.B. This function must be called with the dispatcher database locked.
+
+Arguments:
+
+    Count - Supplies the number of dispatcher objects.
+
+    Object - Supplies an array of pointers to dispatcher objects.
+
+Return Value:
+
+    A mask of the object lock table indices that were acquired.
+
+--*/
+
+{
+
+    ULONG Index;
+    ULONG LockMask;
+    ULONG Locks;
+
+    C_ASSERT(OBJECT_LOCK_TABLE_SIZE <= (sizeof(ULONG) * 8));
+
+    ASSERT(KeGetCurrentIrql() >= DISPATCH_LEVEL);
+
+    LockMask = 0;
+    Index = 0;
+    do {
+        LockMask |= 1 << KiObjectLockIndex(Object[Index]);
+        Index += 1;
+    } while (Index < Count);
+
+    Locks = LockMask;
+    do {
+        BitScanForward(&Index, Locks);
+        KiAcquireSpinLock(&KeObjectLockTable[Index].Lock);
+        Locks &= Locks - 1;
+    } while (Locks != 0);
+
+    return LockMask;
+}
+
+FORCEINLINE
+VOID
+KiReleaseObjectLocks (
+    __in ULONG LockMask
+    )
+
+/*++
+
+Routine Description:
+
+    This function releases the object locks acquired by
+    KiAcquireObjectLocks.
+
+Arguments:
+
+    LockMask - Supplies the mask of object lock table indices to release.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+
+    ASSERT(KeGetCurrentIrql() >= DISPATCH_LEVEL);
+    ASSERT(LockMask != 0);
+
+    do {
+        BitScanForward(&Index, LockMask);
+        KiReleaseSpinLock(&KeObjectLockTable[Index].Lock);
+        LockMask &= LockMask - 1;
+    } while (LockMask != 0);
+
+    return;
+}
+
 extern ULARGE_INTEGER KiTimeIncrementReciprocal;
 extern CCHAR KiTimeIncrementShiftCount;
 
@@ -1200,6 +1401,7 @@ Return Value:
             Timer->Header.SignalState = TRUE;
             Timer->DueTime.QuadPart = 0;
             Timer->Header.Hand = 0;
+            Timer->Header.Processor = (UCHAR)KeGetCurrentProcessorNumber();
             *Hand = 0;
             return FALSE;
         }
@@ -1209,7 +1411,7 @@ Return Value:
 
     //
     // Get the current interrupt time, compute the timer due time, and insert
-    // the timer in the timer table.
+    // the timer in the timer table of the current processor.
     //
 
     KiQueryInterruptTime(&InterruptTime);
@@ -1217,10 +1419,237 @@ Return Value:
     Timer->DueTime.QuadPart = DueTime;
     *Hand = KiComputeTimerTableIndex(DueTime);
     Timer->Header.Hand = (UCHAR)*Hand;
+    Timer->Header.Processor = (UCHAR)KeGetCurrentProcessorNumber();
     Timer->Header.Inserted = TRUE;
     return TRUE;
 }
 
+FORCEINLINE
+ULONG
+KiCoalesceDueTime (
+    IN PKTIMER Timer,
+    IN ULONG TolerableDelay
+    )
+
+/*++
+
+Routine Description:
+
+    This function delays the due time of the specified timer to the next
+    coalescing boundary within the specified tolerable delay and recomputes
+    the timer hand value.
+
+    The coalescing boundary is the largest power of two number of clock ticks
+    that does not exceed the tolerable delay. Timers that round up to the same
+    boundary are placed in the same timer table list and expire in the same
+    timer expiration scan.
+
+Arguments:
+
+    Timer - Supplies a pointer to a dispatcher object of type timer whose
+        due time has been computed.
+
+    TolerableDelay - Supplies the tolerable delay in milliseconds.
+
+Return Value:
+
+    The timer table hand value is returned as the function value.
+
+--*/
+
+{
+
+    ULONG64 DueTime;
+    ULONG64 Granularity;
+    ULONG Hand;
+    ULONG64 Tolerance;
+
+    //
+    // Compute the largest power of two multiple of the clock tick that does
+    // not exceed the tolerable delay. If the tolerable delay is less than a
+    // clock tick, then the due time is not changed.
+    //
+
+    DueTime = Timer->DueTime.QuadPart;
+    Tolerance = (ULONG64)TolerableDelay * 10 * 1000;
+    Granularity = KeMaximumIncrement;
+    if (Tolerance >= Granularity) {
+        while ((Granularity << 1) <= Tolerance) {
+            Granularity <<= 1;
+        }
+
+        DueTime = ((DueTime + Granularity - 1) / Granularity) * Granularity;
+        if (DueTime != (ULONG64)Timer->DueTime.QuadPart) {
+            Timer->DueTime.QuadPart = DueTime;
+            KeTimerExpirationCounters.TimersCoalesced += 1;
+        }
+    }
+
+    Hand = KiComputeTimerTableIndex(DueTime);
+    Timer->Header.Hand = (UCHAR)Hand;
+    return Hand;
+}
+
+#if !defined(NT_UP)
+
+FORCEINLINE
+ULONG64
+KiReadDispatcherLockTime (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This function reads the processor cycle counter used to time dispatcher
+    lock hold times.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    The current processor cycle count, or zero if the processor does not
+    have a cycle counter.
+
+--*/
+
+{
+
+#if defined(_AMD64_)
+
+    return ReadTimeStampCounter();
+
+#else
+
+    if ((KeFeatureBits & KF_RDTSC) == 0) {
+        return 0;
+    }
+
+    return (ULONG64)RDTSC();
+
+#endif
+
+}
+
+FORCEINLINE
+ULONG
+KiComputeLockHistogramIndex (
+    IN ULONG64 Value
+    )
+
+/*++
+
+Routine Description:
+
+    This function computes the logarithmic histogram index of the specified
+    value.
+
+Arguments:
+
+    Value - Supplies the value to compute the histogram index for.
+
+Return Value:
+
+    The floor of the base 2 logarithm of the value plus one, limited to the
+    last histogram entry, or zero if the value is zero.
+
+--*/
+
+{
+
+    ULONG Index;
+
+    Index = 0;
+    while ((Value != 0) && (Index < (DISPATCHER_LOCK_HISTOGRAM_SIZE - 1))) {
+        Value >>= 1;
+        Index += 1;
+    }
+
+    return Index;
+}
+
+FORCEINLINE
+VOID
+KiRecordDispatcherLockAcquire (
+    IN LOGICAL Contended
+    )
+
+/*++
+
+Routine Description:
+
+    This function records an acquisition of the dispatcher database lock in
+    the dispatcher lock counters and stamps the acquisition time in the
+    current processor block.
+
+    N.B. This function is called with the dispatcher lock held. The lock is
+         acquired and released on the same processor at SYNCH_LEVEL, so the
+         acquisition time is always read back with the cycle counter of the
+         processor that wrote it.
+
+Arguments:
+
+    Contended - Supplies TRUE if the lock was owned when the acquisition
+        was attempted.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    KeDispatcherLockCounters.Acquisitions += 1;
+    if (Contended != FALSE) {
+        KeDispatcherLockCounters.Contentions += 1;
+    }
+
+    KeGetCurrentPrcb()->DispatcherLockAcquireTime = KiReadDispatcherLockTime();
+    return;
+}
+
+FORCEINLINE
+VOID
+KiRecordDispatcherLockRelease (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This function records the hold time of the dispatcher database lock in
+    the hold histogram.
+
+    N.B. This function is called with the dispatcher lock held.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG64 HoldTime;
+
+    HoldTime = KiReadDispatcherLockTime() -
+                        KeGetCurrentPrcb()->DispatcherLockAcquireTime;
+
+    KeDispatcherLockCounters.HoldHistogram[KiComputeLockHistogramIndex(HoldTime >> 7)] += 1;
+    return;
+}
+
+#endif
+
 FORCEINLINE
 VOID
 KiClearIdleSummary (
@@ -1334,6 +1763,7 @@ Return Value:
             Timer->DueTime.QuadPart = 0;
             *Hand = 0;
             Timer->Header.Hand = 0;
+            Timer->Header.Processor = (UCHAR)KeGetCurrentProcessorNumber();
             return;
         }
 
@@ -1342,7 +1772,8 @@ Return Value:
 
     //
     // Get the current interrupt time, compute the timer due time, and compute
-    // the timer hand value.
+    // the timer hand value. The timer is inserted in the timer table of the
+    // current processor.
     //
 
     KiQueryInterruptTime(&InterruptTime);
@@ -1350,6 +1781,7 @@ Return Value:
     Timer->DueTime.QuadPart = DueTime;
     *Hand = KiComputeTimerTableIndex(DueTime);
     Timer->Header.Hand = (UCHAR)*Hand;
+    Timer->Header.Processor = (UCHAR)KeGetCurrentProcessorNumber();
     return;
 }
 
@@ -1675,6 +2107,17 @@ typedef ULONG KIPI_REQUEST;
 
 #define IPI_INSTRUMENT_COUNT(a,b)
 
+//
+// Define macro to count translation buffer flush requests by type.
+//
+
+#if !defined(NT_UP)
+
+#define KiRecordTbFlush(Prcb, Type)                                          \
+    KiTbFlushCounters[(Prcb)->Number].Type += 1
+
+#endif
+
 #if !defined(_AMD64_)
 
 VOID
@@ -1939,7 +2382,185 @@ typedef struct _KTIMER_TABLE_ENTRY {
     ULARGE_INTEGER Time;
 } KTIMER_TABLE_ENTRY, *PKTIMER_TABLE_ENTRY;
 
-extern DECLSPEC_CACHEALIGN KTIMER_TABLE_ENTRY KiTimerTableListHead[TIMER_TABLE_SIZE];
+//
+// Define the per processor timer table.
+//
+// Each processor has a timer table that is anchored in its processor block.
+// A timer is inserted in the timer table of the processor on which it is
+// set and expires in the timer expiration scan of that processor. Each entry
+// of the timer table has a sorted near list of timers that are due within
+// one revolution of the timer table and an unsorted far list of timers that
+// are due one or more revolutions in the future.
+//
+// N.B. The near list timer table entries must be first in the structure as
+//      the clock interrupt code indexes them directly from the timer table
+//      address.
+//
+
+typedef struct _KTIMER_TABLE {
+    KTIMER_TABLE_ENTRY TimerEntries[TIMER_TABLE_SIZE];
+    KTIMER_TABLE_ENTRY FarEntries[TIMER_TABLE_SIZE];
+} KTIMER_TABLE, *PKTIMER_TABLE;
+
+C_ASSERT(FIELD_OFFSET(KTIMER_TABLE, TimerEntries) == 0);
+
+//
+// The processor number of a timer is recorded in a seven bit field of the
+// timer header.
+//
+
+C_ASSERT(MAXIMUM_PROCESSORS <= 128);
+
+extern DECLSPEC_CACHEALIGN KTIMER_TABLE KiInitialTimerTable;
+
+VOID
+KiInitializeTimerTable (
+    IN PKTIMER_TABLE TimerTable
+    );
+
+FORCEINLINE
+PKTIMER_TABLE
+KiGetTimerTable (
+    __in ULONG Processor
+    )
+
+/*++
+
+Routine Description:
+
+    This function returns the address of the timer table of the specified
+    processor.
+
+Arguments:
+
+    Processor - Supplies the processor number.
+
+Return Value:
+
+    The address of the timer table of the specified processor is returned
+    as the function value.
+
+--*/
+
+{
+
+    return KiProcessorBlock[Processor]->TimerTable;
+}
+
+//
+// Define the interval covered by one revolution of the timer table and the
+// infinite absolute due time of an empty timer table entry.
+//
+// Timers that are due one or more revolutions in the future are placed in
+// the far list of their timer table entry and are cascaded into the sorted
+// near list when the hand passes the entry in the revolution before they
+// are due.
+//
+
+#define TIMER_TABLE_REVOLUTION ((ULONG64)KeMaximumIncrement << TIMER_TABLE_SHIFT)
+
+#define TIMER_INFINITE_TIME 0xffffffff00000000UI64
+
+FORCEINLINE
+ULONG64
+KiComputeCascadeTime (
+    __in PKTIMER_TABLE TimerTable,
+    __in ULONG Hand
+    )
+
+/*++
+
+Routine Description:
+
+    This function computes the interrupt time at which the far list of the
+    specified timer table entry must be cascaded into the near list.
+
+    N.B. The far due time is a lower bound on the due time of the timers in
+         the far list. It is recomputed when the far list is cascaded.
+
+Arguments:
+
+    TimerTable - Supplies a pointer to a timer table.
+
+    Hand - Supplies the timer table hand value.
+
+Return Value:
+
+    The cascade time is returned as the function value. If the far list is
+    empty, then an infinite absolute time is returned.
+
+--*/
+
+{
+
+    PKTIMER_TABLE_ENTRY FarEntry;
+
+    FarEntry = &TimerTable->FarEntries[Hand];
+    if (&FarEntry->Entry == FarEntry->Entry.Flink) {
+        return TIMER_INFINITE_TIME;
+    }
+
+    return FarEntry->Time.QuadPart - TIMER_TABLE_REVOLUTION;
+}
+
+FORCEINLINE
+VOID
+KiResetTimerTableEntry (
+    __in PKTIMER_TABLE TimerTable,
+    __in ULONG Hand
+    )
+
+/*++
+
+Routine Description:
+
+    This function resets the due times of the specified timer table entry
+    after a timer has been removed and left either the near or the far list
+    empty.
+
+    N.B. This routine assumes that the timer table lock has been acquired.
+
+Arguments:
+
+    TimerTable - Supplies a pointer to a timer table.
+
+    Hand - Supplies the timer table hand value.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PKTIMER_TABLE_ENTRY FarEntry;
+    PKTIMER_TABLE_ENTRY TableEntry;
+
+    //
+    // If the far list is empty, then set the far due time to an infinite
+    // absolute time. If the near list is empty, then set the due time of
+    // the entry to the cascade time of the far list, which is an infinite
+    // absolute time when the far list is also empty.
+    //
+
+    FarEntry = &TimerTable->FarEntries[Hand];
+    if (&FarEntry->Entry == FarEntry->Entry.Flink) {
+        FarEntry->Time.HighPart = 0xffffffff;
+    }
+
+    TableEntry = &TimerTable->TimerEntries[Hand];
+    if (&TableEntry->Entry == TableEntry->Entry.Flink) {
+        if (&FarEntry->Entry == FarEntry->Entry.Flink) {
+            TableEntry->Time.HighPart = 0xffffffff;
+
+        } else {
+            TableEntry->Time.QuadPart = KiComputeCascadeTime(TimerTable, Hand);
+        }
+    }
+
+    return;
+}
 
 FORCEINLINE
 VOID
@@ -1967,12 +2588,10 @@ Return Value:
 {
 
     ULONG Hand;
-    PKTIMER_TABLE_ENTRY TableEntry;
 
     //
-    // Remove the timer from the timer table. If the timer table list is
-    // empty, then set the respective timer table due time to an infinite
-    // absolute time.
+    // Remove the timer from the near or far list of its timer table entry.
+    // If the list is empty, then reset the respective timer table due times.
     //
     // N.B. It is the responsibility of the caller to set the timer inserted
     //      state.
@@ -1980,10 +2599,7 @@ Return Value:
 
     Hand = Timer->Header.Hand;
     if (RemoveEntryList(&Timer->TimerListEntry) != FALSE) {
-        TableEntry = &KiTimerTableListHead[Hand];
-        if (&TableEntry->Entry == TableEntry->Entry.Flink) {
-            TableEntry->Time.HighPart = 0xffffffff;
-        }
+        KiResetTimerTableEntry(KiGetTimerTable(Timer->Header.Processor), Hand);
     }
 
 #if DBG
@@ -2023,23 +2639,24 @@ Return Value:
 
     ULONG Hand;
     PKSPIN_LOCK_QUEUE LockQueue;
-    PKTIMER_TABLE_ENTRY TableEntry;
+    ULONG Processor;
 
     //
     // Acquire the timer table lock, set the insert state of the timer to
-    // FALSE, and remove the timer from the timer table. If the time table
-    // list is empty, then set the respective timer table due time to an
-    // infinite absolute time. Release the timer table lock.
+    // FALSE, and remove the timer from the near or far list of its timer
+    // table entry. If the list is empty, then reset the respective timer
+    // table due times. Release the timer table lock.
+    //
+    // N.B. The timer is removed from the timer table of the processor on
+    //      which it was set, which need not be the current processor.
     //
 
     Hand = Timer->Header.Hand;
-    LockQueue = KiAcquireTimerTableLock(Hand); 
+    Processor = Timer->Header.Processor;
+    LockQueue = KiAcquireTimerTableLock(Processor, Hand); 
     Timer->Header.Inserted = FALSE;
     if (RemoveEntryList(&Timer->TimerListEntry) != FALSE) {
-        TableEntry = &KiTimerTableListHead[Hand];
-        if (&TableEntry->Entry == TableEntry->Entry.Flink) {
-            TableEntry->Time.HighPart = 0xffffffff;
-        }
+        KiResetTimerTableEntry(KiGetTimerTable(Processor), Hand);
     }
 
     KiReleaseTimerTableLock(LockQueue);
@@ -2054,6 +2671,14 @@ Return Value:
     return;
 }
 
+VOID
+FASTCALL
+KiCascadeTimerTable (
+    IN PKTIMER_TABLE TimerTable,
+    IN ULONG Hand,
+    IN ULONG64 CurrentTime
+    );
+
 LOGICAL
 FASTCALL
 KiInsertTimerTable (
@@ -2104,7 +2729,7 @@ Return Value:
 
     Inserted = FALSE;
     if (KiComputeDueTime(Timer, Interval, &Hand) == TRUE) {
-        LockQueue = KiAcquireTimerTableLock(Hand);
+        LockQueue = KiAcquireTimerTableLock(Timer->Header.Processor, Hand);
         if (KiInsertTimerTable(Timer, Hand) == TRUE) {
             KiRemoveEntryTimer(Timer);
             Timer->Header.Inserted = FALSE;
@@ -2175,7 +2800,7 @@ Return Value:
     // N.B. Complete timer releases the timer table lock.
     //
 
-    LockQueue = KiAcquireTimerTableLock(Hand);
+    LockQueue = KiAcquireTimerTableLock(Timer->Header.Processor, Hand);
     KiUnlockDispatcherDatabaseFromSynchLevel();
     if (KiInsertTimerTable(Timer, Hand) == TRUE) {
         KiCompleteTimer(Timer, LockQueue);
@@ -3512,7 +4137,6 @@ extern ULONG_PTR KiServiceTable[];
 extern CALL_PERFORMANCE_DATA KiSetEventCallData;
 extern ULONG KiTickOffset;
 extern KAFFINITY KiTimeProcessor;
-extern KDPC KiTimerExpireDpc;
 extern ALIGNED_SPINLOCK KiFreezeExecutionLock;
 extern CALL_PERFORMANCE_DATA KiWaitSingleCallData;
 extern ULONG KiEnableTimerWatchdog;
@@ -3599,6 +4223,141 @@ Return Value:
     return Thread;
 }
 
+#if !defined(NT_UP)
+
+FORCEINLINE
+PKPRCB
+KiFindStealTarget (
+    IN PKPRCB CurrentPrcb,
+    IN OUT PKAFFINITY Scanned
+    )
+
+/*++
+
+Routine Description:
+
+    This function selects the next processor whose dispatcher ready queues
+    should be searched for a thread to run on the current processor.
+
+    Processors are considered in order of locality: first the logical
+    processors of the current physical processor, then the processors on
+    the current node, and finally all other processors. Within each set
+    the processor with the highest priority ready thread is selected.
+
+    N.B. The ready summaries are examined without holding the respective
+         PRCB locks. The caller must recheck the ready summary of the
+         selected processor after acquiring its PRCB lock.
+
+Arguments:
+
+    CurrentPrcb - Supplies a pointer to the current processor block.
+
+    Scanned - Supplies a pointer to the set of processors that have already
+        been considered. The selected processor, and all processors that
+        have nothing ready, are added to the set.
+
+Return Value:
+
+    If a processor with ready threads is found, then the address of its
+    processor block is returned. Otherwise, NULL is returned.
+
+--*/
+
+{
+
+    PKPRCB BestPrcb;
+    ULONG BestSummary;
+    KAFFINITY Candidates;
+    ULONG Index;
+    ULONG Summary;
+    PKPRCB TargetPrcb;
+    ULONG Tier;
+    KAFFINITY TierSet[3];
+
+    TierSet[0] = CurrentPrcb->MultiThreadProcessorSet;
+    TierSet[1] = CurrentPrcb->ParentNode->ProcessorMask;
+    TierSet[2] = KeActiveProcessors;
+    for (Tier = 0; Tier < 3; Tier += 1) {
+        Candidates = TierSet[Tier] & KeActiveProcessors & ~*Scanned;
+        BestPrcb = NULL;
+        BestSummary = 0;
+        while (Candidates != 0) {
+            KeFindFirstSetLeftAffinity(Candidates, &Index);
+            Candidates ^= AFFINITY_MASK(Index);
+            TargetPrcb = KiProcessorBlock[Index];
+            Summary = TargetPrcb->ReadySummary;
+            if (Summary == 0) {
+                *Scanned |= AFFINITY_MASK(Index);
+
+            } else if (Summary > BestSummary) {
+                BestPrcb = TargetPrcb;
+                BestSummary = Summary;
+            }
+        }
+
+        if (BestPrcb != NULL) {
+            *Scanned |= BestPrcb->SetMember;
+            return BestPrcb;
+        }
+    }
+
+    return NULL;
+}
+
+FORCEINLINE
+VOID
+KiRecordStealThread (
+    IN PKPRCB CurrentPrcb,
+    IN PKPRCB TargetPrcb
+    )
+
+/*++
+
+Routine Description:
+
+    This function records that a thread was taken from the dispatcher ready
+    queues of the target processor to run on the current processor.
+
+Arguments:
+
+    CurrentPrcb - Supplies a pointer to the current processor block.
+
+    TargetPrcb - Supplies a pointer to the processor block the thread was
+        taken from.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PKSCHEDULER_STEAL_COUNTERS Counters;
+
+    Counters = &KiStealCounters[CurrentPrcb->Number];
+    if ((TargetPrcb->SetMember & CurrentPrcb->MultiThreadProcessorSet) != 0) {
+        Counters->SmtSteals += 1;
+
+    } else if (TargetPrcb->ParentNode == CurrentPrcb->ParentNode) {
+        Counters->NodeSteals += 1;
+
+    } else {
+        Counters->RemoteNodeSteals += 1;
+    }
+
+    return;
+}
+
+#define KiRecordLocalReadyThread(Prcb)                                       \
+    KiStealCounters[(Prcb)->Number].LocalHits += 1
+
+#else
+
+#define KiRecordLocalReadyThread(Prcb)
+
+#endif
+
 VOID
 KiSetInternalEvent (
     IN PKEVENT Event,
@@ -52,8 +52,50 @@ extern PHALNUMAPAGETONODE MmPageToNode;
 #pragma alloc_text(INIT, KeInitSystem)
 #pragma alloc_text(INIT, KiInitSpinLocks)
 #pragma alloc_text(INIT, KiInitSystem)
+#pragma alloc_text(INIT, KiInitializeTimerTable)
 #pragma alloc_text(INIT, KeNumaInitialize)
 
+VOID
+KiInitializeTimerTable (
+    IN PKTIMER_TABLE TimerTable
+    )
+
+/*++
+
+Routine Description:
+
+    This function initializes the near and far lists and the due times of
+    the specified timer table.
+
+    N.B. Each entry in the timer table is set to an infinite absolute due
+         time.
+
+Arguments:
+
+    TimerTable - Supplies a pointer to the timer table to initialize.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+
+    for (Index = 0; Index < TIMER_TABLE_SIZE; Index += 1) {
+        InitializeListHead(&TimerTable->TimerEntries[Index].Entry);
+        TimerTable->TimerEntries[Index].Time.HighPart = 0xffffffff;
+        TimerTable->TimerEntries[Index].Time.LowPart = 0;
+        InitializeListHead(&TimerTable->FarEntries[Index].Entry);
+        TimerTable->FarEntries[Index].Time.HighPart = 0xffffffff;
+        TimerTable->FarEntries[Index].Time.LowPart = 0;
+    }
+
+    return;
+}
+
 BOOLEAN
 KeInitSystem (
     VOID
@@ -335,14 +377,6 @@ Return Value:
     InitializeListHead(&KeBugCheckReasonCallbackListHead);
     KeInitializeSpinLock(&KeBugCheckCallbackLock);
 
-    //
-    // Initialize the timer expiration DPC object and set the destination
-    // processor to processor zero.
-    //
-
-    KeInitializeDpc(&KiTimerExpireDpc, KiTimerExpiration, NULL);
-    KeSetTargetProcessorDpc(&KiTimerExpireDpc, 0);
-
     //
     // Initialize the profile listhead and profile locks
     //
@@ -357,17 +391,14 @@ Return Value:
     InitializeListHead(&KiProfileSourceListHead);
 
     //
-    // Initialize the timer table and the timer table due time table.
+    // Initialize the timer table of processor zero.
     //
-    // N.B. Each entry in the timer table due time table is set to an infinite
-    //      absolute due time.
+    // N.B. The timer tables of the other processors are allocated and
+    //      initialized when the processors are started.
     //
 
-    for (Index = 0; Index < TIMER_TABLE_SIZE; Index += 1) {
-        InitializeListHead(&KiTimerTableListHead[Index].Entry);
-        KiTimerTableListHead[Index].Time.HighPart = 0xffffffff;
-        KiTimerTableListHead[Index].Time.LowPart = 0;
-    }
+    KiInitializeTimerTable(&KiInitialTimerTable);
+    KeGetCurrentPrcb()->TimerTable = &KiInitialTimerTable;
 
     //
     // Initialize the swap event, the process inswap listhead, the
@@ -266,9 +266,11 @@ Return Value:
     PLIST_ENTRY NextEntry;
     KIRQL OldIrql1;
     KIRQL OldIrql2;
+    ULONG Processor;
     LARGE_INTEGER TimeDelta;
     TIME_FIELDS TimeFields;
     PKTIMER Timer;
+    PKTIMER_TABLE TimerTable;
 
     ASSERT((NewTime->HighPart & 0xf0000000) == 0);
 
@@ -356,25 +358,36 @@ Return Value:
 
         //
         // Acquire the timer table lock, remove all absolute timers from the
-        // timer queue so their due time can be recomputed, and release the
-        // timer table lock.
+        // near and far lists of the timer table of each processor so their
+        // due time can be recomputed, and release the timer table lock.
         //
 
         InitializeListHead(&AbsoluteListHead);
-        for (Index = 0; Index < TIMER_TABLE_SIZE; Index += 1) {
-            ListHead = &KiTimerTableListHead[Index].Entry;
-            LockQueue = KiAcquireTimerTableLock(Index);
-            NextEntry = ListHead->Flink;
-            while (NextEntry != ListHead) {
-                Timer = CONTAINING_RECORD(NextEntry, KTIMER, TimerListEntry);
-                NextEntry = NextEntry->Flink;
-                if (Timer->Header.Absolute != FALSE) {
-                    KiRemoveEntryTimer(Timer);
-                    InsertTailList(&AbsoluteListHead, &Timer->TimerListEntry);
-                }
+        for (Processor = 0; Processor < (ULONG)KeNumberProcessors; Processor += 1) {
+            TimerTable = KiGetTimerTable(Processor);
+            for (Index = 0; Index < TIMER_TABLE_SIZE; Index += 1) {
+                ListHead = &TimerTable->TimerEntries[Index].Entry;
+                LockQueue = KiAcquireTimerTableLock(Processor, Index);
+                do {
+                    NextEntry = ListHead->Flink;
+                    while (NextEntry != ListHead) {
+                        Timer = CONTAINING_RECORD(NextEntry, KTIMER, TimerListEntry);
+                        NextEntry = NextEntry->Flink;
+                        if (Timer->Header.Absolute != FALSE) {
+                            KiRemoveEntryTimer(Timer);
+                            InsertTailList(&AbsoluteListHead, &Timer->TimerListEntry);
+                        }
+                    }
+
+                    if (ListHead == &TimerTable->FarEntries[Index].Entry) {
+                        break;
+                    }
+
+                    ListHead = &TimerTable->FarEntries[Index].Entry;
+                } while (TRUE);
+
+                KiReleaseTimerTableLock(LockQueue);
             }
-
-            KiReleaseTimerTableLock(LockQueue);
         }
 
         //
@@ -382,6 +395,9 @@ Return Value:
         // tree. If a timer has already expired, then insert the timer in the
         // expired timer list.
         //
+        // N.B. Each timer is reinserted in the timer table of the processor
+        //      on which it was set.
+        //
 
         InitializeListHead(&ExpiredListHead);
         while (AbsoluteListHead.Flink != &AbsoluteListHead) {
@@ -390,7 +406,7 @@ Return Value:
             Timer->DueTime.QuadPart -= TimeDelta.QuadPart;
             Hand = KiComputeTimerTableIndex(Timer->DueTime.QuadPart);
             Timer->Header.Hand = (UCHAR)Hand;
-            LockQueue = KiAcquireTimerTableLock(Hand);
+            LockQueue = KiAcquireTimerTableLock(Timer->Header.Processor, Hand);
             if (KiInsertTimerTable(Timer, Hand) == TRUE) {
                 KiRemoveEntryTimer(Timer);
                 InsertTailList(&ExpiredListHead, &Timer->TimerListEntry);
@@ -530,16 +546,6 @@ Return Value:
 
     } else {
 
-        //
-        // Set timer expiration dpc to scan the timer queues once for any
-        // expired timers.
-        //
-
-        KeRemoveQueueDpc(&KiTimerExpireDpc);
-        KeInsertQueueDpc(&KiTimerExpireDpc,
-                         ULongToPtr(KiQueryLowTickCount() - TIMER_TABLE_SIZE),
-                         NULL);
-
         //
         // Disable interrupts and indicate that this processor is now
         // in final portion of this code.
@@ -662,6 +668,28 @@ Return Value:
 
 #endif
 
+    //
+    // Request a scan of the entire timer table of the current processor for
+    // any timers that expired as a result of the time change.
+    //
+    // N.B. Interrupts are disabled so the request cannot be overwritten by
+    //      the clock interrupt on the current processor.
+    //
+
+#if defined(_WIN64)
+
+    KeGetCurrentPrcb()->TimerHand =
+        0x100000000I64 + (ULONG)(KiQueryLowTickCount() - TIMER_TABLE_SIZE);
+
+#else
+
+    KeGetCurrentPrcb()->TimerHand = KiQueryLowTickCount() - TIMER_TABLE_SIZE;
+    KeGetCurrentPrcb()->TimerRequest = TRUE;
+
+#endif
+
+    KiRequestSoftwareInterrupt(DISPATCH_LEVEL);
+
     HalCalibratePerformanceCounter((LONG volatile *)&Adjust->HalNumber,
                                    (ULONGLONG)Adjust->NewCount.QuadPart);
 
@@ -147,6 +147,7 @@ Return Value:
 
 {
 
+    PKOBJECT_LOCK_ENTRY LockEntry;
     LONG NewState;
     KIRQL OldIrql;
     LONG OldState;
@@ -156,10 +157,42 @@ Return Value:
     ASSERT(KeGetCurrentIrql() <= DISPATCH_LEVEL);
 
     //
-    // Raise IRQL to dispatcher level and lock dispatcher database.
+    // If wait is false, then raise IRQL to SYNCH level and lock the
+    // semaphore object. If the wait list is empty, then there is no wait
+    // to satisfy and the semaphore is released without locking the
+    // dispatcher database.
     //
+    // Otherwise, raise IRQL to dispatcher level, lock the dispatcher
+    // database, and lock the semaphore object.
+    //
+
+    if (Wait == FALSE) {
+        OldIrql = KeRaiseIrqlToSynchLevel();
+        LockEntry = KiAcquireObjectLock(Semaphore);
+        if (IsListEmpty(&Semaphore->Header.WaitListHead) != FALSE) {
+            OldState = ReadForWriteAccess(&Semaphore->Header.SignalState);
+            NewState = OldState + Adjustment;
+            if ((NewState > Semaphore->Limit) || (NewState < OldState)) {
+                KiReleaseObjectLock(LockEntry);
+                KeLowerIrql(OldIrql);
+                ExRaiseStatus(STATUS_SEMAPHORE_LIMIT_EXCEEDED);
+            }
+
+            Semaphore->Header.SignalState = NewState;
+            LockEntry->Bypasses += 1;
+            KiReleaseObjectLock(LockEntry);
+            KeLowerIrql(OldIrql);
+            return OldState;
+        }
+
+        KiReleaseObjectLock(LockEntry);
+        KiLockDispatcherDatabaseAtSynchLevel();
 
-    KiLockDispatcherDatabase(&OldIrql);
+    } else {
+        KiLockDispatcherDatabase(&OldIrql);
+    }
+
+    LockEntry = KiAcquireObjectLock(Semaphore);
 
     //
     // Capture the current signal state of the semaphore object and
@@ -171,10 +204,12 @@ Return Value:
 
     //
     // If the new state value is greater than the limit or a carry occurs,
-    // then unlock the dispatcher database, and raise an exception.
+    // then unlock the semaphore object and the dispatcher database, and
+    // raise an exception.
     //
 
     if ((NewState > Semaphore->Limit) || (NewState < OldState)) {
+        KiReleaseObjectLock(LockEntry);
         KiUnlockDispatcherDatabase(OldIrql);
         ExRaiseStatus(STATUS_SEMAPHORE_LIMIT_EXCEEDED);
     }
@@ -191,6 +226,8 @@ Return Value:
         KiWaitTest(Semaphore, Increment);
     }
 
+    KiReleaseObjectLock(LockEntry);
+
     //
     // If the value of the Wait argument is TRUE, then return to the
     // caller with IRQL raised and the dispatcher database locked. Else
@@ -2351,6 +2351,9 @@ Return Value:
 
     KiLockDispatcherDatabaseAtSynchLevel();
     if (ListHead == NULL) {
+        ExRecordWorkItemInsertion(&ExWorkerQueue[HyperCriticalWorkQueue],
+                                  &PsReaperWorkItem);
+
         KiInsertQueue(&ExWorkerQueue[HyperCriticalWorkQueue].WorkerQueue,
                       &PsReaperWorkItem.List,
                       FALSE);
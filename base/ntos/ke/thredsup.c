@@ -791,6 +791,7 @@ Return Value:
 
 {
 
+    PKTHREAD Candidate;
     ULONG HighPriority;
     PRLIST_ENTRY ListHead;
     PRLIST_ENTRY NextEntry;
@@ -822,36 +823,48 @@ Return Value:
         // Scan the specified dispatcher ready queue for a suitable
         // thread to execute.
         //
-        // N.B. It is not necessary to attempt to find a better candidate
-        //      on either multinode or non-multinode systems. For multinode
-        //      systems, this routine is called sequentially specifying each
-        //      processor on the current node before attempting to schedule
-        //      from other processors. For non-multinode systems all threads
-        //      run on a single node and there is no node distinction. In
-        //      both cases threads are inserted in per-processor ready queues
-        //      according to their ideal processor.
+        // N.B. The callers select the processors to search in order of
+        //      locality, so there is no need to find a better candidate on
+        //      another processor. Within the queue, a thread whose ideal
+        //      processor is the specified processor is not taken if another
+        //      thread of the same priority can run on the specified
+        //      processor, since it will be run by its ideal processor.
         //
 
+        Candidate = NULL;
         do {
             Thread = CONTAINING_RECORD(NextEntry, KTHREAD, WaitListEntry);
             if ((Thread->Affinity & AFFINITY_MASK(Number)) != 0)
             {
-                ASSERT((Prcb->ReadySummary & PRIORITY_MASK(HighPriority)) != 0);
-                ASSERT((KPRIORITY)HighPriority == Thread->Priority);
-                ASSERT(Thread->NextProcessor == Prcb->Number);
-
-                if (RemoveEntryList(&Thread->WaitListEntry) != FALSE) 
-                {
-                    Prcb->ReadySummary ^= PRIORITY_MASK(HighPriority);
+                if (Candidate == NULL) {
+                    Candidate = Thread;
                 }
 
-                Thread->NextProcessor = (UCHAR)Number;
-                return Thread;
+                if (Thread->IdealProcessor != Prcb->Number) {
+                    Candidate = Thread;
+                    break;
+                }
             }
 
             NextEntry = NextEntry->Flink;
         } while (NextEntry != ListHead);
 
+        if (Candidate != NULL) {
+            Thread = Candidate;
+
+            ASSERT((Prcb->ReadySummary & PRIORITY_MASK(HighPriority)) != 0);
+            ASSERT((KPRIORITY)HighPriority == Thread->Priority);
+            ASSERT(Thread->NextProcessor == Prcb->Number);
+
+            if (RemoveEntryList(&Thread->WaitListEntry) != FALSE) 
+            {
+                Prcb->ReadySummary ^= PRIORITY_MASK(HighPriority);
+            }
+
+            Thread->NextProcessor = (UCHAR)Number;
+            return Thread;
+        }
+
         PrioritySet ^= PRIORITY_MASK(HighPriority);
         KeFindFirstSetLeftMember(PrioritySet, &HighPriority);
     } while (PrioritySet != 0);
@@ -1846,10 +1859,8 @@ Return Value:
 
 #if !defined(NT_UP)
       
-    LONG Index;
-    LONG Limit;
-    LONG Number;
     ULONG Processor;
+    KAFFINITY Scanned;
     PKPRCB TargetPrcb;
 
 #endif
@@ -1899,6 +1910,7 @@ Return Value:
 
         if ((NewThread = KiSelectReadyThread(0, CurrentPrcb)) != NULL)      // ǰһ߳
         {
+            KiRecordLocalReadyThread(CurrentPrcb);
             CurrentPrcb->CurrentThread = NewThread;
             NewThread->State = Running;
 
@@ -1951,8 +1963,11 @@ Return Value:
             // Release the current PRCB lock and attempt to select a thread
             // from any processor dispatcher ready queues.
             //
-            // If this is a multinode system, then start with the processors
-            // on the same node. Otherwise, start with the current processor.
+            // Processors are searched in order of locality: the other logical
+            // processors of the current physical processor, then the processors
+            // on the same node, then all other processors. Within each set the
+            // processor with the highest priority ready thread is searched
+            // first.
             //
             // N.B. It is possible to perform the below loop with minimal
             //      releases of the current PRCB lock. However, this limits
@@ -1961,116 +1976,94 @@ Return Value:
 
             KiReleasePrcbLock(CurrentPrcb);                                   // ͷŵǰʼ
             Processor = CurrentPrcb->Number;
-            Index = Processor;
-            if (KeNumberNodes > 1) 
+            Scanned = CurrentPrcb->SetMember;
+            while ((TargetPrcb = KiFindStealTarget(CurrentPrcb, &Scanned)) != NULL) 
             {
-                KeFindFirstSetLeftAffinity(CurrentPrcb->ParentNode->ProcessorMask,
-                                           (PULONG)&Index);                   // Ȳͬһڵϵ
-            }
+                if (TargetPrcb->ReadySummary != 0)                        // ȷȼ
+                {
 
-            Limit = KeNumberProcessors - 1;
-            Number = Limit;
+                    //
+                    // Acquire the current and target PRCB locks.
+                    //
 
-            ASSERT(Index <= Limit);
+                    KiAcquireTwoPrcbLocks(CurrentPrcb, TargetPrcb);
 
-            do 
-            {
-                TargetPrcb = KiProcessorBlock[Index];
-                if (CurrentPrcb != TargetPrcb) 
-                {
-                    if (TargetPrcb->ReadySummary != 0)                        // ȷȼ
+                    //
+                    // If a new thread has not been selected to run on
+                    // the current processor, then attempt to select a
+                    // thread to run on the current processor.
+                    //
+
+                    if ((NewThread = CurrentPrcb->NextThread) == NULL)          // ǰNextThreadǿ
                     {
+                        if ((TargetPrcb->ReadySummary != 0) &&
+                            (NewThread = KiFindReadyThread(Processor,
+                                                           TargetPrcb)) != NULL) // Ŀ괦ҵһ߳ȡ
+                        {
+    
+                            //
+                            // A new thread has been found to run on the
+                            // current processor. 
+                            //
+        
+                            NewThread->State = Running;                         // ȵǰִ
+                            KiReleasePrcbLock(TargetPrcb);
+                            CurrentPrcb->CurrentThread = NewThread;
 
-                        //
-                        // Acquire the current and target PRCB locks.
-                        //
+                            //
+                            // Clear idle on the current processor and
+                            // update the idle summary SMT set to indicate
+                            // the physical processor is not entirely idle.
+                            //
+
+                            KiClearIdleSummary(AFFINITY_MASK(Processor));
+                            KiClearSMTSummary(CurrentPrcb->MultiThreadProcessorSet);
+                            KiRecordStealThread(CurrentPrcb, TargetPrcb);
+                            goto ThreadFound;
 
-                        KiAcquireTwoPrcbLocks(CurrentPrcb, TargetPrcb);
+                        } 
+                        else                                                    // Ŀ괦ʧܵ
+                        {
+                            KiReleasePrcbLock(CurrentPrcb);
+                            KiReleasePrcbLock(TargetPrcb);
+                        }
 
+                    } 
+                    else 
+                    {
+
+                        //
+                        // A thread has already been selected to run on
+                        // the current processor. It is possible that
+                        // the thread is the idle thread due to a state
+                        // change that made a scheduled runable thread
+                        // unrunable.
                         //
-                        // If a new thread has not been selected to run on
-                        // the current processor, then attempt to select a
-                        // thread to run on the current processor.
+                        // N.B. If the idle thread is selected, then the
+                        //      current processor is idle. Otherwise,
+                        //      the current processor is not idle.
                         //
 
-                        if ((NewThread = CurrentPrcb->NextThread) == NULL)          // ǰNextThreadǿ
+                        if (NewThread == CurrentPrcb->IdleThread)             // ǰѾѡִһ̣߳ǿ߳
                         {
-                            if ((TargetPrcb->ReadySummary != 0) &&
-                                (NewThread = KiFindReadyThread(Processor,
-                                                               TargetPrcb)) != NULL) // Ŀ괦ҵһ߳ȡ
-                            {
-    
-                                //
-                                // A new thread has been found to run on the
-                                // current processor. 
-                                //
-        
-                                NewThread->State = Running;                         // ȵǰִ
-                                KiReleasePrcbLock(TargetPrcb);
-                                CurrentPrcb->CurrentThread = NewThread;
-
-                                //
-                                // Clear idle on the current processor and
-                                // update the idle summary SMT set to indicate
-                                // the physical processor is not entirely idle.
-                                //
-
-                                KiClearIdleSummary(AFFINITY_MASK(Processor));
-                                KiClearSMTSummary(CurrentPrcb->MultiThreadProcessorSet);
-                                goto ThreadFound;
-
-                            } 
-                            else                                                    // Ŀ괦ʧܵ
-                            {
-                                KiReleasePrcbLock(CurrentPrcb);
-                                KiReleasePrcbLock(TargetPrcb);
-                            }
+                            CurrentPrcb->NextThread = NULL;
+                            CurrentPrcb->IdleSchedule = FALSE;
+                            KiReleasePrcbLock(CurrentPrcb);
+                            KiReleasePrcbLock(TargetPrcb);
+                            continue;                                         // ڲ
 
                         } 
-                        else 
+                        else
                         {
-
-                            //
-                            // A thread has already been selected to run on
-                            // the current processor. It is possible that
-                            // the thread is the idle thread due to a state
-                            // change that made a scheduled runable thread
-                            // unrunable.
-                            //
-                            // N.B. If the idle thread is selected, then the
-                            //      current processor is idle. Otherwise,
-                            //      the current processor is not idle.
-                            //
-
-                            if (NewThread == CurrentPrcb->IdleThread)             // ǰѾѡִһ̣߳ǿ߳
-                            {
-                                CurrentPrcb->NextThread = NULL;
-                                CurrentPrcb->IdleSchedule = FALSE;
-                                KiReleasePrcbLock(CurrentPrcb);
-                                KiReleasePrcbLock(TargetPrcb);
-                                continue;                                         // ڲ
-
-                            } 
-                            else
-                            {
-                                NewThread->State = Running;                       // ˵Ѿ
-                                KiReleasePrcbLock(TargetPrcb);
-                                CurrentPrcb->NextThread = NULL;
-                                CurrentPrcb->CurrentThread = NewThread;
-                                goto ThreadFound;
-                            }
+                            NewThread->State = Running;                       // ˵Ѿ
+                            KiReleasePrcbLock(TargetPrcb);
+                            CurrentPrcb->NextThread = NULL;
+                            CurrentPrcb->CurrentThread = NewThread;
+                            goto ThreadFound;
                         }
                     }
                 }
-        
-                Index -= 1;
-                if (Index < 0)
-                {
-                    Index = Limit;
-                }
-        
-                Number -= 1;
-            } while (Number >= 0);
+            }
 
             //
             // Acquire the current PRCB lock and if a thread has not been
@@ -317,6 +317,61 @@ Return Value:
 
 --*/
 
+{
+
+    //
+    // Set the timer with a tolerable delay of zero.
+    //
+
+    return KeSetCoalescableTimer(Timer, DueTime, Period, 0, Dpc);
+}
+
+BOOLEAN
+KeSetCoalescableTimer (
+    __inout PKTIMER Timer,
+    __in LARGE_INTEGER DueTime,
+    __in LONG Period,
+    __in ULONG TolerableDelay,
+    __in_opt PKDPC Dpc
+    )
+
+/*++
+
+Routine Description:
+
+    This function sets a timer to expire at a specified time, allowing the
+    expiration to be delayed by up to the specified tolerable delay so that
+    it can be coalesced with the expiration of other timers. If the timer is
+    already set, then it is implicitly canceled before it is set to expire at
+    the specified time. Setting a timer causes its due time to be computed,
+    its state to be set to Not-Signaled, and the timer object itself to be
+    inserted in the timer list.
+
+    N.B. The tolerable delay applies to the due time computed when the timer
+         is set. Periodic expirations are reinserted at the exact period.
+
+Arguments:
+
+    Timer - Supplies a pointer to a dispatcher object of type timer.
+
+    DueTime - Supplies an absolute or relative time at which the timer
+        is to expire.
+
+    Period - Supplies an optional period for the timer in milliseconds.
+
+    TolerableDelay - Supplies the delay in milliseconds by which the timer
+        expiration may be deferred. A value of zero specifies the timer is
+        to expire at the exact due time.
+
+    Dpc - Supplies an optional pointer to a control object of type DPC.
+
+Return Value:
+
+    A boolean value of TRUE is returned if the the specified timer was
+    currently set. Otherwise, a value of FALSE is returned.
+
+--*/
+
 {
 
     ULONG Hand;
@@ -344,8 +399,9 @@ Return Value:
     //
     // Set the DPC address, set the period, and compute the timer due time.
     // If the timer has already expired, then signal the timer. Otherwise,
-    // set the signal state to false and attempt to insert the timer in the
-    // timer table.
+    // delay the due time to the coalescing boundary within the tolerable
+    // delay, set the signal state to false, and attempt to insert the timer
+    // in the timer table.
     //
     // N.B. The signal state must be cleared before it is inserted in the
     //      timer table in case the period is not zero.
@@ -361,6 +417,10 @@ Return Value:
         }
 
     } else {
+        if (TolerableDelay != 0) {
+            Hand = KiCoalesceDueTime(Timer, TolerableDelay);
+        }
+
         Timer->Header.SignalState = FALSE;
         KiInsertOrSignalTimer(Timer, Hand);
     }
@@ -464,7 +524,9 @@ Return Value:
     PKSPIN_LOCK_QUEUE LockQueue;
     PLIST_ENTRY NextEntry;
     KIRQL OldIrql;
+    ULONG Processor;
     PKTIMER Timer;
+    PKTIMER_TABLE TimerTable;
     PUCHAR Start;
 
     //
@@ -485,15 +547,20 @@ Return Value:
     //
     // Raise IRQL to dispatcher level and lock dispatcher database.
     //
-    // Scan the timer database and check for any timers in the specified
-    // memory block.
+    // Scan the near and far lists of the timer table of each processor and
+    // check for any timers in the specified memory block.
     //
 
     KiLockDispatcherDatabase(&OldIrql);
     Index = 0;
+    Processor = 0;
     do {
-        ListHead = &KiTimerTableListHead[Index].Entry;
-        LockQueue = KiAcquireTimerTableLock(Index);
+        TimerTable = KiGetTimerTable(Processor);
+        ListHead = &TimerTable->TimerEntries[Index].Entry;
+        LockQueue = KiAcquireTimerTableLock(Processor, Index);
+
+    ScanList:
+
         NextEntry = ListHead->Flink;
         while (NextEntry != ListHead) {
             Timer = CONTAINING_RECORD(NextEntry, KTIMER, TimerListEntry);
@@ -544,9 +611,19 @@ Return Value:
             }
         }
 
+        if (ListHead != &TimerTable->FarEntries[Index].Entry) {
+            ListHead = &TimerTable->FarEntries[Index].Entry;
+            goto ScanList;
+        }
+
         KiReleaseTimerTableLock(LockQueue);
         Index += 1;
-    } while(Index < TIMER_TABLE_SIZE);
+        if (Index == TIMER_TABLE_SIZE) {
+            Index = 0;
+            Processor += 1;
+        }
+
+    } while(Processor < (ULONG)KeNumberProcessors);
 
     //
     // Unlock the dispatcher database and lower IRQL to its previous value
@@ -91,6 +91,166 @@ Return Value:
     return;
 }
 
+FORCEINLINE
+LOGICAL
+KiInsertNearTimer (
+    IN PKTIMER_TABLE TimerTable,
+    IN PKTIMER Timer,
+    IN ULONG Hand
+    )
+
+/*++
+
+Routine Description:
+
+    This function inserts a timer object in the sorted near list of the
+    specified timer table entry.
+
+    N.B. This routine assumes that the timer table lock has been acquired.
+
+Arguments:
+
+    TimerTable - Supplies a pointer to the timer table of the processor on
+        which the timer was set.
+
+    Timer - Supplies a pointer to a dispatcher object of type timer.
+
+    Hand - supplies the timer table hand value.
+
+Return Value:
+
+    If the timer was inserted at the front of the near list, then a value
+    of TRUE is returned. Otherwise, a value of FALSE is returned.
+
+--*/
+
+{
+
+    ULONG64 DueTime;
+    PLIST_ENTRY ListHead;
+    PLIST_ENTRY NextEntry;
+    PKTIMER NextTimer;
+
+    //
+    // Insert the timer in the sorted order of the list searching from the
+    // back of the list forward.
+    //
+
+    DueTime = Timer->DueTime.QuadPart;
+    ListHead = &TimerTable->TimerEntries[Hand].Entry;
+    NextEntry = ListHead->Blink;
+    while (NextEntry != ListHead) {
+        NextTimer = CONTAINING_RECORD(NextEntry, KTIMER, TimerListEntry);
+        if (DueTime >= (ULONG64)NextTimer->DueTime.QuadPart) {
+            break;
+        }
+
+        NextEntry = NextEntry->Blink;
+    }
+
+    InsertHeadList(NextEntry, &Timer->TimerListEntry);
+    return (LOGICAL)(NextEntry == ListHead);
+}
+
+VOID
+FASTCALL
+KiCascadeTimerTable (
+    IN PKTIMER_TABLE TimerTable,
+    IN ULONG Hand,
+    IN ULONG64 CurrentTime
+    )
+
+/*++
+
+Routine Description:
+
+    This function moves the timers in the far list of the specified timer
+    table entry that are due within one revolution of the current time to
+    the near list, and recomputes the due times of the timer table entry.
+
+    N.B. This routine assumes that the timer table lock has been acquired.
+
+Arguments:
+
+    TimerTable - Supplies a pointer to the timer table of the current
+        processor.
+
+    Hand - supplies the timer table hand value.
+
+    CurrentTime - Supplies the current interrupt time.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG64 DueTime;
+    PKTIMER_TABLE_ENTRY FarEntry;
+    ULONG64 FarTime;
+    PLIST_ENTRY ListHead;
+    PLIST_ENTRY NextEntry;
+    PKTIMER Timer;
+
+    //
+    // Scan the far list and cascade each timer that is now due within one
+    // revolution into the near list. Capture the earliest due time of the
+    // timers that remain in the far list.
+    //
+
+    FarEntry = &TimerTable->FarEntries[Hand];
+    FarTime = TIMER_INFINITE_TIME;
+    NextEntry = FarEntry->Entry.Flink;
+    while (NextEntry != &FarEntry->Entry) {
+        Timer = CONTAINING_RECORD(NextEntry, KTIMER, TimerListEntry);
+        NextEntry = NextEntry->Flink;
+        DueTime = Timer->DueTime.QuadPart;
+        if (DueTime < (CurrentTime + TIMER_TABLE_REVOLUTION)) {
+            RemoveEntryList(&Timer->TimerListEntry);
+            KiInsertNearTimer(TimerTable, Timer, Hand);
+
+        } else if (DueTime < FarTime) {
+            FarTime = DueTime;
+        }
+    }
+
+    //
+    // Set the far due time and set the due time of the timer table entry to
+    // the earlier of the first near timer and the cascade time.
+    //
+    // N.B. On the x86 the write of the due time is not atomic. Therefore,
+    //      interrupts must be disabled to synchronize with the clock
+    //      interrupt so the clock interupt code does not observe a partial
+    //      update of the due time.
+    //
+
+    FarEntry->Time.QuadPart = FarTime;
+    DueTime = KiComputeCascadeTime(TimerTable, Hand);
+    ListHead = &TimerTable->TimerEntries[Hand].Entry;
+    if (ListHead->Flink != ListHead) {
+        Timer = CONTAINING_RECORD(ListHead->Flink, KTIMER, TimerListEntry);
+        if ((ULONG64)Timer->DueTime.QuadPart < DueTime) {
+            DueTime = Timer->DueTime.QuadPart;
+        }
+    }
+
+#if defined(_X86_)
+
+    _disable();
+    TimerTable->TimerEntries[Hand].Time.QuadPart = DueTime;
+    _enable();
+
+#else
+
+    TimerTable->TimerEntries[Hand].Time.QuadPart = DueTime;
+
+#endif
+
+    return;
+}
+
 LOGICAL
 FASTCALL
 KiInsertTimerTable (
@@ -102,7 +262,8 @@ KiInsertTimerTable (
 
 Routine Description:
 
-    This function inserts a timer object in the timer table.
+    This function inserts a timer object in the timer table of the processor
+    on which the timer was set.
 
     N.B. This routine assumes that the timer table lock has been acquired.
 
@@ -121,12 +282,12 @@ Return Value:
 
 {
 
+    ULONG64 CascadeTime;
     ULONG64 DueTime;
     LOGICAL Expired;
+    PKTIMER_TABLE_ENTRY FarEntry;
     ULARGE_INTEGER InterruptTime;
-    PLIST_ENTRY ListHead;
-    PLIST_ENTRY NextEntry;
-    PKTIMER NextTimer;
+    PKTIMER_TABLE TimerTable;
 
     //
     // Set the signal state to FALSE if the period is zero.
@@ -153,27 +314,37 @@ Return Value:
     //
 
     DueTime = Timer->DueTime.QuadPart;
+    TimerTable = KiGetTimerTable(Timer->Header.Processor);
 
     ASSERT(Hand == KiComputeTimerTableIndex(DueTime));
 
-    ListHead = &KiTimerTableListHead[Hand].Entry;
-    NextEntry = ListHead->Blink;
-    while (NextEntry != ListHead) {
-
-        //
-        // Compute the maximum search count.
-        //
+    //
+    // If the timer is due one or more revolutions of the timer table in the
+    // future, then append the timer to the unsorted far list of the computed
+    // entry. The far list is cascaded into the near list by the timer
+    // expiration scan in the revolution before the timer is due, so long
+    // timeouts neither lengthen the sorted near list nor are examined on
+    // every pass of the hand.
+    //
+    // N.B. The due time of the table entry is lowered to the cascade time
+    //      so the clock interrupt requests a scan of the entry.
+    //
 
-        NextTimer = CONTAINING_RECORD(NextEntry, KTIMER, TimerListEntry);
-        if (DueTime >= (ULONG64)NextTimer->DueTime.QuadPart) {
-            break;
+    KiQueryInterruptTime((PLARGE_INTEGER)&InterruptTime);
+    if ((DueTime > (ULONG64)InterruptTime.QuadPart) &&
+        ((DueTime - InterruptTime.QuadPart) >= TIMER_TABLE_REVOLUTION)) {
+
+        FarEntry = &TimerTable->FarEntries[Hand];
+        InsertTailList(&FarEntry->Entry, &Timer->TimerListEntry);
+        if (DueTime < FarEntry->Time.QuadPart) {
+            FarEntry->Time.QuadPart = DueTime;
+            CascadeTime = DueTime - TIMER_TABLE_REVOLUTION;
+            if (CascadeTime < TimerTable->TimerEntries[Hand].Time.QuadPart) {
+                TimerTable->TimerEntries[Hand].Time.QuadPart = CascadeTime;
+            }
         }
 
-        NextEntry = NextEntry->Blink;
-    }
-
-    InsertHeadList(NextEntry, &Timer->TimerListEntry);
-    if (NextEntry == ListHead) {
+    } else if (KiInsertNearTimer(TimerTable, Timer, Hand) != FALSE) {
 
         //
         // The computed list is empty or the timer is due to expire before
@@ -182,8 +353,16 @@ Return Value:
         // Make sure the writes for the update of the due time table are done
         // before reading the interrupt time.
         //
+        // N.B. The due time of the table entry must not be raised above the
+        //      cascade time of the far list.
+        //
+
+        CascadeTime = KiComputeCascadeTime(TimerTable, Hand);
+        if (DueTime < CascadeTime) {
+            CascadeTime = DueTime;
+        }
 
-        KiTimerTableListHead[Hand].Time.QuadPart = DueTime; 
+        TimerTable->TimerEntries[Hand].Time.QuadPart = CascadeTime; 
         KeMemoryBarrier();
         KiQueryInterruptTime((PLARGE_INTEGER)&InterruptTime);
         if (DueTime <= (ULONG64)InterruptTime.QuadPart) {
@@ -618,6 +618,7 @@ Return Value:
     LARGE_INTEGER DueTime;
     ULONG Hand;
     ULONG_PTR Index;
+    ULONG LockMask;
     LARGE_INTEGER NewTime;
     PKMUTANT Objectx;
     PLARGE_INTEGER OriginalTime;
@@ -712,6 +713,15 @@ Return Value:
 
         } else {
 
+            //
+            // Lock the wait objects in the defined object lock order. The
+            // object locks are held until the wait is satisfied or the wait
+            // blocks are inserted so a concurrent signal that does not lock
+            // the dispatcher database cannot be missed.
+            //
+
+            LockMask = KiAcquireObjectLocks(Count, Object);
+
             //
             // Construct wait blocks and check to determine if the wait is
             // already satisfied. If the wait is satisfied, then perform
@@ -748,6 +758,7 @@ Return Value:
                                 goto NoWait;
 
                             } else {
+                                KiReleaseObjectLocks(LockMask);
                                 KiUnlockDispatcherDatabase(Thread->WaitIrql);
                                 ExRaiseStatus(STATUS_MUTANT_LIMIT_EXCEEDED);
                             }
@@ -791,6 +802,7 @@ Return Value:
                     if (Objectx->Header.Type == MutantObject) {
                         if ((Thread == Objectx->OwnerThread) &&
                             (Objectx->Header.SignalState == MINLONG)) {
+                            KiReleaseObjectLocks(LockMask);
                             KiUnlockDispatcherDatabase(Thread->WaitIrql);
                             ExRaiseStatus(STATUS_MUTANT_LIMIT_EXCEEDED);
 
@@ -869,6 +881,8 @@ Return Value:
                 WaitBlock = WaitBlock->NextWaitBlock;
             } while (WaitBlock != &WaitBlockArray[0]);
 
+            KiReleaseObjectLocks(LockMask);
+
             //
             // If the current thread is processing a queue entry, then attempt
             // to activate another thread that is blocked on the queue object.
@@ -944,21 +958,24 @@ WaitStart:
 
     //
     // The thread is alerted or a user APC should be delivered. Unlock the
-    // dispatcher database, lower IRQL to its previous value, and return
-    // the wait status.
+    // wait objects and the dispatcher database, lower IRQL to its previous
+    // value, and return the wait status.
     //
 
+    KiReleaseObjectLocks(LockMask);
     KiUnlockDispatcherDatabase(Thread->WaitIrql);
     return WaitStatus;
 
     //
     // The wait has been satisfied without actually waiting.
     //
-    // Unlock the dispatcher database and remain at SYNCH level.
+    // Unlock the wait objects and the dispatcher database and remain at
+    // SYNCH level.
     //
 
 NoWait:
 
+    KiReleaseObjectLocks(LockMask);
     KiUnlockDispatcherDatabaseFromSynchLevel();
 
     //
@@ -1056,6 +1073,7 @@ Return Value:
     PKPRCB CurrentPrcb;
     LARGE_INTEGER DueTime;
     ULONG Hand;
+    PKOBJECT_LOCK_ENTRY LockEntry;
     LARGE_INTEGER NewTime;
     PKMUTANT Objectx;
     PLARGE_INTEGER OriginalTime;
@@ -1150,6 +1168,14 @@ Return Value:
             /* һmutantź״̬0 еǰ߳mutantowner,ȴ */
             ASSERT(Objectx->Header.Type != QueueObject);
 
+            //
+            // Lock the wait object. The object lock is held until the wait
+            // is satisfied or the wait block is inserted so a concurrent
+            // signal that does not lock the dispatcher database cannot be
+            // missed.
+            //
+
+            LockEntry = KiAcquireObjectLock(Objectx);
             if (Objectx->Header.Type == MutantObject) 
             {
                 if ((Objectx->Header.SignalState > 0) ||
@@ -1163,6 +1189,7 @@ Return Value:
                     } 
                     else
                     {
+                        KiReleaseObjectLock(LockEntry);
                         KiUnlockDispatcherDatabase(Thread->WaitIrql);
                         ExRaiseStatus(STATUS_MUTANT_LIMIT_EXCEEDED);
                     }
@@ -1220,6 +1247,7 @@ Return Value:
             //
 
             InsertTailList(&Objectx->Header.WaitListHead, &WaitBlock->WaitListEntry);
+            KiReleaseObjectLock(LockEntry);
 
             //
             // If the current thread is processing a queue entry, then attempt
@@ -1303,21 +1331,24 @@ WaitStart:
 
     //
     // The thread is alerted or a user APC should be delivered. Unlock the
-    // dispatcher database, lower IRQL to its previous value, and return
-    // the wait status.
+    // wait object and the dispatcher database, lower IRQL to its previous
+    // value, and return the wait status.
     //
 
+    KiReleaseObjectLock(LockEntry);
     KiUnlockDispatcherDatabase(Thread->WaitIrql);
     return WaitStatus;
 
     //
     // The wait has been satisfied without actually waiting.
     //
-    // Unlock the dispatcher database and remain at SYNCH level.
+    // Unlock the wait object and the dispatcher database and remain at
+    // SYNCH level.
     //
 
 NoWait:
 
+    KiReleaseObjectLock(LockEntry);
     KiUnlockDispatcherDatabaseFromSynchLevel();
 
     //
@@ -2364,10 +2364,40 @@ Return Value:
 {
     PMMVAD FoundVad;
     ULONG_PTR Vpn;
+    PETHREAD Thread;
+    PEPROCESS Process;
     PMM_AVL_TABLE Table;
     TABLE_SEARCH_RESULT SearchResult;
 
-    Table = &PsGetCurrentProcess ()->VadRoot;
+    Thread = PsGetCurrentThread ();
+    Process = PsGetCurrentProcessByThread (Thread);
+
+    Table = &Process->VadRoot;
+
+    Vpn = MI_VA_TO_VPN (VirtualAddress);
+
+    //
+    // First check the VAD this thread located last.  Each thread of a
+    // multithreaded process tends to work in its own regions, so this
+    // hits where the single process wide hint below would be thrashed
+    // between threads.  The cached VAD may only be used if no VAD has been
+    // removed from the tree since it was cached (it may have been freed).
+    // The caller holds the address space mutex or the working set pushlock,
+    // so no VAD can be removed while this check is made.
+    //
+
+    if ((Thread->VadCacheSequence == Process->VadSequence) &&
+        (Thread->ThreadsProcess == Process)) {
+
+        FoundVad = (PMMVAD) Thread->VadCache;
+
+        if ((FoundVad != NULL) &&
+            (Vpn >= FoundVad->StartingVpn) &&
+            (Vpn <= FoundVad->EndingVpn)) {
+
+            return FoundVad;
+        }
+    }
 
     //
     // Note the NodeHint *MUST* be captured locally - see the synchronization
@@ -2380,10 +2410,8 @@ Return Value:
         return NULL;
     }
 
-    Vpn = MI_VA_TO_VPN (VirtualAddress);
-
     if ((Vpn >= FoundVad->StartingVpn) && (Vpn <= FoundVad->EndingVpn)) {
-        return FoundVad;
+        goto Found;
     }
 
     //
@@ -2413,6 +2441,13 @@ Return Value:
 
     Table->NodeHint = (PVOID) FoundVad;
 
+Found:
+
+    if (Thread->ThreadsProcess == Process) {
+        Thread->VadCache = (PVOID) FoundVad;
+        Thread->VadCacheSequence = Process->VadSequence;
+    }
+
     //
     // Return the VAD.
     //
@@ -32,6 +32,37 @@ MiFindContiguousMemoryInPool (
     IN PVOID CallingAddress
     );
 
+LOGICAL
+MiCompactContiguousRange (
+    IN PFN_NUMBER LowestPfn,
+    IN PFN_NUMBER HighestPfn,
+    IN PFN_NUMBER BoundaryPfn,
+    IN PFN_NUMBER SizeInPages,
+    IN MI_PFN_CACHE_ATTRIBUTE CacheAttribute
+    );
+
+LOGICAL
+MiMigrateModifiedPage (
+    IN PFN_NUMBER PageFrameIndex,
+    IN PFN_NUMBER WindowStart,
+    IN PFN_NUMBER WindowPages
+    );
+
+ULONG
+MiComputeFragmentationIndex (
+    IN PFN_NUMBER LowestPfn,
+    IN PFN_NUMBER HighestPfn,
+    OUT PPFN_NUMBER AvailablePages,
+    OUT PPFN_NUMBER LargeBlocks
+    );
+
+#if defined(MI_MULTINODE)
+PVOID
+MiAllocateRemoteNonPagedPoolPage (
+    IN POOL_TYPE PoolType
+    );
+#endif
+
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text(INIT, MiInitializeNonPagedPool)
 #pragma alloc_text(INIT, MiAddExpansionNonPagedPool)
@@ -40,6 +71,9 @@ MiFindContiguousMemoryInPool (
 
 #pragma alloc_text(PAGE, MmAvailablePoolInPages)
 #pragma alloc_text(PAGE, MiFindContiguousMemory)
+#pragma alloc_text(PAGE, MiComputeFragmentationIndex)
+#pragma alloc_text(PAGE, MiCompactPhysicalMemory)
+#pragma alloc_text(PAGE, MmGetMemoryCompactionInformation)
 #pragma alloc_text(PAGELK, MiFindContiguousMemoryInPool)
 #pragma alloc_text(PAGELK, MiFindLargePageMemory)
 
@@ -51,6 +85,9 @@ MiFindContiguousMemoryInPool (
 
 #pragma alloc_text(POOLMI, MiAllocatePoolPages)
 #pragma alloc_text(POOLMI, MiFreePoolPages)
+#if defined(MI_MULTINODE)
+#pragma alloc_text(POOLMI, MiAllocateRemoteNonPagedPoolPage)
+#endif
 #endif
 
 ULONG MmPagedPoolCommit;        // used by the debugger
@@ -58,6 +95,20 @@ ULONG MmPagedPoolCommit;        // used by the debugger
 SLIST_HEADER MiNonPagedPoolSListHead;
 ULONG MiNonPagedPoolSListMaximum = 4;
 
+#if defined(MI_MULTINODE)
+
+//
+// On multinode machines the single page nonpaged pool cache is kept per
+// node so that a freed page is only handed back out to the node it
+// physically resides on.
+//
+
+SLIST_HEADER MiNonPagedPoolNodeSListHead[MAXIMUM_CCNUMA_NODES];
+
+#endif
+
+ULONG MiNonPagedPoolRemoteAllocations;
+
 SLIST_HEADER MiPagedPoolSListHead;
 ULONG MiPagedPoolSListMaximum = 8;
 
@@ -81,6 +132,44 @@ extern KGUARDED_MUTEX MmPagedPoolMutex;
 
 #define MM_SMALL_ALLOCATIONS 4
 
+//
+// Physical memory compaction.  Modified pages are moved out of a range of
+// frames so the range can satisfy a contiguous or large page request.  The
+// working set manager also compacts proactively: every MI_COMPACTION_PERIOD
+// passes it examines the next MI_COMPACTION_SEGMENT_PAGES frames and, if
+// their fragmentation index exceeds MiCompactionWatermark, vacates one
+// large page sized block in them.  The segment counts are summed over each
+// sweep of physical memory to give the system wide fragmentation index that
+// is reported to callers, so queries never walk the PFN database.
+//
+
+#define MI_COMPACTION_BLOCK_PAGES   (MM_MINIMUM_VA_FOR_LARGE_PAGE >> PAGE_SHIFT)
+
+#define MI_COMPACTION_SEGMENT_PAGES (64 * MI_COMPACTION_BLOCK_PAGES)
+
+#define MI_COMPACTION_PERIOD        4
+
+#define MI_FRAGMENTATION_INDEX(Available, Blocks)                           \
+    (((Available) == 0) ? 0 :                                               \
+        (ULONG)(((ULONG64)((Available) - (Blocks) * MI_COMPACTION_BLOCK_PAGES) * 1000) / (Available)))
+
+ULONG MiCompactionWatermark = 500;
+
+ULONG MiCompactionPasses;
+PFN_NUMBER MiCompactionCursor;
+
+PFN_NUMBER MiCompactionSweepAvailable;
+PFN_NUMBER MiCompactionSweepBlocks;
+
+ULONG MiFragmentationIndex;
+PFN_NUMBER MiLargeBlocksAvailable;
+
+ULONG MiCompactionAttempts;
+ULONG MiCompactionSuccesses;
+ULONG MiProactiveCompactions;
+ULONG MiPagesMigrated;
+ULONG MiMigrationFailures;
+
 #if DBG
 
 ULONG MiClearCache;
@@ -1184,6 +1273,160 @@ Environment:
     return TRUE;
 }
 
+
+LOGICAL
+MiIsPoolPageLocal (
+    IN PVOID VirtualAddress
+    )
+
+/*++
+
+Routine Description:
+
+    This function determines whether the physical page backing the argument
+    nonpaged pool address resides on the current processor's node.
+
+Arguments:
+
+    VirtualAddress - Supplies a nonpaged pool virtual address.
+
+Return Value:
+
+    TRUE if the page is local to the current node (or the machine has only
+    one node), FALSE if it is remote.
+
+Environment:
+
+    This function is used by the general pool allocation routines
+    and should not be called directly.
+
+    Kernel mode, IRQL <= DISPATCH_LEVEL.
+
+--*/
+
+{
+#if defined(MI_MULTINODE)
+    PMMPFN Pfn1;
+    PMMPTE PointerPte;
+    PFN_NUMBER PageFrameIndex;
+
+    if (KeNumberNodes == 1) {
+        return TRUE;
+    }
+
+    if (MI_IS_PHYSICAL_ADDRESS (VirtualAddress)) {
+
+        //
+        // On certain architectures, virtual addresses
+        // may be physical and hence have no corresponding PTE.
+        //
+
+        PageFrameIndex = MI_CONVERT_PHYSICAL_TO_PFN (VirtualAddress);
+    }
+    else {
+        PointerPte = MiGetPteAddress (VirtualAddress);
+
+        //
+        // Freed pool may be protected (ie: the PTE is not valid) - just
+        // treat it as local since its frame cannot be cheaply determined.
+        //
+
+        if (PointerPte->u.Hard.Valid == 0) {
+            return TRUE;
+        }
+
+        PageFrameIndex = MI_GET_PAGE_FRAME_FROM_PTE (PointerPte);
+    }
+
+    Pfn1 = MI_PFN_ELEMENT (PageFrameIndex);
+
+    if (Pfn1->u3.e1.PageColor != KeGetCurrentNode()->Color) {
+        return FALSE;
+    }
+#else
+    UNREFERENCED_PARAMETER (VirtualAddress);
+#endif
+
+    return TRUE;
+}
+
+#if defined(MI_MULTINODE)
+
+PVOID
+MiAllocateRemoteNonPagedPoolPage (
+    IN POOL_TYPE PoolType
+    )
+
+/*++
+
+Routine Description:
+
+    This function is called when a single page nonpaged pool allocation
+    is about to fail.  Pages cached on the single page slists of the other
+    nodes are neither on the free lists nor counted as free pool, so one
+    of them is handed out rather than failing the request.
+
+Arguments:
+
+    PoolType - Supplies the type of pool to allocate.
+
+Return Value:
+
+    The virtual address of the page, NULL if every node's slist is empty.
+
+Environment:
+
+    Kernel mode, IRQL <= DISPATCH_LEVEL, no locks held.
+
+--*/
+
+{
+    ULONG Color;
+    ULONG LocalColor;
+    PVOID BaseVa;
+    PMMPFN Pfn1;
+    PMMPTE PointerPte;
+    PFN_NUMBER PageFrameIndex;
+
+    LocalColor = KeGetCurrentNode()->Color;
+
+    for (Color = 0; Color < KeNumberNodes; Color += 1) {
+
+        if ((Color == LocalColor) ||
+            (ExQueryDepthSList (&MiNonPagedPoolNodeSListHead[Color]) == 0)) {
+
+            continue;
+        }
+
+        BaseVa = InterlockedPopEntrySList (&MiNonPagedPoolNodeSListHead[Color]);
+
+        if (BaseVa == NULL) {
+            continue;
+        }
+
+        if (PoolType & POOL_VERIFIER_MASK) {
+            if (MI_IS_PHYSICAL_ADDRESS(BaseVa)) {
+                PageFrameIndex = MI_CONVERT_PHYSICAL_TO_PFN (BaseVa);
+            }
+            else {
+                PointerPte = MiGetPteAddress(BaseVa);
+                ASSERT (PointerPte->u.Hard.Valid == 1);
+                PageFrameIndex = MI_GET_PAGE_FRAME_FROM_PTE (PointerPte);
+            }
+            Pfn1 = MI_PFN_ELEMENT (PageFrameIndex);
+            Pfn1->u4.VerifierAllocation = 1;
+        }
+
+        MiNonPagedPoolRemoteAllocations += 1;
+
+        return BaseVa;
+    }
+
+    return NULL;
+}
+
+#endif
+
 
 PVOID
 MiAllocatePoolPages (
@@ -1250,6 +1493,11 @@ Environment:
     ULONG FlushCount;
     PVOID VaFlushList[MM_MAXIMUM_FLUSH_COUNT];
     LOGICAL PreviousPteNeededFlush;
+    PSLIST_HEADER SListHead;
+    LOGICAL LocalNodeOnly;
+#if defined(MI_MULTINODE)
+    PKNODE Node;
+#endif
 
     SizeInPages = BYTES_TO_PAGES (SizeInBytes);
 
@@ -1261,10 +1509,28 @@ Environment:
 
     if ((PoolType & BASE_POOL_TYPE_MASK) == NonPagedPool) {
 
+        SListHead = &MiNonPagedPoolSListHead;
+        LocalNodeOnly = FALSE;
+
+#if defined(MI_MULTINODE)
+
+        //
+        // On multinode machines, satisfy the request from pages that are
+        // local to the current node whenever possible.  Remote pages are
+        // only handed out when the local node is under memory pressure
+        // or local expansion fails.
+        //
+
+        if (KeNumberNodes > 1) {
+            SListHead = &MiNonPagedPoolNodeSListHead[KeGetCurrentNode()->Color];
+            LocalNodeOnly = TRUE;
+        }
+#endif
+
         if ((SizeInPages == 1) &&
-            (ExQueryDepthSList (&MiNonPagedPoolSListHead) != 0)) {
+            (ExQueryDepthSList (SListHead) != 0)) {
 
-            BaseVa = InterlockedPopEntrySList (&MiNonPagedPoolSListHead);
+            BaseVa = InterlockedPopEntrySList (SListHead);
 
             if (BaseVa != NULL) {
 
@@ -1295,6 +1561,10 @@ Environment:
         // NonPaged pool is linked together through the pages themselves.
         //
 
+#if defined(MI_MULTINODE)
+ScanFreeLists:
+#endif
+
         ListHead = &MmNonPagedPoolFreeListHead[Index];
         LastListHead = &MmNonPagedPoolFreeListHead[MI_MAX_FREE_LIST_HEADS];
 
@@ -1319,7 +1589,16 @@ Environment:
                                                  List);
     
                 ASSERT (FreePageInfo->Signature == MM_FREE_POOL_SIGNATURE);
-                if (FreePageInfo->Size >= SizeInPages) {
+
+                //
+                // The pages are removed from the end of the entry so that
+                // is the page whose node must match on a local-only pass.
+                //
+
+                if ((FreePageInfo->Size >= SizeInPages) &&
+                    ((LocalNodeOnly == FALSE) ||
+                     (MiIsPoolPageLocal ((PVOID)((PCHAR)FreePageInfo +
+                        ((FreePageInfo->Size - SizeInPages) << PAGE_SHIFT))) == TRUE))) {
     
                     //
                     // This entry has sufficient space, remove
@@ -1400,6 +1679,13 @@ Environment:
                         Pfn1->u4.VerifierAllocation = 1;
                     }
 
+#if defined(MI_MULTINODE)
+                    if ((KeNumberNodes > 1) &&
+                        (Pfn1->u3.e1.PageColor != KeGetCurrentNode()->Color)) {
+                        MiNonPagedPoolRemoteAllocations += 1;
+                    }
+#endif
+
                     //
                     // Calculate the ending PTE's address.
                     //
@@ -1462,6 +1748,28 @@ Environment:
 
         KeReleaseQueuedSpinLock (LockQueueMmNonPagedPoolLock, OldIrql);
 
+#if defined(MI_MULTINODE)
+
+        //
+        // No local free pool was found.  Expanding would normally yield
+        // local pages, but if this node has no free pages left (or the pool
+        // is nearly exhausted) then reuse remote free pool rather than
+        // consuming more of the pool's virtual address space.
+        //
+
+        if (LocalNodeOnly == TRUE) {
+
+            Node = KeGetCurrentNode ();
+
+            if (((Node->FreeCount[ZeroedPageList] | Node->FreeCount[FreePageList]) == 0) ||
+                (MmMaximumNonPagedPoolInPages - MmAllocatedNonPagedPool < MiHighNonPagedPoolThreshold)) {
+
+                LocalNodeOnly = FALSE;
+                goto ScanFreeLists;
+            }
+        }
+#endif
+
         //
         // No more entries on the list, expand nonpaged pool if
         // possible to satisfy this request.
@@ -1519,6 +1827,22 @@ Environment:
 
             if (StartingPte == NULL) {
 
+#if defined(MI_MULTINODE)
+                if (LocalNodeOnly == TRUE) {
+                    LocalNodeOnly = FALSE;
+                    goto ScanFreeLists;
+                }
+
+                if ((SizeInPages == 1) && (KeNumberNodes > 1)) {
+
+                    BaseVa = MiAllocateRemoteNonPagedPoolPage (PoolType);
+
+                    if (BaseVa != NULL) {
+                        return BaseVa;
+                    }
+                }
+#endif
+
                 MmPoolFailures[MmNonPagedPool][MmHighPriority] += 1;
                 MmPoolFailureReasons[MmNonPagedNoPtes] += 1;
 
@@ -1593,6 +1917,22 @@ Environment:
                                      (ULONG)SizeInPages,
                                      NonPagedPoolExpansion);
 
+#if defined(MI_MULTINODE)
+                if (LocalNodeOnly == TRUE) {
+                    LocalNodeOnly = FALSE;
+                    goto ScanFreeLists;
+                }
+
+                if ((SizeInPages == 1) && (KeNumberNodes > 1)) {
+
+                    BaseVa = MiAllocateRemoteNonPagedPoolPage (PoolType);
+
+                    if (BaseVa != NULL) {
+                        return BaseVa;
+                    }
+                }
+#endif
+
                 MmPoolFailures[MmNonPagedPool][MmHighPriority] += 1;
                 MmPoolFailureReasons[MmNonPagedNoCommit] += 1;
                 MiTrimSegmentCache ();
@@ -1789,6 +2129,13 @@ Environment:
         Pfn1 = MI_PFN_ELEMENT (StartingPte->u.Hard.PageFrameNumber);
         Pfn1->u3.e1.StartOfAllocation = 1;
 
+#if defined(MI_MULTINODE)
+        if ((KeNumberNodes > 1) &&
+            (Pfn1->u3.e1.PageColor != KeGetCurrentNode()->Color)) {
+            MiNonPagedPoolRemoteAllocations += 1;
+        }
+#endif
+
         ASSERT (Pfn1->u4.VerifierAllocation == 0);
 
         if (PoolType & POOL_VERIFIER_MASK) {
@@ -2468,6 +2815,7 @@ Environment:
     PMM_PAGED_POOL_INFO PagedPoolInfo;
     PMM_SESSION_SPACE SessionSpace;
     PFN_NUMBER PagesFreed;
+    PSLIST_HEADER SListHead;
     MMPFNENTRY OriginalPfnFlags;
     ULONG_PTR VerifierAllocation;
     PULONG BitMap;
@@ -2569,14 +2917,23 @@ Environment:
         ASSERT (Pfn1->u4.PteFrame != MI_MAGIC_AWE_PTEFRAME);
 
         //
-        // Hang single page allocations off our slist header.
+        // Hang single page allocations off our slist header.  On multinode
+        // machines the page goes to the slist of the node it resides on.
         //
 
+        SListHead = &MiNonPagedPoolSListHead;
+
+#if defined(MI_MULTINODE)
+        if (KeNumberNodes > 1) {
+            SListHead = &MiNonPagedPoolNodeSListHead[Pfn1->u3.e1.PageColor];
+        }
+#endif
+
         if ((Pfn1->u3.e1.EndOfAllocation == 1) &&
             (Pfn1->u4.VerifierAllocation == 0) &&
             (Pfn1->u3.e1.LargeSessionAllocation == 0) &&
-            (ExQueryDepthSList (&MiNonPagedPoolSListHead) < MiNonPagedPoolSListMaximum)) {
-            InterlockedPushEntrySList (&MiNonPagedPoolSListHead,
+            (ExQueryDepthSList (SListHead) < MiNonPagedPoolSListMaximum)) {
+            InterlockedPushEntrySList (SListHead,
                                        (PSLIST_ENTRY) StartingAddress);
             return 1;
         }
@@ -3442,6 +3799,12 @@ Environment:
     InitializeSListHead (&MiPagedPoolSListHead);
     InitializeSListHead (&MiNonPagedPoolSListHead);
 
+#if defined(MI_MULTINODE)
+    for (Index = 0; Index < MAXIMUM_CCNUMA_NODES; Index += 1) {
+        InitializeSListHead (&MiNonPagedPoolNodeSListHead[Index]);
+    }
+#endif
+
     if (MmNumberOfPhysicalPages >= (2*1024*((1024*1024)/PAGE_SIZE))) {
         MiNonPagedPoolSListMaximum <<= 3;
         MiPagedPoolSListMaximum <<= 3;
@@ -4774,6 +5137,7 @@ Environment:
     MI_PFN_CACHE_ATTRIBUTE CacheAttribute;
     ULONG RetryCount;
     LOGICAL FlushedTb;
+    LOGICAL Compacted;
 
     PAGED_CODE ();
 
@@ -4839,6 +5203,7 @@ Environment:
     UNLOCK_PFN (OldIrql);
 
     RetryCount = 4;
+    Compacted = FALSE;
 
 Retry:
 
@@ -4975,6 +5340,22 @@ Retry:
         goto Failed;
     }
 
+    //
+    // Try to vacate a range by moving the modified pages out of it before
+    // resorting to trimming every working set in the system.
+    //
+
+    if ((Compacted == FALSE) &&
+        (MiCompactContiguousRange (LowestPfn,
+                                   HighestPfn,
+                                   BoundaryPfn,
+                                   SizeInPages,
+                                   CacheAttribute) == TRUE)) {
+
+        Compacted = TRUE;
+        goto Retry;
+    }
+
     InterlockedIncrement (&MiDelayPageFaults);
 
     //
@@ -5062,6 +5443,7 @@ Retry:
 
     if (RetryCount != 0) {
         RetryCount -= 1;
+        Compacted = FALSE;
         goto Retry;
     }
 
@@ -5178,6 +5560,630 @@ Success:
     return Page;
 }
 
+LOGICAL
+MiCompactContiguousRange (
+    IN PFN_NUMBER LowestPfn,
+    IN PFN_NUMBER HighestPfn,
+    IN PFN_NUMBER BoundaryPfn,
+    IN PFN_NUMBER SizeInPages,
+    IN MI_PFN_CACHE_ATTRIBUTE CacheAttribute
+    )
+
+/*++
+
+Routine Description:
+
+    This function searches for a range of pages which would satisfy the
+    request if the modified pages in it were moved elsewhere, and then
+    moves them.  Only the first such range found is compacted.
+
+Arguments:
+
+    LowestPfn - Supplies the lowest acceptable physical page number.
+
+    HighestPfn - Supplies the highest acceptable physical page number.
+
+    BoundaryPfn - Supplies the page frame number multiple the allocation must
+                  not cross.  0 indicates it can cross any boundary.
+
+    SizeInPages - Supplies the number of pages to vacate.
+
+    CacheAttribute - Supplies the cache attribute the pages will be mapped
+                     with.
+
+Return Value:
+
+    TRUE if a range was vacated (the caller must rescan as the PFN lock is
+    not held on return), FALSE if not.
+
+Environment:
+
+    Kernel mode, IRQL of APC_LEVEL or below, dynamic memory mutex held shared.
+
+--*/
+
+{
+    PMMPFN Pfn1;
+    ULONG start;
+    PFN_NUMBER count;
+    PFN_NUMBER Page;
+    PFN_NUMBER LastPage;
+    PFN_NUMBER found;
+    PFN_NUMBER Movable;
+    PFN_NUMBER BoundaryMask;
+    LOGICAL Migratable;
+
+    BoundaryMask = ~(BoundaryPfn - 1);
+
+    start = 0;
+
+    do {
+
+        count = MmPhysicalMemoryBlock->Run[start].PageCount;
+        Page = MmPhysicalMemoryBlock->Run[start].BasePage;
+
+        LastPage = Page + count; 
+
+        if (LastPage - 1 > HighestPfn) {
+            LastPage = HighestPfn + 1;
+        }
+    
+        if (Page < LowestPfn) {
+            Page = LowestPfn;
+        }
+
+        if ((count != 0) && (Page + SizeInPages <= LastPage)) {
+
+            found = 0;
+            Movable = 0;
+            Pfn1 = MI_PFN_ELEMENT (Page);
+
+            for ( ; Page < LastPage; Page += 1, Pfn1 += 1) {
+
+                if (MI_IS_PFN_MIGRATABLE (Pfn1)) {
+                    Migratable = TRUE;
+                }
+                else if ((Pfn1->u3.e1.PageLocation <= StandbyPageList) &&
+                         (Pfn1->u1.Flink != 0) &&
+                         (Pfn1->u2.Blink != 0) &&
+                         (Pfn1->u3.e2.ReferenceCount == 0) &&
+                         ((CacheAttribute == MiCached) || (Pfn1->u4.MustBeCached == 0))) {
+                    Migratable = FALSE;
+                }
+                else {
+                    found = 0;
+                    Movable = 0;
+                    continue;
+                }
+
+                if ((found == 0) && (BoundaryPfn != 0)) {
+                    if (((Page ^ (Page + SizeInPages - 1)) & BoundaryMask) != 0) {
+                        continue;
+                    }
+                }
+
+                found += 1;
+
+                if (Migratable == TRUE) {
+                    Movable += 1;
+                }
+
+                if (found == SizeInPages) {
+
+                    if (Movable == 0) {
+
+                        //
+                        // The range became available on its own.
+                        //
+
+                        return TRUE;
+                    }
+
+                    goto Compact;
+                }
+            }
+        }
+        start += 1;
+
+    } while (start != MmPhysicalMemoryBlock->NumberOfRuns);
+
+    return FALSE;
+
+Compact:
+
+    MiCompactionAttempts += 1;
+
+    Page = Page - SizeInPages + 1;
+    Pfn1 = MI_PFN_ELEMENT (Page);
+
+    for (count = 0; count < SizeInPages; count += 1) {
+
+        if (MI_IS_PFN_MIGRATABLE (Pfn1 + count)) {
+
+            if (MiMigrateModifiedPage (Page + count, Page, SizeInPages) == FALSE) {
+                MiMigrationFailures += 1;
+                return FALSE;
+            }
+        }
+    }
+
+    MiCompactionSuccesses += 1;
+
+    return TRUE;
+}
+
+LOGICAL
+MiMigrateModifiedPage (
+    IN PFN_NUMBER PageFrameIndex,
+    IN PFN_NUMBER WindowStart,
+    IN PFN_NUMBER WindowPages
+    )
+
+/*++
+
+Routine Description:
+
+    This function copies a page on the modified list into a frame outside
+    the specified range, points the transition PTE (which could be a
+    prototype PTE) at the new frame and puts the old frame on the free list.
+    The new frame takes the old frame's place on the modified list and
+    inherits its page file or mapped file backing.
+
+Arguments:
+
+    PageFrameIndex - Supplies the modified page to move.
+
+    WindowStart - Supplies the first page of the range being vacated.
+
+    WindowPages - Supplies the number of pages in the range being vacated.
+
+Return Value:
+
+    TRUE if the page was moved, FALSE if it was not.
+
+Environment:
+
+    Kernel mode, IRQL of APC_LEVEL or below, dynamic memory mutex held shared.
+
+--*/
+
+{
+    KIRQL OldIrql;
+    PMMPFN Pfn1;
+    PMMPFN Pfn2;
+    PMMPTE PointerPte;
+    PMMPTE MappingPte;
+    MMPTE TempPte;
+    PEPROCESS Process;
+    PFN_NUMBER NewPageFrameIndex;
+    PVOID CopyFrom;
+    PVOID CopyTo;
+    PVOID VaFlushList[2];
+
+    MappingPte = MiReserveSystemPtes (2, SystemPteSpace);
+
+    if (MappingPte == NULL) {
+        return FALSE;
+    }
+
+    Pfn1 = MI_PFN_ELEMENT (PageFrameIndex);
+
+    LOCK_PFN (OldIrql);
+
+    if ((!MI_IS_PFN_MIGRATABLE (Pfn1)) ||
+        (MmAvailablePages <= MM_HIGH_LIMIT)) {
+
+        UNLOCK_PFN (OldIrql);
+        MiReleaseSystemPtes (MappingPte, 2, SystemPteSpace);
+        return FALSE;
+    }
+
+    NewPageFrameIndex = MiRemoveAnyPage (MI_GET_PAGE_COLOR_FROM_PTE (NULL));
+
+    if ((NewPageFrameIndex >= WindowStart) &&
+        (NewPageFrameIndex < WindowStart + WindowPages)) {
+
+        //
+        // The replacement frame came from the range being vacated, give
+        // it back.
+        //
+
+        MiInsertPageInFreeList (NewPageFrameIndex);
+        UNLOCK_PFN (OldIrql);
+        MiReleaseSystemPtes (MappingPte, 2, SystemPteSpace);
+        return FALSE;
+    }
+
+    Pfn2 = MI_PFN_ELEMENT (NewPageFrameIndex);
+
+    if (Pfn2->u3.e1.CacheAttribute != MiCached) {
+        MI_FLUSH_TB_FOR_INDIVIDUAL_ATTRIBUTE_CHANGE (NewPageFrameIndex,
+                                                     MiCached);
+        Pfn2->u3.e1.CacheAttribute = MiCached;
+    }
+
+    //
+    // Copy the contents.  The page is unreferenced and on the modified list
+    // so it cannot change while the PFN lock is held.
+    //
+
+    MI_MAKE_VALID_KERNEL_PTE (TempPte,
+                              PageFrameIndex,
+                              MM_READONLY,
+                              MappingPte);
+
+    MI_WRITE_VALID_PTE (MappingPte, TempPte);
+
+    MI_MAKE_VALID_KERNEL_PTE (TempPte,
+                              NewPageFrameIndex,
+                              MM_READWRITE,
+                              MappingPte + 1);
+
+    MI_SET_PTE_DIRTY (TempPte);
+
+    MI_WRITE_VALID_PTE (MappingPte + 1, TempPte);
+
+    CopyFrom = MiGetVirtualAddressMappedByPte (MappingPte);
+    CopyTo = MiGetVirtualAddressMappedByPte (MappingPte + 1);
+
+    KeCopyPage (CopyTo, CopyFrom);
+
+    //
+    // Tear down the copy mappings now.  The system PTEs must be invalid
+    // when they are released, and no translation to the old frame may
+    // survive it being freed below.
+    //
+
+    MiZeroMemoryPte (MappingPte, 2);
+
+    VaFlushList[0] = CopyFrom;
+    VaFlushList[1] = CopyTo;
+
+    MI_FLUSH_MULTIPLE_TB (2, &VaFlushList[0], TRUE);
+
+    //
+    // Point the transition PTE at the new frame.  As in
+    // MiRestoreTransitionPte, the PTE is referenced through hyperspace
+    // unless it is a resident prototype PTE.
+    //
+
+    Process = NULL;
+
+    if ((Pfn1->u3.e1.PrototypePte == 1) &&
+        (MiIsProtoAddressValid (Pfn1->PteAddress))) {
+
+        PointerPte = Pfn1->PteAddress;
+    }
+    else {
+        Process = PsGetCurrentProcess ();
+        PointerPte = MiMapPageInHyperSpaceAtDpc (Process, Pfn1->u4.PteFrame);
+        PointerPte = (PMMPTE)((PCHAR)PointerPte +
+                                MiGetByteOffset(Pfn1->PteAddress));
+    }
+
+    TempPte = *PointerPte;
+
+    ASSERT ((TempPte.u.Hard.Valid == 0) &&
+            (TempPte.u.Soft.Prototype == 0) &&
+            (TempPte.u.Soft.Transition == 1) &&
+            (MI_GET_PAGE_FRAME_FROM_TRANSITION_PTE (&TempPte) == PageFrameIndex));
+
+    TempPte.u.Trans.PageFrameNumber = NewPageFrameIndex;
+
+    MI_WRITE_INVALID_PTE_WITHOUT_WS (PointerPte, TempPte);
+
+    if (Process != NULL) {
+        MiUnmapPageInHyperSpaceFromDpc (Process, PointerPte);
+    }
+
+    //
+    // Move the modified page state to the new frame.
+    //
+
+    MiUnlinkPageFromList (Pfn1);
+
+    Pfn2->PteAddress = Pfn1->PteAddress;
+    Pfn2->OriginalPte = Pfn1->OriginalPte;
+    Pfn2->u4.PteFrame = Pfn1->u4.PteFrame;
+    Pfn2->u4.Priority = Pfn1->u4.Priority;
+    Pfn2->u4.InPageError = Pfn1->u4.InPageError;
+    Pfn2->u3.e1.PrototypePte = Pfn1->u3.e1.PrototypePte;
+    MI_SET_MODIFIED (Pfn2, 1, 0x2A);
+
+    ASSERT (Pfn2->u3.e2.ReferenceCount == 0);
+
+    MiInsertPageInList (&MmModifiedPageListHead, NewPageFrameIndex);
+
+    //
+    // Free the old frame.  Its backing store (if any) now belongs to the
+    // new frame, so clear the original PTE before the frame is released.
+    //
+
+    InterlockedIncrementPfn ((PSHORT)&Pfn1->u3.e2.ReferenceCount);
+    Pfn1->OriginalPte.u.Long = 0;
+    MI_SET_MODIFIED (Pfn1, 0, 0x2B);
+    MI_SET_PFN_DELETED (Pfn1);
+    MiDecrementReferenceCount (Pfn1, PageFrameIndex);
+
+    MiPagesMigrated += 1;
+
+    UNLOCK_PFN (OldIrql);
+
+    MiReleaseSystemPtes (MappingPte, 2, SystemPteSpace);
+
+    return TRUE;
+}
+
+ULONG
+MiComputeFragmentationIndex (
+    IN PFN_NUMBER LowestPfn,
+    IN PFN_NUMBER HighestPfn,
+    OUT PPFN_NUMBER AvailablePages,
+    OUT PPFN_NUMBER LargeBlocks
+    )
+
+/*++
+
+Routine Description:
+
+    This function computes how fragmented the zeroed, free and standby
+    pages in the specified range are.  The index is the share, in tenths
+    of a percent, of those pages which do not lie in a fully available,
+    naturally aligned large page sized block: 0 means all of them could
+    be handed out as large pages, 1000 means none could.
+
+Arguments:
+
+    LowestPfn - Supplies the lowest physical page number to examine.
+
+    HighestPfn - Supplies the highest physical page number to examine.
+
+    AvailablePages - Returns the number of zeroed, free and standby pages.
+
+    LargeBlocks - Returns the number of fully available large page sized
+                  blocks.
+
+Return Value:
+
+    The fragmentation index.
+
+Environment:
+
+    Kernel mode, IRQL of APC_LEVEL or below, dynamic memory mutex held shared.
+    The PFN lock is not acquired so the result is only a snapshot.
+
+--*/
+
+{
+    PMMPFN Pfn1;
+    ULONG start;
+    PFN_NUMBER Page;
+    PFN_NUMBER LastPage;
+    PFN_NUMBER Available;
+    PFN_NUMBER BlockAvailable;
+    PFN_NUMBER Blocks;
+
+    PAGED_CODE ();
+
+    Available = 0;
+    Blocks = 0;
+
+    for (start = 0; start < MmPhysicalMemoryBlock->NumberOfRuns; start += 1) {
+
+        if (MmPhysicalMemoryBlock->Run[start].PageCount == 0) {
+            continue;
+        }
+
+        Page = MmPhysicalMemoryBlock->Run[start].BasePage;
+        LastPage = Page + MmPhysicalMemoryBlock->Run[start].PageCount;
+
+        if (LastPage - 1 > HighestPfn) {
+            LastPage = HighestPfn + 1;
+        }
+
+        if (Page < LowestPfn) {
+            Page = LowestPfn;
+        }
+
+        BlockAvailable = 0;
+        Pfn1 = MI_PFN_ELEMENT (Page);
+
+        for ( ; Page < LastPage; Page += 1, Pfn1 += 1) {
+
+            if ((Page & (MI_COMPACTION_BLOCK_PAGES - 1)) == 0) {
+                BlockAvailable = 0;
+            }
+
+            if ((Pfn1->u3.e1.PageLocation <= StandbyPageList) &&
+                (Pfn1->u1.Flink != 0) &&
+                (Pfn1->u2.Blink != 0) &&
+                (Pfn1->u3.e2.ReferenceCount == 0)) {
+
+                Available += 1;
+                BlockAvailable += 1;
+
+                if (BlockAvailable == MI_COMPACTION_BLOCK_PAGES) {
+                    Blocks += 1;
+                }
+            }
+        }
+    }
+
+    *AvailablePages = Available;
+    *LargeBlocks = Blocks;
+
+    return MI_FRAGMENTATION_INDEX (Available, Blocks);
+}
+
+VOID
+MiCompactPhysicalMemory (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This function is called by the working set manager on each pass.  Every
+    MI_COMPACTION_PERIOD passes it examines the next segment of physical
+    memory and, if the segment is fragmented beyond the watermark, vacates
+    one large page sized block in it.  This keeps large page and contiguous
+    allocations from having to empty every working set to succeed.
+
+    When a sweep of all of physical memory completes, the system wide
+    fragmentation index is updated from the segment counts.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, PASSIVE_LEVEL, no locks held.
+
+--*/
+
+{
+    PKTHREAD Thread;
+    PFN_NUMBER LowestPfn;
+    PFN_NUMBER HighestPfn;
+    PFN_NUMBER AvailablePages;
+    PFN_NUMBER LargeBlocks;
+    ULONG FragmentationIndex;
+
+    PAGED_CODE ();
+
+    MiCompactionPasses += 1;
+
+    if (MiCompactionPasses < MI_COMPACTION_PERIOD) {
+        return;
+    }
+
+    MiCompactionPasses = 0;
+
+    if (MiCompactionCursor > MmHighestPhysicalPage) {
+        MiCompactionCursor = 0;
+    }
+
+    LowestPfn = MiCompactionCursor;
+    HighestPfn = LowestPfn + MI_COMPACTION_SEGMENT_PAGES - 1;
+
+    if (HighestPfn > MmHighestPhysicalPage) {
+        HighestPfn = MmHighestPhysicalPage;
+    }
+
+    MiCompactionCursor = HighestPfn + 1;
+
+    Thread = KeGetCurrentThread ();
+
+    KeEnterGuardedRegionThread (Thread);
+
+    MI_LOCK_DYNAMIC_MEMORY_SHARED ();
+
+    FragmentationIndex = MiComputeFragmentationIndex (LowestPfn,
+                                                      HighestPfn,
+                                                      &AvailablePages,
+                                                      &LargeBlocks);
+
+    MiCompactionSweepAvailable += AvailablePages;
+    MiCompactionSweepBlocks += LargeBlocks;
+
+    if (HighestPfn == MmHighestPhysicalPage) {
+
+        MiLargeBlocksAvailable = MiCompactionSweepBlocks;
+        MiFragmentationIndex = MI_FRAGMENTATION_INDEX (MiCompactionSweepAvailable,
+                                                       MiCompactionSweepBlocks);
+
+        MiCompactionSweepAvailable = 0;
+        MiCompactionSweepBlocks = 0;
+    }
+
+    //
+    // Each page moved consumes an available page until the old frame is
+    // freed, so only compact when memory is plentiful.
+    //
+
+    if ((FragmentationIndex > MiCompactionWatermark) &&
+        (MmAvailablePages >= MmPlentyFreePages)) {
+
+        MiProactiveCompactions += 1;
+
+        MiCompactContiguousRange (LowestPfn,
+                                  HighestPfn,
+                                  MI_COMPACTION_BLOCK_PAGES,
+                                  MI_COMPACTION_BLOCK_PAGES,
+                                  MiCached);
+    }
+
+    MI_UNLOCK_DYNAMIC_MEMORY_SHARED ();
+
+    KeLeaveGuardedRegionThread (Thread);
+
+    return;
+}
+
+NTSTATUS
+MmGetMemoryCompactionInformation (
+    OUT PVOID SystemInformation,
+    IN ULONG SystemInformationLength,
+    OUT PULONG Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the physical memory fragmentation index and the
+    compaction statistics.
+
+    The fragmentation index and the large block count are those computed
+    by the working set manager over its last complete sweep of physical
+    memory.  They are zero until the first sweep completes.
+
+Arguments:
+
+    SystemInformation - Returns a SYSTEM_MEMORY_COMPACTION_INFORMATION
+                        structure.
+
+    SystemInformationLength - Supplies the length of the SystemInformation
+                              buffer.
+
+    Length - Returns the length of the information placed in the buffer.
+
+Return Value:
+
+    Returns the status of the operation.
+
+--*/
+
+{
+    PSYSTEM_MEMORY_COMPACTION_INFORMATION CompactionInfo;
+
+    PAGED_CODE();
+
+    *Length = sizeof (SYSTEM_MEMORY_COMPACTION_INFORMATION);
+
+    if (SystemInformationLength < *Length) {
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    CompactionInfo = (PSYSTEM_MEMORY_COMPACTION_INFORMATION) SystemInformation;
+
+    CompactionInfo->FragmentationIndex = MiFragmentationIndex;
+    CompactionInfo->LargeBlocksAvailable = (ULONG) MiLargeBlocksAvailable;
+    CompactionInfo->CompactionAttempts = MiCompactionAttempts;
+    CompactionInfo->CompactionSuccesses = MiCompactionSuccesses;
+    CompactionInfo->ProactiveCompactions = MiProactiveCompactions;
+    CompactionInfo->PagesMigrated = MiPagesMigrated;
+    CompactionInfo->MigrationFailures = MiMigrationFailures;
+
+    return STATUS_SUCCESS;
+}
+
 
 VOID
 MiFreeContiguousPages (
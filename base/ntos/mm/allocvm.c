@@ -1186,7 +1186,14 @@ Inserted:
     CapturedRegionSize = (PCHAR)EndingAddress - (PCHAR)StartingAddress + 1;
 
     /* ַ */
-    LOCK_ADDRESS_SPACE (Process);
+    //
+    // Only the VAD tree is locked while the VAD is located and checked.
+    // Commits to private memory then just hold the VAD's range lock, so
+    // they can proceed concurrently with operations on other VADs.  Resets
+    // and commits to sections hold the address space exclusive.
+    //
+
+    LOCK_VAD_TREE (Process);
 
     //
     // Make sure the address space was not deleted, if so,
@@ -1196,7 +1203,7 @@ Inserted:
     if (Process->Flags & PS_PROCESS_FLAGS_VM_DELETED) 
     {
         Status = STATUS_PROCESS_IS_TERMINATING;
-        goto ErrorReturn0;
+        goto ErrorReturnVadTree;
     }
     
     /* ʼͽβַǷгͻ */
@@ -1210,7 +1217,7 @@ Inserted:
         //
         /* ûбVADָĵַϣʷش */
         Status = STATUS_CONFLICTING_ADDRESSES;
-        goto ErrorReturn0;
+        goto ErrorReturnVadTree;
     }
 
     if ((FoundVad->u.VadFlags.VadType == VadAwe) ||
@@ -1219,7 +1226,7 @@ Inserted:
     {
         /* صĵַ⼸ҲǴ */
         Status = STATUS_CONFLICTING_ADDRESSES;
-        goto ErrorReturn0;
+        goto ErrorReturnVadTree;
     }
 
     //
@@ -1236,7 +1243,7 @@ Inserted:
         //
 
         Status = STATUS_CONFLICTING_ADDRESSES;
-        goto ErrorReturn0;
+        goto ErrorReturnVadTree;
     }
     /* FoundVADCommitChargeѾﵽMM_MAX_COMMITֵ */
     if (FoundVad->u.VadFlags.CommitCharge == MM_MAX_COMMIT) 
@@ -1245,13 +1252,15 @@ Inserted:
         // This is a special VAD, don't let any commits occur.
         //
         Status = STATUS_CONFLICTING_ADDRESSES;
-        goto ErrorReturn0;
+        goto ErrorReturnVadTree;
     }
 
     /* Reset Memory */
     if (AllocationType == MEM_RESET) 
     {
 
+        CONVERT_VAD_TREE_TO_ADDRESS_SPACE (Process);
+
         Status = MiResetVirtualMemory (StartingAddress,
                                        EndingAddress,
                                        FoundVad,
@@ -1266,6 +1275,8 @@ Inserted:
     if (FoundVad->u.VadFlags.PrivateMemory == 0) 
     {
 
+        CONVERT_VAD_TREE_TO_ADDRESS_SPACE (Process);
+
         if (FoundVad->u.VadFlags.VadType == VadLargePageSection) {
             Status = STATUS_INVALID_PAGE_PROTECTION;
             goto ErrorReturn0;
@@ -1764,9 +1775,11 @@ FinishedCharging:
         (Protect & PAGE_EXECUTE_WRITECOPY)) 
     {
         Status = STATUS_INVALID_PAGE_PROTECTION;
-        goto ErrorReturn0;
+        goto ErrorReturnVadTree;
     }
 
+    MiLockVadRange (Process, FoundVad);
+
     //
     // Build a demand zero PTE with the proper protection.
     //
@@ -1817,7 +1830,7 @@ FinishedCharging:
                 PsReportProcessMemoryLimitViolation ();
             }
             Status = STATUS_COMMITMENT_LIMIT;
-            goto ErrorReturn0;
+            goto ErrorReturnRange;
         }
     }
 
@@ -1828,7 +1841,7 @@ FinishedCharging:
         if (PsChangeJobMemoryUsage (PS_JOB_STATUS_REPORT_COMMIT_CHANGES, QuotaCharge) == FALSE) 
         {
             Status = STATUS_COMMITMENT_LIMIT;
-            goto ErrorReturn0;
+            goto ErrorReturnRange;
         }
         ChargedJobCommit = TRUE;
     }
@@ -1841,7 +1854,7 @@ FinishedCharging:
         {
             PsChangeJobMemoryUsage (PS_JOB_STATUS_REPORT_COMMIT_CHANGES, 0 - QuotaCharge);
         }
-        goto ErrorReturn0;
+        goto ErrorReturnRange;
     }
 
     ChargedExactQuota = FALSE;
@@ -1908,21 +1921,17 @@ FinishedCharging:
             }
 
             Status = STATUS_COMMITMENT_LIMIT;
-            goto ErrorReturn0;
+            goto ErrorReturnRange;
         }
     }
 
     MM_TRACK_COMMIT (MM_DBG_COMMIT_ALLOCVM_PROCESS2, QuotaCharge);
 
     FoundVad->u.VadFlags.CommitCharge += QuotaCharge;
-    Process->CommitCharge += QuotaCharge;
 
-    MI_INCREMENT_TOTAL_PROCESS_COMMIT (QuotaCharge);
+    MiChargeProcessCommitment (Process, QuotaCharge);
 
-    if (Process->CommitCharge > Process->CommitChargePeak) 
-    {
-        Process->CommitChargePeak = Process->CommitCharge;
-    }
+    MI_INCREMENT_TOTAL_PROCESS_COMMIT (QuotaCharge);
 
     QuotaFree = 0;
 
@@ -2058,10 +2067,10 @@ FinishedCharging:
         {
             FoundVad->u.VadFlags.CommitCharge -= ExcessCharge;
             ASSERT ((LONG_PTR)FoundVad->u.VadFlags.CommitCharge >= 0);
-            Process->CommitCharge -= ExcessCharge;
+            MiChargeProcessCommitment (Process, 0 - (SSIZE_T)ExcessCharge);
         }
 
-        UNLOCK_ADDRESS_SPACE (Process);
+        MiUnlockVadRange (Process, FoundVad);
 
         if (ChargedExactQuota == FALSE) 
         {
@@ -2078,7 +2087,7 @@ FinishedCharging:
     }
     else
     {
-        UNLOCK_ADDRESS_SPACE (Process);
+        MiUnlockVadRange (Process, FoundVad);
     }
 
     //
@@ -2131,6 +2140,14 @@ done:
 
     return Status;
 
+ErrorReturnRange:
+        MiUnlockVadRange (Process, FoundVad);
+        goto ErrorReturn1;
+
+ErrorReturnVadTree:
+        UNLOCK_VAD_TREE (Process);
+        goto ErrorReturn1;
+
 ErrorReturn0:
         UNLOCK_ADDRESS_SPACE (Process);
 
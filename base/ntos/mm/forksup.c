@@ -179,6 +179,7 @@ Environment:
     ULONG Waited;
     ULONG PpePdeOffset;
     PFN_NUMBER HyperPhysicalPage;
+    MMPTE_FLUSH_LIST PteFlushList;
 #if (_MI_PAGING_LEVELS >= 3)
     PMMPTE PointerPpeLast;
     PFN_NUMBER PageDirFrameIndex;
@@ -205,6 +206,7 @@ Environment:
 
     HyperPhysicalPage = ProcessToInitialize->WorkingSetPage;
     NumberOfForkPtes = 0;
+    PteFlushList.Count = 0;
     Attached = FALSE;
     PageFrameIndex = (PFN_NUMBER)-1;
     PhysicalViewList = NULL;
@@ -938,6 +940,16 @@ RetryPrivatePageAllocations:
 
                 if ((FirstTime) || MiIsPteOnPdeBoundary (PointerPte)) {
 
+                    //
+                    // Flush the TB for the private pages made copy-on-write
+                    // in the last page table page before anything below
+                    // can release the working set pushlock.
+                    //
+
+                    if (PteFlushList.Count != 0) {
+                        MiFlushPteList (&PteFlushList);
+                    }
+
                     PointerPxe = MiGetPpeAddress (PointerPte);
                     PointerPpe = MiGetPdeAddress (PointerPte);
                     PointerPde = MiGetPteAddress (PointerPte);
@@ -1542,6 +1554,10 @@ RetryPrivatePageAllocations:
                                 MI_WRITE_ZERO_PTE (PointerNewPte);
                                 MI_DECREMENT_USED_PTES_BY_HANDLE (UsedPageTableEntries);
 
+                                if (PteFlushList.Count != 0) {
+                                    MiFlushPteList (&PteFlushList);
+                                }
+
                                 UNLOCK_WS_UNSAFE (CurrentThread, CurrentProcess);
 
                                 if (TempCloneMapping != NULL) {
@@ -1574,7 +1590,35 @@ RetryPrivatePageAllocations:
 
                         MI_MAKE_VALID_PTE_WRITE_COPY (PointerPte);
 
-                        MI_FLUSH_SINGLE_TB (VirtualAddress, FALSE);
+#if DBG
+                        //
+                        // Every deferred flush must be for a page mapped by
+                        // the current page table page.  Pending entries from
+                        // an earlier page table page would mean the list was
+                        // not flushed at the boundary, where the working set
+                        // pushlock may be released to make the next page
+                        // directory entry valid.
+                        //
+
+                        if (PteFlushList.Count != 0) {
+                            ASSERT (MiGetPdeAddress (PteFlushList.FlushVa[0]) ==
+                                    MiGetPdeAddress (VirtualAddress));
+                            ASSERT (PteFlushList.FlushVa[PteFlushList.Count - 1] !=
+                                    VirtualAddress);
+                        }
+#endif
+
+                        //
+                        // Defer the TB flush so the IPIs are batched across
+                        // the page table page instead of sent per page.  The
+                        // dirty bit is left intact, and the list is always
+                        // flushed before the working set pushlock is released.
+                        //
+
+                        if (PteFlushList.Count < MM_MAXIMUM_FLUSH_COUNT) {
+                            PteFlushList.FlushVa[PteFlushList.Count] = VirtualAddress;
+                            PteFlushList.Count += 1;
+                        }
 
                         ForkProtoPte->ProtoPte = *PointerPte;
                         ForkProtoPte->CloneRefCount = 2;
@@ -1705,6 +1749,10 @@ RetryPrivatePageAllocations:
 
                             MI_DECREMENT_USED_PTES_BY_HANDLE (UsedPageTableEntries);
 
+                            if (PteFlushList.Count != 0) {
+                                MiFlushPteList (&PteFlushList);
+                            }
+
                             UNLOCK_WS_UNSAFE (CurrentThread, CurrentProcess);
 
                             if (TempCloneMapping != NULL) {
@@ -1836,6 +1884,10 @@ RetryPrivatePageAllocations:
 
             } while (PointerPte <= LastPte);
 AllDone:
+            if (PteFlushList.Count != 0) {
+                MiFlushPteList (&PteFlushList);
+            }
+
             NewVad = NewVad->u1.Parent;
         }
         Vad = MiGetNextVad (Vad);
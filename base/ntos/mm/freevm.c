@@ -247,8 +247,13 @@ Return Value:
     // be inserted and walked.  Block APCs to prevent page faults while
     // we own the working set mutex.
     //
+    // Only the VAD tree is locked while the VAD is located and checked.
+    // Decommits then just hold the VAD's range lock, so they can proceed
+    // concurrently with operations on other VADs.  Releases hold the
+    // address space exclusive.
+    //
 
-    LOCK_ADDRESS_SPACE (Process);
+    LOCK_VAD_TREE (Process);
 
     //
     // Make sure the address space was not deleted.
@@ -257,7 +262,7 @@ Return Value:
     if (Process->Flags & PS_PROCESS_FLAGS_VM_DELETED) 
     {
         Status = STATUS_PROCESS_IS_TERMINATING;
-        goto ErrorReturn;
+        goto ErrorReturnVadTree;
     }
 
     Vad = (PMMVAD_SHORT) MiLocateAddress (StartingAddress);
@@ -270,7 +275,7 @@ Return Value:
         //
 
         Status = STATUS_MEMORY_NOT_ALLOCATED;
-        goto ErrorReturn;
+        goto ErrorReturnVadTree;
     }
 
     //
@@ -286,7 +291,7 @@ Return Value:
         //
 
         Status = STATUS_UNABLE_TO_FREE_VM;
-        goto ErrorReturn;
+        goto ErrorReturnVadTree;
     }
 
     //
@@ -301,7 +306,7 @@ Return Value:
     {
 
         Status = STATUS_UNABLE_TO_DELETE_SECTION;
-        goto ErrorReturn;
+        goto ErrorReturnVadTree;
     }
 
     if (Vad->u.VadFlags.NoChange == 1) 
@@ -337,7 +342,7 @@ Return Value:
         }
         if (!NT_SUCCESS (Status)) 
         {
-            goto ErrorReturn;
+            goto ErrorReturnVadTree;
         }
     }
 
@@ -356,6 +361,8 @@ Return Value:
         // *****************************************************************
         //
 
+        CONVERT_VAD_TREE_TO_ADDRESS_SPACE (Process);
+
         //
         // The descriptor for the address range is deletable.  Remove or split
         // the descriptor.
@@ -790,7 +797,7 @@ AllDone:
         //
 
         Status = STATUS_MEMORY_NOT_ALLOCATED;
-        goto ErrorReturn;
+        goto ErrorReturnVadTree;
     }
 
     if ((Vad->u.VadFlags.VadType == VadLargePages) ||
@@ -803,7 +810,7 @@ AllDone:
         //
 
         Status = STATUS_MEMORY_NOT_ALLOCATED;
-        goto ErrorReturn;
+        goto ErrorReturnVadTree;
     }
 
     //
@@ -816,7 +823,7 @@ AllDone:
         if (MI_VA_TO_VPN (CapturedBase) != Vad->StartingVpn) 
         {
             Status = STATUS_FREE_VM_NOT_AT_BASE;
-            goto ErrorReturn;
+            goto ErrorReturnVadTree;
         }
         EndingAddress = MI_VPN_TO_VA_ENDING (Vad->EndingVpn);
     }
@@ -825,6 +832,8 @@ AllDone:
     // The address range is entirely committed, decommit it now.
     //
 
+    MiLockVadRange (Process, (PMMVAD) Vad);
+
     //
     // Calculate the initial quotas and commit charges for this VAD.
     //
@@ -852,11 +861,12 @@ AllDone:
 
     Vad->u.VadFlags.CommitCharge -= CommitReduction;
     ASSERT ((LONG)Vad->u.VadFlags.CommitCharge >= 0);
-    Vad = NULL;
 
-    Process->CommitCharge -= CommitReduction;
+    MiChargeProcessCommitment (Process, 0 - (SSIZE_T)CommitReduction);
 
-    UNLOCK_ADDRESS_SPACE (Process);
+    MiUnlockVadRange (Process, (PMMVAD) Vad);
+
+    Vad = NULL;
 
     if (CommitReduction != 0)
     {
@@ -904,6 +914,10 @@ AllDone:
 
     return STATUS_SUCCESS;
 
+ErrorReturnVadTree:
+       UNLOCK_VAD_TREE (Process);
+       goto ErrorReturn2;
+
 ErrorReturn:
        UNLOCK_ADDRESS_SPACE (Process);
 
@@ -1238,7 +1252,7 @@ Return Value:
 
 Environment:
 
-    Kernel mode, APCs disabled, AddressCreation mutex held.
+    Kernel mode, APCs disabled, VAD range lock held.
 
 --*/
 
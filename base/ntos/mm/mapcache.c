@@ -1801,6 +1801,246 @@ UnlockAndReturnTrue:
     return TRUE;
 }
 
+LOGICAL
+MmTransferCachedPage (
+    IN PVOID SystemCacheAddress,
+    IN PVOID UserAddress
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gives the physical page behind the specified system cache
+    address to the current process at the specified user address, so the
+    cache manager does not have to copy the data.
+
+    This is only done when nobody else can tell.  The cache page must be
+    clean, on the standby list and not mapped anywhere, and the user page
+    must be committed private read/write memory which has never been
+    touched, i.e., is still demand zero.  The file then loses the page
+    exactly as if it had been reused off the standby list, and reads the
+    data back in if it is ever needed again.
+
+    This routine is for usage by the cache manager.
+
+Arguments:
+
+    SystemCacheAddress - Supplies the page aligned address of a page mapped
+                         in the system cache.
+
+    UserAddress - Supplies the page aligned user address in the current
+                  process which is to receive the page.
+
+Return Value:
+
+    TRUE if the page was transferred, FALSE if the caller must copy the
+    data instead.
+
+Environment:
+
+    Kernel mode, PASSIVE_LEVEL, no working set locks held.
+
+--*/
+
+{
+    PETHREAD Thread;
+    PEPROCESS Process;
+    PMMVAD Vad;
+    PMMPTE CachePte;
+    PMMPTE ProtoPte;
+    PMMPTE PointerPte;
+    PMMPTE PointerPde;
+    MMPTE ProtoPteContents;
+    MMPTE TempPte;
+    PMMPFN Pfn1;
+    PFN_NUMBER PageFrameIndex;
+    ULONG ProtectionCode;
+    WSLE_NUMBER WorkingSetIndex;
+    PVOID UsedPageTableHandle;
+    KIRQL OldIrql;
+
+    ASSERT (KeGetCurrentIrql () == PASSIVE_LEVEL);
+    ASSERT (BYTE_OFFSET (SystemCacheAddress) == 0);
+    ASSERT (BYTE_OFFSET (UserAddress) == 0);
+
+    if (UserAddress > MM_HIGHEST_USER_ADDRESS) {
+        return FALSE;
+    }
+
+    //
+    // If the page is valid in the system cache it is in use, don't bother
+    // going any further.
+    //
+
+    CachePte = MiGetPteAddress (SystemCacheAddress);
+
+    if ((CachePte->u.Hard.Valid == 1) || (CachePte->u.Soft.Prototype == 0)) {
+        return FALSE;
+    }
+
+    ProtoPte = MiPteToProto (CachePte);
+
+    Thread = PsGetCurrentThread ();
+    Process = PsGetCurrentProcess ();
+
+    PointerPte = MiGetPteAddress (UserAddress);
+    PointerPde = MiGetPdeAddress (UserAddress);
+
+    LOCK_WS (Thread, Process);
+
+    //
+    // A fork in progress would have to share the page, so leave it alone.
+    //
+
+    if ((Process->ForkInProgress != NULL) ||
+        (Process->Flags & PS_PROCESS_FLAGS_VM_DELETED)) {
+
+        UNLOCK_WS (Thread, Process);
+        return FALSE;
+    }
+
+    MiMakePdeExistAndMakeValid (PointerPde, Process, MM_NOIRQL);
+
+    TempPte = *PointerPte;
+
+    if ((TempPte.u.Long != MM_ZERO_PTE) &&
+        (TempPte.u.Long != MM_DEMAND_ZERO_WRITE_PTE)) {
+
+        //
+        // The page has been touched or has some other protection.
+        //
+
+        UNLOCK_WS (Thread, Process);
+        return FALSE;
+    }
+
+    //
+    // Only plain committed private memory qualifies.  In particular, write
+    // watch regions must see the write fault.
+    //
+
+    if ((MiCheckVirtualAddress (UserAddress, &ProtectionCode, &Vad) != NULL) ||
+        (Vad == NULL) ||
+        (Vad->u.VadFlags.PrivateMemory == 0) ||
+        (Vad->u.VadFlags.VadType != VadNone) ||
+        ((TempPte.u.Long == MM_ZERO_PTE) && (ProtectionCode != MM_READWRITE))) {
+
+        UNLOCK_WS (Thread, Process);
+        return FALSE;
+    }
+
+    if (TempPte.u.Long == MM_ZERO_PTE) {
+
+        //
+        // Make the PTE explicitly demand zero, exactly as a fault on it
+        // would, so that it is accounted for in its page table page.
+        //
+
+        UsedPageTableHandle = MI_GET_USED_PTES_HANDLE (UserAddress);
+        MI_INCREMENT_USED_PTES_BY_HANDLE (UsedPageTableHandle);
+
+        MI_WRITE_INVALID_PTE (PointerPte, DemandZeroPte);
+    }
+
+    LOCK_PFN (OldIrql);
+
+    //
+    // Don't fault in the page containing the prototype PTE for this, if it
+    // is not resident the data page is unlikely to be either.
+    //
+
+    if (MiGetPteAddress (ProtoPte)->u.Hard.Valid == 0) {
+        goto UnlockAndReturnFalse;
+    }
+
+    ProtoPteContents = *ProtoPte;
+
+    if ((ProtoPteContents.u.Hard.Valid == 1) ||
+        (ProtoPteContents.u.Soft.Prototype == 1) ||
+        (ProtoPteContents.u.Soft.Transition == 0)) {
+
+        goto UnlockAndReturnFalse;
+    }
+
+    PageFrameIndex = MI_GET_PAGE_FRAME_FROM_TRANSITION_PTE (&ProtoPteContents);
+    Pfn1 = MI_PFN_ELEMENT (PageFrameIndex);
+
+    ASSERT (Pfn1->PteAddress == ProtoPte);
+
+    //
+    // The page must be clean and idle, and the prototype PTE must revert
+    // to the file so the data can be read back.  Don't take pages that
+    // free memory can't spare either.
+    //
+
+    if ((Pfn1->u3.e1.PageLocation != StandbyPageList) ||
+        (Pfn1->u3.e2.ReferenceCount != 0) ||
+        (Pfn1->u3.e1.ReadInProgress == 1) ||
+        (Pfn1->u4.InPageError == 1) ||
+        (Pfn1->u3.e1.CacheAttribute != MiCached) ||
+        (Pfn1->OriginalPte.u.Soft.Prototype == 0) ||
+        (MmAvailablePages < MM_HIGH_LIMIT)) {
+
+        goto UnlockAndReturnFalse;
+    }
+
+    //
+    // Take the page away from the file as if it were being reused off the
+    // standby list, then make it a private page of this process.
+    //
+
+    MiUnlinkPageFromList (Pfn1);
+    MiRestoreTransitionPte (Pfn1);
+
+    Pfn1->u3.e1.PrototypePte = 0;
+
+    MiInitializePfn (PageFrameIndex, PointerPte, 1);
+
+    MI_MAKE_VALID_USER_PTE (TempPte,
+                            PageFrameIndex,
+                            MM_READWRITE,
+                            PointerPte);
+
+    MI_SET_PTE_DIRTY (TempPte);
+
+    MI_WRITE_VALID_PTE (PointerPte, TempPte);
+
+    UNLOCK_PFN (OldIrql);
+
+    Process->NumberOfPrivatePages += 1;
+
+    WorkingSetIndex = MiAddValidPageToWorkingSet (UserAddress,
+                                                  PointerPte,
+                                                  Pfn1,
+                                                  0);
+    if (WorkingSetIndex == 0) {
+
+        //
+        // Trim the page since we couldn't add it to the working set list
+        // at this time.  It already holds the data, so it still counts as
+        // transferred.
+        //
+
+        MiTrimPte (UserAddress,
+                   PointerPte,
+                   Pfn1,
+                   Process,
+                   ZeroPte);
+    }
+
+    UNLOCK_WS (Thread, Process);
+
+    return TRUE;
+
+UnlockAndReturnFalse:
+
+    UNLOCK_PFN (OldIrql);
+    UNLOCK_WS (Thread, Process);
+
+    return FALSE;
+}
+
 NTSTATUS
 MmCopyToCachedPage (
     IN PVOID SystemCacheAddress,
@@ -6533,6 +6533,7 @@ EditVad:
         if (Process->VadRoot.NodeHint == Vad) {
             Process->VadRoot.NodeHint = (PMMVAD) NewVad;
         }
+        Process->VadSequence += 1;
         if (Process->VadFreeHint == Vad) {
             Process->VadFreeHint = (PMMVAD) NewVad;
         }
@@ -656,6 +656,29 @@ MiCheckForConflictingVadExistence (
     IN PVOID EndingAddress
     );
 
+VOID
+MiInitializeVadRangeLocks (
+    IN PEPROCESS Process
+    );
+
+VOID
+MiLockVadRange (
+    IN PEPROCESS Process,
+    IN PMMVAD Vad
+    );
+
+VOID
+MiUnlockVadRange (
+    IN PEPROCESS Process,
+    IN PMMVAD Vad
+    );
+
+VOID
+MiChargeProcessCommitment (
+    IN PEPROCESS Process,
+    IN SSIZE_T QuotaCharge
+    );
+
 // PMMVAD
 // MiCheckForConflictingVad (
 //     IN PVOID StartingAddress,
@@ -1267,10 +1290,47 @@ extern PETHREAD MiExpansionLockOwner;
 //
 // Address space synchronization definitions.
 //
+// The address creation mutex serializes all changes to the VAD tree.
+// LOCK_ADDRESS_SPACE also acquires the address space range lock exclusive,
+// which waits for any range locked operation (see MiLockVadRange) to
+// finish, so holders see the address space exactly as if they held the
+// mutex alone.
+//
+// Protection changes, commits and decommits instead acquire just the
+// mutex (LOCK_VAD_TREE) to locate and check their VAD.  If the operation
+// is confined to a single private VAD the mutex is then exchanged for that
+// VAD's range lock, so operations on different VADs and page faults all
+// proceed concurrently.  Otherwise the range lock is acquired exclusive
+// (CONVERT_VAD_TREE_TO_ADDRESS_SPACE) and the address space is released
+// with UNLOCK_ADDRESS_SPACE as usual.
+//
 
 #define LOCK_ADDRESS_SPACE(PROCESS)                                  \
+            KeAcquireGuardedMutex (&((PROCESS)->AddressCreationLock)); \
+            ExAcquirePushLockExclusive (&((PROCESS)->AddressSpaceRangeLock));
+
+#define LOCK_VAD_TREE(PROCESS)                                       \
             KeAcquireGuardedMutex (&((PROCESS)->AddressCreationLock));
 
+#define CONVERT_VAD_TREE_TO_ADDRESS_SPACE(PROCESS)                   \
+            ExAcquirePushLockExclusive (&((PROCESS)->AddressSpaceRangeLock));
+
+#define UNLOCK_VAD_TREE(PROCESS)                                     \
+            KeReleaseGuardedMutex (&((PROCESS)->AddressCreationLock));
+
+#define MI_VAD_RANGE_LOCK(PROCESS, VAD)                              \
+            (&(PROCESS)->VadRangeLocks[((ULONG_PTR)(VAD) / sizeof (MMVAD_SHORT)) & (PS_VAD_RANGE_LOCKS - 1)])
+
+//
+// Only private memory which is neither AWE nor large page can be operated
+// on under a VAD range lock.
+//
+
+#define MI_VAD_RANGE_LOCKABLE(VAD)                                   \
+            (((VAD)->u.VadFlags.PrivateMemory == 1) &&               \
+             (((VAD)->u.VadFlags.VadType == VadNone) ||              \
+              ((VAD)->u.VadFlags.VadType == VadWriteWatch)))
+
 #define LOCK_WS_AND_ADDRESS_SPACE(THREAD, PROCESS)                  \
         LOCK_ADDRESS_SPACE(PROCESS);                                \
         LOCK_WS_UNSAFE(THREAD, PROCESS)
@@ -1280,6 +1340,7 @@ extern PETHREAD MiExpansionLockOwner;
         UNLOCK_ADDRESS_SPACE(PROCESS);
 
 #define UNLOCK_ADDRESS_SPACE(PROCESS)                               \
+            ExReleasePushLockExclusive (&((PROCESS)->AddressSpaceRangeLock)); \
             KeReleaseGuardedMutex (&((PROCESS)->AddressCreationLock));
 
 //
@@ -1704,6 +1765,38 @@ typedef struct _MMPFNENTRY
 #define MI_RESET_PFN_PRIORITY(Pfn)                      \
     MI_SET_PFN_PRIORITY(Pfn, MI_DEFAULT_PFN_PRIORITY);
 
+//
+// Pages read around a page file fault go to the standby list at a low
+// priority so they are the first to be repurposed if they turn out not
+// to be needed.  The default priority is restored once one is referenced.
+//
+
+#define MI_READ_AROUND_PFN_PRIORITY 1
+
+#define MI_NOTE_READ_AROUND_HIT(Pfn)                                    \
+    if (MI_GET_PFN_PRIORITY (Pfn) == MI_READ_AROUND_PFN_PRIORITY) {     \
+        MmReadAroundHits += 1;                                          \
+        if (PERFINFO_IS_GROUP_ON (PERF_MEMORY)) {                       \
+            MiLogPfnInformation (Pfn, PERFINFO_LOG_TYPE_READAROUNDHIT); \
+        }                                                               \
+        MI_RESET_PFN_PRIORITY (Pfn);                                    \
+    }
+
+//
+// Pages of files opened for sequential access only go to the standby list
+// below the default priority, pages last added to the working set of a
+// foreground process above it.  Since repurposing always takes from the
+// lowest nonempty priority, this is the order in which they are reclaimed.
+//
+
+#define MI_SEQUENTIAL_PFN_PRIORITY  2
+#define MI_FOREGROUND_PFN_PRIORITY  5
+
+#define MI_PFN_PRIORITY_FROM_MEMORY_PRIORITY(MemoryPriority)            \
+    (((MemoryPriority) >= MEMORY_PRIORITY_FOREGROUND) ?                 \
+        MI_FOREGROUND_PFN_PRIORITY :                                    \
+        MI_DEFAULT_PFN_PRIORITY + (MemoryPriority))
+
 #if defined (_X86PAE_)
 #pragma pack(1)
 #endif
@@ -1853,6 +1946,42 @@ MiGetInstructionPointer (
             }                                                   \
             (_Pfn)->u3.e1.Modified = (_NewValue);
 
+//++
+// LOGICAL
+// MI_IS_PFN_MIGRATABLE (
+//    IN PMMPFN PPFN
+//    );
+//
+// Routine Description:
+//
+//    This macro determines whether a page can be moved to another frame
+//    by physical memory compaction.  Only unreferenced pages on the modified
+//    list which back a prototype PTE or a user space PTE qualify.  Page
+//    table pages are excluded as their frame number is recorded in the
+//    PFN entries of the pages they map.
+//
+// Arguments
+//
+//    PPFN - Supplies the PFN entry to check.
+//
+// Return Value:
+//
+//    TRUE if the page can be moved, FALSE if not.
+//
+//--
+
+#define MI_IS_PFN_MIGRATABLE(_Pfn)                                      \
+            (((_Pfn)->u3.e1.PageLocation == ModifiedPageList) &&        \
+             ((_Pfn)->u3.e2.ReferenceCount == 0) &&                     \
+             ((_Pfn)->u3.e1.ReadInProgress == 0) &&                     \
+             ((_Pfn)->u3.e1.WriteInProgress == 0) &&                    \
+             ((_Pfn)->u3.e1.RemovalRequested == 0) &&                   \
+             ((_Pfn)->u3.e1.ParityError == 0) &&                        \
+             ((_Pfn)->u3.e1.CacheAttribute == MiCached) &&              \
+             ((_Pfn)->u4.InPageError == 0) &&                           \
+             (((_Pfn)->u3.e1.PrototypePte == 1) ||                      \
+              ((_Pfn)->PteAddress <= MiHighestUserPte)))
+
 //
 // ccNUMA is supported in multiprocessor PAE and WIN64 systems only.
 //
@@ -2961,8 +3090,40 @@ typedef struct _MMWSLE_HASH {
 //--
 //
 #define MI_WSLE_HASH(Address, Wsl) \
+    MI_WSLE_HASH_INDEX(Address, (Wsl)->HashTableSize)
+
+#define MI_WSLE_HASH_INDEX(Address, Size) \
     ((WSLE_NUMBER)(((ULONG_PTR)PAGE_ALIGN(Address) >> (PAGE_SHIFT - 2)) % \
-        ((Wsl)->HashTableSize - 1)))
+        ((Size) - 1)))
+
+//
+// When an existing hash table is grown, its entries are not all rehashed at
+// once.  The table is extended in place and the old size is remembered in
+// the working set list.  Lookups probe from both the new and the old home
+// slots until every slot of the old range has been rehashed.  Each insert
+// rehashes the next MI_WSLE_HASH_MIGRATE_SLOTS slots of the old range, so a
+// fault never pays for the whole table.
+//
+
+#define MI_WSLE_HASH_MIGRATE_SLOTS 64
+
+//
+// Entries are removed from the hash by zeroing their key, so a probe for an
+// address cannot stop at the first free slot.  Instead the longest distance
+// any entry has been placed from its home slot since the table was last
+// filled is kept, and probes stop after that many slots.  This keeps the
+// cost of looking up entries that are not in the hash proportional to the
+// clustering of the table rather than to its size.
+//
+
+#define MI_NOTE_WSLE_HASH_PROBES(Wsl, Home, Slot) {                     \
+        ULONG _Probes;                                                  \
+        _Probes = ((Slot) >= (Home)) ? (Slot) - (Home) :                \
+                  (Slot) + (Wsl)->HashTableSize - (Home);               \
+        if (_Probes > (Wsl)->MaximumHashProbes) {                       \
+            (Wsl)->MaximumHashProbes = _Probes;                         \
+        }                                                               \
+    }
 
 //
 // Working Set List Entry.
@@ -3024,6 +3185,10 @@ typedef struct _MMWSL {
     WSLE_NUMBER NonDirectCount;
     PMMWSLE_HASH HashTable;
     ULONG HashTableSize;
+    ULONG MaximumHashProbes;
+    ULONG MigrateHashTableSize;         // Old size while rehashing, else 0
+    ULONG MigrateHashProbes;            // MaximumHashProbes of the old size
+    ULONG MigrateHashIndex;             // Next old slot to rehash
     ULONG NumberOfCommittedPageTables;
     PVOID HashTableStart;
     PVOID HighestPermittedHashAddress;
@@ -3136,6 +3301,46 @@ extern PKEVENT MiLowMemoryEvent;
 
 #define MI_TRIM_AGE_THRESHOLD 2
 
+//
+// Pages removed by MiTrimWorkingSet are remembered in a small direct mapped
+// table indexed by page frame number.  If the same page is faulted back
+// into the same working set at the same address before its slot is reused,
+// the trim removed a page that was still in use and the working set's
+// refault count is charged.  The table is only used for this heuristic so
+// it is updated without synchronization.
+//
+
+#define MI_TRIM_GHOST_ENTRIES   2048        // Must be a power of 2.
+
+#define MI_TRIM_GHOST_INDEX(PageFrameIndex) \
+    ((ULONG)(PageFrameIndex) & (MI_TRIM_GHOST_ENTRIES - 1))
+
+typedef struct _MMTRIM_GHOST {
+    PFN_NUMBER PageFrameIndex;
+    PMMPTE PointerPte;
+    PMMSUPPORT WsInfo;
+} MMTRIM_GHOST, *PMMTRIM_GHOST;
+
+extern MMTRIM_GHOST MiTrimGhosts[MI_TRIM_GHOST_ENTRIES];
+
+//
+// System wide totals of the trim feedback, kept for reporting only since
+// the per working set counts decay.
+//
+
+extern ULONG MiTrimmedPageCount;
+extern ULONG MiTrimRefaultCount;
+extern ULONG MiTrimThrottleCount;
+
+//
+// A working set that has faulted back in more than 1/2^N of the pages
+// recently trimmed from it (and at least the minimum) is trimmed less
+// aggressively.
+//
+
+#define MI_TRIM_REFAULT_SHIFT   2
+#define MI_TRIM_REFAULT_MINIMUM 16
+
 //
 // This "percentage" of a claim is up for grabs in a foreground process.
 //
@@ -4244,7 +4449,12 @@ typedef struct _MMMOD_WRITER_MDL_ENTRY {
 } MMMOD_WRITER_MDL_ENTRY, *PMMMOD_WRITER_MDL_ENTRY;
 
 
-#define MM_PAGING_FILE_MDLS 2
+//
+// Number of write MDLs per paging file.  This bounds the number of
+// modified page writes to each paging file that can be in flight at once.
+//
+
+#define MM_PAGING_FILE_MDLS 4
 
 typedef struct _MMPAGING_FILE {
     PFN_NUMBER Size;
@@ -4748,6 +4958,12 @@ MiStartZeroPageWorkers (
     VOID
     );
 
+VOID
+FASTCALL
+MiSignalZeroingNode (
+    IN ULONG Node
+    );
+
 VOID
 MiPurgeTransitionList (
     VOID
@@ -4888,6 +5104,11 @@ MiFindContiguousPages (
     IN MEMORY_CACHING_TYPE CacheType
     );
 
+VOID
+MiCompactPhysicalMemory (
+    VOID
+    );
+
 PVOID
 MiFindContiguousMemory (
     IN PFN_NUMBER LowestPfn,
@@ -5480,6 +5701,12 @@ Return Value:
 
     MiRemoveNode ((PMMADDRESS_NODE)Vad, Root);
 
+    //
+    // Invalidate the VADs cached by the threads of the process.
+    //
+
+    CurrentProcess->VadSequence += 1;
+
     //
     // If the hint points at the removed VAD, change the hint.
     //
@@ -5578,6 +5805,12 @@ MiFillWsleHash (
     IN PMMWSL WorkingSetList
     );
 
+VOID
+MiMigrateWsleHash (
+    IN PMMWSL WorkingSetList,
+    IN ULONG Slots
+    );
+
 WSLE_NUMBER
 MiTrimWorkingSet (
     IN WSLE_NUMBER Reduction,
@@ -5987,6 +6220,16 @@ extern PKNODE KeNodeBlock[];
         (((MI_SYSTEM_PAGE_COLOR++) & MmSecondaryColorMask) |                \
          KeNodeBlock[n]->MmShiftedColor)
 
+#define MI_ZERO_NODE_FROM_COLOR(c)                                          \
+        ((KeNumberNodes > 1) ? (ULONG)((c) >> MmSecondaryColorNodeShift) : 0)
+
+#define MI_ZERO_NODE_FROM_PFN(pfn)                                          \
+        ((KeNumberNodes > 1) ? (ULONG)((pfn)->u3.e1.PageColor) : 0)
+
+#define MI_NODE_PAGE_COUNT(n,l)                                             \
+        ((KeNumberNodes > 1) ? KeNodeBlock[n]->FreeCount[l] :               \
+                               MmPageLocationList[l]->Total)
+
 #else
 
 #define MI_NODE_FROM_COLOR(c)
@@ -6004,6 +6247,12 @@ extern PKNODE KeNodeBlock[];
 #define MI_GET_PAGE_COLOR_NODE(n)                                           \
         ((MI_SYSTEM_PAGE_COLOR++) & MmSecondaryColorMask)
 
+#define MI_ZERO_NODE_FROM_COLOR(c)      0
+
+#define MI_ZERO_NODE_FROM_PFN(pfn)      0
+
+#define MI_NODE_PAGE_COUNT(n,l)         (MmPageLocationList[l]->Total)
+
 #endif
 
 FORCEINLINE
@@ -7478,6 +7727,18 @@ extern MMPFNLIST MmFreePageListHead;
 extern MMPFNLIST MmStandbyPageListHead;
 
 extern MMPFNLIST MmStandbyPageListByPriority[MI_PFN_PRIORITIES];
+extern ULONG MmStandbyRepurposedByPriority[MI_PFN_PRIORITIES];
+
+extern ULONG MmReadAroundPages;
+extern ULONG MmReadAroundHits;
+extern ULONG MmReadAroundMisses;
+
+VOID
+FASTCALL
+MiLogPfnInformation (
+    IN PMMPFN Pfn1,
+    IN USHORT Reason
+    );
 
 extern MMPFNLIST MmRomPageListHead;
 
@@ -7529,6 +7790,38 @@ extern KEVENT MmZeroingPageEvent;
 
 extern BOOLEAN MmZeroingPageThreadActive;
 
+//
+// Per-node zeroing state.  On multinode systems each node with processors
+// gets its own zero page worker thread which keeps the node's zeroed lists
+// filled from the node's free pages.  The zero page thread itself covers
+// any node without a worker (and is the only zeroer on single node
+// systems).  Workers are woken when enough free pages accumulate on the
+// node, or when the node's zeroed pages fall below the watermark.  The
+// watermark adapts to keep MiRemoveZeroPage misses below
+// 1 / MI_ZERO_MISS_TARGET of all requests.
+//
+// All fields except the counters are protected by the PFN lock.
+//
+
+#define MI_ZERO_WATERMARK_MINIMUM   ((1024 * 1024) >> PAGE_SHIFT)
+#define MI_ZERO_WATERMARK_MAXIMUM   ((64 * 1024 * 1024) >> PAGE_SHIFT)
+
+#define MI_ZERO_MISS_TARGET         64
+
+typedef struct _MI_ZERO_NODE {
+    KEVENT Event;
+    BOOLEAN Worker;
+    BOOLEAN Active;
+    PFN_NUMBER Watermark;
+    ULONG Hits;
+    ULONG Misses;
+    ULONG LastHits;
+    ULONG LastMisses;
+    ULONG64 BytesZeroed;
+} MI_ZERO_NODE, *PMI_ZERO_NODE;
+
+extern MI_ZERO_NODE MiZeroNodes[MAXIMUM_CCNUMA_NODES];
+
 //
 // Minimum number of free pages before zeroing page thread starts.
 //
@@ -8158,6 +8451,14 @@ extern ULONG MmMinimumPageFileReduction;
 
 extern LARGE_INTEGER MiModifiedPageLife;
 
+//
+// Mapped pages are written once they are older than MiModifiedPageLife,
+// which is measured in seconds, so the timer which signals that they are
+// too old may fire up to a second late (see KeSetCoalescableTimer).
+//
+
+#define MI_MODIFIED_PAGE_TOLERABLE_DELAY 1000
+
 extern BOOLEAN MiTimerPending;
 
 extern KEVENT MiMappedPagesTooOldEvent;
@@ -217,6 +217,12 @@ KEVENT MmZeroingPageEvent;
 
 BOOLEAN MmZeroingPageThreadActive;
 
+//
+// Per-node zeroing state, see MiSignalZeroingNode.
+//
+
+MI_ZERO_NODE MiZeroNodes[MAXIMUM_CCNUMA_NODES];
+
 //
 // Minimum number of free pages before zeroing page thread starts.
 //
@@ -1112,6 +1112,13 @@ Environment:
 
         MmZeroingPageThreadActive = FALSE;
 
+        for (i = 0; i < MAXIMUM_CCNUMA_NODES; i += 1) {
+            KeInitializeEvent (&MiZeroNodes[i].Event,
+                               SynchronizationEvent,
+                               FALSE);
+            MiZeroNodes[i].Watermark = MI_ZERO_WATERMARK_MINIMUM;
+        }
+
         MiMemorySan (LoaderBlock);
 
         //
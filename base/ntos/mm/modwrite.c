@@ -68,6 +68,20 @@ NTSTATUS MiLastMappedWriteError;
 ULONG MiMappedWriteBurstCount;
 ULONG MiModifiedWriteBurstCount;
 
+//
+// Page file write statistics.  These are updated under the PFN lock when
+// the writes are issued and by the write completion APCs, which run in the
+// context of the modified page writer thread that issued them, so no other
+// synchronization is needed.
+//
+
+ULONG MiPageFileWrites;
+ULONG MiPageFilePagesWritten;
+ULONG MiPageFileWriteRuns;
+ULONG MiPageFileWritesInProgress;
+ULONG MiPageFileWritesInProgressPeak;
+ULONGLONG MiPageFileWriteTime;
+
 VOID
 MiClusterWritePages (
     IN PMMPFN Pfn1,
@@ -97,6 +111,8 @@ MiZeroPageFileFirstPage (
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text(PAGE,NtCreatePagingFile)
 #pragma alloc_text(PAGE,MmGetPageFileInformation)
+#pragma alloc_text(PAGE,MmGetPageFileWriteInformation)
+#pragma alloc_text(PAGE,MmGetPageFileReadInformation)
 #pragma alloc_text(PAGE,MmGetSystemPageFile)
 #pragma alloc_text(PAGE,MiLdwPopupWorker)
 #pragma alloc_text(PAGE,MiAttemptPageFileExtension)
@@ -119,6 +135,108 @@ KEVENT MmMappedFileIoComplete;
 ULONG MmSystemShutdown;
 
 BOOLEAN MmSystemPageFileLocated;
+NTSTATUS
+MmGetPageFileWriteInformation (
+    OUT PVOID SystemInformation,
+    IN ULONG SystemInformationLength,
+    OUT PULONG Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the modified page writer's page file write
+    statistics.
+
+Arguments:
+
+    SystemInformation - Returns a SYSTEM_PAGEFILE_WRITE_INFORMATION
+                        structure.
+
+    SystemInformationLength - Supplies the length of the SystemInformation
+                              buffer.
+
+    Length - Returns the length of the information placed in the buffer.
+
+Return Value:
+
+    Returns the status of the operation.
+
+--*/
+
+{
+    PSYSTEM_PAGEFILE_WRITE_INFORMATION WriteInfo;
+
+    PAGED_CODE();
+
+    *Length = sizeof (SYSTEM_PAGEFILE_WRITE_INFORMATION);
+
+    if (SystemInformationLength < *Length) {
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    WriteInfo = (PSYSTEM_PAGEFILE_WRITE_INFORMATION) SystemInformation;
+
+    WriteInfo->Writes = MiPageFileWrites;
+    WriteInfo->PagesWritten = MiPageFilePagesWritten;
+    WriteInfo->ContiguousRuns = MiPageFileWriteRuns;
+    WriteInfo->WritesInProgress = MiPageFileWritesInProgress;
+    WriteInfo->PeakWritesInProgress = MiPageFileWritesInProgressPeak;
+    WriteInfo->WriteTime = MiPageFileWriteTime;
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+MmGetPageFileReadInformation (
+    OUT PVOID SystemInformation,
+    IN ULONG SystemInformationLength,
+    OUT PULONG Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the page file read-around statistics.
+
+Arguments:
+
+    SystemInformation - Returns a SYSTEM_PAGEFILE_READ_INFORMATION
+                        structure.
+
+    SystemInformationLength - Supplies the length of the SystemInformation
+                              buffer.
+
+    Length - Returns the length of the information placed in the buffer.
+
+Return Value:
+
+    Returns the status of the operation.
+
+--*/
+
+{
+    PSYSTEM_PAGEFILE_READ_INFORMATION ReadInfo;
+
+    PAGED_CODE();
+
+    *Length = sizeof (SYSTEM_PAGEFILE_READ_INFORMATION);
+
+    if (SystemInformationLength < *Length) {
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    ReadInfo = (PSYSTEM_PAGEFILE_READ_INFORMATION) SystemInformation;
+
+    ReadInfo->ReadAroundPages = MmReadAroundPages;
+    ReadInfo->ReadAroundHits = MmReadAroundHits;
+    ReadInfo->ReadAroundMisses = MmReadAroundMisses;
+
+    return STATUS_SUCCESS;
+}
+
 
 NTSTATUS
 MiCheckPageFileMapping (
@@ -1045,8 +1163,9 @@ Arguments:
         // Allocate pool failed.
         //
 
-        ExFreePool (NewPagingFile->Entry[0]);
-        ExFreePool (NewPagingFile->Entry[1]);
+        for (i = 0; i < MM_PAGING_FILE_MDLS; i += 1) {
+            ExFreePool (NewPagingFile->Entry[i]);
+        }
         ExFreePool (NewPagingFile);
         Status = STATUS_INSUFFICIENT_RESOURCES;
         goto ErrorReturn3;
@@ -2357,6 +2476,11 @@ Environment:
         LARGE_INTEGER CurrentTime;
         KeQuerySystemTime (&CurrentTime);
         MI_PAGEFILE_WRITE (WriterEntry, &CurrentTime, 0, status);
+
+        ASSERT (MiPageFileWritesInProgress != 0);
+        MiPageFileWritesInProgress -= 1;
+        MiPageFileWriteTime += (ULONGLONG)(CurrentTime.QuadPart -
+                                           WriterEntry->IssueTime.QuadPart);
     }
 
     if (!NT_SUCCESS (status)) {
@@ -3254,10 +3378,11 @@ Environment:
 
                         MiTimerPending = TRUE;
 
-                        KeSetTimerEx (&MiModifiedPageWriterTimer,
-                                      MiModifiedPageLife,
-                                      0,
-                                      &MiModifiedPageWriterTimerDpc);
+                        KeSetCoalescableTimer (&MiModifiedPageWriterTimer,
+                                               MiModifiedPageLife,
+                                               0,
+                                               MI_MODIFIED_PAGE_TOLERABLE_DELAY,
+                                               &MiModifiedPageWriterTimerDpc);
 
                         UNLOCK_PFN (OldIrql);
                         break;
@@ -3877,11 +4002,14 @@ Environment:
     LARGE_INTEGER StartingOffset;
     PFN_NUMBER ClusterSize;
     PFN_NUMBER ThisCluster;
+    PFN_NUMBER i;
+    PFN_NUMBER j;
     MMPTE LongPte;
     KIRQL OldIrql;
     ULONG NextColor;
     LOGICAL PageFileFull;
     PMMPFN Pfn1;
+    PMMPFN Pfn2;
     PFN_NUMBER PageFrameIndex;
     PKPRCB Prcb;
 
@@ -4129,31 +4257,8 @@ Environment:
             Pfn1->u3.e1.WriteInProgress = 1;
             ASSERT (Pfn1->OriginalPte.u.Soft.PageFileHigh == 0);
 
-            MI_SET_PAGING_FILE_INFO (LongPte,
-                                     Pfn1->OriginalPte,
-                                     CurrentPagingFile->PageFileNumber,
-                                     StartBit);
-
-#if DBG
-            if ((StartBit < 8192) &&
-                (CurrentPagingFile->PageFileNumber == 0)) {
-                ASSERT ((MmPagingFileDebug[StartBit] & 1) == 0);
-                MmPagingFileDebug[StartBit] =
-                    (((ULONG_PTR)Pfn1->PteAddress << 3) |
-                        ((ClusterSize & 0xf) << 1) | 1);
-            }
-#endif
-
-            //
-            // Change the original PTE contents to refer to
-            // the paging file offset where this was written.
-            //
-
-            Pfn1->OriginalPte = LongPte;
-
             ClusterSize += 1;
             Page += 1;
-            StartBit += 1;
         }
         else {
 
@@ -4177,6 +4282,82 @@ Environment:
 
     } //end while
 
+    //
+    // The pages were taken in modified list order, which interleaves
+    // pages from unrelated address ranges.  Sort them by page table page
+    // and PTE address so that virtually adjacent pages are written to
+    // adjacent page file blocks, allowing them to be read back with a
+    // single clustered read.  The cluster is small so an insertion sort
+    // is used.
+    //
+
+    Page = &ModWriterEntry->Page[0];
+
+    for (i = 1; i < ClusterSize; i += 1) {
+
+        PageFrameIndex = Page[i];
+        Pfn1 = MI_PFN_ELEMENT (PageFrameIndex);
+
+        for (j = i; j != 0; j -= 1) {
+
+            Pfn2 = MI_PFN_ELEMENT (Page[j - 1]);
+
+            if ((Pfn2->u4.PteFrame < Pfn1->u4.PteFrame) ||
+                ((Pfn2->u4.PteFrame == Pfn1->u4.PteFrame) &&
+                 (Pfn2->PteAddress < Pfn1->PteAddress))) {
+                break;
+            }
+
+            Page[j] = Page[j - 1];
+        }
+
+        Page[j] = PageFrameIndex;
+    }
+
+    //
+    // Assign the reserved page file blocks in sorted order and count the
+    // virtually contiguous runs being written.
+    //
+
+    Pfn2 = NULL;
+
+    for (i = 0; i < ClusterSize; i += 1) {
+
+        Pfn1 = MI_PFN_ELEMENT (Page[i]);
+
+        if ((Pfn2 == NULL) ||
+            (Pfn2->u4.PteFrame != Pfn1->u4.PteFrame) ||
+            (Pfn2->PteAddress + 1 != Pfn1->PteAddress)) {
+
+            MiPageFileWriteRuns += 1;
+        }
+
+        MI_SET_PAGING_FILE_INFO (LongPte,
+                                 Pfn1->OriginalPte,
+                                 CurrentPagingFile->PageFileNumber,
+                                 StartBit);
+
+#if DBG
+        if ((StartBit < 8192) &&
+            (CurrentPagingFile->PageFileNumber == 0)) {
+            ASSERT ((MmPagingFileDebug[StartBit] & 1) == 0);
+            MmPagingFileDebug[StartBit] =
+                (((ULONG_PTR)Pfn1->PteAddress << 3) |
+                    ((i & 0xf) << 1) | 1);
+        }
+#endif
+
+        //
+        // Change the original PTE contents to refer to
+        // the paging file offset where this was written.
+        //
+
+        Pfn1->OriginalPte = LongPte;
+
+        StartBit += 1;
+        Pfn2 = Pfn1;
+    }
+
     if (ClusterSize != ThisCluster) {
 
 bail:
@@ -4245,6 +4426,14 @@ bail:
 
     ModWriterEntry->LastPageToWrite = StartBit - 1;
 
+    MiPageFileWrites += 1;
+    MiPageFilePagesWritten += (ULONG) ClusterSize;
+
+    MiPageFileWritesInProgress += 1;
+    if (MiPageFileWritesInProgress > MiPageFileWritesInProgressPeak) {
+        MiPageFileWritesInProgressPeak = MiPageFileWritesInProgress;
+    }
+
     //
     // Release the PFN lock and wait for the write to complete.
     //
@@ -4839,7 +5028,7 @@ Return Value:
 
     MmPagingFile[MmNumberOfPagingFiles - 1]->ReferenceCount = 0;
 
-    MmNumberOfActiveMdlEntries += 2;
+    MmNumberOfActiveMdlEntries += MM_PAGING_FILE_MDLS;
 
     UNLOCK_PFN (OldIrql);
 
@@ -34,6 +34,15 @@ ULONG MiUserFaultRetries;
 
 ULONG MmClusterPageFileReads;
 
+//
+// Pages read around page file faults, and how many of them were then
+// referenced or repurposed without being referenced.
+//
+
+ULONG MmReadAroundPages;
+ULONG MmReadAroundHits;
+ULONG MmReadAroundMisses;
+
 #define MI_PROTOTYPE_WSINDEX    ((ULONG)-1)
 
 NTSTATUS
@@ -93,8 +102,22 @@ MiCompleteProtoPteFault (
     IN OUT PMMPFN *LockedProtoPfn
     );
 
+VOID
+MiFaultAround (
+    IN PVOID FaultingAddress,
+    IN PMMPTE PointerPte,
+    IN PEPROCESS Process
+    );
+
 ULONG MmMaxTransitionCluster = 8;
 
+//
+// Maximum number of resident image pages following a soft faulted
+// image page that are made valid along with it.  Zero disables.
+//
+
+ULONG MmFaultAroundPages = 16;
+
 
 NTSTATUS
 MiDispatchFault (
@@ -585,6 +608,8 @@ Environment:
                         }
         
                         MiUnlinkPageFromList (Pfn1);
+
+                        MI_NOTE_READ_AROUND_HIT (Pfn1);
         
                         //
                         // Update the PFN database - the reference count
@@ -1152,6 +1177,20 @@ NonProtoFault:
             UNLOCK_SYSTEM_WS (WsThread);
             LOCK_WORKING_SET (WsThread, SessionWs);
         }
+        else if ((status == STATUS_SUCCESS) &&
+                 (PointerProtoPte != NULL) &&
+                 (Process > PREFETCH_PROCESS) &&
+                 (VirtualAddress <= MM_HIGHEST_USER_ADDRESS) &&
+                 (MmFaultAroundPages != 0)) {
+
+            //
+            // The prototype PTE was resolved without I/O and the working
+            // set pushlock has been held throughout.  Opportunistically
+            // map the resident pages that follow it.
+            //
+
+            MiFaultAround (VirtualAddress, PointerPte, Process);
+        }
 
         ASSERT (EntryIrql == KeGetCurrentIrql ());
         ASSERT (KeGetCurrentIrql() <= APC_LEVEL);
@@ -1319,6 +1358,20 @@ NonProtoFault:
                         PfnClusterPage->u1.Event = NULL;
                     }
                 }
+
+                //
+                // Page file pages that nobody else has referenced yet go
+                // to the standby list at the read around priority.
+                //
+
+                if ((PfnClusterPage->OriginalPte.u.Soft.Prototype == 0) &&
+                    (PfnClusterPage->u3.e2.ReferenceCount == 1) &&
+                    (PfnClusterPage->u4.InPageError == 0)) {
+
+                    MI_SET_PFN_PRIORITY (PfnClusterPage, MI_READ_AROUND_PFN_PRIORITY);
+                    MmReadAroundPages += 1;
+                }
+
                 MI_REMOVE_LOCKED_PAGE_CHARGE_AND_DECREF (PfnClusterPage);
             }
             else {
@@ -2347,6 +2400,13 @@ Environment:
 
             MiUnlinkPageFromList (Pfn1);
 
+            //
+            // The priority selects the standby list so it can only be
+            // reset once the page has been unlinked.
+            //
+
+            MI_NOTE_READ_AROUND_HIT (Pfn1);
+
             //
             // Update the PFN database - the reference count must be
             // incremented as the share count is going to go from zero to 1.
@@ -2647,10 +2707,41 @@ Environment:
     }
 
     //
-    // Capture the desired cluster size.
+    // Size the cluster to the access pattern of this thread.  A fault at
+    // or just beyond the page following its last page file read means the
+    // access is sequential, so read further ahead this time.  Anything else
+    // halves the cluster so random access stops reading pages that are
+    // never used.  MmClusterPageFileReads is the starting size.
     //
 
-    ClusterSize = MmClusterPageFileReads;
+    CurrentThread = PsGetCurrentThread ();
+
+    ClusterSize = CurrentThread->PageFileReadCluster;
+
+    if (ClusterSize == 0) {
+        ClusterSize = MmClusterPageFileReads;
+        if (ClusterSize == 0) {
+            ClusterSize = 1;
+        }
+    }
+
+    if ((PAGE_ALIGN (FaultingAddress) >= CurrentThread->PageFileReadNext) &&
+        ((ULONG_PTR) PAGE_ALIGN (FaultingAddress) - (ULONG_PTR) CurrentThread->PageFileReadNext < ((ULONG_PTR) ClusterSize << PAGE_SHIFT))) {
+
+        ClusterSize *= 2;
+
+        if (ClusterSize > MM_MAXIMUM_READ_CLUSTER_SIZE) {
+            ClusterSize = MM_MAXIMUM_READ_CLUSTER_SIZE;
+        }
+    }
+    else if (ClusterSize > 1) {
+        ClusterSize /= 2;
+    }
+
+    CurrentThread->PageFileReadCluster = ClusterSize;
+
+    ForwardPageCount = 0;
+
     ASSERT (ClusterSize <= MM_MAXIMUM_READ_CLUSTER_SIZE);
 
     if (MiInPageSinglePages != 0) {
@@ -2720,8 +2811,6 @@ Environment:
             }
         }
 
-        CurrentThread = PsGetCurrentThread();
-
         if (CurrentThread->ForwardClusterOnly) {
 
             MaxBackwardPageCount = 0;
@@ -2768,13 +2857,15 @@ Environment:
 
             ReadSize += (MaxForwardPageCount - ForwardPageCount);
 
+            ForwardPageCount = MaxForwardPageCount - ForwardPageCount;
+
             //
             // Try to cluster backward within the page of PTEs.  Donate
             // any unused forward cluster space to the backwards gathering
             // but keep the entire transfer within the MDL.
             //
 
-            ClusterSize -= (MaxForwardPageCount - ForwardPageCount);
+            ClusterSize -= ForwardPageCount;
 
             if (MaxBackwardPageCount > ClusterSize) {
                 MaxBackwardPageCount = ClusterSize;
@@ -2804,6 +2895,13 @@ Environment:
         }
     }
 
+    //
+    // Remember where this read ends so the next fault can tell whether
+    // the thread is moving through its address space sequentially.
+    //
+
+    CurrentThread->PageFileReadNext = (PVOID)((ULONG_PTR) PAGE_ALIGN (FaultingAddress) + ((ForwardPageCount + 1) << PAGE_SHIFT));
+
     if (ReadSize == 1) {
 
         //
@@ -3745,6 +3843,381 @@ Environment:
     return Status;
 }
 
+
+VOID
+MiFaultAround (
+    IN PVOID FaultingAddress,
+    IN PMMPTE PointerPte,
+    IN PEPROCESS Process
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called after a soft fault on an image view has been
+    resolved.  The image pages following the faulting one are usually
+    touched next (particularly while the image is starting up), and the
+    ones whose prototype PTEs are already valid or in transition are
+    made valid now so each of them does not take its own soft fault.
+
+    Data views are not handled here as MiDispatchFault already clusters
+    their transition faults (see MmMaxTransitionCluster).
+
+    Only PTEs which have never been touched (ie: are still zero) are
+    filled in, and only while they lie in the same VAD, the same page
+    table page and the same page of prototype PTEs.  The cluster stops
+    at the first page that is not resident.
+
+Arguments:
+
+    FaultingAddress - Supplies the address that was just made valid.
+
+    PointerPte - Supplies the PTE for the faulting address.
+
+    Process - Supplies the current process.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, APCs disabled, working set pushlock held.  PFN lock NOT held.
+
+--*/
+
+{
+    PMMVAD Vad;
+    KIRQL OldIrql;
+    MMPTE TempPte;
+    MMPTE ProtoPteContents;
+    PMMPTE ProtoPte;
+    PMMPTE FirstPte;
+    PMMPTE FirstProtoPte;
+    PVOID VirtualAddress;
+    PVOID UsedPageTableHandle;
+    PMMPFN Pfn1;
+    PMMPFN Pfn2;
+    PFN_NUMBER PageFrameIndex;
+    ULONG_PTR Vpn;
+    ULONG_PTR MaxPages;
+    ULONG_PTR NumberOfPages;
+    ULONG_PTR PagesMapped;
+    ULONG_PTR i;
+    WSLE_NUMBER WorkingSetIndex;
+    MM_PROTECTION_MASK Protection;
+    PSUBSECTION Subsection;
+    ULONG Flags;
+
+    ASSERT (FaultingAddress <= MM_HIGHEST_USER_ADDRESS);
+
+    if ((PointerPte->u.Hard.Valid == 0) ||
+        (MmAvailablePages < MM_ENORMOUS_LIMIT) ||
+        ((Process->Vm.Flags.MaximumWorkingSetHard == 1) &&
+         (Process->Vm.WorkingSetSize + MmFaultAroundPages > Process->Vm.MaximumWorkingSetSize))) {
+
+        return;
+    }
+
+    Vad = MiLocateAddress (FaultingAddress);
+
+    if ((Vad == NULL) || (Vad->u.VadFlags.VadType != VadImageMap)) {
+        return;
+    }
+
+    Vpn = MI_VA_TO_VPN (FaultingAddress);
+
+    if (Vpn >= Vad->EndingVpn) {
+        return;
+    }
+
+    NumberOfPages = MmFaultAroundPages;
+
+    //
+    // Stay within the VAD.
+    //
+
+    MaxPages = Vad->EndingVpn - Vpn;
+
+    if (NumberOfPages > MaxPages) {
+        NumberOfPages = MaxPages;
+    }
+
+    //
+    // Stay within the page table page mapping the faulting address as it is
+    // the only one known to be resident.
+    //
+
+    FirstPte = PointerPte + 1;
+
+    if (BYTE_OFFSET (FirstPte) == 0) {
+        return;
+    }
+
+    MaxPages = (PAGE_SIZE - BYTE_OFFSET (FirstPte)) / sizeof (MMPTE);
+
+    if (NumberOfPages > MaxPages) {
+        NumberOfPages = MaxPages;
+    }
+
+    //
+    // Stay within the contiguous prototype PTEs of the VAD and within the
+    // page containing them.
+    //
+
+    FirstProtoPte = MiGetProtoPteAddress (Vad, Vpn + 1);
+
+    if ((FirstProtoPte == NULL) ||
+        (FirstProtoPte > Vad->LastContiguousPte) ||
+        (BYTE_OFFSET (FirstProtoPte) == 0)) {
+
+        return;
+    }
+
+    MaxPages = Vad->LastContiguousPte - FirstProtoPte + 1;
+
+    if (NumberOfPages > MaxPages) {
+        NumberOfPages = MaxPages;
+    }
+
+    MaxPages = (PAGE_SIZE - BYTE_OFFSET (FirstProtoPte)) / sizeof (MMPTE);
+
+    if (NumberOfPages > MaxPages) {
+        NumberOfPages = MaxPages;
+    }
+
+    //
+    // Ensure enough WSLEs are available so the working set insertions
+    // below should not fail.
+    //
+
+    MaxPages = 0;
+    WorkingSetIndex = MmWorkingSetList->FirstFree;
+
+    while ((MaxPages < NumberOfPages) &&
+           (WorkingSetIndex != WSLE_NULL_INDEX)) {
+
+        MaxPages += 1;
+
+        if (MmWsle[WorkingSetIndex].u1.Long == (WSLE_NULL_INDEX << MM_FREE_WSLE_SHIFT)) {
+            break;
+        }
+
+        WorkingSetIndex = (WSLE_NUMBER) (MmWsle[WorkingSetIndex].u1.Long >> MM_FREE_WSLE_SHIFT);
+    }
+
+    if (NumberOfPages > MaxPages) {
+        NumberOfPages = MaxPages;
+    }
+
+    if (NumberOfPages == 0) {
+        return;
+    }
+
+    Pfn2 = MI_PFN_ELEMENT (MiGetPteAddress (PointerPte)->u.Hard.PageFrameNumber);
+
+    PagesMapped = 0;
+    PointerPte = FirstPte;
+    ProtoPte = FirstProtoPte;
+
+    LOCK_PFN (OldIrql);
+
+    //
+    // The prototype PTE page was resident when the faulting address was
+    // resolved, but the PFN lock has been released since then.
+    //
+
+    if (MiGetPteAddress (FirstProtoPte)->u.Hard.Valid == 0) {
+        UNLOCK_PFN (OldIrql);
+        return;
+    }
+
+    do {
+
+        if (PointerPte->u.Long != MM_ZERO_PTE) {
+            break;
+        }
+
+        ProtoPteContents = *ProtoPte;
+
+        if (ProtoPteContents.u.Hard.Valid == 1) {
+            PageFrameIndex = MI_GET_PAGE_FRAME_FROM_PTE (&ProtoPteContents);
+        }
+        else if ((ProtoPteContents.u.Soft.Prototype == 0) &&
+                 (ProtoPteContents.u.Soft.Transition == 1)) {
+            PageFrameIndex = MI_GET_PAGE_FRAME_FROM_TRANSITION_PTE (&ProtoPteContents);
+        }
+        else {
+            break;
+        }
+
+        Pfn1 = MI_PFN_ELEMENT (PageFrameIndex);
+
+        //
+        // The protection the PTE would get if it was faulted on comes from
+        // the prototype PTE (see MiCompleteProtoPteFault).  Skip anything
+        // other than plain cached accessible pages so access checks and
+        // guard page semantics are left to the real fault.
+        //
+
+        Protection = (MM_PROTECTION_MASK) MI_GET_PROTECTION_FROM_SOFT_PTE (&Pfn1->OriginalPte);
+
+        if ((Protection < MM_READONLY) ||
+            (Protection > MM_EXECUTE_WRITECOPY) ||
+            (Pfn1->u3.e1.CacheAttribute != MiCached)) {
+
+            break;
+        }
+
+        if (ProtoPteContents.u.Hard.Valid == 1) {
+            Pfn1->u2.ShareCount += 1;
+        }
+        else {
+
+            ASSERT (Pfn1->u3.e1.PageLocation != ActiveAndValid);
+
+            if ((Pfn1->u3.e1.ReadInProgress == 1) ||
+                (Pfn1->u4.InPageError == 1) ||
+                (MmAvailablePages < MM_HIGH_LIMIT)) {
+
+                break;
+            }
+
+            MiUnlinkPageFromList (Pfn1);
+
+            //
+            // The share count is going from zero to one, so the reference
+            // count goes up too.  See the identical transition handling
+            // in MiDispatchFault for why no locked page charge is needed.
+            //
+
+            ASSERT (Pfn1->u2.ShareCount == 0);
+
+            InterlockedIncrementPfn ((PSHORT)&Pfn1->u3.e2.ReferenceCount);
+
+            Pfn1->u2.ShareCount += 1;
+            Pfn1->u3.e1.PageLocation = ActiveAndValid;
+
+            MI_MAKE_TRANSITION_PROTOPTE_VALID (TempPte, ProtoPte);
+
+            if ((Pfn1->u3.e1.Modified) &&
+                (TempPte.u.Hard.Write) &&
+                (TempPte.u.Hard.CopyOnWrite == 0)) {
+
+                MI_SET_PTE_DIRTY (TempPte);
+            }
+            else {
+                MI_SET_PTE_CLEAN (TempPte);
+            }
+
+            MI_WRITE_VALID_PTE (ProtoPte, TempPte);
+        }
+
+        Pfn1->u3.e1.PrototypePte = 1;
+
+        //
+        // The page table page gains a valid PTE.
+        //
+
+        Pfn2->u2.ShareCount += 1;
+
+        MI_MAKE_VALID_USER_PTE (TempPte,
+                                PageFrameIndex,
+                                Protection,
+                                PointerPte);
+
+        MI_WRITE_VALID_PTE (PointerPte, TempPte);
+
+        PagesMapped += 1;
+        PointerPte += 1;
+        ProtoPte += 1;
+
+    } while (PagesMapped < NumberOfPages);
+
+    UNLOCK_PFN (OldIrql);
+
+    if (PagesMapped == 0) {
+        return;
+    }
+
+    UsedPageTableHandle = MI_GET_USED_PTES_HANDLE (FaultingAddress);
+    MI_INCREMENT_USED_PTES_BY_HANDLE_CLUSTER (UsedPageTableHandle, PagesMapped);
+
+    //
+    // Insert the new valid pages in the working set list.  The protection
+    // is in the prototype PTEs, so no protection is kept in the WSLEs.
+    //
+
+    PointerPte = FirstPte;
+    ProtoPte = FirstProtoPte;
+
+    for (i = 0; i < PagesMapped; i += 1) {
+
+        VirtualAddress = MiGetVirtualAddressMappedByPte (PointerPte);
+
+        PageFrameIndex = MI_GET_PAGE_FRAME_FROM_PTE (PointerPte);
+        Pfn1 = MI_PFN_ELEMENT (PageFrameIndex);
+
+        //
+        // The page must be the one the image maps at this address: its
+        // PFN must point back at the prototype PTE the VAD assigns to the
+        // virtual page.  A mismatch means the cluster ran past the range
+        // where the VAD's prototype PTEs are contiguous.
+        //
+
+        ASSERT (Pfn1->PteAddress == ProtoPte);
+        ASSERT (ProtoPte == MiGetProtoPteAddress (Vad, MI_VA_TO_VPN (VirtualAddress)));
+
+        WorkingSetIndex = MiAddValidPageToWorkingSet (VirtualAddress,
+                                                      PointerPte,
+                                                      Pfn1,
+                                                      0);
+
+        if (WorkingSetIndex == 0) {
+
+            //
+            // Trim the page since it could not be added to the working
+            // set list.
+            //
+
+            TempPte.u.Long = MiProtoAddressForPte (Pfn1->PteAddress);
+            TempPte.u.Proto.Prototype = 1;
+
+            MiTrimPte (VirtualAddress, PointerPte, Pfn1, Process, TempPte);
+        }
+        else {
+
+            Process->FaultAroundCount += 1;
+
+            //
+            // Tell the prefetcher about the page just as if it had been
+            // faulted on.
+            //
+
+            if ((CCPF_IS_PREFETCHER_ACTIVE()) &&
+                (Pfn1->OriginalPte.u.Soft.Prototype == 1)) {
+
+                Subsection = MiGetSubsectionAddress (&Pfn1->OriginalPte);
+
+                Flags = CCPF_TYPE_IMAGE;
+                if (Subsection->ControlArea->u.Flags.Rom) {
+                    Flags |= CCPF_TYPE_ROM;
+                }
+
+                CcPfLogPageFault (Subsection->ControlArea->FilePointer,
+                                  MiStartingOffset (Subsection, ProtoPte),
+                                  Flags);
+            }
+        }
+
+        PointerPte += 1;
+        ProtoPte += 1;
+    }
+
+    return;
+}
+
 
 NTSTATUS
 MiResolveMappedFileFault (
@@ -57,6 +57,16 @@ PFN_NUMBER MmTransitionSharedPages;
 
 ULONG MmStandbyRePurposed;
 
+//
+// Number of standby pages repurposed from each priority list.
+//
+
+ULONG MmStandbyRepurposedByPriority[MI_PFN_PRIORITIES];
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text(PAGE,MmGetStandbyListInformation)
+#endif
+
 MM_LDW_WORK_CONTEXT MiLastChanceLdwContext;
     
 ULONG MiAvailablePagesEventLowSets;
@@ -74,13 +84,6 @@ MiRemovePageByColor (
     IN ULONG PageColor
     );
 
-VOID
-FASTCALL
-MiLogPfnInformation (
-    IN PMMPFN Pfn1,
-    IN USHORT Reason
-    );
-
 extern LOGICAL MiZeroingDisabled;
 
 #if DBG
@@ -99,6 +102,59 @@ MiInitializePfnTracing (
 }
 
 
+VOID
+FASTCALL
+MiSignalZeroingNode (
+    IN ULONG Node
+    )
+
+/*++
+
+Routine Description:
+
+    This procedure wakes the thread which zeroes pages for the specified
+    node, unless it is already active or the node has no free pages.
+
+Arguments:
+
+    Node - Supplies the node whose zeroed page lists need refilling.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    PFN lock held.
+
+--*/
+
+{
+    PMI_ZERO_NODE ZeroNode;
+
+    MM_PFN_LOCK_ASSERT();
+
+    if (MI_NODE_PAGE_COUNT (Node, FreePageList) == 0) {
+        return;
+    }
+
+    ZeroNode = &MiZeroNodes[Node];
+
+    if (ZeroNode->Worker == TRUE) {
+        if (ZeroNode->Active == FALSE) {
+            ZeroNode->Active = TRUE;
+            KeSetEvent (&ZeroNode->Event, 0, FALSE);
+        }
+    }
+    else if (MmZeroingPageThreadActive == FALSE) {
+        MmZeroingPageThreadActive = TRUE;
+        KeSetEvent (&MmZeroingPageEvent, 0, FALSE);
+    }
+
+    return;
+}
+
+
 VOID
 FASTCALL
 MiInsertPageInFreeList (
@@ -130,6 +186,7 @@ Environment:
     PMMPFN Pfn1;
     PMMPFN Pfn2;
     ULONG Color;
+    ULONG Node;
     MMLISTS ListName;
     PMMPFNLIST ListHead;
     PMMCOLOR_TABLES ColorHead;
@@ -334,16 +391,16 @@ Environment:
     ColorHead->Count += 1;
     Pfn1->OriginalPte.u.Long = MM_EMPTY_LIST;
 
-    if ((ListHead->Total >= MmMinimumFreePagesToZero) &&
-        (MmZeroingPageThreadActive == FALSE)) {
+    Node = MI_ZERO_NODE_FROM_PFN (Pfn1);
+
+    if (MI_NODE_PAGE_COUNT (Node, FreePageList) >= MmMinimumFreePagesToZero) {
 
         //
-        // There are enough pages on the free list, start
-        // the zeroing page thread.
+        // There are enough pages on this node's free list, start
+        // the thread which zeroes pages for the node.
         //
 
-        MmZeroingPageThreadActive = TRUE;
-        KeSetEvent (&MmZeroingPageEvent, 0, FALSE);
+        MiSignalZeroingNode (Node);
     }
 
     return;
@@ -523,10 +580,11 @@ Environment:
                 if (MiTimerPending == FALSE) {
                     MiTimerPending = TRUE;
 
-                    KeSetTimerEx (&MiModifiedPageWriterTimer,
-                                  MiModifiedPageLife,
-                                  0,
-                                  &MiModifiedPageWriterTimerDpc);
+                    KeSetCoalescableTimer (&MiModifiedPageWriterTimer,
+                                           MiModifiedPageLife,
+                                           0,
+                                           MI_MODIFIED_PAGE_TOLERABLE_DELAY,
+                                           &MiModifiedPageWriterTimerDpc);
                 }
             }
         }
@@ -1194,6 +1252,21 @@ Environment:
         //
 
         MI_TALLY_TRANSITION_PAGE_REMOVAL (Pfn1);
+
+        //
+        // A page read around a page file fault is being repurposed without
+        // ever having been referenced.
+        //
+
+        if (MI_GET_PFN_PRIORITY (Pfn1) == MI_READ_AROUND_PFN_PRIORITY) {
+            MmReadAroundMisses += 1;
+            if (PERFINFO_IS_GROUP_ON(PERF_MEMORY)) {
+                MiLogPfnInformation (Pfn1, PERFINFO_LOG_TYPE_READAROUNDMISS);
+            }
+        }
+
+        MmStandbyRepurposedByPriority[MI_GET_PFN_PRIORITY (Pfn1)] += 1;
+
         MiRestoreTransitionPte (Pfn1);
     }
 
@@ -2101,6 +2174,7 @@ Environment:
 #if MI_BARRIER_SUPPORTED
     ULONG BarrierStamp;
 #endif
+    ULONG ZeroNode;
 #if defined(MI_MULTINODE)
     PKNODE Node;
     ULONG NodeColor;
@@ -2112,6 +2186,8 @@ Environment:
 
     FreePagesByColor = MmFreePagesByColor[ZeroedPageList];
 
+    ZeroNode = MI_ZERO_NODE_FROM_COLOR (Color);
+
 #if defined(MI_MULTINODE)
 
     //
@@ -2178,6 +2254,17 @@ Environment:
             ASSERT (Pfn1->u2.ShareCount == 0);
             ASSERT (Pfn1->u4.PteFrame != MI_MAGIC_AWE_PTEFRAME);
 
+            //
+            // Refill the node's zeroed pages early if they are running low.
+            //
+
+            MiZeroNodes[ZeroNode].Hits += 1;
+
+            if (MI_NODE_PAGE_COUNT (ZeroNode, ZeroedPageList) <
+                                        MiZeroNodes[ZeroNode].Watermark) {
+                MiSignalZeroingNode (ZeroNode);
+            }
+
             return Page;
 
         }
@@ -2244,6 +2331,10 @@ Environment:
         ASSERT (Pfn1->u2.ShareCount == 0);
         ASSERT (Pfn1->u4.PteFrame != MI_MAGIC_AWE_PTEFRAME);
 
+        MiZeroNodes[ZeroNode].Hits += 1;
+
+        MiSignalZeroingNode (ZeroNode);
+
         return Page;
     }
 
@@ -2328,6 +2419,14 @@ Environment:
 
 ZeroPage:
 
+    //
+    // The node's zeroing did not keep up, make sure it is running.
+    //
+
+    MiZeroNodes[ZeroNode].Misses += 1;
+
+    MiSignalZeroingNode (ZeroNode);
+
     Pfn1 = MI_PFN_ELEMENT(Page);
 
     MiZeroPhysicalPage (Page);
@@ -2943,3 +3042,56 @@ MiPurgeTransitionList (
     return;
 }
 
+
+NTSTATUS
+MmGetStandbyListInformation (
+    OUT PVOID SystemInformation,
+    IN ULONG SystemInformationLength,
+    OUT PULONG Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the number of pages on each standby priority list
+    and the number of pages repurposed from each of them.
+
+Arguments:
+
+    SystemInformation - Returns a SYSTEM_STANDBY_LIST_INFORMATION structure.
+
+    SystemInformationLength - Supplies the length of the SystemInformation
+                              buffer.
+
+    Length - Returns the length of the information placed in the buffer.
+
+Return Value:
+
+    Returns the status of the operation.
+
+--*/
+
+{
+    ULONG i;
+    PSYSTEM_STANDBY_LIST_INFORMATION StandbyInfo;
+
+    C_ASSERT (MI_PFN_PRIORITIES == SYSTEM_STANDBY_PRIORITIES);
+
+    PAGED_CODE();
+
+    *Length = sizeof (SYSTEM_STANDBY_LIST_INFORMATION);
+
+    if (SystemInformationLength < *Length) {
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    StandbyInfo = (PSYSTEM_STANDBY_LIST_INFORMATION) SystemInformation;
+
+    for (i = 0; i < MI_PFN_PRIORITIES; i += 1) {
+        StandbyInfo->StandbyPages[i] = (ULONG) MmStandbyPageListByPriority[i].Total;
+        StandbyInfo->RepurposedPages[i] = MmStandbyRepurposedByPriority[i];
+    }
+
+    return STATUS_SUCCESS;
+}
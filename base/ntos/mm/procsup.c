@@ -751,6 +751,7 @@ Environment:
     /* ʼַLock͹mutex */
     KeInitializeGuardedMutex (&ProcessToInitialize->AddressCreationLock);
     ExInitializePushLock (&ProcessToInitialize->Vm.WorkingSetMutex);
+    MiInitializeVadRangeLocks (ProcessToInitialize);
 
     //
     // NOTE:  The process block has been zeroed when allocated, so
@@ -1563,6 +1564,7 @@ Environment:
 
     KeInitializeGuardedMutex (&ProcessToInitialize->AddressCreationLock);
     ExInitializePushLock (&ProcessToInitialize->Vm.WorkingSetMutex);
+    MiInitializeVadRangeLocks (ProcessToInitialize);
 
     KeInitializeSpinLock (&ProcessToInitialize->HyperSpaceLock);
 
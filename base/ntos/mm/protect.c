@@ -29,7 +29,8 @@ MiFlushTbAndCapture (
     IN PMMPTE PtePointer,
     IN ULONG ProtectionMask,
     IN PMMPFN Pfn1,
-    IN LOGICAL CaptureDirtyBit
+    IN LOGICAL CaptureDirtyBit,
+    IN PMMPTE_FLUSH_LIST PteFlushList
     );
 
 ULONG
@@ -364,6 +365,7 @@ Environment:
     PVOID UsedPageTableHandle;
     WIN32_PROTECTION_MASK OriginalProtect;
     LOGICAL WsHeld;
+    MMPTE_FLUSH_LIST PteFlushList;
 #if defined (_MI_RESET_USER_STACK_LIMIT)
     PTEB Teb;
     PVOID StackLimit;
@@ -431,7 +433,14 @@ Environment:
 
 #endif
 
-    LOCK_ADDRESS_SPACE (Process);
+    //
+    // Only the VAD tree is locked while the VAD is located and checked.
+    // Changes to private memory then just hold the VAD's range lock, so
+    // they can proceed concurrently with those to other VADs.  Changes to
+    // sections hold the address space exclusive.
+    //
+
+    LOCK_VAD_TREE (Process);
 
     //
     // Make sure the address space was not deleted, if so, return an error.
@@ -440,7 +449,7 @@ Environment:
     if (Process->Flags & PS_PROCESS_FLAGS_VM_DELETED) 
     {
         Status = STATUS_PROCESS_IS_TERMINATING;
-        goto ErrorFound;
+        goto ErrorFoundVadTree;
     }
 
     FoundVad = MiCheckForConflictingVad (Process, StartingAddress, EndingAddress);
@@ -454,7 +463,7 @@ Environment:
         //
 
         Status = STATUS_CONFLICTING_ADDRESSES;
-        goto ErrorFound;
+        goto ErrorFoundVadTree;
     }
 
     //
@@ -471,7 +480,7 @@ Environment:
         //
 
         Status = STATUS_CONFLICTING_ADDRESSES;
-        goto ErrorFound;
+        goto ErrorFoundVadTree;
     }
 
     if (FoundVad->u.VadFlags.VadType == VadLargePages) 
@@ -484,7 +493,7 @@ Environment:
         if (ProtectionMask == FoundVad->u.VadFlags.Protection) 
         {
 
-            UNLOCK_ADDRESS_SPACE (Process);
+            UNLOCK_VAD_TREE (Process);
 
             *RegionSize = (PCHAR)EndingAddress - (PCHAR)StartingAddress + 1L;
             *BaseAddress = StartingAddress;
@@ -494,7 +503,7 @@ Environment:
         }
 
         Status = STATUS_CONFLICTING_ADDRESSES;
-        goto ErrorFound;
+        goto ErrorFoundVadTree;
     }
 
     if (FoundVad->u.VadFlags.VadType == VadAwe)
@@ -508,7 +517,7 @@ Environment:
                                                      EndingAddress,
                                                      ProtectionMask);
 
-            UNLOCK_ADDRESS_SPACE (Process);
+            UNLOCK_VAD_TREE (Process);
 
             *RegionSize = (PCHAR)EndingAddress - (PCHAR)StartingAddress + 1L;
             *BaseAddress = StartingAddress;
@@ -518,7 +527,7 @@ Environment:
         }
 
         Status = STATUS_CONFLICTING_ADDRESSES;
-        goto ErrorFound;
+        goto ErrorFoundVadTree;
     }
 
     if (FoundVad->u.VadFlags.VadType == VadDevicePhysicalMemory) 
@@ -530,7 +539,7 @@ Environment:
         //
 
         Status = STATUS_CONFLICTING_ADDRESSES;
-        goto ErrorFound;
+        goto ErrorFoundVadTree;
     }
 
     if (FoundVad->u.VadFlags.NoChange == 1)
@@ -549,13 +558,15 @@ Environment:
 
         if (!NT_SUCCESS (Status)) 
         {
-            goto ErrorFound;
+            goto ErrorFoundVadTree;
         }
     }
 
     if (FoundVad->u.VadFlags.PrivateMemory == 0) 
     {
 
+        CONVERT_VAD_TREE_TO_ADDRESS_SPACE (Process);
+
         if (FoundVad->u.VadFlags.VadType == VadLargePageSection) 
         {
 
@@ -750,6 +761,8 @@ Environment:
         if (!NT_SUCCESS (Status)) {
             goto ErrorFound;
         }
+
+        UNLOCK_ADDRESS_SPACE (Process);
     }
     else
     {
@@ -768,9 +781,11 @@ Environment:
             //
 
             Status = STATUS_INVALID_PARAMETER_4;
-            goto ErrorFound;
+            goto ErrorFoundVadTree;
         }
 
+        MiLockVadRange (Process, FoundVad);
+
         Thread = PsGetCurrentThread ();
 
         LOCK_WS_UNSAFE (Thread, Process);
@@ -793,7 +808,7 @@ Environment:
 
             UNLOCK_WS_UNSAFE (Thread, Process);
             Status = STATUS_NOT_COMMITTED;
-            goto ErrorFound;
+            goto ErrorFoundRange;
         }
 
         //
@@ -834,9 +849,14 @@ Environment:
 
         //
         // For all the PTEs in the specified address range, set the
-        // protection depending on the state of the PTE.
+        // protection depending on the state of the PTE.  The TB flushes
+        // for valid PTEs are batched and issued before the working set
+        // mutex is released.
         //
 
+        PteFlushList.Count = 0;
+        SATISFY_OVERZEALOUS_COMPILER (PteFlushList.FlushVa[0] = NULL);
+
         while (PointerPte <= LastPte) 
         {
 
@@ -845,6 +865,16 @@ Environment:
 
                 PointerPde = MiGetPteAddress (PointerPte);
 
+                //
+                // Making the next page directory entry valid may release
+                // the working set mutex, so flush the batched TB entries
+                // for the previous page table first.
+                //
+
+                if (PteFlushList.Count != 0) {
+                    MiFlushPteList (&PteFlushList);
+                }
+
                 MiMakePdeExistAndMakeValid (PointerPde, Process, MM_NOIRQL);
             }
 
@@ -880,9 +910,14 @@ Environment:
 
                     //
                     // This PTE refers to a fork prototype PTE, make it
-                    // private.
+                    // private.  This may release the working set mutex,
+                    // so flush the batched TB entries first.
                     //
 
+                    if (PteFlushList.Count != 0) {
+                        MiFlushPteList (&PteFlushList);
+                    }
+
                     MiCopyOnWrite (MiGetVirtualAddressMappedByPte (PointerPte),
                                    PointerPte);
 
@@ -924,14 +959,16 @@ Environment:
                 Pfn1->OriginalPte.u.Soft.Protection = ProtectionMask;
 
                 //
-                // Change the protection of the valid PTE and flush the TB.
+                // Change the protection of the valid PTE and queue the
+                // TB flush.
                 //
 
                 MiFlushTbAndCapture (FoundVad,
                                      PointerPte,
                                      ProtectionMask,
                                      Pfn1,
-                                     TRUE);
+                                     TRUE,
+                                     &PteFlushList);
             }
             else if (PteContents.u.Soft.Prototype == 1) 
             {
@@ -955,6 +992,10 @@ Environment:
                 while (PteContents.u.Hard.Valid == 0) 
                 {
 
+                    if (PteFlushList.Count != 0) {
+                        MiFlushPteList (&PteFlushList);
+                    }
+
                     UNLOCK_WS_UNSAFE (Thread, Process);
                     WsHeld = FALSE;
 
@@ -1037,6 +1078,10 @@ Environment:
 
         } //end while
 
+        if (PteFlushList.Count != 0) {
+            MiFlushPteList (&PteFlushList);
+        }
+
         UNLOCK_WS_UNSAFE (Thread, Process);
 
 #if defined (_MI_RESET_USER_STACK_LIMIT)
@@ -1074,10 +1119,9 @@ Environment:
 
 #endif
 
+        MiUnlockVadRange (Process, FoundVad);
     }
 
-    UNLOCK_ADDRESS_SPACE (Process);
-
     //
     // Common completion code.
     //
@@ -1096,6 +1140,16 @@ ErrorFound:
 
     UNLOCK_ADDRESS_SPACE (Process);
     return Status;
+
+ErrorFoundVadTree:
+
+    UNLOCK_VAD_TREE (Process);
+    return Status;
+
+ErrorFoundRange:
+
+    MiUnlockVadRange (Process, FoundVad);
+    return Status;
 }
 
 
@@ -1176,6 +1230,7 @@ Environment:
     PVOID UsedPageTableHandle;
     NTSTATUS Status;
     LOGICAL CaptureDirtyBit;
+    MMPTE_FLUSH_LIST PteFlushList;
 
 #if DBG
 
@@ -1650,6 +1705,14 @@ Done:
 
     QuotaCharge = 0;
 
+    //
+    // The TB flushes for valid PTEs are batched and issued before the
+    // working set mutex is released.
+    //
+
+    PteFlushList.Count = 0;
+    SATISFY_OVERZEALOUS_COMPILER (PteFlushList.FlushVa[0] = NULL);
+
     while (PointerPte <= LastPte) {
 
         if (MiIsPteOnPdeBoundary (PointerPte)) {
@@ -1657,6 +1720,16 @@ Done:
             PointerPpe = MiGetPdeAddress (PointerPte);
             PointerPxe = MiGetPpeAddress (PointerPte);
 
+            //
+            // Making the next page directory entry valid may release the
+            // working set mutex, so flush the batched TB entries for the
+            // previous page table first.
+            //
+
+            if (PteFlushList.Count != 0) {
+                MiFlushPteList (&PteFlushList);
+            }
+
             MiMakePdeExistAndMakeValid (PointerPde, Process, MM_NOIRQL);
         }
 
@@ -1788,9 +1861,15 @@ Done:
                     // This PTE refers to a fork prototype PTE, make it
                     // private.  But don't charge quota for it if the PTE
                     // was already copy on write (because it's already
-                    // been charged for this case).
+                    // been charged for this case).  This may release the
+                    // working set mutex, so flush the batched TB entries
+                    // first.
                     //
 
+                    if (PteFlushList.Count != 0) {
+                        MiFlushPteList (&PteFlushList);
+                    }
+
                     if (MiCopyOnWrite ((PVOID)Va, PointerPte) == TRUE) {
 
                         if ((WriteCopy) && (PteContents.u.Hard.CopyOnWrite == 0)) {
@@ -1850,17 +1929,20 @@ Done:
             MI_SNAP_DATA (Pfn1, PointerPte, 7);
 
             //
-            // Change the protection of the valid PTE and flush the TB.
+            // Change the protection of the valid PTE and queue the TB flush.
             //
 
             MiFlushTbAndCapture (FoundVad,
                                  PointerPte,
                                  NewProtectionMask,
                                  Pfn1,
-                                 CaptureDirtyBit);
+                                 CaptureDirtyBit,
+                                 &PteFlushList);
 
             if (FoundVad->u.VadFlags.VadType == VadRotatePhysical) {
 
+                MiFlushPteList (&PteFlushList);
+
                 //
                 // Release the working set pushlock as the prototype PTE we
                 // are about to update may be paged out and we don't want
@@ -1942,6 +2024,10 @@ Done:
 
                 while (PteContents.u.Hard.Valid == 0) {
 
+                    if (PteFlushList.Count != 0) {
+                        MiFlushPteList (&PteFlushList);
+                    }
+
                     UNLOCK_WS_UNSAFE (Thread, Process);
 
                     WsHeld = FALSE;
@@ -2055,6 +2141,10 @@ Done:
         PointerPte += 1;
     }
 
+    if (PteFlushList.Count != 0) {
+        MiFlushPteList (&PteFlushList);
+    }
+
     UNLOCK_WS_UNSAFE (Thread, Process);
 
     //
@@ -2364,14 +2454,17 @@ MiFlushTbAndCapture (
     IN PMMPTE PointerPte,
     IN ULONG ProtectionMask,
     IN PMMPFN Pfn1,
-    IN LOGICAL CaptureDirtyBit
+    IN LOGICAL CaptureDirtyBit,
+    IN PMMPTE_FLUSH_LIST PteFlushList
     )
 
 /*++
 
 Routine Description:
 
-    Non-pageable helper routine to change a PTE & flush the relevant TB entry.
+    Non-pageable helper routine to change a PTE & queue the relevant TB
+    entry for flushing.  The caller flushes the list before it releases
+    the working set mutex at the end of the operation.
 
 Arguments:
 
@@ -2387,6 +2480,9 @@ Arguments:
     CaptureDirtyBit - Supplies TRUE if the dirty bit should be captured and
                       pagefile space released, etc.
 
+    PteFlushList - Supplies the list to add the virtual address to.  If the
+                   list is full the whole process TB will be flushed.
+
 Return Value:
 
     None.
@@ -2526,10 +2622,15 @@ Environment:
     ASSERT (PreviousPte.u.Hard.Valid == 1);
 
     //
-    // Flush the TB as we have changed the protection of a valid PTE.
+    // Queue the TB flush as we have changed the protection of a valid PTE.
+    // A stale entry can only be dirty if the previous PTE captured above
+    // was, so deferring the flush loses no modifications.
     //
 
-    MI_FLUSH_SINGLE_TB (VirtualAddress, FALSE);
+    if (PteFlushList->Count < MM_MAXIMUM_FLUSH_COUNT) {
+        PteFlushList->FlushVa[PteFlushList->Count] = VirtualAddress;
+        PteFlushList->Count += 1;
+    }
 
     ASSERT (PreviousPte.u.Hard.Valid == 1);
 
@@ -32,6 +32,10 @@ VadTreeWalk (
 #pragma alloc_text(PAGE, MmPerfVadTreeWalk)
 #pragma alloc_text(PAGE, MiInsertVadCharges)
 #pragma alloc_text(PAGE, MiRemoveVadCharges)
+#pragma alloc_text(PAGE, MiInitializeVadRangeLocks)
+#pragma alloc_text(PAGE, MiLockVadRange)
+#pragma alloc_text(PAGE, MiUnlockVadRange)
+#pragma alloc_text(PAGE, MiChargeProcessCommitment)
 #if DBG
 #pragma alloc_text(PAGE, VadTreeWalk)
 #endif
@@ -655,6 +659,209 @@ VadTreeWalk (
 }
 #endif
 
+VOID
+MiInitializeVadRangeLocks (
+    IN PEPROCESS Process
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes the address space range lock and the VAD
+    range locks of the specified process.
+
+Arguments:
+
+    Process - Supplies the process being initialized.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, APC_LEVEL or below.
+
+--*/
+
+{
+    ULONG i;
+
+    ExInitializePushLock (&Process->AddressSpaceRangeLock);
+
+    for (i = 0; i < PS_VAD_RANGE_LOCKS; i += 1) {
+        ExInitializePushLock (&Process->VadRangeLocks[i]);
+    }
+}
+
+VOID
+MiLockVadRange (
+    IN PEPROCESS Process,
+    IN PMMVAD Vad
+    )
+
+/*++
+
+Routine Description:
+
+    This routine exchanges the caller's hold of the address creation mutex
+    for a range lock on the specified VAD.  The VAD tree may then change
+    (other than this VAD) and other range locked operations may proceed,
+    but anything acquiring the address space exclusive waits until the
+    range lock is released.
+
+    Only the VAD's own PTEs, commitment and the process commitment (see
+    MiChargeProcessCommitment) may be changed while the range lock is held,
+    and the PTEs only with the working set pushlock held, exactly as for
+    page faults.  Other VADs must not be referenced.
+
+Arguments:
+
+    Process - Supplies the process whose address space is being operated on.
+
+    Vad - Supplies the VAD to lock, this must satisfy MI_VAD_RANGE_LOCKABLE.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, APC_LEVEL or below.  The address creation mutex is held
+    (via LOCK_VAD_TREE) on entry and released on return.
+
+--*/
+
+{
+    PETHREAD Thread;
+
+    PAGED_CODE ();
+
+    ASSERT (MI_VAD_RANGE_LOCKABLE (Vad));
+
+    Thread = PsGetCurrentThread ();
+
+    //
+    // Stay in a guarded region while the range lock is held, as holding the
+    // mutex did.
+    //
+
+    KeEnterGuardedRegionThread (&Thread->Tcb);
+
+    //
+    // The current holder of the VAD range lock (if any) is a range locked
+    // operation which does not need the mutex to finish.  No exclusive
+    // owner or waiter of the address space range lock can exist as they
+    // would also hold the mutex, so the shared acquire does not wait.
+    //
+
+    ExAcquirePushLockExclusive (MI_VAD_RANGE_LOCK (Process, Vad));
+
+    ExAcquirePushLockShared (&Process->AddressSpaceRangeLock);
+
+    KeReleaseGuardedMutex (&Process->AddressCreationLock);
+}
+
+VOID
+MiUnlockVadRange (
+    IN PEPROCESS Process,
+    IN PMMVAD Vad
+    )
+
+/*++
+
+Routine Description:
+
+    This routine releases a range lock acquired by MiLockVadRange.
+
+Arguments:
+
+    Process - Supplies the process whose address space was operated on.
+
+    Vad - Supplies the VAD which was locked.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, APC_LEVEL or below.
+
+--*/
+
+{
+    PAGED_CODE ();
+
+    ExReleasePushLockShared (&Process->AddressSpaceRangeLock);
+
+    ExReleasePushLockExclusive (MI_VAD_RANGE_LOCK (Process, Vad));
+
+    KeLeaveGuardedRegionThread (&PsGetCurrentThread ()->Tcb);
+}
+
+VOID
+MiChargeProcessCommitment (
+    IN PEPROCESS Process,
+    IN SSIZE_T QuotaCharge
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds the specified (possibly negative) charge to the
+    process commitment and updates its peak.  Range locked operations on
+    different VADs may do this concurrently, so interlocked operations are
+    used.  Holders of the address space lock exclude these, so they update
+    the process commitment directly.
+
+Arguments:
+
+    Process - Supplies the process to charge.
+
+    QuotaCharge - Supplies the number of pages to charge (negative to
+                  return).
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, APC_LEVEL or below, VAD range lock held.
+
+--*/
+
+{
+    SIZE_T NewCharge;
+    SIZE_T Peak;
+    SIZE_T OldPeak;
+
+    PAGED_CODE ();
+
+    NewCharge = (SIZE_T) InterlockedExchangeAddSizeT (&Process->CommitCharge,
+                                                      QuotaCharge);
+    NewCharge += QuotaCharge;
+
+    Peak = Process->CommitChargePeak;
+
+    while (NewCharge > Peak) {
+
+        OldPeak = (SIZE_T) InterlockedCompareExchangePointer (
+                                    (PVOID *) &Process->CommitChargePeak,
+                                    (PVOID) NewCharge,
+                                    (PVOID) Peak);
+
+        if (OldPeak == Peak) {
+            break;
+        }
+
+        Peak = OldPeak;
+    }
+}
+
 LOGICAL
 MiCheckForConflictingVadExistence (
     IN PEPROCESS Process,
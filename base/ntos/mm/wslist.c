@@ -92,6 +92,12 @@ MiCheckNullIndex (
     IN PMMWSL WorkingSetList
     );
 
+VOID
+MiSetStandbyPriority (
+    IN PMMSUPPORT WsInfo,
+    IN PMMPFN Pfn1
+    );
+
 #if DBG
 ULONG MiTbDebug;
 #endif
@@ -108,6 +114,11 @@ ULONG MiTbDebug;
 
 ULONG MiWsleFailures;
 
+MMTRIM_GHOST MiTrimGhosts[MI_TRIM_GHOST_ENTRIES];
+
+ULONG MiTrimmedPageCount;
+ULONG MiTrimRefaultCount;
+
 
 WSLE_NUMBER
 MiAllocateWsle (
@@ -158,6 +169,8 @@ Environment:
     PMMWSLE Wsle;
     PMMWSL WorkingSetList;
     WSLE_NUMBER WorkingSetIndex;
+    PFN_NUMBER PageFrameIndex;
+    PMMTRIM_GHOST Ghost;
 
     WorkingSetList = WsInfo->VmWorkingSetList;
     Wsle = WorkingSetList->Wsle;
@@ -256,6 +269,25 @@ Environment:
         Wsle[WorkingSetIndex].u1.Long |= WsleMask;
     }
 
+    MiSetStandbyPriority (WsInfo, Pfn1);
+
+    //
+    // Charge the working set if it is taking back a page it recently
+    // trimmed.
+    //
+
+    PageFrameIndex = MI_PFN_ELEMENT_TO_INDEX (Pfn1);
+    Ghost = &MiTrimGhosts[MI_TRIM_GHOST_INDEX (PageFrameIndex)];
+
+    if ((Ghost->WsInfo == WsInfo) &&
+        (Ghost->PointerPte == PointerPte) &&
+        (Ghost->PageFrameIndex == PageFrameIndex)) {
+
+        Ghost->WsInfo = NULL;
+        WsInfo->RefaultedPages += 1;
+        MiTrimRefaultCount += 1;
+    }
+
 #if DBG
     if (MI_IS_SYSTEM_CACHE_ADDRESS (VirtualAddress)) {
         ASSERT (MmSystemCacheWsle[WorkingSetIndex].u1.e1.Protection == MM_ZERO_ACCESS);
@@ -268,6 +300,97 @@ Environment:
 }
 
 VOID
+MiSetStandbyPriority (
+    IN PMMSUPPORT WsInfo,
+    IN PMMPFN Pfn1
+    )
+
+/*++
+
+Routine Description:
+
+    This function sets the priority of the standby list the specified page
+    will be placed on when it leaves the working set.
+
+    Pages of the system cache working set that belong to files opened for
+    sequential access only are given a low priority.  All other pages are
+    given the priority corresponding to the memory priority of the working
+    set.  A page that is also mapped elsewhere is never lowered, so shared
+    pages keep the highest priority of the working sets using them.
+
+Arguments:
+
+    WsInfo - Supplies the working set the page is being added to.
+
+    Pfn1 - Supplies the PFN entry of the page.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, APCs disabled, working set lock.  PFN lock NOT held.
+
+--*/
+
+{
+    ULONG Priority;
+    PSUBSECTION Subsection;
+    PFILE_OBJECT FilePointer;
+    ULONG_PTR OldFrame;
+    MMPFN TempPfn;
+
+    if (WsInfo == &MmSystemCacheWs) {
+
+        Priority = MI_DEFAULT_PFN_PRIORITY;
+
+        if ((Pfn1->u3.e1.PrototypePte == 1) &&
+            (Pfn1->OriginalPte.u.Soft.Prototype == 1)) {
+
+            Subsection = MiGetSubsectionAddress (&Pfn1->OriginalPte);
+            FilePointer = Subsection->ControlArea->FilePointer;
+
+            if ((FilePointer != NULL) &&
+                (FilePointer->Flags & FO_SEQUENTIAL_ONLY)) {
+
+                Priority = MI_SEQUENTIAL_PFN_PRIORITY;
+            }
+        }
+    }
+    else {
+        Priority = MI_PFN_PRIORITY_FROM_MEMORY_PRIORITY (WsInfo->Flags.MemoryPriority);
+    }
+
+    if (MI_GET_PFN_PRIORITY (Pfn1) == Priority) {
+        return;
+    }
+
+    if ((Priority < MI_GET_PFN_PRIORITY (Pfn1)) &&
+        (Pfn1->u2.ShareCount > 1)) {
+        return;
+    }
+
+    //
+    // The PFN lock is not held so the other fields sharing this longword
+    // may be changing.  Update the priority with an interlocked sequence
+    // so those changes are never lost.  The page is valid in this working
+    // set and so cannot be put on (or taken off) a standby list while this
+    // is in progress, which is when the priority must remain stable.
+    //
+
+    do {
+        OldFrame = Pfn1->u4.EntireFrame;
+        TempPfn.u4.EntireFrame = OldFrame;
+        TempPfn.u4.Priority = Priority;
+    } while (InterlockedCompareExchangePointer ((PVOID *)&Pfn1->u4.EntireFrame,
+                                                (PVOID)TempPfn.u4.EntireFrame,
+                                                (PVOID)OldFrame) != (PVOID)OldFrame);
+
+    return;
+}
+
+VOID
 MiDoReplacement (
     IN PMMSUPPORT WsInfo,
     IN WSLE_ALLOCATION_TYPE Flags
@@ -3352,6 +3475,14 @@ Environment:
     Table = WorkingSetList->HashTable;
     OriginalTable = WorkingSetList->HashTable;
 
+    //
+    // Finish rehashing after the previous growth before growing again.
+    //
+
+    if ((Table != NULL) && (WorkingSetList->MigrateHashTableSize != 0)) {
+        MiMigrateWsleHash (WorkingSetList, WorkingSetList->MigrateHashTableSize);
+    }
+
     First = WorkingSetList->HashTableSize;
 
     if (Table == NULL) {
@@ -3380,16 +3511,25 @@ Environment:
         EntryHashTableEnd = &Table[WorkingSetList->HashTableSize];
 
         WorkingSetList->HashTableSize = 0;
+        WorkingSetList->MigrateHashTableSize = 0;
     }
     else {
 
         //
-        // Attempt to increase by 1/4 of the indirect count.  If this is less
-        // than 4 pages, then grow by 4.  Make sure the working set list has
-        // enough free entries for the growth size though.
+        // Attempt to increase by half of the current table size (or 1/4 of
+        // the indirect count if that is larger) so that the number of
+        // times the entire table must be refilled stays logarithmic in the
+        // size of the working set.  If this is less than 4 pages, then grow
+        // by 4.  Make sure the working set list has enough free entries for
+        // the growth size though.
         //
 
-        NewSize = MI_ROUND_TO_SIZE ((WorkingSetList->NonDirectCount >> 2) * sizeof (MMWSLE_HASH), PAGE_SIZE);
+        if ((WorkingSetList->NonDirectCount >> 2) > (WorkingSetList->HashTableSize >> 1)) {
+            NewSize = MI_ROUND_TO_SIZE ((WorkingSetList->NonDirectCount >> 2) * sizeof (MMWSLE_HASH), PAGE_SIZE);
+        }
+        else {
+            NewSize = MI_ROUND_TO_SIZE ((WorkingSetList->HashTableSize >> 1) * sizeof (MMWSLE_HASH), PAGE_SIZE);
+        }
 
         if (NewSize < 4 * PAGE_SIZE) {
             NewSize = 4 * PAGE_SIZE;
@@ -3654,11 +3794,30 @@ Environment:
     ASSERT ((VirtualAddress == WorkingSetList->HighestPermittedHashAddress) ||
             (MiIsAddressValid (VirtualAddress, FALSE) == FALSE));
 
+    WsInfo->Flags.GrowWsleHash = 0;
+
+    if (OriginalTable != NULL) {
+
+        //
+        // The existing entries stay where they are and are rehashed for
+        // the new size a few slots at a time by subsequent inserts, so
+        // growing never has to refill the whole table at once.
+        //
+
+        WorkingSetList->MigrateHashTableSize = First;
+        WorkingSetList->MigrateHashProbes = WorkingSetList->MaximumHashProbes;
+        WorkingSetList->MigrateHashIndex = 0;
+        WorkingSetList->MaximumHashProbes = 0;
+
+        MiMigrateWsleHash (WorkingSetList, MI_WSLE_HASH_MIGRATE_SLOTS);
+        return;
+    }
+
     if (First != 0) {
         RtlZeroMemory (Table, First * sizeof(MMWSLE_HASH));
     }
 
-    WsInfo->Flags.GrowWsleHash = 0;
+    WorkingSetList->MaximumHashProbes = 0;
 
     //
     // Fill hash table.
@@ -4060,6 +4219,8 @@ Environment:
     WSLE_NUMBER NumberLeftToRemove;
     WSLE_NUMBER NumberNotFlushed;
     MMWSLE_FLUSH_LIST WsleFlushList;
+    PFN_NUMBER PageFrameIndex;
+    PMMTRIM_GHOST Ghost;
 
     WsleFlushList.Count = 0;
 
@@ -4093,6 +4254,12 @@ TrimMore:
                 WsleFlushList.Count += 1;
                 NumberLeftToRemove -= 1;
 
+                PageFrameIndex = MI_GET_PAGE_FRAME_FROM_PTE (PointerPte);
+                Ghost = &MiTrimGhosts[MI_TRIM_GHOST_INDEX (PageFrameIndex)];
+                Ghost->PageFrameIndex = PageFrameIndex;
+                Ghost->PointerPte = PointerPte;
+                Ghost->WsInfo = WsInfo;
+
                 if (WsleFlushList.Count == MM_MAXIMUM_FLUSH_COUNT) {
                     NumberNotFlushed = MiFreeWsleList (WsInfo, &WsleFlushList);
                     WsleFlushList.Count = 0;
@@ -4125,6 +4292,9 @@ TrimMore:
 
     WorkingSetList->NextSlot = TryToFree;
 
+    WsInfo->TrimmedPages += Reduction - NumberLeftToRemove;
+    MiTrimmedPageCount += Reduction - NumberLeftToRemove;
+
     //
     // See if the working set list can be contracted.
     //
@@ -4542,6 +4712,7 @@ Top:
 
             WorkingSetList->HashTable = NULL;
             WorkingSetList->HashTableSize = NewSize;
+            WorkingSetList->MigrateHashTableSize = 0;
 
             MiDeletePteRange (WsInfo, PointerPte, LastPte, FALSE);
         }
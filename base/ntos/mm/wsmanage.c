@@ -50,6 +50,7 @@ Abstract:
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text(INIT, MiAdjustWorkingSetManagerParameters)
 #pragma alloc_text(PAGE, MmIsMemoryAvailable)
+#pragma alloc_text(PAGE, MmGetWorkingSetTrimInformation)
 #endif
 
 KEVENT  MiWorkingSetRequestEvent;
@@ -103,6 +104,8 @@ const LARGE_INTEGER MmClaimParameterAdjustDownTime = {2 * 1000 * 1000 * 10, 0};
 
 LOGICAL MiHardTrim = FALSE;
 
+ULONG MiTrimThrottleCount;
+
 WSLE_NUMBER MiMaximumWslesPerSweep = (1024 * 1024 * 1024) / PAGE_SIZE;
 
 #define MI_MAXIMUM_SAMPLE 8192
@@ -673,6 +676,13 @@ Environment:
         KeSetEvent (&MmModifiedPageWriterEvent, 0, FALSE);
     }
 
+    //
+    // Periodically vacate large page sized blocks of physical memory so
+    // contiguous and large page allocations keep succeeding.
+    //
+
+    MiCompactPhysicalMemory ();
+
     return;
 }
 
@@ -1393,6 +1403,25 @@ Environment:
         break;
     }
 
+    //
+    // If many of the pages recently trimmed from this working set were
+    // faulted straight back in, the trims are removing pages that are
+    // still in use.  Trim it less and never strip pages that have been
+    // accessed since they were last aged.
+    //
+
+    if ((VmSupport->RefaultedPages >= MI_TRIM_REFAULT_MINIMUM) &&
+        (VmSupport->RefaultedPages >
+            (VmSupport->TrimmedPages >> MI_TRIM_REFAULT_SHIFT))) {
+
+        Trim = Trim >> 1;
+        MiTrimThrottleCount += 1;
+
+        if (Criteria->TrimAge == 0) {
+            Criteria->TrimAge = 1;
+        }
+    }
+
     if (Trim > MaxTrim) {
         Trim = MaxTrim;
     }
@@ -1679,6 +1708,13 @@ Environment:
 
             VmSupport->NextAgingSlot = CurrentEntry + 1; // Start here next time
         }
+
+        //
+        // Decay the trim feedback so it reflects recent behavior.
+        //
+
+        VmSupport->TrimmedPages = VmSupport->TrimmedPages >> 1;
+        VmSupport->RefaultedPages = VmSupport->RefaultedPages >> 1;
     }
 
     //
@@ -2683,3 +2719,53 @@ Bail:
     return Status;
 }
 
+
+NTSTATUS
+MmGetWorkingSetTrimInformation (
+    OUT PVOID SystemInformation,
+    IN ULONG SystemInformationLength,
+    OUT PULONG Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the system wide working set trim feedback
+    statistics.
+
+Arguments:
+
+    SystemInformation - Returns a SYSTEM_WORKING_SET_TRIM_INFORMATION
+                        structure.
+
+    SystemInformationLength - Supplies the length of the SystemInformation
+                              buffer.
+
+    Length - Returns the length of the information placed in the buffer.
+
+Return Value:
+
+    Returns the status of the operation.
+
+--*/
+
+{
+    PSYSTEM_WORKING_SET_TRIM_INFORMATION TrimInfo;
+
+    PAGED_CODE();
+
+    *Length = sizeof (SYSTEM_WORKING_SET_TRIM_INFORMATION);
+
+    if (SystemInformationLength < *Length) {
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    TrimInfo = (PSYSTEM_WORKING_SET_TRIM_INFORMATION) SystemInformation;
+
+    TrimInfo->TrimmedPages = MiTrimmedPageCount;
+    TrimInfo->RefaultedPages = MiTrimRefaultCount;
+    TrimInfo->TrimThrottles = MiTrimThrottleCount;
+
+    return STATUS_SUCCESS;
+}
@@ -39,6 +39,12 @@ MiRepointWsleHashIndex (
     IN WSLE_NUMBER NewWsIndex
     );
 
+PMMWSLE_HASH
+MiLookupWsleHash (
+    IN PMMWSL WorkingSetList,
+    IN PVOID Key
+    );
+
 VOID
 MiCheckWsleHash (
     IN PMMWSL WorkingSetList
@@ -89,6 +95,7 @@ Environment:
     WSLE_NUMBER CurrentVictimHashIndex;
     MMWSLE CurrentVictimWsleContents;
     ULONG CurrentVictimAccessed;
+    WSLE_NUMBER HomeHash;
 
     WorkingSetList = WsInfo->VmWorkingSetList;
 
@@ -108,16 +115,28 @@ Environment:
     MmNumberOfInserts += 1;
 #endif
 
+    //
+    // If the table was recently grown, rehash the next few slots of its
+    // old range.
+    //
+
+    if (WorkingSetList->MigrateHashTableSize != 0) {
+        MiMigrateWsleHash (WorkingSetList, MI_WSLE_HASH_MIGRATE_SLOTS);
+    }
+
     Hash = MI_WSLE_HASH (Wsle[Entry].u1.Long, WorkingSetList);
+    HomeHash = Hash;
 
     HashTableSize = WorkingSetList->HashTableSize;
 
     //
     // Check hash table size and see if there is enough room to
-    // hash or if the table should be grown.
+    // hash or if the table should be grown.  Growth is requested once
+    // the table is three quarters full as linear probe sequences (and
+    // so the cost of every lookup) lengthen rapidly beyond that.
     //
 
-    if ((WorkingSetList->NonDirectCount + 10 + (HashTableSize >> 4)) >
+    if ((WorkingSetList->NonDirectCount + (HashTableSize >> 2)) >
                 HashTableSize) {
 
         if ((Table + HashTableSize + ((2*PAGE_SIZE) / sizeof (MMWSLE_HASH)) <= (PMMWSLE_HASH)WorkingSetList->HighestPermittedHashAddress)) {
@@ -288,6 +307,8 @@ GotHash:
     Table[Hash].Key = MI_GENERATE_VALID_WSLE (&Wsle[Entry]);
     Table[Hash].Index = Entry;
 
+    MI_NOTE_WSLE_HASH_PROBES (WorkingSetList, HomeHash, Hash);
+
 #if DBG
     if ((MmNumberOfInserts % 1000) == 0) {
         MiCheckWsleHash (WorkingSetList);
@@ -414,6 +435,10 @@ Environment:
             Table->Key = MI_GENERATE_VALID_WSLE (Wsle);
             Table->Index = Index;
 
+            MI_NOTE_WSLE_HASH_PROBES (WorkingSetList,
+                                      (ULONG)(OriginalTable - StartTable),
+                                      (ULONG)(Table - StartTable));
+
             Wsle->u1.e1.Hashed = 1;
 
 DidOne:
@@ -435,6 +460,196 @@ DidOne:
     return;
 }
 
+VOID
+MiMigrateWsleHash (
+    IN PMMWSL WorkingSetList,
+    IN ULONG Slots
+    )
+
+/*++
+
+Routine Description:
+
+    This function rehashes the next slots of the old range of a hash table
+    which has been grown in place.  Each entry is taken out of its slot and
+    reinserted relative to its home slot for the current table size.
+
+    Entries already placed for the current size may be moved as well, which
+    is harmless since they are reinserted at or before their old position in
+    their probe sequence.
+
+    When the whole old range has been rehashed, lookups stop probing from
+    the old home slots.
+
+Arguments:
+
+    WorkingSetList - Supplies a pointer to the working set list structure.
+
+    Slots - Supplies the maximum number of old slots to rehash.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, APCs disabled, working set lock held.
+
+--*/
+
+{
+    PVOID Key;
+    WSLE_NUMBER Index;
+    WSLE_NUMBER Hash;
+    WSLE_NUMBER HomeHash;
+    WSLE_NUMBER Slot;
+    PMMWSLE_HASH Table;
+    ULONG HashTableSize;
+
+    ASSERT (WorkingSetList->HashTable != NULL);
+    ASSERT (WorkingSetList->MigrateHashTableSize != 0);
+    ASSERT (WorkingSetList->MigrateHashTableSize < WorkingSetList->HashTableSize);
+
+    Table = WorkingSetList->HashTable;
+    HashTableSize = WorkingSetList->HashTableSize;
+    Slot = WorkingSetList->MigrateHashIndex;
+
+    while ((Slots != 0) && (Slot < WorkingSetList->MigrateHashTableSize)) {
+
+        Key = Table[Slot].Key;
+
+        if (Key != 0) {
+
+            Index = Table[Slot].Index;
+            Table[Slot].Key = 0;
+
+            //
+            // There is always a free slot since this one was just freed.
+            //
+
+            Hash = MI_WSLE_HASH (Key, WorkingSetList);
+            HomeHash = Hash;
+
+            while (Table[Hash].Key != 0) {
+                Hash += 1;
+                if (Hash >= HashTableSize) {
+                    Hash = 0;
+                }
+                ASSERT (Hash != HomeHash);
+            }
+
+            Table[Hash].Key = Key;
+            Table[Hash].Index = Index;
+
+            MI_NOTE_WSLE_HASH_PROBES (WorkingSetList, HomeHash, Hash);
+        }
+
+        Slot += 1;
+        Slots -= 1;
+    }
+
+    if (Slot < WorkingSetList->MigrateHashTableSize) {
+        WorkingSetList->MigrateHashIndex = Slot;
+        return;
+    }
+
+    WorkingSetList->MigrateHashTableSize = 0;
+    WorkingSetList->MigrateHashProbes = 0;
+    WorkingSetList->MigrateHashIndex = 0;
+
+#if DBG
+    MiCheckWsleHash (WorkingSetList);
+#endif
+    return;
+}
+
+PMMWSLE_HASH
+MiLookupWsleHash (
+    IN PMMWSL WorkingSetList,
+    IN PVOID Key
+    )
+
+/*++
+
+Routine Description:
+
+    This function locates the hash table slot for the specified key.
+
+    The probe from the home slot for the current table size stops after
+    MaximumHashProbes slots.  While the table is being rehashed after
+    growing, a second probe is made from the home slot for the old size,
+    wrapping within the old range, and it stops after MigrateHashProbes
+    slots.
+
+Arguments:
+
+    WorkingSetList - Supplies the working set list to search.
+
+    Key - Supplies the page aligned virtual address with the valid bit set.
+
+Return Value:
+
+    A pointer to the hash table slot, or NULL if the key is not hashed.
+
+Environment:
+
+    Kernel mode, APCs disabled, working set lock held.
+
+--*/
+
+{
+    PMMWSLE_HASH Table;
+    WSLE_NUMBER Hash;
+    WSLE_NUMBER StartHash;
+    ULONG Probes;
+    ULONG HashTableSize;
+
+    Table = WorkingSetList->HashTable;
+
+    ASSERT (Table != NULL);
+
+    HashTableSize = WorkingSetList->HashTableSize;
+    Probes = WorkingSetList->MaximumHashProbes;
+
+    while (TRUE) {
+
+        Hash = MI_WSLE_HASH_INDEX (Key, HashTableSize);
+        StartHash = Hash;
+
+        do {
+
+            if (Table[Hash].Key == Key) {
+                return &Table[Hash];
+            }
+
+            Hash += 1;
+            if (Hash >= HashTableSize) {
+                Hash = 0;
+            }
+
+            if (Probes == 0) {
+                break;
+            }
+
+            Probes -= 1;
+
+        } while (Hash != StartHash);
+
+        //
+        // Then look from the home slot for the old size if the table is
+        // still being rehashed.
+        //
+
+        if ((WorkingSetList->MigrateHashTableSize == 0) ||
+            (HashTableSize == WorkingSetList->MigrateHashTableSize)) {
+            return NULL;
+        }
+
+        HashTableSize = WorkingSetList->MigrateHashTableSize;
+        Probes = WorkingSetList->MigrateHashProbes;
+    }
+}
+
 #if DBG
 VOID
 MiCheckWsleHash (
@@ -453,6 +668,16 @@ MiCheckWsleHash (
             found += 1;
             ASSERT (WorkingSetList->HashTable[i].Key ==
                 MI_GENERATE_VALID_WSLE (&Wsle[WorkingSetList->HashTable[i].Index]));
+
+            //
+            // Every hashed entry must be reachable within the probe bounds,
+            // from its home slot for the current size or, while the table
+            // is being rehashed, for the old size.
+            //
+
+            ASSERT (MiLookupWsleHash (WorkingSetList,
+                                      WorkingSetList->HashTable[i].Key) ==
+                    &WorkingSetList->HashTable[i]);
         }
     }
     if (found > WorkingSetList->NonDirectCount) {
@@ -508,10 +733,7 @@ Environment:
 {
     PMMWSLE Wsle;
     PMMWSLE LastWsle;
-    WSLE_NUMBER Hash;
-    WSLE_NUMBER StartHash;
     PMMWSLE_HASH Table;
-    ULONG Tries;
 #if defined (_WIN64)
     ULONG LoopCount;
     WSLE_NUMBER WsPteIndex;
@@ -566,32 +788,17 @@ Environment:
 #endif
 
     if (WorkingSetList->HashTable != NULL) {
-        Tries = 0;
-        Table = WorkingSetList->HashTable;
 
-        Hash = MI_WSLE_HASH (VirtualAddress, WorkingSetList);
-        StartHash = Hash;
+        Table = MiLookupWsleHash (WorkingSetList, VirtualAddress);
 
-        while (Table[Hash].Key != VirtualAddress) {
-            Hash += 1;
-            if (Hash >= WorkingSetList->HashTableSize) {
-                ASSERT (Tries == 0);
-                Hash = 0;
-                Tries = 1;
-            }
-            if (Hash == StartHash) {
-                Tries = 2;
-                break;
-            }
-        }
-        if (Tries < 2) {
-            WsPfnIndex = Table[Hash].Index;
+        if (Table != NULL) {
+            WsPfnIndex = Table->Index;
             ASSERT (Wsle[WsPfnIndex].u1.e1.Hashed == 1);
             ASSERT (Wsle[WsPfnIndex].u1.e1.Direct == 0);
-            ASSERT (MI_GENERATE_VALID_WSLE (&Wsle[WsPfnIndex]) == Table[Hash].Key);
+            ASSERT (MI_GENERATE_VALID_WSLE (&Wsle[WsPfnIndex]) == Table->Key);
             if (Deletion) {
                 Wsle[WsPfnIndex].u1.e1.Hashed = 0;
-                Table[Hash].Key = 0;
+                Table->Key = 0;
             }
             return WsPfnIndex;
         }
@@ -653,9 +860,9 @@ Environment:
     PVOID VirtualAddress;
     PMMWSLE_HASH Table;
     MMWSLE WsleContents;
+#if DBG
     WSLE_NUMBER Hash;
-    WSLE_NUMBER StartHash;
-    ULONG Tries;
+#endif
 
     Wsle = WorkingSetList->Wsle;
 
@@ -736,11 +943,6 @@ Environment:
 
         if (WorkingSetList->HashTable != NULL) {
 
-            Hash = MI_WSLE_HASH (WsleContents.u1.Long, WorkingSetList);
-            Table = WorkingSetList->HashTable;
-            Tries = 0;
-            StartHash = Hash;
-
             //
             // Or in the valid bit so virtual address 0 is handled
             // properly (instead of matching a free hash entry).
@@ -748,28 +950,22 @@ Environment:
 
             VirtualAddress = (PVOID)((ULONG_PTR)VirtualAddress | 0x1);
 
-            while (Table[Hash].Key != VirtualAddress) {
-                Hash += 1;
-                if (Hash >= WorkingSetList->HashTableSize) {
-                    ASSERT (Tries == 0);
-                    Hash = 0;
-                    Tries = 1;
-                }
-                if (Hash == StartHash) {
+            Table = MiLookupWsleHash (WorkingSetList, VirtualAddress);
 
-                    //
-                    // The entry could not be found in the hash, it must
-                    // never have been inserted.  This is ok, we don't
-                    // need to do anything more in this case.
-                    //
+            if (Table == NULL) {
 
-                    ASSERT (WsleContents.u1.e1.Hashed == 0);
-                    return;
-                }
+                //
+                // The entry could not be found in the hash, it must
+                // never have been inserted.  This is ok, we don't
+                // need to do anything more in this case.
+                //
+
+                ASSERT (WsleContents.u1.e1.Hashed == 0);
+                return;
             }
 
             ASSERT (WsleContents.u1.e1.Hashed == 1);
-            Table[Hash].Key = 0;
+            Table->Key = 0;
         }
     }
 
@@ -1132,11 +1328,11 @@ Environment:
 --*/
 
 {
+#if DBG
     WSLE_NUMBER Hash;
-    WSLE_NUMBER StartHash;
+#endif
     PVOID VirtualAddress;
     PMMWSLE_HASH Table;
-    ULONG Tries;
     
     if (WsleEntry.u1.e1.Hashed == 0) {
 #if DBG
@@ -1153,37 +1349,22 @@ Environment:
         return;
     }
 
-    Tries = 0;
-    Table = WorkingSetList->HashTable;
-
     VirtualAddress = MI_GENERATE_VALID_WSLE (&WsleEntry);
 
-    Hash = MI_WSLE_HASH (WsleEntry.u1.VirtualAddress, WorkingSetList);
-    StartHash = Hash;
-
-    while (Table[Hash].Key != VirtualAddress) {
-
-        Hash += 1;
+    Table = MiLookupWsleHash (WorkingSetList, VirtualAddress);
 
-        if (Hash >= WorkingSetList->HashTableSize) {
-            ASSERT (Tries == 0);
-            Hash = 0;
-            Tries = 1;
-        }
-
-        if (StartHash == Hash) {
+    if (Table == NULL) {
 
-            //
-            // Didn't find the hash entry, so this virtual address must
-            // not have one.  That's ok, just return as nothing needs to
-            // be done in this case.
-            //
+        //
+        // Didn't find the hash entry, so this virtual address must
+        // not have one.  That's ok, just return as nothing needs to
+        // be done in this case.
+        //
 
-            return;
-        }
+        return;
     }
 
-    Table[Hash].Index = NewWsIndex;
+    Table->Index = NewWsIndex;
 
     return;
 }
@@ -40,6 +40,24 @@ LONG MiNextZeroProcessor = (LONG)-1;
 
 #endif
 
+#if defined(MI_MULTINODE)
+
+VOID
+MiZeroNodeThread (
+    IN PVOID StartContext
+    );
+
+#endif
+
+VOID
+MiAdjustZeroWatermark (
+    IN PMI_ZERO_NODE ZeroNode
+    );
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text(PAGE,MmGetZeroPageInformation)
+#endif
+
 VOID
 MmZeroPageThread (
     VOID
@@ -218,6 +236,20 @@ Environment:
 
         LOCK_PFN (OldIrql);
 
+        //
+        // Retune the watermarks of the nodes this thread zeroes for.
+        //
+
+#if defined(MI_MULTINODE)
+        for (i = 0; i < KeNumberNodes; i += 1) {
+            if (MiZeroNodes[i].Worker == FALSE) {
+                MiAdjustZeroWatermark (&MiZeroNodes[i]);
+            }
+        }
+#else
+        MiAdjustZeroWatermark (&MiZeroNodes[0]);
+#endif
+
         do {
 
             if (MmFreePageListHead.Total == 0) {
@@ -246,7 +278,8 @@ Environment:
             //
             // In a multinode system, zero pages by node.  Resume on
             // the last node examined, find a node with free pages that
-            // need to be zeroed.
+            // need to be zeroed.  Nodes with their own zero page worker
+            // are left to it.
             //
 
             if (KeNumberNodes > 1) {
@@ -254,13 +287,19 @@ Environment:
                 n = LastNodeZeroing;
 
                 for (i = 0; i < KeNumberNodes; i += 1) {
-                    if (KeNodeBlock[n]->FreeCount[FreePageList] != 0) {
+                    if ((KeNodeBlock[n]->FreeCount[FreePageList] != 0) &&
+                        (MiZeroNodes[n].Worker == FALSE)) {
                         break;
                     }
                     n = (n + 1) % KeNumberNodes;
                 }
 
-                ASSERT (i != KeNumberNodes);
+                if (i == KeNumberNodes) {
+                    MmZeroingPageThreadActive = FALSE;
+                    UNLOCK_PFN (OldIrql);
+                    break;
+                }
+
                 ASSERT (KeNodeBlock[n]->FreeCount[FreePageList] != 0);
 
                 if (n != LastNodeZeroing) {
@@ -398,6 +437,12 @@ Environment:
                 MiUnmapPagesInZeroSpace (ZeroBase, PagesToZero);
             }
 
+#if defined(MI_MULTINODE)
+            MiZeroNodes[n].BytesZeroed += ((ULONG64)PagesToZero << PAGE_SHIFT);
+#else
+            MiZeroNodes[0].BytesZeroed += ((ULONG64)PagesToZero << PAGE_SHIFT);
+#endif
+
             PagesToZero = 0;
 
             Pfn1 = PfnAllocation;
@@ -430,6 +475,379 @@ Environment:
     } while (TRUE);
 }
 
+
+VOID
+MiAdjustZeroWatermark (
+    IN PMI_ZERO_NODE ZeroNode
+    )
+
+/*++
+
+Routine Description:
+
+    This routine retunes the zeroed page watermark of the specified node
+    from the zeroed page requests seen since the last call.  If more than
+    1 / MI_ZERO_MISS_TARGET of them had to zero a page inline, the
+    watermark is doubled so the node's zeroing starts earlier.  Otherwise
+    it decays back towards the minimum.
+
+Arguments:
+
+    ZeroNode - Supplies the node's zeroing state.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, PFN lock held.
+
+--*/
+
+{
+    ULONG Hits;
+    ULONG Misses;
+    PFN_NUMBER Watermark;
+
+    MM_PFN_LOCK_ASSERT();
+
+    Hits = ZeroNode->Hits - ZeroNode->LastHits;
+    Misses = ZeroNode->Misses - ZeroNode->LastMisses;
+
+    ZeroNode->LastHits = ZeroNode->Hits;
+    ZeroNode->LastMisses = ZeroNode->Misses;
+
+    Watermark = ZeroNode->Watermark;
+
+    if ((ULONG64)Misses * MI_ZERO_MISS_TARGET > (ULONG64)Hits + Misses) {
+        Watermark *= 2;
+        if (Watermark > MI_ZERO_WATERMARK_MAXIMUM) {
+            Watermark = MI_ZERO_WATERMARK_MAXIMUM;
+        }
+    }
+    else {
+        Watermark -= Watermark / 8;
+        if (Watermark < MI_ZERO_WATERMARK_MINIMUM) {
+            Watermark = MI_ZERO_WATERMARK_MINIMUM;
+        }
+    }
+
+    ZeroNode->Watermark = Watermark;
+
+    return;
+}
+
+#if defined(MI_MULTINODE)
+
+
+VOID
+MiZeroNodeThread (
+    IN PVOID StartContext
+    )
+
+/*++
+
+Routine Description:
+
+    Implements the zero page worker thread for a single node.  Like the
+    zeroing page thread, this thread runs at priority zero so it only
+    uses idle processor time.  It is affinitized to the node's processors
+    and moves the node's free pages to its zeroed lists.  The pages are
+    zeroed with nontemporal stores (see KeZeroPages) so they do not push
+    useful data out of the node's caches.
+
+    System PTEs are used for the mappings since the zeroing PTEs in
+    hyperspace belong to the zeroing page thread.
+
+Arguments:
+
+    StartContext - Supplies the number of the node to zero pages for.
+
+Return Value:
+
+    None.
+
+Environment:
+
+    Kernel mode, PASSIVE_LEVEL.
+
+--*/
+
+{
+    ULONG Node;
+    PKNODE KeNode;
+    PMI_ZERO_NODE ZeroNode;
+    MMPTE TempPte;
+    PMMPTE PointerPte;
+    KIRQL OldIrql;
+    PVOID ZeroBase;
+    PMMPFN Pfn1;
+    PFN_COUNT PagesToZero;
+    PFN_COUNT MaximumPagesToZero;
+    PFN_NUMBER PageFrame;
+    PFN_NUMBER PageFrame1;
+    PMMPFN PfnAllocation;
+    ULONG Color;
+    ULONG StartColor;
+    ULONG SecondaryColorMask;
+    PMMCOLOR_TABLES FreePagesByColor;
+
+    Node = (ULONG)(ULONG_PTR) StartContext;
+    KeNode = KeNodeBlock[Node];
+    ZeroNode = &MiZeroNodes[Node];
+
+    //
+    // Make local copies of globals so they don't have to be wastefully
+    // refetched while holding the PFN lock.
+    //
+
+    FreePagesByColor = MmFreePagesByColor[FreePageList];
+    SecondaryColorMask = MmSecondaryColorMask;
+
+    KeSetSystemAffinityThread (KeNode->ProcessorMask);
+
+    KeSetPriorityZeroPageThread (0);
+
+    //
+    // Zero groups of pages at once to reduce PFN lock contention, charging
+    // commitment and resident available up front as the zeroing page
+    // thread does.  64k is the largest binned system PTE size.
+    //
+
+    MaximumPagesToZero = SecondaryColorMask + 1;
+
+    if (MaximumPagesToZero > (64 * 1024) / PAGE_SIZE) {
+        MaximumPagesToZero = (64 * 1024) / PAGE_SIZE;
+    }
+
+    PagesToZero = MaximumPagesToZero;
+    MaximumPagesToZero = 1;
+
+    if (MiChargeCommitment (PagesToZero, NULL) == TRUE) {
+
+        LOCK_PFN (OldIrql);
+
+        if (MI_NONPAGEABLE_MEMORY_AVAILABLE() > (SPFN_NUMBER)(PagesToZero)) {
+            MI_DECREMENT_RESIDENT_AVAILABLE (PagesToZero,
+                                    MM_RESAVAIL_ALLOCATE_ZERO_PAGE_CLUSTERS);
+            MaximumPagesToZero = PagesToZero;
+        }
+
+        UNLOCK_PFN (OldIrql);
+    }
+
+    Color = KeNode->MmShiftedColor;
+    PfnAllocation = (PMMPFN) MM_EMPTY_LIST;
+
+    //
+    // Loop forever zeroing pages.
+    //
+
+    do {
+
+        KeWaitForSingleObject (&ZeroNode->Event,
+                               WrFreePage,
+                               KernelMode,
+                               FALSE,
+                               NULL);
+
+        LOCK_PFN (OldIrql);
+
+        MiAdjustZeroWatermark (ZeroNode);
+
+        do {
+
+            if ((KeNode->FreeCount[FreePageList] == 0) ||
+                (MiZeroingDisabled == TRUE)) {
+
+                ZeroNode->Active = FALSE;
+                UNLOCK_PFN (OldIrql);
+                break;
+            }
+
+            PagesToZero = 0;
+
+            StartColor = Color;
+
+            do {
+
+                PageFrame = FreePagesByColor[Color].Flink;
+
+                if (PageFrame != MM_EMPTY_LIST) {
+
+                    Pfn1 = MI_PFN_ELEMENT (PageFrame);
+
+                    if ((Pfn1->u3.e1.PageLocation != FreePageList) ||
+                        (Pfn1->u3.e2.ReferenceCount != 0)) {
+
+                        KeBugCheckEx (PFN_LIST_CORRUPT,
+                                      0x8D,
+                                      PageFrame,
+                                      (Pfn1->u3.e2.ShortFlags << 16) |
+                                        Pfn1->u3.e2.ReferenceCount,
+                                      (ULONG_PTR) Pfn1->PteAddress);
+                    }
+
+                    PageFrame1 = MiRemoveAnyPage (Color);
+
+                    if (PageFrame != PageFrame1) {
+
+                        KeBugCheckEx (PFN_LIST_CORRUPT,
+                                      0x8E,
+                                      PageFrame,
+                                      PageFrame1,
+                                      0);
+                    }
+
+                    //
+                    // The colors scanned here belong to this node, so the
+                    // page must too.  A page from another node would be
+                    // zeroed through remote memory and then inserted in
+                    // the wrong node's zeroed lists.
+                    //
+
+                    ASSERT (Pfn1->u3.e1.PageColor == KeNode->Color);
+
+                    Pfn1->u1.Flink = (PFN_NUMBER) PfnAllocation;
+
+                    //
+                    // Mark the page bad while it is off the lists, see
+                    // MmZeroPageThread.
+                    //
+
+                    Pfn1->u3.e1.PageLocation = BadPageList;
+
+                    PfnAllocation = Pfn1;
+
+                    PagesToZero += 1;
+                }
+
+                Color = (Color & ~SecondaryColorMask) |
+                        ((Color + 1) & SecondaryColorMask);
+
+                if (PagesToZero == MaximumPagesToZero) {
+                    break;
+                }
+
+                if (Color == StartColor) {
+                    break;
+                }
+
+            } while (TRUE);
+
+            ASSERT (PagesToZero != 0);
+            ASSERT (PfnAllocation != (PMMPFN) MM_EMPTY_LIST);
+
+            UNLOCK_PFN (OldIrql);
+
+            PointerPte = MiReserveSystemPtes (PagesToZero, SystemPteSpace);
+
+            if (PointerPte == NULL) {
+
+                //
+                // Put these pages back on the free list and wait to be
+                // woken again.  The node is still marked active while
+                // the pages are reinserted so this thread is not
+                // immediately signaled again.
+                //
+
+                LOCK_PFN (OldIrql);
+
+                do {
+
+                    PageFrame = MI_PFN_ELEMENT_TO_INDEX (PfnAllocation);
+
+                    PfnAllocation = (PMMPFN) PfnAllocation->u1.Flink;
+
+                    MiInsertPageInFreeList (PageFrame);
+
+                } while (PfnAllocation != (PMMPFN) MM_EMPTY_LIST);
+
+                ZeroNode->Active = FALSE;
+
+                UNLOCK_PFN (OldIrql);
+
+                break;
+            }
+
+            ZeroBase = MiGetVirtualAddressMappedByPte (PointerPte);
+
+            Pfn1 = PfnAllocation;
+
+            do {
+
+                ASSERT (PointerPte->u.Hard.Valid == 0);
+
+                TempPte = ValidKernelPte;
+
+                if (Pfn1->u3.e1.CacheAttribute == MiWriteCombined) {
+                    MI_SET_PTE_WRITE_COMBINE (TempPte);
+                }
+                else if (Pfn1->u3.e1.CacheAttribute == MiNonCached) {
+                    MI_DISABLE_CACHING (TempPte);
+                }
+
+                TempPte.u.Hard.PageFrameNumber = MI_PFN_ELEMENT_TO_INDEX (Pfn1);
+
+                MI_WRITE_VALID_PTE (PointerPte, TempPte);
+
+                PointerPte += 1;
+
+                Pfn1 = (PMMPFN) Pfn1->u1.Flink;
+
+            } while (Pfn1 != (PMMPFN) MM_EMPTY_LIST);
+
+            MACHINE_ZERO_PAGE (ZeroBase, PagesToZero << PAGE_SHIFT);
+
+            //
+            // Verify the nontemporal stores through the system PTE mapping
+            // actually zeroed the cluster before it is put on the zeroed
+            // lists.
+            //
+
+            ASSERT (RtlCompareMemoryUlong (ZeroBase,
+                                           PagesToZero << PAGE_SHIFT,
+                                           0) == (PagesToZero << PAGE_SHIFT));
+
+            PointerPte -= PagesToZero;
+
+            MiReleaseSystemPtes (PointerPte, PagesToZero, SystemPteSpace);
+
+            ZeroNode->BytesZeroed += ((ULONG64)PagesToZero << PAGE_SHIFT);
+
+            Pfn1 = PfnAllocation;
+
+            LOCK_PFN (OldIrql);
+
+            do {
+
+                PageFrame = MI_PFN_ELEMENT_TO_INDEX (Pfn1);
+
+                Pfn1 = (PMMPFN) Pfn1->u1.Flink;
+
+                MiInsertPageInList (&MmZeroedPageListHead, PageFrame);
+
+            } while (Pfn1 != (PMMPFN) MM_EMPTY_LIST);
+
+            //
+            // Briefly release the PFN lock between clusters to allow other
+            // threads to make progress.
+            //
+
+            UNLOCK_PFN (OldIrql);
+
+            PfnAllocation = (PMMPFN) MM_EMPTY_LIST;
+
+            LOCK_PFN (OldIrql);
+
+        } while (TRUE);
+
+    } while (TRUE);
+}
+
+#endif
+
 #if !defined(NT_UP)
 
 
@@ -806,6 +1224,11 @@ Environment:
 {
     ULONG i;
     PWORK_QUEUE_ITEM WorkItem;
+#if defined(MI_MULTINODE)
+    KIRQL OldIrql;
+    HANDLE ThreadHandle;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+#endif
 
     for (i = 0; i < (ULONG) KeNumberProcessors; i += 1) {
 
@@ -821,7 +1244,107 @@ Environment:
 
         ExQueueWorkItem (WorkItem, CriticalWorkQueue);
     }
+
+#if defined(MI_MULTINODE)
+
+    //
+    // Give every node but the first its own zero page worker thread so
+    // its zeroed lists are refilled by its own processors.  The zeroing
+    // page thread keeps the first node and any node without processors.
+    //
+
+    if (KeNumberNodes > 1) {
+
+        InitializeObjectAttributes (&ObjectAttributes, NULL, 0, NULL, NULL);
+
+        for (i = 1; i < KeNumberNodes; i += 1) {
+
+            if (KeNodeBlock[i]->ProcessorMask == 0) {
+                continue;
+            }
+
+            if (!NT_SUCCESS(PsCreateSystemThread (&ThreadHandle,
+                                                  THREAD_ALL_ACCESS,
+                                                  &ObjectAttributes,
+                                                  0L,
+                                                  NULL,
+                                                  MiZeroNodeThread,
+                                                  (PVOID)(ULONG_PTR) i))) {
+                break;
+            }
+
+            ZwClose (ThreadHandle);
+
+            LOCK_PFN (OldIrql);
+
+            MiZeroNodes[i].Worker = TRUE;
+            MiSignalZeroingNode (i);
+
+            UNLOCK_PFN (OldIrql);
+        }
+    }
+
+#endif
 }
 
 #endif
 
+
+NTSTATUS
+MmGetZeroPageInformation (
+    OUT PVOID SystemInformation,
+    IN ULONG SystemInformationLength,
+    OUT PULONG Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the zeroing statistics of each node.
+
+Arguments:
+
+    SystemInformation - Returns an array of SYSTEM_ZERO_PAGE_INFORMATION
+                        structures, one per node.
+
+    SystemInformationLength - Supplies the length of the SystemInformation
+                              buffer.
+
+    Length - Returns the length of the information placed in the buffer.
+
+Return Value:
+
+    Returns the status of the operation.
+
+--*/
+
+{
+    ULONG i;
+    ULONG NumberOfNodes;
+    PSYSTEM_ZERO_PAGE_INFORMATION ZeroPageInfo;
+
+    PAGED_CODE();
+
+    NumberOfNodes = KeNumberNodes;
+
+    *Length = NumberOfNodes * sizeof (SYSTEM_ZERO_PAGE_INFORMATION);
+
+    if (SystemInformationLength < *Length) {
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    ZeroPageInfo = (PSYSTEM_ZERO_PAGE_INFORMATION) SystemInformation;
+
+    for (i = 0; i < NumberOfNodes; i += 1) {
+        ZeroPageInfo->BytesZeroed = MiZeroNodes[i].BytesZeroed;
+        ZeroPageInfo->ZeroedListHits = MiZeroNodes[i].Hits;
+        ZeroPageInfo->ZeroedListMisses = MiZeroNodes[i].Misses;
+        ZeroPageInfo->ZeroedPages = (ULONG) MI_NODE_PAGE_COUNT (i, ZeroedPageList);
+        ZeroPageInfo->Watermark = (ULONG) MiZeroNodes[i].Watermark;
+        ZeroPageInfo += 1;
+    }
+
+    return STATUS_SUCCESS;
+}
+
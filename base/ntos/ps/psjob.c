@@ -58,6 +58,7 @@ BOOLEAN PspJobTimeLimitsShuttingDown;
 
 #define PSP_ONE_SECOND      (10 * (1000*1000))
 #define PSP_JOB_TIME_LIMITS_TIME    -7
+#define PSP_JOB_TIME_LIMITS_TOLERABLE_DELAY 1000
 
 #ifdef ALLOC_DATA_PRAGMA
 #pragma data_seg("PAGEDATA")
@@ -3021,9 +3022,11 @@ PspJobTimeLimitsWork(
     PspLockJobTimeLimitsShared (CurrentThread);
 
     if (!PspJobTimeLimitsShuttingDown) {
-        KeSetTimer (&PspJobTimeLimitsTimer,
-                    PspJobTimeLimitsInterval,
-                    &PspJobTimeLimitsDpc);
+        KeSetCoalescableTimer (&PspJobTimeLimitsTimer,
+                               PspJobTimeLimitsInterval,
+                               0,
+                               PSP_JOB_TIME_LIMITS_TOLERABLE_DELAY,
+                               &PspJobTimeLimitsDpc);
     }
 
     PspUnlockJobTimeLimitsShared (CurrentThread);
@@ -3087,9 +3090,11 @@ PspInitializeJobStructuresPhase1(
     // queues work items!).
     //
 
-    KeSetTimer (&PspJobTimeLimitsTimer,
-                PspJobTimeLimitsInterval,
-                &PspJobTimeLimitsDpc);
+    KeSetCoalescableTimer (&PspJobTimeLimitsTimer,
+                           PspJobTimeLimitsInterval,
+                           0,
+                           PSP_JOB_TIME_LIMITS_TOLERABLE_DELAY,
+                           &PspJobTimeLimitsDpc);
 }
 
 VOID
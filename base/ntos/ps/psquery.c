@@ -599,7 +599,7 @@ NtQueryInformationProcess(
     KPROCESSOR_MODE PreviousMode;
     NTSTATUS st;
     PROCESS_BASIC_INFORMATION BasicInfo;
-    VM_COUNTERS_EX VmCounters;
+    VM_COUNTERS_EX2 VmCounters;
     IO_COUNTERS IoCounters;
     KERNEL_USER_TIMES SysUserTime;
     HANDLE DebugPort;
@@ -872,7 +872,8 @@ NtQueryInformationProcess(
     case ProcessVmCounters:
 
         if (ProcessInformationLength != (ULONG) sizeof (VM_COUNTERS)
-            && ProcessInformationLength != (ULONG) sizeof (VM_COUNTERS_EX)) {
+            && ProcessInformationLength != (ULONG) sizeof (VM_COUNTERS_EX)
+            && ProcessInformationLength != (ULONG) sizeof (VM_COUNTERS_EX2)) {
             return STATUS_INFO_LENGTH_MISMATCH;
         }
 
@@ -914,6 +915,7 @@ NtQueryInformationProcess(
         VmCounters.PagefileUsage = ((SIZE_T) Process->QuotaUsage[PsPageFile]) << PAGE_SHIFT;
         VmCounters.PeakPagefileUsage = ((SIZE_T) Process->QuotaPeak[PsPageFile]) << PAGE_SHIFT;
         VmCounters.PrivateUsage = ((SIZE_T) Process->CommitCharge) << PAGE_SHIFT;
+        VmCounters.FaultAroundCount = Process->FaultAroundCount;
 
         ObDereferenceObject (Process);
 
@@ -816,6 +816,8 @@ typedef struct _WMI_SWITCH_BUFFER_INFORMATION {
 #define PERFINFO_LOG_TYPE_TRIMSESSION              (EVENT_TRACE_GROUP_MEMORY | 0x46)
 #define PERFINFO_LOG_TYPE_MEMORYSNAPLITE           (EVENT_TRACE_GROUP_MEMORY | 0x47)
 #define PERFINFO_LOG_TYPE_WS_SESSION               (EVENT_TRACE_GROUP_MEMORY | 0x48)
+#define PERFINFO_LOG_TYPE_READAROUNDHIT            (EVENT_TRACE_GROUP_MEMORY | 0x49)
+#define PERFINFO_LOG_TYPE_READAROUNDMISS           (EVENT_TRACE_GROUP_MEMORY | 0x4a)
 
 // (EVENT_TRACE_GROUP_POOL
 // 
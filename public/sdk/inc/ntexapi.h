@@ -1130,6 +1130,20 @@ typedef enum _SYSTEM_INFORMATION_CLASS {
     SystemSuperfetchInformation,
     SystemMemoryListInformation,
     SystemFileCacheInformationEx,
+    SystemPoolTagNodeInformation,
+    SystemLookasideInformationEx,
+    SystemTimerExpirationInformation,
+    SystemDispatcherLockInformation,
+    SystemSchedulerStealInformation,
+    SystemWorkQueueDelayInformation,
+    SystemZeroPageInformation,
+    SystemTbFlushInformation,
+    SystemStandbyListInformation,
+    SystemPageFileWriteInformation,
+    SystemMemoryCompactionInformation,
+    SystemPoolMagazineInformation,
+    SystemPageFileReadInformation,
+    SystemWorkingSetTrimInformation,
     MaxSystemInfoClass  // MaxSystemInfoClass should always be the last enum
 } SYSTEM_INFORMATION_CLASS;
 
@@ -1829,6 +1843,15 @@ typedef struct _SYSTEM_POOLTAG {
     SIZE_T NonPagedUsed;
 } SYSTEM_POOLTAG, *PSYSTEM_POOLTAG;
 
+typedef struct _SYSTEM_POOLTAG_NODE {
+    union {
+        UCHAR Tag[4];
+        ULONG TagUlong;
+    };
+    ULONG NonPagedAllocs;
+    ULONG NonPagedRemoteAllocs;     // satisfied with pages from another node
+} SYSTEM_POOLTAG_NODE, *PSYSTEM_POOLTAG_NODE;
+
 typedef struct _SYSTEM_BIGPOOL_ENTRY {
     union {
         PVOID VirtualAddress;
@@ -1852,6 +1875,11 @@ typedef struct _SYSTEM_POOLTAG_INFORMATION {
     SYSTEM_POOLTAG TagInfo[1];
 } SYSTEM_POOLTAG_INFORMATION, *PSYSTEM_POOLTAG_INFORMATION;
 
+typedef struct _SYSTEM_POOLTAG_NODE_INFORMATION {
+    ULONG Count;
+    SYSTEM_POOLTAG_NODE TagInfo[1];
+} SYSTEM_POOLTAG_NODE_INFORMATION, *PSYSTEM_POOLTAG_NODE_INFORMATION;
+
 typedef struct _SYSTEM_SESSION_POOLTAG_INFORMATION {
     SIZE_T NextEntryOffset;
     ULONG SessionId;
@@ -1887,6 +1915,131 @@ typedef struct _SYSTEM_CONTEXT_SWITCH_INFORMATION {
     ULONG SwitchToIdle;
 } SYSTEM_CONTEXT_SWITCH_INFORMATION, *PSYSTEM_CONTEXT_SWITCH_INFORMATION;
 
+typedef struct _SYSTEM_TIMER_EXPIRATION_INFORMATION {
+    ULONG ExpirationScans;
+    ULONG TimersExpired;
+    ULONG TimersCoalesced;
+} SYSTEM_TIMER_EXPIRATION_INFORMATION, *PSYSTEM_TIMER_EXPIRATION_INFORMATION;
+
+#define SYSTEM_LOCK_HISTOGRAM_SIZE 16
+
+typedef struct _SYSTEM_DISPATCHER_LOCK_INFORMATION {
+    ULONG Acquisitions;
+    ULONG Contentions;
+    ULONG SpinHistogram[SYSTEM_LOCK_HISTOGRAM_SIZE];
+    ULONG HoldHistogram[SYSTEM_LOCK_HISTOGRAM_SIZE];
+    ULONG ObjectLockBypasses;
+} SYSTEM_DISPATCHER_LOCK_INFORMATION, *PSYSTEM_DISPATCHER_LOCK_INFORMATION;
+
+typedef struct _SYSTEM_SCHEDULER_STEAL_INFORMATION {
+    ULONG LocalHits;
+    ULONG SmtSteals;
+    ULONG NodeSteals;
+    ULONG RemoteNodeSteals;
+} SYSTEM_SCHEDULER_STEAL_INFORMATION, *PSYSTEM_SCHEDULER_STEAL_INFORMATION;
+
+//
+// Returned as an array with one element per system work queue type for
+// each node, the queues of node zero first.  The delay histogram is log2,
+// the first bucket covering delays below 1024 interrupt time units.
+//
+
+#define SYSTEM_WORK_QUEUE_DELAY_HISTOGRAM_SIZE 16
+
+typedef struct _SYSTEM_WORK_QUEUE_DELAY_INFORMATION {
+    ULONG WorkItemsProcessed;
+    ULONG DynamicThreadCount;
+    ULONG DelayThreadsCreated;
+    ULONG DelayHistogram[SYSTEM_WORK_QUEUE_DELAY_HISTOGRAM_SIZE];
+} SYSTEM_WORK_QUEUE_DELAY_INFORMATION, *PSYSTEM_WORK_QUEUE_DELAY_INFORMATION;
+
+//
+// Returned as an array with one element per node.
+//
+
+typedef struct _SYSTEM_ZERO_PAGE_INFORMATION {
+    ULONGLONG BytesZeroed;
+    ULONG ZeroedListHits;
+    ULONG ZeroedListMisses;
+    ULONG ZeroedPages;
+    ULONG Watermark;
+} SYSTEM_ZERO_PAGE_INFORMATION, *PSYSTEM_ZERO_PAGE_INFORMATION;
+
+typedef struct _SYSTEM_TB_FLUSH_INFORMATION {
+    ULONG EntireFlushes;
+    ULONG ProcessFlushes;
+    ULONG MultipleFlushes;
+    ULONG MultipleFlushEntries;
+    ULONG SingleFlushes;
+    ULONG IpiRequests;
+} SYSTEM_TB_FLUSH_INFORMATION, *PSYSTEM_TB_FLUSH_INFORMATION;
+
+//
+// Pool magazine counters summed over all processors.  Hits are allocations
+// and frees satisfied by a processor's loaded or previous magazine; depot
+// allocates and frees are magazine exchanges with the node depots.
+//
+
+typedef struct _SYSTEM_POOL_MAGAZINE_INFORMATION {
+    ULONG Allocates;
+    ULONG AllocateHits;
+    ULONG Frees;
+    ULONG FreeHits;
+    ULONG DepotAllocates;
+    ULONG DepotFrees;
+    ULONG Flushes;
+} SYSTEM_POOL_MAGAZINE_INFORMATION, *PSYSTEM_POOL_MAGAZINE_INFORMATION;
+
+#define SYSTEM_STANDBY_PRIORITIES 8
+
+typedef struct _SYSTEM_STANDBY_LIST_INFORMATION {
+    ULONG StandbyPages[SYSTEM_STANDBY_PRIORITIES];
+    ULONG RepurposedPages[SYSTEM_STANDBY_PRIORITIES];
+} SYSTEM_STANDBY_LIST_INFORMATION, *PSYSTEM_STANDBY_LIST_INFORMATION;
+
+typedef struct _SYSTEM_PAGEFILE_WRITE_INFORMATION {
+    ULONG Writes;
+    ULONG PagesWritten;
+    ULONG ContiguousRuns;
+    ULONG WritesInProgress;
+    ULONG PeakWritesInProgress;
+    ULONGLONG WriteTime;
+} SYSTEM_PAGEFILE_WRITE_INFORMATION, *PSYSTEM_PAGEFILE_WRITE_INFORMATION;
+
+//
+// Pages read around page file faults.  A hit is a read-around page later
+// taken by a transition fault; a miss is one repurposed from standby
+// without ever being referenced.
+//
+
+typedef struct _SYSTEM_PAGEFILE_READ_INFORMATION {
+    ULONG ReadAroundPages;
+    ULONG ReadAroundHits;
+    ULONG ReadAroundMisses;
+} SYSTEM_PAGEFILE_READ_INFORMATION, *PSYSTEM_PAGEFILE_READ_INFORMATION;
+
+//
+// Working set trim feedback.  Refaults are trimmed pages faulted back into
+// the same working set before their frames were reused; throttles are
+// trims halved because a working set's recent refault rate was high.
+//
+
+typedef struct _SYSTEM_WORKING_SET_TRIM_INFORMATION {
+    ULONG TrimmedPages;
+    ULONG RefaultedPages;
+    ULONG TrimThrottles;
+} SYSTEM_WORKING_SET_TRIM_INFORMATION, *PSYSTEM_WORKING_SET_TRIM_INFORMATION;
+
+typedef struct _SYSTEM_MEMORY_COMPACTION_INFORMATION {
+    ULONG FragmentationIndex;
+    ULONG LargeBlocksAvailable;
+    ULONG CompactionAttempts;
+    ULONG CompactionSuccesses;
+    ULONG ProactiveCompactions;
+    ULONG PagesMigrated;
+    ULONG MigrationFailures;
+} SYSTEM_MEMORY_COMPACTION_INFORMATION, *PSYSTEM_MEMORY_COMPACTION_INFORMATION;
+
 typedef struct _SYSTEM_INTERRUPT_INFORMATION {
     ULONG ContextSwitches;
     ULONG DpcCount;
@@ -1918,6 +2071,25 @@ typedef struct _SYSTEM_LOOKASIDE_INFORMATION {
     ULONG Size;
 } SYSTEM_LOOKASIDE_INFORMATION, *PSYSTEM_LOOKASIDE_INFORMATION;
 
+//
+// Lookaside depth decisions made by the last periodic scan.
+//
+
+#define LOOKASIDE_DEPTH_HOLD 0
+#define LOOKASIDE_DEPTH_GROW 1
+#define LOOKASIDE_DEPTH_SHRINK 2
+#define LOOKASIDE_DEPTH_IDLE 3
+#define LOOKASIDE_DEPTH_PRESSURE 4
+#define LOOKASIDE_DEPTH_DISABLED 5
+
+typedef struct _SYSTEM_LOOKASIDE_INFORMATION_EX {
+    SYSTEM_LOOKASIDE_INFORMATION Information;
+    USHORT MissRatio;               // smoothed, in tenths of a percent
+    UCHAR Decision;                 // LOOKASIDE_DEPTH_xxx
+    UCHAR Spare;
+    ULONG MissRate;                 // allocate misses per second
+} SYSTEM_LOOKASIDE_INFORMATION_EX, *PSYSTEM_LOOKASIDE_INFORMATION_EX;
+
 typedef struct _SYSTEM_LEGACY_DRIVER_INFORMATION {
     ULONG VetoType;
     UNICODE_STRING VetoList;
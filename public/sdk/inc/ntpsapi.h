@@ -739,6 +739,23 @@ typedef struct _VM_COUNTERS_EX {
 } VM_COUNTERS_EX;
 typedef VM_COUNTERS_EX *PVM_COUNTERS_EX;
 
+typedef struct _VM_COUNTERS_EX2 {
+    SIZE_T PeakVirtualSize;
+    SIZE_T VirtualSize;
+    ULONG PageFaultCount;
+    SIZE_T PeakWorkingSetSize;
+    SIZE_T WorkingSetSize;
+    SIZE_T QuotaPeakPagedPoolUsage;
+    SIZE_T QuotaPagedPoolUsage;
+    SIZE_T QuotaPeakNonPagedPoolUsage;
+    SIZE_T QuotaNonPagedPoolUsage;
+    SIZE_T PagefileUsage;
+    SIZE_T PeakPagefileUsage;
+    SIZE_T PrivateUsage;
+    ULONG FaultAroundCount;
+} VM_COUNTERS_EX2;
+typedef VM_COUNTERS_EX2 *PVM_COUNTERS_EX2;
+
 //
 // Process Pooled Quota Usage and Limits
 //  NtQueryInformationProcess using ProcessPooledUsageAndLimits